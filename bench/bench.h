@@ -0,0 +1,151 @@
+/**
+ @file  bench.h
+ @brief Shared helpers for the rcenet_bench scenarios
+*/
+#ifndef RCENET_BENCH_H
+#define RCENET_BENCH_H
+
+#include <stddef.h>
+#include "rcenet/enet.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+typedef unsigned long long bench_ticks;
+
+/** A benchmark scenario, registered in the table of main.c. */
+typedef struct _BenchScenario
+{
+   const char * name;
+   const char * description;
+   int (* run) (void);
+} BenchScenario;
+
+/** Monotonic clock in nanoseconds, used where no cycle counter is available. */
+extern bench_ticks bench_ticks_fallback (void);
+
+/** Returns a monotonic tick count: the CPU cycle counter when one is readable from user space, nanoseconds otherwise. */
+static inline bench_ticks
+bench_ticks_now (void)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return (bench_ticks) __rdtsc ();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    return (bench_ticks) __rdtsc ();
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+    bench_ticks ticks;
+    __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (ticks));
+    return ticks;
+#else
+    return bench_ticks_fallback ();
+#endif
+}
+
+/** Reports one measurement of the running scenario. */
+extern void bench_report (const char * metric, double value, const char * unit);
+
+/** Number of enet_malloc calls made by the library since the program started. */
+extern size_t bench_allocations (void);
+
+/** Bytes currently allocated by the library, and the most ever allocated at once since the last bench_heap_reset_peak(). */
+extern size_t bench_heap_in_use (void);
+extern size_t bench_heap_peak (void);
+extern void   bench_heap_reset_peak (void);
+
+/** Creates a loopback server/client host pair and connects them.
+    @returns 0 on success, < 0 on failure
+*/
+extern int  bench_host_pair_create (size_t channelCount, ENetHost ** server, ENetHost ** client, ENetPeer ** serverPeer, ENetPeer ** clientPeer);
+extern void bench_host_pair_destroy (ENetHost * server, ENetHost * client);
+
+/** Services both hosts without blocking and hands every received packet to the callback, or destroys it if callback is NULL.
+    @returns the number of packets received, or < 0 on failure
+*/
+extern int  bench_host_pair_pump (ENetHost * server, ENetHost * client, void (* received) (ENetPeer *, enet_uint8, ENetPacket *, void *), void * userData);
+
+/** Creates a loopback server with clientCount client hosts connected to it.
+    @returns 0 on success, < 0 on failure
+*/
+extern int  bench_host_star_create (size_t clientCount, size_t channelCount, ENetHost ** server, ENetHost ** clients);
+extern void bench_host_star_destroy (ENetHost * server, ENetHost ** clients, size_t clientCount);
+
+#define BENCH_RELAY_SLOTS       8192
+#define BENCH_RELAY_BUFFER_SIZE (4 * 1024 * 1024)
+
+typedef struct _BenchRelayDatagram
+{
+   enet_uint32 deliverTime;
+   int toServer;
+   size_t dataLength;
+   enet_uint8 data [ENET_HOST_DEFAULT_MTU];
+} BenchRelayDatagram;
+
+/** A lossy, delaying UDP relay between one client and one server. While held is set it queues
+    the datagrams it receives without forwarding any, until bench_relay_release. */
+typedef struct _BenchRelay
+{
+   ENetSocket socket;
+   ENetAddress address;
+   ENetAddress serverAddress;
+   ENetAddress clientAddress;
+   enet_uint32 delay;
+   enet_uint32 lossPercent;
+   int held;
+   enet_uint32 seed;
+   size_t head;
+   size_t count;
+   BenchRelayDatagram queue [BENCH_RELAY_SLOTS];
+} BenchRelay;
+
+/** Creates a loopback server/client host pair that talk through relay, which delays every datagram
+    by delay microseconds each way, and connects them with both hosts limited to windowLimit
+    (see enet_host_window_limit, 0 for the default). The relay starts without loss.
+    @returns 0 on success, < 0 on failure
+*/
+extern int  bench_relay_pair_create (BenchRelay * relay, size_t channelCount, enet_uint32 delay, enet_uint32 windowLimit, ENetHost ** server, ENetHost ** client, ENetPeer ** clientPeer);
+extern void bench_relay_pair_destroy (BenchRelay * relay, ENetHost * server, ENetHost * client);
+
+/** Forwards the datagrams that are due and queues the newly received ones, dropping lossPercent % of them.
+    @returns 0 on success, < 0 on failure
+*/
+extern int  bench_relay_pump (BenchRelay * relay);
+
+/** Forwards every queued datagram now, in the order received or in reverse order.
+    @returns 0 on success, < 0 on failure
+*/
+extern int  bench_relay_release (BenchRelay * relay, int reversed);
+
+/** Services the server and every client without blocking, destroying any received packet.
+    @returns the number of packets received, or < 0 on failure
+*/
+extern int  bench_host_star_pump (ENetHost * server, ENetHost ** clients, size_t clientCount);
+
+#define BENCH_FAN_CLIENT_PEERS    4096
+#define BENCH_FAN_MAXIMUM_CLIENTS ((ENET_PROTOCOL_MAXIMUM_PEER_ID + BENCH_FAN_CLIENT_PEERS - 1) / BENCH_FAN_CLIENT_PEERS)
+#define BENCH_FAN_CONNECT_BATCH   1024
+#define BENCH_FAN_PING_INTERVAL   60000
+
+/** Connects peerCount peers to server from client hosts of up to BENCH_FAN_CLIENT_PEERS peers
+    each, stored in clients (BENCH_FAN_MAXIMUM_CLIENTS entries at most), so that the bandwidth
+    limits every host sends to all of its peers while connections keep arriving fit in the socket
+    buffers. The peers ping every BENCH_FAN_PING_INTERVAL ms instead of every 500 ms. Every
+    connection makes both hosts scan all of their peers, so connecting grows with the square of
+    the peer count; it succeeds once 99% of the peers are connected, as the few handshakes lost
+    to full socket buffers would otherwise only be retried after a ping timeout.
+    @returns 0 on success, < 0 on failure
+*/
+extern int  bench_host_fan_connect (ENetHost * server, size_t peerCount, ENetHost ** clients, size_t * clientCount);
+
+/** Services the server, then every client, without blocking, destroying any received packet.
+    @returns 0 on success, < 0 on failure
+*/
+extern int  bench_host_fan_pump (ENetHost * server, ENetHost ** clients, size_t clientCount);
+extern void bench_host_fan_destroy (ENetHost ** clients, size_t clientCount);
+
+/** Resident memory of the process in bytes, or 0 where it cannot be read. */
+extern size_t bench_resident_memory (void);
+
+#endif /* RCENET_BENCH_H */
@@ -0,0 +1,143 @@
+/**
+ @file  bench_acks.c
+ @brief Cost of processing acknowledgements against the number of reliable commands in flight
+
+ The client sends a burst of 16-byte reliable packets through a relay that holds every datagram.
+ Once the server has received them all and its acknowledgements are held by the relay too, the
+ acknowledgements are released at once, in sending order or in reverse order, and the time the
+ client takes to process them is divided by their number. The client runs with the default fast
+ retransmit threshold, so that acknowledgements in reverse order also pay for the retransmissions
+ they trigger, and again with fast retransmit disabled, which measures the lookup of the
+ acknowledged commands alone. The burst stops at 8191 commands, the most the reliable windows
+ let a channel have in flight.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define ACKS_PACKET_SIZE 16
+
+static int
+acks_run (size_t inFlight, int reversed, int fastRetransmit)
+{
+    static BenchRelay relay;
+    ENetHost * server, * client;
+    ENetPeer * clientPeer;
+    enet_uint8 payload [ACKS_PACKET_SIZE];
+    size_t received = 0, packet;
+    enet_uint32 deadline;
+    bench_ticks elapsed;
+    char metric [64];
+    int result = 0, count;
+
+    memset (payload, 0x3C, sizeof (payload));
+
+    if (bench_relay_pair_create (& relay, 1, 0, ENET_PROTOCOL_MAXIMUM_SCALED_WINDOW_SIZE, & server, & client, & clientPeer) < 0)
+      return -1;
+
+    if (! fastRetransmit)
+      enet_peer_set_fast_retransmit (clientPeer, 0);
+    relay.held = 1;
+
+    for (packet = 0; packet < inFlight; ++ packet)
+      if (enet_peer_send (clientPeer, 0, enet_packet_create (payload, sizeof (payload), ENET_PACKET_FLAG_RELIABLE)) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    deadline = enet_time_get () + 5000;
+    while (enet_list_size (& clientPeer -> sentReliableCommands) < inFlight && ENET_TIME_LESS (enet_time_get (), deadline))
+      if (bench_relay_pump (& relay) < 0 ||
+          bench_host_pair_pump (server, client, NULL, NULL) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    if (bench_relay_pump (& relay) < 0 ||
+        bench_relay_release (& relay, 0) < 0)
+    {
+        result = -1;
+        goto done;
+    }
+
+    while (received < inFlight && ENET_TIME_LESS (enet_time_get (), deadline))
+    {
+        if (bench_relay_pump (& relay) < 0 ||
+            (count = bench_host_pair_pump (server, client, NULL, NULL)) < 0)
+        {
+            result = -1;
+            goto done;
+        }
+
+        received += (size_t) count;
+    }
+
+    /* Let the last acknowledgements reach the relay. */
+    enet_host_flush (server);
+    if (bench_relay_pump (& relay) < 0)
+    {
+        result = -1;
+        goto done;
+    }
+
+    if (received < inFlight)
+    {
+        fprintf (stderr, "%u in flight: only %u of them delivered\n", (unsigned) inFlight, (unsigned) received);
+        result = -1;
+        goto done;
+    }
+
+    elapsed = bench_ticks_fallback ();
+
+    if (bench_relay_release (& relay, reversed) < 0)
+    {
+        result = -1;
+        goto done;
+    }
+
+    /* Commands queued again by fast retransmit are done once their original is acknowledged. */
+    while ((! enet_list_empty (& clientPeer -> sentReliableCommands) || ! enet_list_empty (& clientPeer -> outgoingSendReliableCommands)) &&
+           ENET_TIME_LESS (enet_time_get (), deadline))
+      if (enet_host_service (client, NULL, 0) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    elapsed = bench_ticks_fallback () - elapsed;
+
+    if (! enet_list_empty (& clientPeer -> sentReliableCommands) || ! enet_list_empty (& clientPeer -> outgoingSendReliableCommands))
+    {
+        fprintf (stderr, "%u in flight: %u left unacknowledged\n", (unsigned) inFlight,
+                 (unsigned) (enet_list_size (& clientPeer -> sentReliableCommands) + enet_list_size (& clientPeer -> outgoingSendReliableCommands)));
+        result = -1;
+        goto done;
+    }
+
+    sprintf (metric, "%s%s.in_flight%u.per_ack", fastRetransmit ? "" : "no_fast_retransmit.", reversed ? "reversed" : "in_order", (unsigned) inFlight);
+    bench_report (metric, (double) elapsed / inFlight, "ns");
+
+done:
+    bench_relay_pair_destroy (& relay, server, client);
+    return result;
+}
+
+int
+bench_acks (void)
+{
+    static const size_t inFlights [] = { 256, 1024, 4096, 8191 };
+    size_t i;
+    int fastRetransmit;
+
+    for (fastRetransmit = 1; fastRetransmit >= 0; -- fastRetransmit)
+      for (i = 0; i < sizeof (inFlights) / sizeof (inFlights [0]); ++ i)
+        if (acks_run (inFlights [i], 0, fastRetransmit) < 0 ||
+            acks_run (inFlights [i], 1, fastRetransmit) < 0)
+          return -1;
+
+    return 0;
+}
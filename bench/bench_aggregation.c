@@ -0,0 +1,145 @@
+/**
+ @file  bench_aggregation.c
+ @brief Datagram count and header overhead of many tiny messages, with and without channel aggregation
+
+ Every tick the client sends a burst of 20-byte messages and flushes once, as a game client
+ sending inputs and small events would. Without aggregation each message costs a SEND command
+ header and one of the ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS slots of a datagram; with
+ enet_peer_set_channel_aggregation the burst is packed into MTU-sized SEND commands.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define AGGREGATION_TICKS        200
+#define AGGREGATION_MESSAGES     200
+#define AGGREGATION_MESSAGE_SIZE 20
+
+typedef struct _AggregationReceived
+{
+   size_t messages;
+   size_t malformed;
+} AggregationReceived;
+
+static void
+aggregation_received (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet, void * userData)
+{
+    AggregationReceived * received = (AggregationReceived *) userData;
+
+    (void) peer;
+    (void) channelID;
+
+    if (packet -> dataLength == AGGREGATION_MESSAGE_SIZE && packet -> data [1] == 0x33)
+      ++ received -> messages;
+    else
+      ++ received -> malformed;
+
+    enet_packet_destroy (packet);
+}
+
+static int
+aggregation_run (const char * label, enet_uint32 packetFlags, int aggregation)
+{
+    ENetHost * server, * client;
+    ENetPeer * serverPeer, * clientPeer;
+    AggregationReceived received;
+    enet_uint8 payload [AGGREGATION_MESSAGE_SIZE];
+    enet_uint32 sentPackets, sentData;
+    bench_ticks elapsed;
+    size_t tick, message, expected = 0;
+    char metric [64];
+    int result = 0;
+
+    memset (payload, 0x33, sizeof (payload));
+    memset (& received, 0, sizeof (received));
+
+    if (bench_host_pair_create (1, & server, & client, & serverPeer, & clientPeer) < 0)
+      return -1;
+
+    if (aggregation && enet_peer_set_channel_aggregation (clientPeer, 0, 1, 0) < 0)
+    {
+        result = -1;
+        goto done;
+    }
+
+    sentPackets = client -> totalSentPackets;
+    sentData = client -> totalSentData;
+    elapsed = bench_ticks_fallback ();
+
+    for (tick = 0; tick < AGGREGATION_TICKS; ++ tick)
+    {
+        enet_uint32 deadline;
+
+        for (message = 0; message < AGGREGATION_MESSAGES; ++ message)
+        {
+            payload [0] = (enet_uint8) message;
+
+            if (enet_peer_send (clientPeer, 0, enet_packet_create (payload, sizeof (payload), packetFlags)) < 0)
+            {
+                result = -1;
+                goto done;
+            }
+        }
+
+        expected += AGGREGATION_MESSAGES;
+        enet_host_flush (client);
+
+        /* Unreliable messages may be throttled, so only wait a bounded time for them. */
+        deadline = enet_time_get () + (packetFlags & ENET_PACKET_FLAG_RELIABLE ? 5000 : 50);
+        while (received.messages + received.malformed < expected && ENET_TIME_LESS (enet_time_get (), deadline))
+          if (bench_host_pair_pump (server, client, aggregation_received, & received) < 0)
+          {
+              result = -1;
+              goto done;
+          }
+
+        if (packetFlags & ENET_PACKET_FLAG_RELIABLE && received.messages < expected)
+        {
+            fprintf (stderr, "%s: only %u of %u messages delivered\n", label, (unsigned) received.messages, (unsigned) expected);
+            result = -1;
+            goto done;
+        }
+
+        /* Realign on the next tick in case unreliable messages were lost. */
+        received.messages = expected;
+    }
+
+    elapsed = bench_ticks_fallback () - elapsed;
+    sentPackets = client -> totalSentPackets - sentPackets;
+    sentData = client -> totalSentData - sentData;
+
+    if (received.malformed > 0)
+    {
+        fprintf (stderr, "%s: %u malformed messages\n", label, (unsigned) received.malformed);
+        result = -1;
+        goto done;
+    }
+
+    sprintf (metric, "%s.datagrams_per_tick", label);
+    bench_report (metric, (double) sentPackets / AGGREGATION_TICKS, "datagrams");
+    sprintf (metric, "%s.datagrams_per_sec", label);
+    bench_report (metric, elapsed > 0 ? (double) sentPackets * 1e9 / elapsed : 0.0, "datagrams/s");
+    sprintf (metric, "%s.messages_per_sec", label);
+    bench_report (metric, elapsed > 0 ? (double) expected * 1e9 / elapsed : 0.0, "messages/s");
+    sprintf (metric, "%s.wire_bytes_per_message", label);
+    bench_report (metric, (double) sentData / expected, "bytes");
+    sprintf (metric, "%s.header_overhead", label);
+    bench_report (metric, sentData > 0 ? 100.0 * (sentData - (double) expected * AGGREGATION_MESSAGE_SIZE) / sentData : 0.0, "%");
+
+done:
+    bench_host_pair_destroy (server, client);
+    return result;
+}
+
+int
+bench_aggregation (void)
+{
+    if (aggregation_run ("reliable", ENET_PACKET_FLAG_RELIABLE, 0) < 0 ||
+        aggregation_run ("reliable_aggregated", ENET_PACKET_FLAG_RELIABLE, 1) < 0 ||
+        aggregation_run ("unreliable", 0, 0) < 0 ||
+        aggregation_run ("unreliable_aggregated", 0, 1) < 0)
+      return -1;
+
+    return 0;
+}
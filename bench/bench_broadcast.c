@@ -0,0 +1,196 @@
+/**
+ @file  bench_broadcast.c
+ @brief Cost of queueing one packet to many peers
+
+ "broadcast" compares enet_host_broadcast (serialize-once fragment table, pooled commands, connected
+ peer list) with the equivalent loop of enet_peer_send calls, and an interest-managed broadcast that
+ only selects one peer in four through enet_host_broadcast_filtered.
+
+ "multicast" sends area-of-interest updates to explicit lists of 50 to 200 peers, comparing
+ enet_host_send_to_peers with a loop of enet_peer_send calls over the same list.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "bench.h"
+
+#define BROADCAST_PEERS       256
+#define BROADCAST_ITERATIONS  200
+#define BROADCAST_PACKET_SIZE 4096
+#define MULTICAST_ITERATIONS  500
+
+typedef enum _BroadcastMode
+{
+   BROADCAST_MODE_HOST,
+   BROADCAST_MODE_PEER_LOOP,
+   BROADCAST_MODE_FILTERED
+} BroadcastMode;
+
+static int ENET_CALLBACK
+broadcast_filter (ENetPeer * peer, void * context)
+{
+    (void) context;
+
+    return (peer -> incomingPeerID & 3) == 0;
+}
+
+static void
+broadcast_queue (ENetHost * server, ENetPacket * packet, BroadcastMode mode)
+{
+    ENetPeer * peer;
+
+    switch (mode)
+    {
+    case BROADCAST_MODE_HOST:
+        enet_host_broadcast (server, 0, packet);
+        break;
+
+    case BROADCAST_MODE_FILTERED:
+        enet_host_broadcast_filtered (server, 0, packet, broadcast_filter, NULL);
+        break;
+
+    case BROADCAST_MODE_PEER_LOOP:
+        for (peer = server -> peers; peer < & server -> peers [server -> committedPeers]; ++ peer)
+          if (peer -> state == ENET_PEER_STATE_CONNECTED)
+            enet_peer_send (peer, 0, packet);
+
+        if (packet -> referenceCount == 0)
+          enet_packet_destroy (packet);
+        break;
+    }
+}
+
+static int
+broadcast_run (const char * label, ENetHost * server, ENetHost ** clients, BroadcastMode mode)
+{
+    enet_uint8 payload [BROADCAST_PACKET_SIZE];
+    bench_ticks ticks = 0;
+    size_t allocations = 0, iteration;
+    char metric [64];
+
+    memset (payload, 0x5A, sizeof (payload));
+
+    for (iteration = 0; iteration < BROADCAST_ITERATIONS; ++ iteration)
+    {
+        ENetPacket * packet = enet_packet_create (payload, sizeof (payload), ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
+        size_t allocationsBefore;
+        bench_ticks start;
+
+        if (packet == NULL)
+          return -1;
+
+        allocationsBefore = bench_allocations ();
+        start = bench_ticks_now ();
+        broadcast_queue (server, packet, mode);
+        ticks += bench_ticks_now () - start;
+        allocations += bench_allocations () - allocationsBefore;
+
+        enet_host_flush (server);
+        if (bench_host_star_pump (server, clients, BROADCAST_PEERS) < 0)
+          return -1;
+    }
+
+    sprintf (metric, "%s.queue", label);
+    bench_report (metric, (double) ticks / BROADCAST_ITERATIONS, "ticks/call");
+    sprintf (metric, "%s.queue_per_peer", label);
+    bench_report (metric, (double) ticks / BROADCAST_ITERATIONS / (mode == BROADCAST_MODE_FILTERED ? BROADCAST_PEERS / 4 : BROADCAST_PEERS), "ticks/peer");
+    sprintf (metric, "%s.allocations", label);
+    bench_report (metric, (double) allocations / BROADCAST_ITERATIONS, "allocs/call");
+
+    return 0;
+}
+
+int
+bench_broadcast (void)
+{
+    ENetHost * server, * clients [BROADCAST_PEERS];
+    int result = 0;
+
+    if (bench_host_star_create (BROADCAST_PEERS, 1, & server, clients) < 0)
+      return -1;
+
+    if (broadcast_run ("peer_send_loop", server, clients, BROADCAST_MODE_PEER_LOOP) < 0 ||
+        broadcast_run ("host_broadcast", server, clients, BROADCAST_MODE_HOST) < 0 ||
+        broadcast_run ("host_broadcast_filtered", server, clients, BROADCAST_MODE_FILTERED) < 0)
+      result = -1;
+
+    bench_host_star_destroy (server, clients, BROADCAST_PEERS);
+    return result;
+}
+
+static int
+multicast_run (ENetHost * server, ENetHost ** clients, size_t peerCount, size_t packetSize, int useSendToPeers)
+{
+    ENetPeer * peers [BROADCAST_PEERS];
+    enet_uint8 payload [BROADCAST_PACKET_SIZE];
+    enet_uint32 seed = 0x12345678;
+    bench_ticks ticks = 0;
+    size_t allocations = 0, iteration, i;
+    char metric [64];
+
+    memset (payload, 0xA5, sizeof (payload));
+
+    for (iteration = 0; iteration < MULTICAST_ITERATIONS; ++ iteration)
+    {
+        ENetPacket * packet = enet_packet_create (payload, packetSize, packetSize > 1024 ? ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT : 0);
+        size_t allocationsBefore;
+        bench_ticks start;
+
+        if (packet == NULL)
+          return -1;
+
+        /* A different random area of interest every tick. */
+        for (i = 0; i < peerCount; ++ i)
+        {
+            seed = seed * 1664525 + 1013904223;
+            peers [i] = & server -> peers [(seed >> 8) % server -> committedPeers];
+        }
+
+        allocationsBefore = bench_allocations ();
+        start = bench_ticks_now ();
+        if (useSendToPeers)
+          enet_host_send_to_peers (server, 0, packet, peers, peerCount);
+        else
+        {
+            for (i = 0; i < peerCount; ++ i)
+              enet_peer_send (peers [i], 0, packet);
+
+            if (packet -> referenceCount == 0)
+              enet_packet_destroy (packet);
+        }
+        ticks += bench_ticks_now () - start;
+        allocations += bench_allocations () - allocationsBefore;
+
+        enet_host_flush (server);
+        if (bench_host_star_pump (server, clients, BROADCAST_PEERS) < 0)
+          return -1;
+    }
+
+    sprintf (metric, "%s.%ub.%upeers.queue", useSendToPeers ? "send_to_peers" : "peer_send_loop", (unsigned) packetSize, (unsigned) peerCount);
+    bench_report (metric, (double) ticks / MULTICAST_ITERATIONS, "ticks/call");
+    sprintf (metric, "%s.%ub.%upeers.allocations", useSendToPeers ? "send_to_peers" : "peer_send_loop", (unsigned) packetSize, (unsigned) peerCount);
+    bench_report (metric, (double) allocations / MULTICAST_ITERATIONS, "allocs/call");
+
+    return 0;
+}
+
+int
+bench_multicast (void)
+{
+    static const size_t peerCounts [] = { 50, 100, 200 };
+    static const size_t packetSizes [] = { 256, 4096 };
+    ENetHost * server, * clients [BROADCAST_PEERS];
+    size_t i, j;
+    int result = 0;
+
+    if (bench_host_star_create (BROADCAST_PEERS, 1, & server, clients) < 0)
+      return -1;
+
+    for (i = 0; i < sizeof (packetSizes) / sizeof (packetSizes [0]) && result == 0; ++ i)
+      for (j = 0; j < sizeof (peerCounts) / sizeof (peerCounts [0]) && result == 0; ++ j)
+        if (multicast_run (server, clients, peerCounts [j], packetSizes [i], 0) < 0 ||
+            multicast_run (server, clients, peerCounts [j], packetSizes [i], 1) < 0)
+          result = -1;
+
+    bench_host_star_destroy (server, clients, BROADCAST_PEERS);
+    return result;
+}
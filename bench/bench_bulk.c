@@ -0,0 +1,175 @@
+/**
+ @file  bench_bulk.c
+ @brief Throughput of multi-megabyte reliable transfers, reassembled into ENet packets or in place
+
+ The client sends a series of large reliable packets on one channel. In the heap mode the server
+ receives them in packets allocated by ENet and copies each one to its final location, as an
+ application writing a file would. In the direct mode a reassembly callback hands ENet a packet
+ over that final location, so the fragments land there and nothing is copied after delivery.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define BULK_PACKETS     8
+#define BULK_PACKET_SIZE (4 * 1024 * 1024)
+
+typedef struct _BulkReceived
+{
+   enet_uint8 * destination;
+   size_t packets;
+   size_t copiedBytes;
+   size_t reassembled;
+} BulkReceived;
+
+static BulkReceived * bulkReassemblyTarget = NULL;
+
+static ENetPacket * ENET_CALLBACK
+bulk_reassembly (ENetPeer * peer, enet_uint8 channelID, size_t totalLength, enet_uint32 flags)
+{
+    enet_uint8 * slot;
+
+    (void) peer;
+    (void) channelID;
+
+    if (bulkReassemblyTarget == NULL || totalLength != BULK_PACKET_SIZE || bulkReassemblyTarget -> reassembled >= BULK_PACKETS)
+      return NULL;
+
+    /* The packets of a reliable channel start arriving in order, so each one gets the next slot. */
+    slot = bulkReassemblyTarget -> destination + bulkReassemblyTarget -> reassembled * BULK_PACKET_SIZE;
+    ++ bulkReassemblyTarget -> reassembled;
+
+    return enet_packet_create (slot, totalLength, flags | ENET_PACKET_FLAG_NO_ALLOCATE);
+}
+
+static void
+bulk_received (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet, void * userData)
+{
+    BulkReceived * received = (BulkReceived *) userData;
+    enet_uint8 * slot = received -> destination + received -> packets * BULK_PACKET_SIZE;
+
+    (void) peer;
+    (void) channelID;
+
+    if (received -> packets < BULK_PACKETS && packet -> dataLength == BULK_PACKET_SIZE)
+    {
+        if (packet -> data != slot)
+        {
+            memcpy (slot, packet -> data, packet -> dataLength);
+            received -> copiedBytes += packet -> dataLength;
+        }
+
+        ++ received -> packets;
+    }
+
+    enet_packet_destroy (packet);
+}
+
+static int
+bulk_run (const char * label, int direct)
+{
+    static BulkReceived received;
+    ENetHost * server, * client;
+    ENetPeer * serverPeer, * clientPeer;
+    enet_uint8 * payload = NULL;
+    size_t allocations, packet, i;
+    enet_uint32 deadline;
+    bench_ticks elapsed;
+    char metric [64];
+    int result = 0;
+
+    memset (& received, 0, sizeof (received));
+
+    if (bench_host_pair_create (1, & server, & client, & serverPeer, & clientPeer) < 0)
+      return -1;
+
+    payload = (enet_uint8 *) malloc (BULK_PACKET_SIZE);
+    received.destination = (enet_uint8 *) malloc (BULK_PACKETS * BULK_PACKET_SIZE);
+    if (payload == NULL || received.destination == NULL)
+    {
+        result = -1;
+        goto done;
+    }
+
+    for (i = 0; i < BULK_PACKET_SIZE; ++ i)
+      payload [i] = (enet_uint8) (i * 7 + (i >> 12));
+
+    /* Touch the destination so that both modes start with resident pages. */
+    memset (received.destination, 0, BULK_PACKETS * BULK_PACKET_SIZE);
+
+    if (direct)
+    {
+        bulkReassemblyTarget = & received;
+        enet_host_set_reassembly_callback (server, bulk_reassembly);
+    }
+
+    allocations = bench_allocations ();
+    elapsed = bench_ticks_fallback ();
+
+    for (packet = 0; packet < BULK_PACKETS; ++ packet)
+    {
+        payload [0] = (enet_uint8) packet;
+
+        if (enet_peer_send (clientPeer, 0, enet_packet_create (payload, BULK_PACKET_SIZE, ENET_PACKET_FLAG_RELIABLE)) < 0)
+        {
+            result = -1;
+            goto done;
+        }
+    }
+
+    deadline = enet_time_get () + 60000;
+    while (received.packets < BULK_PACKETS && ENET_TIME_LESS (enet_time_get (), deadline))
+      if (bench_host_pair_pump (server, client, bulk_received, & received) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    elapsed = bench_ticks_fallback () - elapsed;
+    allocations = bench_allocations () - allocations;
+
+    if (received.packets < BULK_PACKETS)
+    {
+        fprintf (stderr, "%s: only %u of %u packets delivered\n", label, (unsigned) received.packets, (unsigned) BULK_PACKETS);
+        result = -1;
+        goto done;
+    }
+
+    for (packet = 0; packet < BULK_PACKETS; ++ packet)
+    {
+        payload [0] = (enet_uint8) packet;
+
+        if (memcmp (received.destination + packet * BULK_PACKET_SIZE, payload, BULK_PACKET_SIZE) != 0)
+        {
+            fprintf (stderr, "%s: packet %u corrupted\n", label, (unsigned) packet);
+            result = -1;
+            goto done;
+        }
+    }
+
+    sprintf (metric, "%s.throughput", label);
+    bench_report (metric, elapsed > 0 ? (double) BULK_PACKETS * BULK_PACKET_SIZE / (1024.0 * 1024.0) * 1e9 / elapsed : 0.0, "MB/s");
+    sprintf (metric, "%s.application_copied", label);
+    bench_report (metric, (double) received.copiedBytes / (1024.0 * 1024.0), "MB");
+    sprintf (metric, "%s.allocations_per_packet", label);
+    bench_report (metric, (double) allocations / BULK_PACKETS, "allocations");
+
+done:
+    bulkReassemblyTarget = NULL;
+    bench_host_pair_destroy (server, client);
+    free (received.destination);
+    free (payload);
+    return result;
+}
+
+int
+bench_bulk (void)
+{
+    if (bulk_run ("heap", 0) < 0 ||
+        bulk_run ("direct", 1) < 0)
+      return -1;
+
+    return 0;
+}
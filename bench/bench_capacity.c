@@ -0,0 +1,95 @@
+/**
+ @file  bench_capacity.c
+ @brief Resident memory of a host created for the largest number of peers, against the peers actually connected
+
+ A server is created for ENET_PROTOCOL_MAXIMUM_PEER_ID peers, then 1000 and 10000 peers are
+ connected to it with bench_host_fan_connect and disconnected again. The resident memory of the
+ process is reported after creating the server, with the peers connected, which covers both ends
+ of every connection, and once the server has released the peers left unused for its release
+ timeout. Resident memory is read from the system, so the figures also include whatever the C
+ library keeps of the memory freed in between.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define CAPACITY_RELEASE_TIMEOUT 1000
+
+static int
+capacity_run (ENetHost * server, size_t peerCount, size_t baseline)
+{
+    ENetHost * clients [BENCH_FAN_MAXIMUM_CLIENTS];
+    size_t clientCount, connected;
+    enet_uint32 deadline;
+    char metric [64];
+    int result = 0;
+
+    if (bench_host_fan_connect (server, peerCount, clients, & clientCount) < 0)
+      return -1;
+
+    connected = server -> connectedPeers;
+
+    sprintf (metric, "peers%u.rss", (unsigned) peerCount);
+    bench_report (metric, (double) (bench_resident_memory () - baseline) / (1024.0 * 1024.0), "MB");
+    sprintf (metric, "peers%u.rss_per_connection", (unsigned) peerCount);
+    bench_report (metric, (double) (bench_resident_memory () - baseline) / connected, "B");
+
+    while (server -> connectedPeers > 0)
+      enet_peer_disconnect_now (server -> connectedPeerList [0], 0);
+
+    bench_host_fan_destroy (clients, clientCount);
+
+    /* The unused peers are released by enet_host_service once they stayed unused for the timeout. */
+    deadline = enet_time_get () + CAPACITY_RELEASE_TIMEOUT + 2 * ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL;
+    while (ENET_TIME_LESS (enet_time_get (), deadline))
+      if (bench_host_fan_pump (server, NULL, 0) < 0)
+      {
+          result = -1;
+          break;
+      }
+
+    sprintf (metric, "peers%u.released.rss", (unsigned) peerCount);
+    bench_report (metric, (double) (bench_resident_memory () - baseline) / (1024.0 * 1024.0), "MB");
+
+    return result;
+}
+
+int
+bench_capacity (void)
+{
+    static const size_t peerCounts [] = { 1000, 10000 };
+    ENetHost * server;
+    ENetAddress address;
+    size_t baseline, i;
+    int result = 0;
+
+    if (bench_resident_memory () == 0)
+    {
+        fprintf (stderr, "resident memory cannot be read on this system\n");
+        return -1;
+    }
+
+    enet_address_build_loopback (& address, ENET_ADDRESS_TYPE_IPV4);
+
+    baseline = bench_resident_memory ();
+
+    server = enet_host_create (ENET_ADDRESS_TYPE_IPV4, & address, ENET_PROTOCOL_MAXIMUM_PEER_ID, 1, 0, 0);
+    if (server == NULL)
+      return -1;
+
+    enet_host_set_peer_release_timeout (server, CAPACITY_RELEASE_TIMEOUT);
+
+    bench_report ("created.rss", (double) (bench_resident_memory () - baseline) / (1024.0 * 1024.0), "MB");
+
+    for (i = 0; i < sizeof (peerCounts) / sizeof (peerCounts [0]); ++ i)
+      if (capacity_run (server, peerCounts [i], baseline) < 0)
+      {
+          result = -1;
+          break;
+      }
+
+    enet_host_destroy (server);
+    return result;
+}
@@ -0,0 +1,151 @@
+/**
+ @file  bench_churn.c
+ @brief Allocator calls and resident memory growth over an hour of simulated connection churn
+
+ A client host keeps 128 sessions connected to a server, each with a random number of channels
+ up to the channel limit of both hosts. Every simulated second, 4 random sessions disconnect and
+ 4 new ones connect, then every session sends the server one reliable packet of random size so
+ that packet buffers are allocated between the connection-scoped ones. 3600 simulated seconds
+ are run as fast as the loopback allows. After the first simulated minute, the enet_malloc calls
+ made while sessions connect and disconnect are counted per session, and the growth of the
+ resident memory of the process is reported at the end.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define CHURN_ONLINE              128
+#define CHURN_CHANNELS            8
+#define CHURN_SESSIONS_PER_SECOND 4
+#define CHURN_SECONDS             3600
+#define CHURN_WARMUP_SECONDS      60
+#define CHURN_MAXIMUM_PACKET_SIZE 1200
+
+static enet_uint32
+churn_random (enet_uint32 * seed)
+{
+    * seed = * seed * 1664525 + 1013904223;
+
+    return * seed >> 8;
+}
+
+/** Services both hosts until every session is connected on both ends and the server received packetCount packets. */
+static int
+churn_settle (ENetHost * server, ENetHost * client, ENetPeer ** sessions, size_t sessionCount, size_t packetCount)
+{
+    enet_uint32 deadline = enet_time_get () + 5000;
+    size_t received = 0, connected;
+    int count;
+
+    do
+    {
+        if ((count = bench_host_pair_pump (server, client, NULL, NULL)) < 0)
+          return -1;
+
+        received += (size_t) count;
+
+        for (connected = 0; connected < sessionCount; ++ connected)
+          if (sessions [connected] -> state != ENET_PEER_STATE_CONNECTED)
+            break;
+
+        if (connected >= sessionCount && server -> connectedPeers == sessionCount && received >= packetCount)
+          return 0;
+    }
+    while (ENET_TIME_LESS (enet_time_get (), deadline));
+
+    fprintf (stderr, "%u of %u sessions connected, %u of %u packets received\n",
+             (unsigned) server -> connectedPeers, (unsigned) sessionCount, (unsigned) received, (unsigned) packetCount);
+    return -1;
+}
+
+int
+bench_churn (void)
+{
+    ENetHost * server, * client;
+    ENetPeer * sessions [CHURN_ONLINE];
+    ENetAddress address;
+    enet_uint8 payload [CHURN_MAXIMUM_PACKET_SIZE];
+    enet_uint32 seed = 0x2545F491;
+    size_t sessionCount = 0, sessionsMeasured = 0, allocations = 0, residentMemory = 0, second, i;
+    int result = 0;
+
+    memset (payload, 0x5A, sizeof (payload));
+
+    enet_address_build_loopback (& address, ENET_ADDRESS_TYPE_IPV4);
+
+    server = enet_host_create (ENET_ADDRESS_TYPE_IPV4, & address, CHURN_ONLINE + CHURN_SESSIONS_PER_SECOND, CHURN_CHANNELS, 0, 0);
+    client = enet_host_create (ENET_ADDRESS_TYPE_IPV4, NULL, CHURN_ONLINE + CHURN_SESSIONS_PER_SECOND, CHURN_CHANNELS, 0, 0);
+    if (server == NULL || client == NULL)
+    {
+        result = -1;
+        goto done;
+    }
+
+    for (second = 0; second < CHURN_SECONDS; ++ second)
+    {
+        size_t allocationsBefore = bench_allocations (), connected;
+
+        if (second == CHURN_WARMUP_SECONDS)
+          residentMemory = bench_resident_memory ();
+
+        for (i = 0; i < CHURN_SESSIONS_PER_SECOND && sessionCount + CHURN_SESSIONS_PER_SECOND > CHURN_ONLINE; ++ i)
+        {
+            size_t session = churn_random (& seed) % sessionCount;
+
+            enet_peer_disconnect_now (sessions [session], 0);
+            sessions [session] = sessions [-- sessionCount];
+        }
+
+        for (connected = 0; connected < CHURN_SESSIONS_PER_SECOND && sessionCount < CHURN_ONLINE; ++ connected)
+        {
+            sessions [sessionCount] = enet_host_connect (client, & server -> address, 1 + churn_random (& seed) % CHURN_CHANNELS, 0);
+            if (sessions [sessionCount] == NULL)
+            {
+                result = -1;
+                goto done;
+            }
+
+            ++ sessionCount;
+        }
+
+        if (churn_settle (server, client, sessions, sessionCount, 0) < 0)
+        {
+            result = -1;
+            goto done;
+        }
+
+        if (second >= CHURN_WARMUP_SECONDS)
+        {
+            allocations += bench_allocations () - allocationsBefore;
+            sessionsMeasured += connected;
+        }
+
+        for (i = 0; i < sessionCount; ++ i)
+        {
+            size_t packetSize = 16 + churn_random (& seed) % (CHURN_MAXIMUM_PACKET_SIZE - 16);
+
+            if (enet_peer_send (sessions [i], (enet_uint8) (churn_random (& seed) % sessions [i] -> channelCount),
+                                enet_packet_create (payload, packetSize, ENET_PACKET_FLAG_RELIABLE)) < 0)
+            {
+                result = -1;
+                goto done;
+            }
+        }
+
+        if (churn_settle (server, client, sessions, sessionCount, sessionCount) < 0)
+        {
+            result = -1;
+            goto done;
+        }
+    }
+
+    bench_report ("sessions", (double) sessionsMeasured, "sessions");
+    bench_report ("allocations_per_session", (double) allocations / sessionsMeasured, "calls");
+    bench_report ("rss_growth", ((double) bench_resident_memory () - (double) residentMemory) / 1024.0, "KB");
+
+done:
+    bench_host_pair_destroy (server, client);
+    return result;
+}
@@ -0,0 +1,131 @@
+/**
+ @file  bench_coalescing.c
+ @brief Datagram fill and added latency of per-peer send coalescing
+
+ The client sends a small reliable message every 20 microseconds and calls enet_host_flush after
+ each one, the pattern that produces one tiny datagram per message. With enet_peer_set_coalescing
+ the commands are held until the datagram is nearly full or the deadline passes.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define COALESCING_MESSAGES     5000
+#define COALESCING_MESSAGE_SIZE 40
+#define COALESCING_INTERVAL_US  20
+
+typedef struct _CoalescingReceived
+{
+   size_t messages;
+   double latency;
+} CoalescingReceived;
+
+static void
+coalescing_received (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet, void * userData)
+{
+    CoalescingReceived * received = (CoalescingReceived *) userData;
+    enet_uint32 sentTime;
+
+    (void) peer;
+    (void) channelID;
+
+    memcpy (& sentTime, packet -> data, sizeof (sentTime));
+    received -> latency += (double) (enet_uint32) (enet_time_get_us () - sentTime);
+    ++ received -> messages;
+
+    enet_packet_destroy (packet);
+}
+
+static int
+coalescing_run (const char * label, enet_uint32 timeout)
+{
+    ENetHost * server, * client;
+    ENetPeer * serverPeer, * clientPeer;
+    CoalescingReceived received;
+    enet_uint8 payload [COALESCING_MESSAGE_SIZE];
+    enet_uint32 sentPackets, sentData, deadline;
+    size_t message;
+    char metric [64];
+    int result = 0;
+
+    memset (payload, 0x44, sizeof (payload));
+    memset (& received, 0, sizeof (received));
+
+    if (bench_host_pair_create (1, & server, & client, & serverPeer, & clientPeer) < 0)
+      return -1;
+
+    enet_peer_set_coalescing (clientPeer, timeout);
+
+    sentPackets = client -> totalSentPackets;
+    sentData = client -> totalSentData;
+
+    for (message = 0; message < COALESCING_MESSAGES; ++ message)
+    {
+        enet_uint32 sentTime = enet_time_get_us ();
+
+        memcpy (payload, & sentTime, sizeof (sentTime));
+
+        if (enet_peer_send (clientPeer, 0, enet_packet_create (payload, sizeof (payload), ENET_PACKET_FLAG_RELIABLE)) < 0)
+        {
+            result = -1;
+            goto done;
+        }
+
+        enet_host_flush (client);
+
+        if (bench_host_pair_pump (server, client, coalescing_received, & received) < 0)
+        {
+            result = -1;
+            goto done;
+        }
+
+        while ((enet_uint32) (enet_time_get_us () - sentTime) < COALESCING_INTERVAL_US);
+    }
+
+    enet_peer_flush (clientPeer);
+
+    deadline = enet_time_get () + 5000;
+    while (received.messages < COALESCING_MESSAGES && ENET_TIME_LESS (enet_time_get (), deadline))
+      if (bench_host_pair_pump (server, client, coalescing_received, & received) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    if (received.messages < COALESCING_MESSAGES)
+    {
+        fprintf (stderr, "%s: only %u of %u messages delivered\n", label, (unsigned) received.messages, (unsigned) COALESCING_MESSAGES);
+        result = -1;
+        goto done;
+    }
+
+    sentPackets = client -> totalSentPackets - sentPackets;
+    sentData = client -> totalSentData - sentData;
+
+    sprintf (metric, "%s.datagrams", label);
+    bench_report (metric, (double) sentPackets, "datagrams");
+    sprintf (metric, "%s.messages_per_datagram", label);
+    bench_report (metric, (double) COALESCING_MESSAGES / sentPackets, "messages");
+    sprintf (metric, "%s.mean_fill", label);
+    bench_report (metric, 100.0 * sentData / ((double) sentPackets * clientPeer -> mtu), "% of mtu");
+    sprintf (metric, "%s.peer_fill_ratio", label);
+    bench_report (metric, 100.0 * enet_peer_get_datagram_fill_ratio (clientPeer), "% of mtu");
+    sprintf (metric, "%s.mean_latency", label);
+    bench_report (metric, received.latency / received.messages, "us");
+
+done:
+    bench_host_pair_destroy (server, client);
+    return result;
+}
+
+int
+bench_coalescing (void)
+{
+    if (coalescing_run ("no_coalescing", 0) < 0 ||
+        coalescing_run ("coalesce_500us", 500) < 0 ||
+        coalescing_run ("coalesce_2000us", 2000) < 0)
+      return -1;
+
+    return 0;
+}
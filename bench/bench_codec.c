@@ -0,0 +1,138 @@
+/**
+ @file  bench_codec.c
+ @brief Range coder and CRC32 micro-benchmarks on datagram-sized buffers
+
+ The range coder compresses and decompresses 1400-byte buffers shaped like game state snapshots:
+ records of an entity id counting up, a few flag bytes, and positions that drift by small steps
+ from one record to the next. Every buffer comes from the same seed, so the ratio is the same
+ from one run to the next and the figures of two releases can be compared. Each operation runs
+ for a fixed wall time and the megabytes of uncompressed data processed per second are reported,
+ with the compressed size in percent of the original. enet_crc32 is measured the same way on a
+ 1400-byte datagram and on a 64 KB buffer, the latter showing its throughput once the table stays
+ in cache.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "bench.h"
+
+#define CODEC_DATAGRAM_SIZE 1400
+#define CODEC_LARGE_SIZE    (64 * 1024)
+#define CODEC_DURATION      500000000ULL
+#define CODEC_BATCH         64
+
+static enet_uint8 codecData [CODEC_LARGE_SIZE];
+static enet_uint8 codecCompressed [CODEC_DATAGRAM_SIZE];
+static enet_uint8 codecDecompressed [CODEC_DATAGRAM_SIZE];
+
+static volatile enet_uint32 codecSink;
+
+static void
+codec_fill (enet_uint8 * data, size_t dataLength)
+{
+    enet_uint32 seed = 0xC0DEC, entity = 100, x = 5000, y = 7000;
+    size_t offset;
+
+    for (offset = 0; offset + 12 <= dataLength; offset += 12)
+    {
+        seed = seed * 1664525 + 1013904223;
+
+        x += (seed >> 24) % 9 - 4;
+        y += (seed >> 16) % 9 - 4;
+
+        data [offset] = (enet_uint8) entity;
+        data [offset + 1] = (enet_uint8) (entity >> 8);
+        data [offset + 2] = (enet_uint8) ((seed >> 8) % 4);
+        data [offset + 3] = 0;
+        memcpy (& data [offset + 4], & x, 4);
+        memcpy (& data [offset + 8], & y, 4);
+
+        ++ entity;
+    }
+
+    memset (& data [offset], 0, dataLength - offset);
+}
+
+/** Reports the megabytes of input processed per second over elapsed nanoseconds. */
+static void
+codec_report (const char * metric, size_t bytes, bench_ticks elapsed)
+{
+    bench_report (metric, elapsed > 0 ? (double) bytes / (1024.0 * 1024.0) * 1e9 / elapsed : 0.0, "MB/s");
+}
+
+static int
+codec_range_coder (void)
+{
+    void * context = enet_range_coder_create ();
+    ENetBuffer buffer;
+    bench_ticks start, elapsed;
+    size_t compressedLength = 0, bytes, i;
+
+    if (context == NULL)
+      return -1;
+
+    buffer.data = codecData;
+    buffer.dataLength = CODEC_DATAGRAM_SIZE;
+
+    start = bench_ticks_fallback ();
+    for (bytes = 0, elapsed = 0; elapsed < CODEC_DURATION; elapsed = bench_ticks_fallback () - start)
+      for (i = 0; i < CODEC_BATCH; ++ i, bytes += CODEC_DATAGRAM_SIZE)
+      {
+          compressedLength = enet_range_coder_compress (context, & buffer, 1, CODEC_DATAGRAM_SIZE, codecCompressed, sizeof (codecCompressed));
+          if (compressedLength == 0)
+            goto fail;
+      }
+
+    codec_report ("range_coder.compress", bytes, elapsed);
+    bench_report ("range_coder.ratio", 100.0 * compressedLength / CODEC_DATAGRAM_SIZE, "%");
+
+    start = bench_ticks_fallback ();
+    for (bytes = 0, elapsed = 0; elapsed < CODEC_DURATION; elapsed = bench_ticks_fallback () - start)
+      for (i = 0; i < CODEC_BATCH; ++ i, bytes += CODEC_DATAGRAM_SIZE)
+        if (enet_range_coder_decompress (context, codecCompressed, compressedLength, codecDecompressed, sizeof (codecDecompressed)) != CODEC_DATAGRAM_SIZE)
+          goto fail;
+
+    if (memcmp (codecDecompressed, codecData, CODEC_DATAGRAM_SIZE) != 0)
+      goto fail;
+
+    codec_report ("range_coder.decompress", bytes, elapsed);
+
+    enet_range_coder_destroy (context);
+    return 0;
+
+fail:
+    fprintf (stderr, "range coder: round trip failed\n");
+    enet_range_coder_destroy (context);
+    return -1;
+}
+
+static void
+codec_crc32 (const char * metric, size_t dataLength)
+{
+    ENetBuffer buffer;
+    bench_ticks start, elapsed;
+    size_t bytes, i;
+
+    buffer.data = codecData;
+    buffer.dataLength = dataLength;
+
+    start = bench_ticks_fallback ();
+    for (bytes = 0, elapsed = 0; elapsed < CODEC_DURATION; elapsed = bench_ticks_fallback () - start)
+      for (i = 0; i < CODEC_BATCH; ++ i, bytes += dataLength)
+        codecSink += enet_crc32 (& buffer, 1);
+
+    codec_report (metric, bytes, elapsed);
+}
+
+int
+bench_codec (void)
+{
+    codec_fill (codecData, sizeof (codecData));
+
+    if (codec_range_coder () < 0)
+      return -1;
+
+    codec_crc32 ("crc32.datagram", CODEC_DATAGRAM_SIZE);
+    codec_crc32 ("crc32.64k", CODEC_LARGE_SIZE);
+
+    return 0;
+}
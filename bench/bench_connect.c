@@ -0,0 +1,150 @@
+/**
+ @file  bench_connect.c
+ @brief Connection storm: how fast a server accepts and then tears down a thousand connections at once
+
+ A client host starts 1024 connections to a loopback server in one go, and both hosts are serviced
+ until the server has reported every connection and every client peer is connected. The client
+ then disconnects all of its peers at once, and both hosts are serviced until the server has
+ reported every disconnection and every client peer is back to disconnected. Each connection
+ makes both hosts scan all of their peers, so the storm also measures how the handshake scales
+ with the number of peers already connected. The best of a few rounds, each on fresh hosts, is
+ reported; steady connection churn is measured by the churn scenario.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define CONNECT_PEERS  1024
+#define CONNECT_ROUNDS 3
+#define CONNECT_LIMIT  30000
+
+/** Services both hosts until the server has reported expected events of the given kind and
+    every client peer is in the given state.
+    @returns 0 on success, < 0 on failure or timeout
+*/
+static int
+connect_service (ENetHost * server, ENetHost * client, int connecting, ENetPeerState state)
+{
+    enet_uint32 deadline = enet_time_get () + CONNECT_LIMIT;
+    size_t events = 0, settled = 0, i;
+    ENetEvent event;
+    int result;
+
+    while (events < CONNECT_PEERS || settled < CONNECT_PEERS)
+    {
+        if (! ENET_TIME_LESS (enet_time_get (), deadline))
+        {
+            fprintf (stderr, "%s: %u of %u peers after %u ms\n", connecting ? "connect" : "disconnect",
+                     (unsigned) (events < settled ? events : settled), (unsigned) CONNECT_PEERS, (unsigned) CONNECT_LIMIT);
+            return -1;
+        }
+
+        if (enet_host_service (client, & event, 0) < 0)
+          return -1;
+        while (enet_host_check_events (client, & event) > 0);
+
+        for (result = enet_host_service (server, & event, 0);
+             result > 0;
+             result = enet_host_check_events (server, & event))
+          switch (event.type)
+          {
+          case ENET_EVENT_TYPE_CONNECT:
+              if (connecting)
+                ++ events;
+              break;
+
+          case ENET_EVENT_TYPE_DISCONNECT:
+          case ENET_EVENT_TYPE_DISCONNECT_TIMEOUT:
+              if (! connecting)
+                ++ events;
+              break;
+
+          case ENET_EVENT_TYPE_RECEIVE:
+              enet_packet_destroy (event.packet);
+              break;
+
+          default:
+              break;
+          }
+
+        if (result < 0)
+          return -1;
+
+        for (settled = 0, i = 0; i < CONNECT_PEERS; ++ i)
+          if (client -> peers [i].state == state)
+            ++ settled;
+    }
+
+    return 0;
+}
+
+static int
+connect_round (bench_ticks * connectTime, bench_ticks * disconnectTime)
+{
+    ENetHost * server = NULL, * client = NULL;
+    ENetAddress address;
+    bench_ticks start;
+    size_t i;
+    int result = -1;
+
+    enet_address_build_loopback (& address, ENET_ADDRESS_TYPE_IPV4);
+
+    server = enet_host_create (ENET_ADDRESS_TYPE_IPV4, & address, CONNECT_PEERS, 1, 0, 0);
+    client = enet_host_create (ENET_ADDRESS_TYPE_IPV4, NULL, CONNECT_PEERS, 1, 0, 0);
+    if (server == NULL || client == NULL)
+      goto done;
+
+    enet_socket_set_option (server -> socket, ENET_SOCKOPT_RCVBUF, BENCH_RELAY_BUFFER_SIZE);
+    enet_socket_set_option (client -> socket, ENET_SOCKOPT_RCVBUF, BENCH_RELAY_BUFFER_SIZE);
+
+    start = bench_ticks_fallback ();
+
+    for (i = 0; i < CONNECT_PEERS; ++ i)
+      if (enet_host_connect (client, & server -> address, 1, 0) == NULL)
+        goto done;
+
+    if (connect_service (server, client, 1, ENET_PEER_STATE_CONNECTED) < 0)
+      goto done;
+
+    * connectTime = bench_ticks_fallback () - start;
+    start = bench_ticks_fallback ();
+
+    for (i = 0; i < CONNECT_PEERS; ++ i)
+      enet_peer_disconnect (& client -> peers [i], 0);
+
+    if (connect_service (server, client, 0, ENET_PEER_STATE_DISCONNECTED) < 0)
+      goto done;
+
+    * disconnectTime = bench_ticks_fallback () - start;
+    result = 0;
+
+done:
+    bench_host_pair_destroy (server, client);
+    return result;
+}
+
+int
+bench_connect (void)
+{
+    bench_ticks bestConnect = 0, bestDisconnect = 0, connectTime, disconnectTime;
+    int round;
+
+    for (round = 0; round < CONNECT_ROUNDS; ++ round)
+    {
+        if (connect_round (& connectTime, & disconnectTime) < 0)
+          return -1;
+
+        if (round == 0 || connectTime < bestConnect)
+          bestConnect = connectTime;
+        if (round == 0 || disconnectTime < bestDisconnect)
+          bestDisconnect = disconnectTime;
+    }
+
+    bench_report ("storm.connect_time", (double) bestConnect / 1e6, "ms");
+    bench_report ("storm.connects", (double) CONNECT_PEERS * 1e9 / bestConnect, "connections/s");
+    bench_report ("storm.disconnect_time", (double) bestDisconnect / 1e6, "ms");
+    bench_report ("storm.disconnects", (double) CONNECT_PEERS * 1e9 / bestDisconnect, "connections/s");
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+/**
+ @file  bench_expiry.c
+ @brief Freshness of reliable state updates sent faster than the link carries them, with and without a time to live
+
+ The client sends a timestamped 1000-byte reliable update every 500 microseconds through a relay
+ that delays every datagram by 50 ms each way, which limits the reliable window to about 640 KB/s
+ against the 2 MB/s offered. Without a time to live the backlog grows and every update is
+ delivered ever later. With enet_peer_set_channel_time_to_live the updates that waited too long
+ are cancelled before they are sent and the ones delivered stay fresh.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define EXPIRY_UPDATES     2000
+#define EXPIRY_UPDATE_SIZE 1000
+#define EXPIRY_INTERVAL_US 500
+#define EXPIRY_DELAY_US    50000
+
+typedef struct _ExpiryReceived
+{
+   size_t updates;
+   double ages [EXPIRY_UPDATES];
+} ExpiryReceived;
+
+static void
+expiry_received (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet, void * userData)
+{
+    ExpiryReceived * received = (ExpiryReceived *) userData;
+    enet_uint32 sentTime;
+
+    (void) peer;
+    (void) channelID;
+
+    memcpy (& sentTime, packet -> data, sizeof (sentTime));
+
+    if (received -> updates < EXPIRY_UPDATES)
+      received -> ages [received -> updates ++] = (double) (enet_uint32) (enet_time_get_us () - sentTime);
+
+    enet_packet_destroy (packet);
+}
+
+static int
+expiry_compare_ages (const void * a, const void * b)
+{
+    double x = * (const double *) a, y = * (const double *) b;
+
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static int
+expiry_pump (BenchRelay * relay, ENetHost * server, ENetHost * client, ExpiryReceived * received)
+{
+    if (bench_relay_pump (relay) < 0)
+      return -1;
+
+    return bench_host_pair_pump (server, client, expiry_received, received);
+}
+
+static int
+expiry_run (const char * label, enet_uint32 timeToLive)
+{
+    static BenchRelay relay;
+    static ExpiryReceived received;
+    ENetHost * server, * client;
+    ENetPeer * clientPeer;
+    enet_uint8 payload [EXPIRY_UPDATE_SIZE];
+    enet_uint32 sentData, deadline, update;
+    char metric [64];
+    int result = 0;
+
+    memset (payload, 0x55, sizeof (payload));
+    memset (& received, 0, sizeof (received));
+
+    if (bench_relay_pair_create (& relay, 1, EXPIRY_DELAY_US, 0, & server, & client, & clientPeer) < 0)
+      return -1;
+
+    if (enet_peer_set_channel_time_to_live (clientPeer, 0, timeToLive, 1) < 0)
+    {
+        result = -1;
+        goto done;
+    }
+
+    sentData = client -> totalSentData;
+
+    for (update = 0; update < EXPIRY_UPDATES; ++ update)
+    {
+        enet_uint32 sentTime = enet_time_get_us ();
+
+        memcpy (payload, & sentTime, sizeof (sentTime));
+
+        if (enet_peer_send (clientPeer, 0, enet_packet_create (payload, sizeof (payload), ENET_PACKET_FLAG_RELIABLE)) < 0)
+        {
+            result = -1;
+            goto done;
+        }
+
+        do
+        {
+            if (expiry_pump (& relay, server, client, & received) < 0)
+            {
+                result = -1;
+                goto done;
+            }
+        }
+        while ((enet_uint32) (enet_time_get_us () - sentTime) < EXPIRY_INTERVAL_US);
+    }
+
+    deadline = enet_time_get () + 20000;
+    while (received.updates + enet_peer_get_expired_packets (clientPeer) < EXPIRY_UPDATES && ENET_TIME_LESS (enet_time_get (), deadline))
+      if (expiry_pump (& relay, server, client, & received) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    sentData = client -> totalSentData - sentData;
+
+    if (received.updates == 0 || received.updates + enet_peer_get_expired_packets (clientPeer) < EXPIRY_UPDATES)
+    {
+        fprintf (stderr, "%s: %u updates delivered and %u expired out of %u\n", label, (unsigned) received.updates, (unsigned) enet_peer_get_expired_packets (clientPeer), (unsigned) EXPIRY_UPDATES);
+        result = -1;
+        goto done;
+    }
+
+    qsort (received.ages, received.updates, sizeof (double), expiry_compare_ages);
+
+    sprintf (metric, "%s.delivered", label);
+    bench_report (metric, (double) received.updates, "updates");
+    sprintf (metric, "%s.expired", label);
+    bench_report (metric, (double) enet_peer_get_expired_packets (clientPeer), "updates");
+    sprintf (metric, "%s.p50_age", label);
+    bench_report (metric, received.ages [received.updates / 2] / 1000.0, "ms");
+    sprintf (metric, "%s.p99_age", label);
+    bench_report (metric, received.ages [(received.updates * 99) / 100] / 1000.0, "ms");
+    sprintf (metric, "%s.wire_bytes", label);
+    bench_report (metric, (double) sentData / 1024.0, "KB");
+
+done:
+    bench_relay_pair_destroy (& relay, server, client);
+    return result;
+}
+
+int
+bench_expiry (void)
+{
+    if (expiry_run ("no_ttl", 0) < 0 ||
+        expiry_run ("ttl_100ms", 100) < 0)
+      return -1;
+
+    return 0;
+}
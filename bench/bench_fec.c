@@ -0,0 +1,206 @@
+/**
+ @file  bench_fec.c
+ @brief Delivery rate and tail latency of a lossy channel, with and without forward error correction
+
+ The server drops a fixed fraction of the datagrams it receives through its intercept callback.
+ The client sends a timestamped message every 200 microseconds and flushes after each one. Without
+ FEC a lost unsequenced message is gone and a lost reliable one waits for its retransmission; with
+ enet_peer_set_channel_fec the receiver rebuilds it from the parity of its group instead.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define FEC_MESSAGES     2000
+#define FEC_MESSAGE_SIZE 200
+#define FEC_INTERVAL_US  200
+
+typedef struct _FecReceived
+{
+   size_t messages;
+   enet_uint8 seen [FEC_MESSAGES];
+   double latencies [FEC_MESSAGES];
+} FecReceived;
+
+static enet_uint32 fecLossPercent = 0;
+static enet_uint32 fecSeed = 0x2545F491;
+
+static int ENET_CALLBACK
+fec_drop (ENetHost * host, ENetEvent * event)
+{
+    (void) host;
+    (void) event;
+
+    fecSeed = fecSeed * 1664525 + 1013904223;
+
+    return (fecSeed >> 8) % 100 < fecLossPercent ? 1 : 0;
+}
+
+static void
+fec_received (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet, void * userData)
+{
+    FecReceived * received = (FecReceived *) userData;
+    enet_uint32 sentTime, message;
+
+    (void) peer;
+    (void) channelID;
+
+    memcpy (& sentTime, packet -> data, sizeof (sentTime));
+    memcpy (& message, packet -> data + sizeof (sentTime), sizeof (message));
+
+    if (message < FEC_MESSAGES && ! received -> seen [message])
+    {
+        received -> seen [message] = 1;
+        received -> latencies [received -> messages ++] = (double) (enet_uint32) (enet_time_get_us () - sentTime);
+    }
+
+    enet_packet_destroy (packet);
+}
+
+static int
+fec_compare_latencies (const void * a, const void * b)
+{
+    double x = * (const double *) a, y = * (const double *) b;
+
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static int
+fec_negotiated (ENetPeer * peer, enet_uint8 groupSize)
+{
+    return groupSize == 0 || (peer -> channels [0].fec != NULL && peer -> channels [0].fec -> groupSize == groupSize);
+}
+
+static int
+fec_run (const char * label, enet_uint32 packetFlags, enet_uint32 lossPercent, enet_uint8 groupSize)
+{
+    static FecReceived received;
+    ENetHost * server, * client;
+    ENetPeer * serverPeer, * clientPeer;
+    enet_uint8 payload [FEC_MESSAGE_SIZE];
+    enet_uint32 sentData, deadline, message;
+    char metric [64];
+    int result = 0;
+
+    memset (payload, 0x66, sizeof (payload));
+    memset (& received, 0, sizeof (received));
+
+    if (bench_host_pair_create (1, & server, & client, & serverPeer, & clientPeer) < 0)
+      return -1;
+
+    if (groupSize > 0 &&
+        (enet_peer_set_channel_fec (clientPeer, 0, groupSize) < 0 ||
+         enet_peer_set_channel_fec (serverPeer, 0, groupSize) < 0))
+    {
+        result = -1;
+        goto done;
+    }
+
+    deadline = enet_time_get () + 5000;
+    while (! (fec_negotiated (clientPeer, groupSize) && fec_negotiated (serverPeer, groupSize)) &&
+           ENET_TIME_LESS (enet_time_get (), deadline))
+      if (bench_host_pair_pump (server, client, NULL, NULL) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    if (! fec_negotiated (clientPeer, groupSize) || ! fec_negotiated (serverPeer, groupSize))
+    {
+        fprintf (stderr, "%s: FEC group size not negotiated\n", label);
+        result = -1;
+        goto done;
+    }
+
+    fecLossPercent = lossPercent;
+    enet_host_set_intercept_callback (server, fec_drop);
+
+    sentData = client -> totalSentData;
+
+    for (message = 0; message < FEC_MESSAGES; ++ message)
+    {
+        enet_uint32 sentTime = enet_time_get_us ();
+
+        memcpy (payload, & sentTime, sizeof (sentTime));
+        memcpy (payload + sizeof (sentTime), & message, sizeof (message));
+
+        if (enet_peer_send (clientPeer, 0, enet_packet_create (payload, sizeof (payload), packetFlags)) < 0)
+        {
+            result = -1;
+            goto done;
+        }
+
+        enet_host_flush (client);
+
+        if (bench_host_pair_pump (server, client, fec_received, & received) < 0)
+        {
+            result = -1;
+            goto done;
+        }
+
+        while ((enet_uint32) (enet_time_get_us () - sentTime) < FEC_INTERVAL_US);
+    }
+
+    /* Reliable messages all arrive eventually; give the others long enough for the last parity. */
+    deadline = enet_time_get () + (packetFlags & ENET_PACKET_FLAG_RELIABLE ? 5000 : 2 * ENET_PEER_FEC_GROUP_TIMEOUT);
+    while (received.messages < FEC_MESSAGES && ENET_TIME_LESS (enet_time_get (), deadline))
+      if (bench_host_pair_pump (server, client, fec_received, & received) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    sentData = client -> totalSentData - sentData;
+
+    if (received.messages == 0)
+    {
+        fprintf (stderr, "%s: no message delivered\n", label);
+        result = -1;
+        goto done;
+    }
+
+    qsort (received.latencies, received.messages, sizeof (double), fec_compare_latencies);
+
+    sprintf (metric, "%s.loss%u.delivered", label, (unsigned) lossPercent);
+    bench_report (metric, 100.0 * received.messages / FEC_MESSAGES, "%");
+    sprintf (metric, "%s.loss%u.p50_latency", label, (unsigned) lossPercent);
+    bench_report (metric, received.latencies [received.messages / 2], "us");
+    sprintf (metric, "%s.loss%u.p99_latency", label, (unsigned) lossPercent);
+    bench_report (metric, received.latencies [(received.messages * 99) / 100], "us");
+    sprintf (metric, "%s.loss%u.wire_bytes_per_message", label, (unsigned) lossPercent);
+    bench_report (metric, (double) sentData / FEC_MESSAGES, "bytes");
+
+done:
+    bench_host_pair_destroy (server, client);
+    return result;
+}
+
+int
+bench_fec (void)
+{
+    static const enet_uint32 lossPercents [] = { 1, 5, 10 };
+    static const enet_uint8 groupSizes [] = { 0, 4, 8 };
+    char label [64];
+    size_t i, j;
+
+    for (i = 0; i < sizeof (lossPercents) / sizeof (lossPercents [0]); ++ i)
+      for (j = 0; j < sizeof (groupSizes) / sizeof (groupSizes [0]); ++ j)
+      {
+          if (groupSizes [j] == 0)
+            strcpy (label, "no_fec");
+          else
+            sprintf (label, "fec%u", (unsigned) groupSizes [j]);
+
+          if (fec_run (label, ENET_PACKET_FLAG_UNSEQUENCED, lossPercents [i], groupSizes [j]) < 0)
+            return -1;
+
+          strcat (label, ".reliable");
+
+          if (fec_run (label, ENET_PACKET_FLAG_RELIABLE, lossPercents [i], groupSizes [j]) < 0)
+            return -1;
+      }
+
+    return 0;
+}
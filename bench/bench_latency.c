@@ -0,0 +1,139 @@
+/**
+ @file  bench_latency.c
+ @brief Round trip time percentiles of small reliable messages, idle and behind a bulk stream
+
+ The client sends a reliable probe carrying its send time every millisecond on channel 0, and the
+ server echoes each probe back reliably as soon as it receives it. The round trips measured by the
+ client go into an ENetHistogram, from which the percentiles are read. The probes run first on an
+ otherwise idle connection, then while the client also keeps a stream of 1000-byte reliable
+ packets flowing to the server on channel 1, up to 256 packets ahead of what the server received,
+ which shows how much of the latency under load is queueing behind the bulk data. The throughput
+ of the stream is reported with the percentiles of the loaded run.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define LATENCY_PROBES        2000
+#define LATENCY_INTERVAL_US   1000
+#define LATENCY_BULK_SIZE     1000
+#define LATENCY_BULK_AHEAD    256
+
+typedef struct _LatencyState
+{
+   ENetHost * server;
+   ENetHistogram roundTrips;
+   size_t bulkReceived;
+   int failed;
+} LatencyState;
+
+static void
+latency_received (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet, void * userData)
+{
+    LatencyState * state = (LatencyState *) userData;
+    enet_uint32 sentTime;
+
+    if (channelID != 0)
+      ++ state -> bulkReceived;
+    else
+    if (peer -> host == state -> server)
+    {
+        if (enet_peer_send (peer, 0, enet_packet_create (packet -> data, packet -> dataLength, ENET_PACKET_FLAG_RELIABLE)) < 0)
+          state -> failed = 1;
+    }
+    else
+    {
+        memcpy (& sentTime, packet -> data, sizeof (sentTime));
+        enet_histogram_record (& state -> roundTrips, enet_time_get_us () - sentTime);
+    }
+
+    enet_packet_destroy (packet);
+}
+
+static int
+latency_run (const char * label, int loaded)
+{
+    static enet_uint8 bulk [LATENCY_BULK_SIZE];
+    static const double percentiles [] = { 50.0, 90.0, 99.0, 99.9 };
+    static const char * const percentileNames [] = { "p50", "p90", "p99", "p99.9" };
+    ENetHost * server, * client;
+    ENetPeer * serverPeer, * clientPeer;
+    LatencyState state;
+    enet_uint32 nextProbe, now, deadline;
+    size_t probes = 0, bulkSent = 0, i;
+    bench_ticks start;
+    char metric [64];
+    int result = -1;
+
+    if (bench_host_pair_create (2, & server, & client, & serverPeer, & clientPeer) < 0)
+      return -1;
+
+    memset (& state, 0, sizeof (state));
+    state.server = server;
+    enet_histogram_reset (& state.roundTrips);
+
+    memset (bulk, 0xB5, sizeof (bulk));
+
+    start = bench_ticks_fallback ();
+    nextProbe = enet_time_get_us ();
+    deadline = enet_time_get () + 10000 + LATENCY_PROBES * LATENCY_INTERVAL_US / 1000;
+
+    while (state.roundTrips.count < LATENCY_PROBES && ENET_TIME_LESS (enet_time_get (), deadline))
+    {
+        now = enet_time_get_us ();
+
+        if (probes < LATENCY_PROBES && (enet_uint32) (now - nextProbe) < 0x80000000)
+        {
+            if (enet_peer_send (clientPeer, 0, enet_packet_create (& now, sizeof (now), ENET_PACKET_FLAG_RELIABLE)) < 0)
+              goto done;
+
+            ++ probes;
+            nextProbe += LATENCY_INTERVAL_US;
+        }
+
+        for (; loaded && probes < LATENCY_PROBES && bulkSent < state.bulkReceived + LATENCY_BULK_AHEAD; ++ bulkSent)
+          if (enet_peer_send (clientPeer, 1, enet_packet_create (bulk, sizeof (bulk), ENET_PACKET_FLAG_RELIABLE)) < 0)
+            goto done;
+
+        if (bench_host_pair_pump (server, client, latency_received, & state) < 0 || state.failed)
+          goto done;
+    }
+
+    if (state.roundTrips.count < LATENCY_PROBES)
+    {
+        fprintf (stderr, "%s: only %u of %u probes came back\n", label, (unsigned) state.roundTrips.count, (unsigned) LATENCY_PROBES);
+        goto done;
+    }
+
+    for (i = 0; i < sizeof (percentiles) / sizeof (percentiles [0]); ++ i)
+    {
+        sprintf (metric, "%s.%s", label, percentileNames [i]);
+        bench_report (metric, (double) enet_histogram_percentile (& state.roundTrips, percentiles [i]), "us");
+    }
+
+    sprintf (metric, "%s.max", label);
+    bench_report (metric, (double) state.roundTrips.maximum, "us");
+
+    if (loaded)
+    {
+        sprintf (metric, "%s.bulk_throughput", label);
+        bench_report (metric, (double) state.bulkReceived * LATENCY_BULK_SIZE / (1024.0 * 1024.0) * 1e9 / (double) (bench_ticks_fallback () - start), "MB/s");
+    }
+
+    result = 0;
+
+done:
+    bench_host_pair_destroy (server, client);
+    return result;
+}
+
+int
+bench_latency (void)
+{
+    if (latency_run ("idle", 0) < 0 ||
+        latency_run ("loaded", 1) < 0)
+      return -1;
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+/**
+ @file  bench_loopback.c
+ @brief Packets and bytes per second between two hosts over loopback, by kind of traffic
+
+ A client sends packets of one kind to a server over the loopback interface for a fixed wall time:
+ 64-byte unreliable packets, 1000-byte reliable packets, 16 KB reliable packets split into
+ fragments, and 4 KB unreliable packets split into unreliable fragments. The client keeps at most
+ a window of bytes sent and not yet received by the server, so that the socket buffers never
+ overflow and the rate measured is the rate at which both hosts process the traffic. Unreliable
+ packets that have not arrived after a few milliseconds without progress are counted as lost and
+ leave the window. The packets and bytes received per second are reported, and the share of
+ unreliable packets delivered.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define LOOPBACK_DURATION     1000
+#define LOOPBACK_WINDOW       (256 * 1024)
+#define LOOPBACK_BURST        32
+#define LOOPBACK_STALL        5000000
+#define LOOPBACK_MAXIMUM_SIZE (16 * 1024)
+
+typedef struct _LoopbackKind
+{
+   const char * name;
+   size_t packetSize;
+   enet_uint32 flags;
+} LoopbackKind;
+
+static int
+loopback_run (const LoopbackKind * kind)
+{
+    static enet_uint8 payload [LOOPBACK_MAXIMUM_SIZE];
+    ENetHost * server = NULL, * client = NULL;
+    ENetPeer * serverPeer = NULL, * clientPeer = NULL;
+    bench_ticks start, now, lastProgress;
+    size_t sent = 0, received = 0, lost = 0, burst;
+    int reliable = (kind -> flags & ENET_PACKET_FLAG_RELIABLE) != 0, count;
+    char metric [64];
+    double seconds;
+
+    if (bench_host_pair_create (1, & server, & client, & serverPeer, & clientPeer) < 0)
+      return -1;
+
+    enet_socket_set_option (server -> socket, ENET_SOCKOPT_RCVBUF, BENCH_RELAY_BUFFER_SIZE);
+    enet_socket_set_option (client -> socket, ENET_SOCKOPT_SNDBUF, BENCH_RELAY_BUFFER_SIZE);
+
+    memset (payload, 0x5A, kind -> packetSize);
+
+    start = bench_ticks_fallback ();
+    lastProgress = start;
+
+    for (now = start; now - start < (bench_ticks) LOOPBACK_DURATION * 1000000; now = bench_ticks_fallback ())
+    {
+        /* Unreliable packets counted as lost may still arrive afterwards. */
+        for (burst = 0;
+             burst < LOOPBACK_BURST && (received + lost >= sent ? 1 : sent - received - lost + 1) * kind -> packetSize <= LOOPBACK_WINDOW;
+             ++ burst, ++ sent)
+          if (enet_peer_send (clientPeer, 0, enet_packet_create (payload, kind -> packetSize, kind -> flags)) < 0)
+            goto fail;
+
+        count = bench_host_pair_pump (server, client, NULL, NULL);
+        if (count < 0)
+          goto fail;
+
+        if (count > 0)
+        {
+            received += (size_t) count;
+            lastProgress = now;
+        }
+        else
+        if (! reliable && now - lastProgress > LOOPBACK_STALL)
+        {
+            lost = sent - received;
+            lastProgress = now;
+        }
+    }
+
+    seconds = (double) (now - start) / 1e9;
+
+    bench_host_pair_destroy (server, client);
+
+    if (received == 0)
+    {
+        fprintf (stderr, "%s: no packet delivered\n", kind -> name);
+        return -1;
+    }
+
+    sprintf (metric, "%s.packets", kind -> name);
+    bench_report (metric, (double) received / seconds, "packets/s");
+    sprintf (metric, "%s.throughput", kind -> name);
+    bench_report (metric, (double) received * kind -> packetSize / (1024.0 * 1024.0) / seconds, "MB/s");
+
+    if (! reliable)
+    {
+        sprintf (metric, "%s.delivered", kind -> name);
+        bench_report (metric, 100.0 * received / sent, "%");
+    }
+
+    return 0;
+
+fail:
+    bench_host_pair_destroy (server, client);
+    return -1;
+}
+
+int
+bench_loopback (void)
+{
+    static const LoopbackKind kinds [] =
+    {
+       { "unreliable", 64, 0 },
+       { "reliable", 1000, ENET_PACKET_FLAG_RELIABLE },
+       { "fragmented", 16 * 1024, ENET_PACKET_FLAG_RELIABLE },
+       { "unreliable_fragmented", 4 * 1024, ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT }
+    };
+    size_t kind;
+
+    for (kind = 0; kind < sizeof (kinds) / sizeof (kinds [0]); ++ kind)
+      if (loopback_run (& kinds [kind]) < 0)
+        return -1;
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+/**
+ @file  bench_network.c
+ @brief Reliable transfer over simulated links: goodput vs loss, determinism and simulation speed
+
+ A client sends 2 MB of 1000-byte reliable packets to a server over a virtual network whose links
+ have a 25 ms one-way latency with 2 ms of jitter, 2 MB/s of bandwidth with a 64 KB queue, and
+ 0%, 1% or 5% loss. Both hosts are serviced without waiting and the virtual clock advances by
+ 250 microseconds per step, so a transfer takes whatever simulated time the protocol needs and
+ whatever wall time the hosts need to process it. Each transfer is run twice with the same seed:
+ the simulated times must match, as must the counters of the network.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define NETWORK_PACKETS      2048
+#define NETWORK_PACKET_SIZE  1000
+#define NETWORK_STEP         250
+#define NETWORK_TIME_LIMIT   600000
+
+/** Runs one transfer on a fresh network.
+    @returns the simulated milliseconds the transfer took, or 0 on failure
+*/
+static enet_uint32
+network_transfer (enet_uint32 loss, ENetNetworkStats * stats, bench_ticks * wallTime)
+{
+    ENetNetwork * network = enet_network_create (0x5EED);
+    ENetHost * server = NULL, * client = NULL;
+    ENetPeer * clientPeer = NULL;
+    ENetLink link;
+    ENetEvent event;
+    enet_uint8 payload [NETWORK_PACKET_SIZE];
+    enet_uint32 start = 0, elapsed = 0;
+    bench_ticks wallStart = bench_ticks_fallback ();
+    size_t packet, received = 0;
+    int sent = 0;
+
+    if (network == NULL)
+      return 0;
+
+    memset (payload, 0x3C, sizeof (payload));
+    memset (& link, 0, sizeof (link));
+    link.latency = 25000;
+    link.jitter = 2000;
+    link.loss = loss;
+    link.bandwidth = 2 * 1024 * 1024;
+    link.queueLimit = 64 * 1024;
+
+    server = enet_host_create (ENET_ADDRESS_TYPE_IPV4, NULL, 1, 1, 0, 0);
+    client = enet_host_create (ENET_ADDRESS_TYPE_IPV4, NULL, 1, 1, 0, 0);
+    if (server == NULL || client == NULL ||
+        enet_network_attach (network, server) < 0 || enet_network_attach (network, client) < 0 ||
+        enet_network_link (network, NULL, NULL, & link) < 0)
+      goto done;
+
+    start = enet_time_get ();
+
+    clientPeer = enet_host_connect (client, & server -> address, 1, 0);
+    if (clientPeer == NULL)
+      goto done;
+
+    while (received < NETWORK_PACKETS)
+    {
+        if (enet_time_get () - start > NETWORK_TIME_LIMIT)
+          goto done;
+
+        if (! sent && clientPeer -> state == ENET_PEER_STATE_CONNECTED)
+        {
+            for (packet = 0; packet < NETWORK_PACKETS; ++ packet)
+              if (enet_peer_send (clientPeer, 0, enet_packet_create (payload, sizeof (payload), ENET_PACKET_FLAG_RELIABLE)) < 0)
+                goto done;
+
+            sent = 1;
+        }
+
+        if (enet_host_service (client, & event, 0) < 0)
+          goto done;
+
+        while (enet_host_service (server, & event, 0) > 0)
+          if (event.type == ENET_EVENT_TYPE_RECEIVE)
+          {
+              ++ received;
+              enet_packet_destroy (event.packet);
+          }
+
+        enet_network_advance (network, NETWORK_STEP);
+    }
+
+    elapsed = enet_time_get () - start;
+    enet_network_get_stats (network, stats);
+
+done:
+    bench_host_pair_destroy (server, client);
+    enet_network_destroy (network);
+
+    * wallTime = bench_ticks_fallback () - wallStart;
+    return elapsed;
+}
+
+int
+bench_network (void)
+{
+    static const enet_uint32 losses [] = { 0, ENET_LINK_CHANCE_SCALE / 100, ENET_LINK_CHANCE_SCALE / 20 };
+    static const char * const names [] = { "loss_0", "loss_1", "loss_5" };
+    size_t lossIndex;
+
+    for (lossIndex = 0; lossIndex < sizeof (losses) / sizeof (losses [0]); ++ lossIndex)
+    {
+        ENetNetworkStats stats [2];
+        bench_ticks wallTime [2];
+        enet_uint32 elapsed [2];
+        char metric [64];
+        int run;
+
+        for (run = 0; run < 2; ++ run)
+        {
+            memset (& stats [run], 0, sizeof (stats [run]));
+
+            elapsed [run] = network_transfer (losses [lossIndex], & stats [run], & wallTime [run]);
+            if (elapsed [run] == 0)
+              return -1;
+        }
+
+        if (elapsed [0] != elapsed [1] || memcmp (& stats [0], & stats [1], sizeof (stats [0])) != 0)
+        {
+            fprintf (stderr, "%s: runs with the same seed diverged\n", names [lossIndex]);
+            return -1;
+        }
+
+        sprintf (metric, "%s_goodput", names [lossIndex]);
+        bench_report (metric, (double) NETWORK_PACKETS * NETWORK_PACKET_SIZE / 1024.0 / ((double) elapsed [0] / 1000.0), "KB/s");
+        sprintf (metric, "%s_simulated_time", names [lossIndex]);
+        bench_report (metric, (double) elapsed [0], "ms");
+        sprintf (metric, "%s_datagrams", names [lossIndex]);
+        bench_report (metric, (double) stats [0].sentDatagrams, "datagrams");
+        sprintf (metric, "%s_speedup", names [lossIndex]);
+        bench_report (metric, (double) elapsed [0] * 1000000.0 / (double) (wallTime [0] < wallTime [1] ? wallTime [0] : wallTime [1]), "x");
+    }
+
+    return 0;
+}
@@ -0,0 +1,288 @@
+/**
+ @file  bench_pipeline.c
+ @brief Per-stage cost of the outgoing/incoming transform pipeline (compression + encryption)
+
+ The encryptor is a toy keystream cipher that appends a 16-byte tag, standing in for an AEAD.
+ It comes in an out-of-place flavour (encrypt/decrypt) and an in-place one (encryptInPlace/decryptInPlace)
+ so both pipeline shapes can be compared on the same traffic.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define PIPELINE_PACKETS     20000
+#define PIPELINE_PACKET_SIZE 1000
+#define PIPELINE_TAG_SIZE    16
+
+typedef struct _PipelineStats
+{
+   bench_ticks compress, decompress, encrypt, decrypt, flush;
+   size_t compressCalls, decompressCalls, encryptCalls, decryptCalls, flushCalls;
+} PipelineStats;
+
+static PipelineStats stats;
+
+static size_t ENET_CALLBACK
+pipeline_compress (void * context, const ENetBuffer * inBuffers, size_t inBufferCount, size_t inLimit, enet_uint8 * outData, size_t outLimit)
+{
+    bench_ticks start = bench_ticks_now ();
+    size_t result = enet_range_coder_compress (context, inBuffers, inBufferCount, inLimit, outData, outLimit);
+
+    stats.compress += bench_ticks_now () - start;
+    ++ stats.compressCalls;
+    return result;
+}
+
+static size_t ENET_CALLBACK
+pipeline_decompress (void * context, const enet_uint8 * inData, size_t inLimit, enet_uint8 * outData, size_t outLimit)
+{
+    bench_ticks start = bench_ticks_now ();
+    size_t result = enet_range_coder_decompress (context, inData, inLimit, outData, outLimit);
+
+    stats.decompress += bench_ticks_now () - start;
+    ++ stats.decompressCalls;
+    return result;
+}
+
+static void ENET_CALLBACK
+pipeline_compress_destroy (void * context)
+{
+    enet_range_coder_destroy (context);
+}
+
+static enet_uint8
+pipeline_keystream (enet_uint32 * state)
+{
+    * state = * state * 1664525 + 1013904223;
+    return (enet_uint8) (* state >> 24);
+}
+
+static size_t
+pipeline_cipher (enet_uint8 * data, size_t dataLength)
+{
+    enet_uint32 state = 0x9E3779B9;
+    enet_uint8 tag = 0;
+    size_t i;
+
+    for (i = 0; i < dataLength; ++ i)
+    {
+        tag ^= data [i];
+        data [i] ^= pipeline_keystream (& state);
+    }
+
+    return tag;
+}
+
+static size_t ENET_CALLBACK
+pipeline_encrypt (void * context, ENetPeer * peer, const ENetBuffer * inBuffers, size_t inBufferCount, size_t inLimit, enet_uint8 * outData, size_t outLimit)
+{
+    bench_ticks start = bench_ticks_now ();
+    size_t i, length = 0;
+
+    (void) context;
+    (void) peer;
+
+    if (inLimit + PIPELINE_TAG_SIZE > outLimit)
+      return 0;
+
+    for (i = 0; i < inBufferCount; ++ i)
+    {
+        memcpy (outData + length, inBuffers [i].data, inBuffers [i].dataLength);
+        length += inBuffers [i].dataLength;
+    }
+
+    memset (outData + length, (int) pipeline_cipher (outData, length), PIPELINE_TAG_SIZE);
+
+    stats.encrypt += bench_ticks_now () - start;
+    ++ stats.encryptCalls;
+    return length + PIPELINE_TAG_SIZE;
+}
+
+static size_t ENET_CALLBACK
+pipeline_decrypt (void * context, ENetPeer * peer, const enet_uint8 * inData, size_t inLimit, enet_uint8 * outData, size_t outLimit)
+{
+    bench_ticks start = bench_ticks_now ();
+    size_t length;
+
+    (void) context;
+    (void) peer;
+
+    if (inLimit < PIPELINE_TAG_SIZE || inLimit - PIPELINE_TAG_SIZE > outLimit)
+      return 0;
+
+    length = inLimit - PIPELINE_TAG_SIZE;
+    memcpy (outData, inData, length);
+    pipeline_cipher (outData, length);
+
+    stats.decrypt += bench_ticks_now () - start;
+    ++ stats.decryptCalls;
+    return length;
+}
+
+static size_t ENET_CALLBACK
+pipeline_encrypt_in_place (void * context, ENetPeer * peer, enet_uint8 * data, size_t dataLength, size_t dataLimit)
+{
+    bench_ticks start = bench_ticks_now ();
+
+    (void) context;
+    (void) peer;
+
+    if (dataLength + PIPELINE_TAG_SIZE > dataLimit)
+      return 0;
+
+    memset (data + dataLength, (int) pipeline_cipher (data, dataLength), PIPELINE_TAG_SIZE);
+
+    stats.encrypt += bench_ticks_now () - start;
+    ++ stats.encryptCalls;
+    return dataLength + PIPELINE_TAG_SIZE;
+}
+
+static size_t ENET_CALLBACK
+pipeline_decrypt_in_place (void * context, ENetPeer * peer, enet_uint8 * data, size_t dataLength)
+{
+    bench_ticks start = bench_ticks_now ();
+
+    (void) context;
+    (void) peer;
+
+    if (dataLength < PIPELINE_TAG_SIZE)
+      return 0;
+
+    pipeline_cipher (data, dataLength - PIPELINE_TAG_SIZE);
+
+    stats.decrypt += bench_ticks_now () - start;
+    ++ stats.decryptCalls;
+    return dataLength - PIPELINE_TAG_SIZE;
+}
+
+static void
+pipeline_setup (ENetHost * host, int compress, int encrypt, int inPlace)
+{
+    if (compress)
+    {
+        ENetCompressor compressor;
+
+        compressor.context = enet_range_coder_create ();
+        compressor.compress = pipeline_compress;
+        compressor.decompress = pipeline_decompress;
+        compressor.destroy = pipeline_compress_destroy;
+        enet_host_compress (host, & compressor);
+    }
+
+    if (encrypt)
+    {
+        ENetEncryptor encryptor;
+
+        memset (& encryptor, 0, sizeof (encryptor));
+        encryptor.context = host;
+        if (inPlace)
+        {
+            encryptor.encryptInPlace = pipeline_encrypt_in_place;
+            encryptor.decryptInPlace = pipeline_decrypt_in_place;
+        }
+        else
+        {
+            encryptor.encrypt = pipeline_encrypt;
+            encryptor.decrypt = pipeline_decrypt;
+        }
+        enet_host_encrypt (host, & encryptor);
+    }
+}
+
+static int
+pipeline_run (const char * label, int compress, int encrypt, int inPlace)
+{
+    ENetHost * server, * client;
+    ENetPeer * serverPeer, * clientPeer;
+    enet_uint8 payload [PIPELINE_PACKET_SIZE];
+    char metric [64];
+    size_t i, sent = 0, received = 0;
+    enet_uint32 deadline;
+    int result = 0;
+
+    /* Text-like payload: compressible, but not trivially so. */
+    for (i = 0; i < sizeof (payload); ++ i)
+      payload [i] = (enet_uint8) ("abcdefghijklmnopqrstuvwxyz0123456789" [(i * 7 + i / 13) % 36]);
+
+    if (bench_host_pair_create (1, & server, & client, & serverPeer, & clientPeer) < 0)
+      return -1;
+
+    /* Transforms are configured after the handshake so that only data traffic is measured. */
+    pipeline_setup (server, compress, encrypt, inPlace);
+    pipeline_setup (client, compress, encrypt, inPlace);
+    memset (& stats, 0, sizeof (stats));
+    deadline = enet_time_get () + 60000;
+
+    while (received < PIPELINE_PACKETS)
+    {
+        int count;
+
+        if (! ENET_TIME_LESS (enet_time_get (), deadline))
+        {
+            fprintf (stderr, "%s: only %u of %u packets delivered\n", label, (unsigned) received, (unsigned) PIPELINE_PACKETS);
+            result = -1;
+            goto done;
+        }
+
+        for (; sent < PIPELINE_PACKETS && sent - received < 256; ++ sent)
+        {
+            bench_ticks start;
+
+            if (enet_peer_send (clientPeer, 0, enet_packet_create (payload, sizeof (payload), ENET_PACKET_FLAG_RELIABLE)) < 0)
+            {
+                result = -1;
+                goto done;
+            }
+
+            if (sent % 8 == 7)
+            {
+                start = bench_ticks_now ();
+                enet_host_flush (client);
+                stats.flush += bench_ticks_now () - start;
+                ++ stats.flushCalls;
+            }
+        }
+
+        count = bench_host_pair_pump (server, client, NULL, NULL);
+        if (count < 0)
+        {
+            result = -1;
+            goto done;
+        }
+        received += (size_t) count;
+    }
+
+#define PIPELINE_REPORT(name, ticks, calls) \
+    if ((calls) > 0) \
+    { \
+        sprintf (metric, "%s.%s", label, name); \
+        bench_report (metric, (double) (ticks) / (calls), "ticks/call"); \
+    }
+
+    PIPELINE_REPORT ("compress", stats.compress, stats.compressCalls);
+    PIPELINE_REPORT ("encrypt", stats.encrypt, stats.encryptCalls);
+    PIPELINE_REPORT ("decrypt", stats.decrypt, stats.decryptCalls);
+    PIPELINE_REPORT ("decompress", stats.decompress, stats.decompressCalls);
+    PIPELINE_REPORT ("flush", stats.flush, stats.flushCalls);
+
+#undef PIPELINE_REPORT
+
+done:
+    bench_host_pair_destroy (server, client);
+    return result;
+}
+
+int
+bench_pipeline (void)
+{
+    if (pipeline_run ("plain", 0, 0, 0) < 0 ||
+        pipeline_run ("compress", 1, 0, 0) < 0 ||
+        pipeline_run ("encrypt", 0, 1, 0) < 0 ||
+        pipeline_run ("encrypt_inplace", 0, 1, 1) < 0 ||
+        pipeline_run ("compress_encrypt", 1, 1, 0) < 0 ||
+        pipeline_run ("compress_encrypt_inplace", 1, 1, 1) < 0)
+      return -1;
+
+    return 0;
+}
@@ -0,0 +1,165 @@
+/**
+ @file  bench_priority.c
+ @brief Latency of small input messages behind a concurrent bulk transfer, with and without channel priority
+
+ The client keeps about 4 MB of reliable bulk data queued on channel 1 and sends a timestamped
+ reliable input message on channel 0 every 5 milliseconds. Without priorities an input message
+ is queued behind the whole bulk backlog; with channel 0 given a higher priority through
+ enet_peer_set_channel_priority it is sent as soon as the reliable window has room.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define PRIORITY_INPUTS       400
+#define PRIORITY_INPUT_SIZE   32
+#define PRIORITY_INTERVAL_US  5000
+#define PRIORITY_BULK_SIZE    (256 * 1024)
+#define PRIORITY_BULK_BACKLOG 16
+
+typedef struct _PriorityReceived
+{
+   size_t inputs;
+   size_t bulkPackets;
+   double latencies [PRIORITY_INPUTS];
+} PriorityReceived;
+
+static void
+priority_received (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet, void * userData)
+{
+    PriorityReceived * received = (PriorityReceived *) userData;
+    enet_uint32 sentTime;
+
+    (void) peer;
+
+    if (channelID == 0)
+    {
+        memcpy (& sentTime, packet -> data, sizeof (sentTime));
+
+        if (received -> inputs < PRIORITY_INPUTS)
+          received -> latencies [received -> inputs ++] = (double) (enet_uint32) (enet_time_get_us () - sentTime);
+    }
+    else
+      ++ received -> bulkPackets;
+
+    enet_packet_destroy (packet);
+}
+
+static int
+priority_compare_latencies (const void * a, const void * b)
+{
+    double x = * (const double *) a, y = * (const double *) b;
+
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static int
+priority_run (const char * label, int prioritized)
+{
+    static PriorityReceived received;
+    ENetHost * server, * client;
+    ENetPeer * serverPeer, * clientPeer;
+    enet_uint8 input [PRIORITY_INPUT_SIZE];
+    enet_uint8 * bulk;
+    size_t bulkSent = 0, inputs;
+    enet_uint32 deadline;
+    char metric [64];
+    int result = 0;
+
+    memset (input, 0x11, sizeof (input));
+    memset (& received, 0, sizeof (received));
+
+    bulk = (enet_uint8 *) malloc (PRIORITY_BULK_SIZE);
+    if (bulk == NULL)
+      return -1;
+
+    memset (bulk, 0x22, PRIORITY_BULK_SIZE);
+
+    if (bench_host_pair_create (2, & server, & client, & serverPeer, & clientPeer) < 0)
+    {
+        free (bulk);
+        return -1;
+    }
+
+    if (prioritized && enet_peer_set_channel_priority (clientPeer, 0, 1, ENET_PEER_DEFAULT_CHANNEL_WEIGHT) < 0)
+    {
+        result = -1;
+        goto done;
+    }
+
+    for (inputs = 0; inputs < PRIORITY_INPUTS; ++ inputs)
+    {
+        enet_uint32 sentTime;
+
+        while (bulkSent < received.bulkPackets + PRIORITY_BULK_BACKLOG)
+        {
+            if (enet_peer_send (clientPeer, 1, enet_packet_create (bulk, PRIORITY_BULK_SIZE, ENET_PACKET_FLAG_RELIABLE)) < 0)
+            {
+                result = -1;
+                goto done;
+            }
+
+            ++ bulkSent;
+        }
+
+        sentTime = enet_time_get_us ();
+        memcpy (input, & sentTime, sizeof (sentTime));
+
+        if (enet_peer_send (clientPeer, 0, enet_packet_create (input, sizeof (input), ENET_PACKET_FLAG_RELIABLE)) < 0)
+        {
+            result = -1;
+            goto done;
+        }
+
+        do
+        {
+            if (bench_host_pair_pump (server, client, priority_received, & received) < 0)
+            {
+                result = -1;
+                goto done;
+            }
+        }
+        while ((enet_uint32) (enet_time_get_us () - sentTime) < PRIORITY_INTERVAL_US);
+    }
+
+    deadline = enet_time_get () + 10000;
+    while (received.inputs < PRIORITY_INPUTS && ENET_TIME_LESS (enet_time_get (), deadline))
+      if (bench_host_pair_pump (server, client, priority_received, & received) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    if (received.inputs < PRIORITY_INPUTS)
+    {
+        fprintf (stderr, "%s: only %u of %u inputs delivered\n", label, (unsigned) received.inputs, (unsigned) PRIORITY_INPUTS);
+        result = -1;
+        goto done;
+    }
+
+    qsort (received.latencies, received.inputs, sizeof (double), priority_compare_latencies);
+
+    sprintf (metric, "%s.input_p50_latency", label);
+    bench_report (metric, received.latencies [received.inputs / 2] / 1000.0, "ms");
+    sprintf (metric, "%s.input_p99_latency", label);
+    bench_report (metric, received.latencies [(received.inputs * 99) / 100] / 1000.0, "ms");
+    sprintf (metric, "%s.bulk_throughput", label);
+    bench_report (metric, (double) received.bulkPackets * PRIORITY_BULK_SIZE / (1024.0 * 1024.0) / (PRIORITY_INPUTS * PRIORITY_INTERVAL_US / 1e6), "MB/s");
+
+done:
+    bench_host_pair_destroy (server, client);
+    free (bulk);
+    return result;
+}
+
+int
+bench_priority (void)
+{
+    if (priority_run ("fifo", 0) < 0 ||
+        priority_run ("prioritized", 1) < 0)
+      return -1;
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+/**
+ @file  bench_reorder.c
+ @brief Cost of queueing reliable commands that arrive out of order, against how many are waiting
+
+ The client sends a burst of 16-byte reliable packets through a relay that holds every datagram,
+ then the relay releases them at once, in sending order or in reverse order. In reverse order
+ every command arrives ahead of the one the server waits for, so it has to be queued with all
+ the commands received before it until the first one comes in last and the whole burst is
+ delivered. The time the server takes to receive the burst is divided by its size.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define REORDER_PACKET_SIZE 16
+
+static int
+reorder_run (size_t burst, int reversed)
+{
+    static BenchRelay relay;
+    ENetHost * server, * client;
+    ENetPeer * clientPeer;
+    ENetEvent event;
+    enet_uint8 payload [REORDER_PACKET_SIZE];
+    size_t received = 0, packet;
+    enet_uint32 deadline;
+    bench_ticks elapsed;
+    char metric [64];
+    int result = 0, serviced;
+
+    memset (payload, 0x5A, sizeof (payload));
+
+    if (bench_relay_pair_create (& relay, 1, 0, ENET_PROTOCOL_MAXIMUM_SCALED_WINDOW_SIZE, & server, & client, & clientPeer) < 0)
+      return -1;
+
+    relay.held = 1;
+
+    for (packet = 0; packet < burst; ++ packet)
+      if (enet_peer_send (clientPeer, 0, enet_packet_create (payload, sizeof (payload), ENET_PACKET_FLAG_RELIABLE)) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    deadline = enet_time_get () + 5000;
+    while (enet_list_size (& clientPeer -> sentReliableCommands) < burst && ENET_TIME_LESS (enet_time_get (), deadline))
+      if (enet_host_service (client, NULL, 0) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    /* Let the last datagrams of the burst reach the relay. */
+    if (bench_relay_pump (& relay) < 0)
+    {
+        result = -1;
+        goto done;
+    }
+
+    elapsed = bench_ticks_fallback ();
+
+    if (bench_relay_release (& relay, reversed) < 0)
+    {
+        result = -1;
+        goto done;
+    }
+
+    while (received < burst && ENET_TIME_LESS (enet_time_get (), deadline))
+    {
+        for (serviced = enet_host_service (server, & event, 0);
+             serviced > 0;
+             serviced = enet_host_check_events (server, & event))
+          if (event.type == ENET_EVENT_TYPE_RECEIVE)
+          {
+              ++ received;
+              enet_packet_destroy (event.packet);
+          }
+
+        if (serviced < 0)
+        {
+            result = -1;
+            goto done;
+        }
+    }
+
+    elapsed = bench_ticks_fallback () - elapsed;
+
+    if (received < burst)
+    {
+        fprintf (stderr, "%u in a burst: only %u of them delivered\n", (unsigned) burst, (unsigned) received);
+        result = -1;
+        goto done;
+    }
+
+    sprintf (metric, "%s.burst%u.per_packet", reversed ? "reversed" : "in_order", (unsigned) burst);
+    bench_report (metric, (double) elapsed / burst, "ns");
+
+done:
+    bench_relay_pair_destroy (& relay, server, client);
+    return result;
+}
+
+int
+bench_reorder (void)
+{
+    static const size_t bursts [] = { 256, 1024, 4096, 8191 };
+    size_t i;
+
+    for (i = 0; i < sizeof (bursts) / sizeof (bursts [0]); ++ i)
+      if (reorder_run (bursts [i], 0) < 0 ||
+          reorder_run (bursts [i], 1) < 0)
+        return -1;
+
+    return 0;
+}
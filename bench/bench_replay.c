@@ -0,0 +1,193 @@
+/**
+ @file  bench_replay.c
+ @brief Replay of a captured server session: cost per datagram and determinism
+
+ A client connects to a server whose traffic is captured, sends bursts of reliable and unreliable
+ packets on two channels, then disconnects. The capture is then replayed several times into fresh
+ hosts configured as the server was. Every event of the server is folded into a digest, live and
+ in each replay: a replay is deterministic when its digest equals the live one, as the replayed
+ host then produced the same connects, packets and disconnects in the same order. The fastest
+ replay is reported per datagram fed, which is the cost of the receive path of the protocol
+ without the socket.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define REPLAY_FILE         "rcenet_bench_replay.pcap"
+#define REPLAY_CHANNELS     2
+#define REPLAY_ROUNDS       40
+#define REPLAY_PACKETS      200
+#define REPLAY_RUNS         8
+
+static enet_uint32
+replay_digest (enet_uint32 digest, const ENetEvent * event)
+{
+    enet_uint32 value = (enet_uint32) event -> type << 24;
+
+    if (event -> type == ENET_EVENT_TYPE_RECEIVE)
+      value |= (enet_uint32) event -> channelID << 16 | ((enet_uint32) event -> packet -> dataLength & 0xFFFF);
+
+    return (digest ^ value) * 16777619u;
+}
+
+/** Runs the captured session.
+    @returns the digest of the server events, or 0 on failure
+*/
+static enet_uint32
+replay_capture_session (size_t * eventCount)
+{
+    ENetHost * server = NULL, * client = NULL;
+    ENetPeer * clientPeer;
+    ENetAddress address;
+    ENetEvent event;
+    enet_uint8 payload [256];
+    enet_uint32 digest = 2166136261u, deadline = enet_time_get () + 10000;
+    size_t round, packet, expected = 0, received = 0;
+    int disconnected = 0;
+
+    memset (payload, 0x5A, sizeof (payload));
+
+    enet_address_build_loopback (& address, ENET_ADDRESS_TYPE_IPV4);
+
+    server = enet_host_create (ENET_ADDRESS_TYPE_IPV4, & address, 1, REPLAY_CHANNELS, 0, 0);
+    client = enet_host_create (ENET_ADDRESS_TYPE_IPV4, NULL, 1, REPLAY_CHANNELS, 0, 0);
+    if (server == NULL || client == NULL || enet_host_capture_open (server, REPLAY_FILE) < 0)
+      goto fail;
+
+    clientPeer = enet_host_connect (client, & server -> address, REPLAY_CHANNELS, 0);
+    if (clientPeer == NULL)
+      goto fail;
+
+    for (round = 0; ! disconnected; )
+    {
+        if (! ENET_TIME_LESS (enet_time_get (), deadline))
+          goto fail;
+
+        if (clientPeer -> state == ENET_PEER_STATE_CONNECTED && received == expected && clientPeer -> reliableDataInTransit == 0)
+        {
+            if (round == REPLAY_ROUNDS)
+              enet_peer_disconnect (clientPeer, 0);
+            else
+            {
+                for (packet = 0; packet < REPLAY_PACKETS; ++ packet)
+                  if (enet_peer_send (clientPeer, (enet_uint8) (packet & 1),
+                        enet_packet_create (payload, packet & 1 ? 64 : sizeof (payload), packet & 1 ? 0 : ENET_PACKET_FLAG_RELIABLE)) < 0)
+                    goto fail;
+
+                expected += REPLAY_PACKETS / 2;
+            }
+
+            ++ round;
+        }
+
+        if (enet_host_service (client, & event, 0) < 0)
+          goto fail;
+
+        while (enet_host_service (server, & event, 0) > 0)
+        {
+            digest = replay_digest (digest, & event);
+            ++ * eventCount;
+
+            if (event.type == ENET_EVENT_TYPE_RECEIVE)
+            {
+                if (event.packet -> flags & ENET_PACKET_FLAG_RELIABLE)
+                  ++ received;
+                enet_packet_destroy (event.packet);
+            }
+            else
+            if (event.type == ENET_EVENT_TYPE_DISCONNECT || event.type == ENET_EVENT_TYPE_DISCONNECT_TIMEOUT)
+              disconnected = 1;
+        }
+    }
+
+    bench_host_pair_destroy (server, client);
+    return digest;
+
+fail:
+    bench_host_pair_destroy (server, client);
+    return 0;
+}
+
+/** Replays the capture into a fresh host.
+    @returns the digest of its events, or 0 on failure
+*/
+static enet_uint32
+replay_run (bench_ticks * elapsed, enet_uint64 * datagrams)
+{
+    ENetReplay * replay = enet_replay_create (REPLAY_FILE);
+    ENetHost * host = enet_host_create (ENET_ADDRESS_TYPE_IPV4, NULL, 1, REPLAY_CHANNELS, 0, 0);
+    enet_uint32 digest = 2166136261u;
+    ENetEvent event;
+    bench_ticks start;
+    int result;
+
+    if (replay == NULL || host == NULL)
+      digest = 0;
+    else
+    {
+        start = bench_ticks_fallback ();
+
+        while ((result = enet_replay_service (replay, host, & event)) > 0)
+        {
+            digest = replay_digest (digest, & event);
+
+            if (event.type == ENET_EVENT_TYPE_RECEIVE)
+              enet_packet_destroy (event.packet);
+        }
+
+        * elapsed = bench_ticks_fallback () - start;
+        * datagrams = host -> stats.receivedDatagrams;
+
+        if (result < 0)
+          digest = 0;
+    }
+
+    if (host != NULL)
+      enet_host_destroy (host);
+    if (replay != NULL)
+      enet_replay_destroy (replay);
+    return digest;
+}
+
+int
+bench_replay (void)
+{
+    enet_uint32 live, digest;
+    enet_uint64 datagrams = 0;
+    bench_ticks fastest = 0, elapsed = 0;
+    size_t events = 0, run, deterministic = 0;
+
+    live = replay_capture_session (& events);
+    if (live == 0)
+    {
+        remove (REPLAY_FILE);
+        return -1;
+    }
+
+    for (run = 0; run < REPLAY_RUNS; ++ run)
+    {
+        digest = replay_run (& elapsed, & datagrams);
+        if (digest == 0)
+        {
+            remove (REPLAY_FILE);
+            return -1;
+        }
+
+        if (digest == live)
+          ++ deterministic;
+
+        if (fastest == 0 || elapsed < fastest)
+          fastest = elapsed;
+    }
+
+    remove (REPLAY_FILE);
+
+    bench_report ("events", (double) events, "events");
+    bench_report ("datagrams_replayed", (double) datagrams, "datagrams");
+    bench_report ("replay_per_datagram", (double) fastest / (double) (datagrams > 0 ? datagrams : 1), "ns");
+    bench_report ("runs_matching_live", (double) deterministic * 100.0 / REPLAY_RUNS, "%");
+
+    return deterministic == REPLAY_RUNS ? 0 : -1;
+}
@@ -0,0 +1,154 @@
+/**
+ @file  bench_retransmit.c
+ @brief Reliable channel stalls on a lossy link, with and without fast retransmit
+
+ The client and the server talk through a UDP relay that delays every datagram by 50 ms each
+ way and drops a fixed fraction of them in both directions. The client sends a timestamped
+ reliable message every millisecond; the stall of a message is how much later than the link
+ delay it was delivered, which is the time its channel spent waiting for a retransmission.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define RETRANSMIT_MESSAGES     2000
+#define RETRANSMIT_MESSAGE_SIZE 100
+#define RETRANSMIT_INTERVAL_US  1000
+#define RETRANSMIT_DELAY_US     50000
+
+typedef struct _RetransmitReceived
+{
+   size_t messages;
+   double stalls [RETRANSMIT_MESSAGES];
+} RetransmitReceived;
+
+static void
+retransmit_received (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet, void * userData)
+{
+    RetransmitReceived * received = (RetransmitReceived *) userData;
+    enet_uint32 sentTime, latency;
+
+    (void) peer;
+    (void) channelID;
+
+    memcpy (& sentTime, packet -> data, sizeof (sentTime));
+    latency = enet_time_get_us () - sentTime;
+
+    if (received -> messages < RETRANSMIT_MESSAGES)
+      received -> stalls [received -> messages ++] = latency > RETRANSMIT_DELAY_US ? (double) (latency - RETRANSMIT_DELAY_US) : 0.0;
+
+    enet_packet_destroy (packet);
+}
+
+static int
+retransmit_compare_stalls (const void * a, const void * b)
+{
+    double x = * (const double *) a, y = * (const double *) b;
+
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static int
+retransmit_pump (BenchRelay * relay, ENetHost * server, ENetHost * client, RetransmitReceived * received)
+{
+    if (bench_relay_pump (relay) < 0)
+      return -1;
+
+    return bench_host_pair_pump (server, client, received != NULL ? retransmit_received : NULL, received);
+}
+
+static int
+retransmit_run (const char * label, enet_uint32 lossPercent, enet_uint32 threshold)
+{
+    static BenchRelay relay;
+    static RetransmitReceived received;
+    ENetHost * server, * client;
+    ENetPeer * clientPeer;
+    enet_uint8 payload [RETRANSMIT_MESSAGE_SIZE];
+    enet_uint32 deadline, message;
+    char metric [64];
+    int result = 0;
+
+    memset (payload, 0x77, sizeof (payload));
+    memset (& received, 0, sizeof (received));
+
+    if (bench_relay_pair_create (& relay, 1, RETRANSMIT_DELAY_US, 0, & server, & client, & clientPeer) < 0)
+      return -1;
+
+    enet_peer_set_fast_retransmit (clientPeer, threshold);
+
+    relay.lossPercent = lossPercent;
+
+    for (message = 0; message < RETRANSMIT_MESSAGES; ++ message)
+    {
+        enet_uint32 sentTime = enet_time_get_us ();
+
+        memcpy (payload, & sentTime, sizeof (sentTime));
+
+        if (enet_peer_send (clientPeer, 0, enet_packet_create (payload, sizeof (payload), ENET_PACKET_FLAG_RELIABLE)) < 0)
+        {
+            result = -1;
+            goto done;
+        }
+
+        enet_host_flush (client);
+
+        do
+        {
+            if (retransmit_pump (& relay, server, client, & received) < 0)
+            {
+                result = -1;
+                goto done;
+            }
+        }
+        while ((enet_uint32) (enet_time_get_us () - sentTime) < RETRANSMIT_INTERVAL_US);
+    }
+
+    deadline = enet_time_get () + 20000;
+    while (received.messages < RETRANSMIT_MESSAGES && ENET_TIME_LESS (enet_time_get (), deadline))
+      if (retransmit_pump (& relay, server, client, & received) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    if (received.messages < RETRANSMIT_MESSAGES)
+    {
+        fprintf (stderr, "%s: only %u of %u messages delivered\n", label, (unsigned) received.messages, (unsigned) RETRANSMIT_MESSAGES);
+        result = -1;
+        goto done;
+    }
+
+    qsort (received.stalls, received.messages, sizeof (double), retransmit_compare_stalls);
+
+    sprintf (metric, "%s.loss%u.p50_stall", label, (unsigned) lossPercent);
+    bench_report (metric, received.stalls [received.messages / 2] / 1000.0, "ms");
+    sprintf (metric, "%s.loss%u.p99_stall", label, (unsigned) lossPercent);
+    bench_report (metric, received.stalls [(received.messages * 99) / 100] / 1000.0, "ms");
+    sprintf (metric, "%s.loss%u.max_stall", label, (unsigned) lossPercent);
+    bench_report (metric, received.stalls [received.messages - 1] / 1000.0, "ms");
+    sprintf (metric, "%s.loss%u.fast_retransmits", label, (unsigned) lossPercent);
+    bench_report (metric, (double) enet_peer_get_fast_retransmits (clientPeer), "commands");
+    sprintf (metric, "%s.loss%u.spurious_retransmits", label, (unsigned) lossPercent);
+    bench_report (metric, (double) enet_peer_get_spurious_retransmits (clientPeer), "commands");
+
+done:
+    bench_relay_pair_destroy (& relay, server, client);
+    return result;
+}
+
+int
+bench_retransmit (void)
+{
+    static const enet_uint32 lossPercents [] = { 1, 5 };
+    size_t i;
+
+    for (i = 0; i < sizeof (lossPercents) / sizeof (lossPercents [0]); ++ i)
+      if (retransmit_run ("timer_only", lossPercents [i], 0) < 0 ||
+          retransmit_run ("fast_retransmit", lossPercents [i], ENET_PEER_FAST_RETRANSMIT_THRESHOLD) < 0)
+        return -1;
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+/**
+ @file  bench_stream.c
+ @brief Peak memory and time to first byte of a large transfer, as one packet or as a stream
+
+ The client sends the same 24 MB asset to the server twice. As one packet it is copied into an
+ ENet packet, fragmented, and reassembled on the server before the application sees any of it.
+ As a stream it is produced chunk by chunk by a read callback and delivered to the server as the
+ chunks arrive. The peak is measured on the heap shared by both hosts through the allocator of
+ the benchmark, so it covers the sender and the receiver together.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define STREAM_ASSET_SIZE (24 * 1024 * 1024)
+
+typedef struct _StreamReceived
+{
+   size_t length;
+   int corrupted;
+   int ended;
+   bench_ticks firstByte;
+} StreamReceived;
+
+static enet_uint8
+stream_asset_byte (size_t offset)
+{
+    return (enet_uint8) (offset * 7 + (offset >> 12));
+}
+
+static size_t ENET_CALLBACK
+stream_read (ENetStream * stream, enet_uint8 * data, size_t dataLength)
+{
+    size_t * offset = (size_t *) stream -> data, i;
+
+    if (dataLength > STREAM_ASSET_SIZE - * offset)
+      dataLength = STREAM_ASSET_SIZE - * offset;
+
+    for (i = 0; i < dataLength; ++ i)
+      data [i] = stream_asset_byte (* offset + i);
+
+    * offset += dataLength;
+
+    return dataLength;
+}
+
+static void
+stream_received (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet, void * userData)
+{
+    StreamReceived * received = (StreamReceived *) userData;
+    size_t i;
+
+    (void) peer;
+    (void) channelID;
+
+    if (received -> firstByte == 0 && packet -> dataLength > 0)
+      received -> firstByte = bench_ticks_fallback ();
+
+    for (i = 0; i < packet -> dataLength; ++ i)
+      if (packet -> data [i] != stream_asset_byte (received -> length + i))
+      {
+          received -> corrupted = 1;
+          break;
+      }
+
+    received -> length += packet -> dataLength;
+
+    if (! (packet -> flags & ENET_PACKET_FLAG_STREAM) || (packet -> flags & ENET_PACKET_FLAG_STREAM_END))
+      received -> ended = 1;
+
+    enet_packet_destroy (packet);
+}
+
+static int
+stream_run (const char * label, int streamed)
+{
+    StreamReceived received;
+    ENetHost * server, * client;
+    ENetPeer * serverPeer, * clientPeer;
+    enet_uint8 * asset = NULL;
+    size_t offset = 0, i;
+    enet_uint32 deadline;
+    bench_ticks start, elapsed;
+    char metric [64];
+    int result = 0;
+
+    memset (& received, 0, sizeof (received));
+
+    if (bench_host_pair_create (1, & server, & client, & serverPeer, & clientPeer) < 0)
+      return -1;
+
+    if (! streamed)
+    {
+        /* The application's own copy of the asset lives outside the library heap. */
+        asset = (enet_uint8 *) malloc (STREAM_ASSET_SIZE);
+        if (asset == NULL)
+        {
+            result = -1;
+            goto done;
+        }
+
+        for (i = 0; i < STREAM_ASSET_SIZE; ++ i)
+          asset [i] = stream_asset_byte (i);
+    }
+
+    bench_heap_reset_peak ();
+    start = bench_ticks_fallback ();
+
+    if (streamed)
+    {
+        if (enet_peer_stream_open (clientPeer, 0, stream_read, & offset) == NULL)
+        {
+            result = -1;
+            goto done;
+        }
+    }
+    else if (enet_peer_send (clientPeer, 0, enet_packet_create (asset, STREAM_ASSET_SIZE, ENET_PACKET_FLAG_RELIABLE)) < 0)
+    {
+        result = -1;
+        goto done;
+    }
+
+    deadline = enet_time_get () + 60000;
+    while (! received.ended && ENET_TIME_LESS (enet_time_get (), deadline))
+      if (bench_host_pair_pump (server, client, stream_received, & received) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    elapsed = bench_ticks_fallback () - start;
+
+    if (! received.ended || received.length != STREAM_ASSET_SIZE || received.corrupted)
+    {
+        fprintf (stderr, "%s: %u of %u bytes delivered%s\n", label, (unsigned) received.length, (unsigned) STREAM_ASSET_SIZE, received.corrupted ? ", corrupted" : "");
+        result = -1;
+        goto done;
+    }
+
+    sprintf (metric, "%s.peak_heap", label);
+    bench_report (metric, (double) bench_heap_peak () / (1024.0 * 1024.0), "MB");
+    sprintf (metric, "%s.throughput", label);
+    bench_report (metric, elapsed > 0 ? (double) STREAM_ASSET_SIZE / (1024.0 * 1024.0) * 1e9 / elapsed : 0.0, "MB/s");
+    sprintf (metric, "%s.first_byte", label);
+    bench_report (metric, (double) (received.firstByte - start) / 1e6, "ms");
+
+done:
+    bench_host_pair_destroy (server, client);
+    free (asset);
+    return result;
+}
+
+int
+bench_stream (void)
+{
+    if (stream_run ("packet", 0) < 0 ||
+        stream_run ("stream", 1) < 0)
+      return -1;
+
+    return 0;
+}
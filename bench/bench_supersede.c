@@ -0,0 +1,156 @@
+/**
+ @file  bench_supersede.c
+ @brief Freshness and wire cost of keyed state updates sent faster than the link carries them, with and without superseding
+
+ The client sends a timestamped 1000-byte reliable update for one of 32 entities every 500
+ microseconds through a relay that delays every datagram by 50 ms each way, which limits the
+ reliable window to about 640 KB/s against the 2 MB/s offered. Queued in order, every update of
+ every entity is carried and the backlog keeps growing. Sent with enet_peer_send_superseding on a
+ superseding channel, an update that has not left yet is replaced by the next update of the same
+ entity, so the queue never holds more than one update per entity.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define SUPERSEDE_UPDATES     2000
+#define SUPERSEDE_ENTITIES    32
+#define SUPERSEDE_UPDATE_SIZE 1000
+#define SUPERSEDE_INTERVAL_US 500
+#define SUPERSEDE_DELAY_US    50000
+
+typedef struct _SupersedeReceived
+{
+   size_t updates;
+   double ages [SUPERSEDE_UPDATES];
+} SupersedeReceived;
+
+static void
+supersede_received (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet, void * userData)
+{
+    SupersedeReceived * received = (SupersedeReceived *) userData;
+    enet_uint32 sentTime;
+
+    (void) peer;
+    (void) channelID;
+
+    memcpy (& sentTime, packet -> data, sizeof (sentTime));
+
+    if (received -> updates < SUPERSEDE_UPDATES)
+      received -> ages [received -> updates ++] = (double) (enet_uint32) (enet_time_get_us () - sentTime);
+
+    enet_packet_destroy (packet);
+}
+
+static int
+supersede_compare_ages (const void * a, const void * b)
+{
+    double x = * (const double *) a, y = * (const double *) b;
+
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static int
+supersede_pump (BenchRelay * relay, ENetHost * server, ENetHost * client, SupersedeReceived * received)
+{
+    if (bench_relay_pump (relay) < 0)
+      return -1;
+
+    return bench_host_pair_pump (server, client, supersede_received, received);
+}
+
+static int
+supersede_run (const char * label, int superseding)
+{
+    static BenchRelay relay;
+    static SupersedeReceived received;
+    ENetHost * server, * client;
+    ENetPeer * clientPeer;
+    enet_uint8 payload [SUPERSEDE_UPDATE_SIZE];
+    enet_uint32 sentData, deadline, update;
+    char metric [64];
+    int result = 0;
+
+    memset (payload, 0x55, sizeof (payload));
+    memset (& received, 0, sizeof (received));
+
+    if (bench_relay_pair_create (& relay, 1, SUPERSEDE_DELAY_US, 0, & server, & client, & clientPeer) < 0)
+      return -1;
+
+    if (superseding && enet_peer_set_channel_superseding (clientPeer, 0, SUPERSEDE_ENTITIES) < 0)
+    {
+        result = -1;
+        goto done;
+    }
+
+    sentData = client -> totalSentData;
+
+    for (update = 0; update < SUPERSEDE_UPDATES; ++ update)
+    {
+        enet_uint32 sentTime = enet_time_get_us ();
+
+        memcpy (payload, & sentTime, sizeof (sentTime));
+
+        if (enet_peer_send_superseding (clientPeer, 0, enet_packet_create (payload, sizeof (payload), ENET_PACKET_FLAG_RELIABLE), update % SUPERSEDE_ENTITIES) < 0)
+        {
+            result = -1;
+            goto done;
+        }
+
+        do
+        {
+            if (supersede_pump (& relay, server, client, & received) < 0)
+            {
+                result = -1;
+                goto done;
+            }
+        }
+        while ((enet_uint32) (enet_time_get_us () - sentTime) < SUPERSEDE_INTERVAL_US);
+    }
+
+    deadline = enet_time_get () + 20000;
+    while (received.updates + enet_peer_get_superseded_packets (clientPeer) < SUPERSEDE_UPDATES && ENET_TIME_LESS (enet_time_get (), deadline))
+      if (supersede_pump (& relay, server, client, & received) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    sentData = client -> totalSentData - sentData;
+
+    if (received.updates == 0 || received.updates + enet_peer_get_superseded_packets (clientPeer) < SUPERSEDE_UPDATES)
+    {
+        fprintf (stderr, "%s: %u updates delivered and %u superseded out of %u\n", label, (unsigned) received.updates, (unsigned) enet_peer_get_superseded_packets (clientPeer), (unsigned) SUPERSEDE_UPDATES);
+        result = -1;
+        goto done;
+    }
+
+    qsort (received.ages, received.updates, sizeof (double), supersede_compare_ages);
+
+    sprintf (metric, "%s.delivered", label);
+    bench_report (metric, (double) received.updates, "updates");
+    sprintf (metric, "%s.superseded", label);
+    bench_report (metric, (double) enet_peer_get_superseded_packets (clientPeer), "updates");
+    sprintf (metric, "%s.p50_age", label);
+    bench_report (metric, received.ages [received.updates / 2] / 1000.0, "ms");
+    sprintf (metric, "%s.p99_age", label);
+    bench_report (metric, received.ages [(received.updates * 99) / 100] / 1000.0, "ms");
+    sprintf (metric, "%s.wire_bytes", label);
+    bench_report (metric, (double) sentData / 1024.0, "KB");
+
+done:
+    bench_relay_pair_destroy (& relay, server, client);
+    return result;
+}
+
+int
+bench_supersede (void)
+{
+    if (supersede_run ("queued", 0) < 0 ||
+        supersede_run ("superseding", 1) < 0)
+      return -1;
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+/**
+ @file  bench_sweep.c
+ @brief Cycles spent per connected peer by an idle enet_host_service sweep, against the number of peers
+
+ The peers are connected with bench_host_fan_connect and ping once a minute. Once they are
+ connected and nothing is queued, each enet_host_service call on the server only visits its
+ peers to find there is nothing to acknowledge, retransmit or send, which makes the cost of the
+ call the cost of bringing each peer through the cache. The median over many calls is reported
+ in ticks of bench_ticks_now, CPU cycles where a cycle counter is readable. Connecting grows with
+ the square of the peer count, which stops the scenario at 20000 peers.
+
+ At 1000 peers the whole peer array fits in the second level cache and the fixed cost of the
+ call, a receive system call among others, weighs as much as the peers; the layout of ENetPeer
+ shows from 5000 peers on.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+
+#define SWEEP_SAMPLES 101
+
+static int
+sweep_compare_ticks (const void * a, const void * b)
+{
+    bench_ticks x = * (const bench_ticks *) a, y = * (const bench_ticks *) b;
+
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static int
+sweep_run (size_t peerCount)
+{
+    static bench_ticks samples [SWEEP_SAMPLES];
+    ENetHost * server, * clients [BENCH_FAN_MAXIMUM_CLIENTS];
+    ENetAddress address;
+    ENetEvent event;
+    size_t clientCount, sample;
+    char metric [64];
+    int result = 0;
+
+    enet_address_build_loopback (& address, ENET_ADDRESS_TYPE_IPV4);
+
+    server = enet_host_create (ENET_ADDRESS_TYPE_IPV4, & address, peerCount, 1, 0, 0);
+    if (server == NULL)
+      return -1;
+
+    if (bench_host_fan_connect (server, peerCount, clients, & clientCount) < 0)
+    {
+        enet_host_destroy (server);
+        return -1;
+    }
+
+    for (sample = 0; sample < SWEEP_SAMPLES; ++ sample)
+    {
+        bench_ticks start = bench_ticks_now ();
+
+        if (enet_host_service (server, & event, 0) < 0)
+        {
+            result = -1;
+            goto done;
+        }
+
+        samples [sample] = bench_ticks_now () - start;
+
+        if (bench_host_fan_pump (server, clients, clientCount) < 0)
+        {
+            result = -1;
+            goto done;
+        }
+    }
+
+    qsort (samples, SWEEP_SAMPLES, sizeof (bench_ticks), sweep_compare_ticks);
+
+    sprintf (metric, "peers%u.service_per_peer", (unsigned) peerCount);
+    bench_report (metric, (double) samples [SWEEP_SAMPLES / 2] / peerCount, "ticks");
+
+done:
+    bench_host_fan_destroy (clients, clientCount);
+    enet_host_destroy (server);
+    return result;
+}
+
+int
+bench_sweep (void)
+{
+    static const size_t peerCounts [] = { 1000, 5000, 10000, 20000 };
+    size_t i;
+
+    for (i = 0; i < sizeof (peerCounts) / sizeof (peerCounts [0]); ++ i)
+      if (sweep_run (peerCounts [i]) < 0)
+        return -1;
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+/**
+ @file  bench_trace.c
+ @brief Cost of the protocol tracepoints on a reliable packet stream, trace disabled vs enabled
+
+ The client sends bursts of 256-byte reliable packets that the server acknowledges, the traffic
+ where the tracepoints fire most: every command is queued, sent and acknowledged, and every
+ datagram is traced on both ends. Two host pairs are connected, one tracing into a ring on both
+ hosts and one not, and rounds alternate between them so that both see the same loopback and
+ cache conditions; the ring is drained between rounds, outside the measured time. The fastest
+ round of each pair is compared, as slower rounds measure scheduler noise rather than the library.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define TRACE_ROUNDS       400
+#define TRACE_PACKETS      500
+#define TRACE_PACKET_SIZE  256
+#define TRACE_RING         (1 << 12)
+
+/** Sends one burst and services both hosts until the server received all of it.
+    @returns the elapsed nanoseconds, or 0 on failure
+*/
+static bench_ticks
+trace_round (ENetHost * server, ENetHost * client, ENetPeer * clientPeer, const enet_uint8 * payload)
+{
+    enet_uint32 deadline = enet_time_get () + 5000;
+    bench_ticks start = bench_ticks_fallback ();
+    size_t packet, received = 0;
+    int count;
+
+    for (packet = 0; packet < TRACE_PACKETS; ++ packet)
+      if (enet_peer_send (clientPeer, 0, enet_packet_create (payload, TRACE_PACKET_SIZE, ENET_PACKET_FLAG_RELIABLE)) < 0)
+        return 0;
+
+    while (received < TRACE_PACKETS || clientPeer -> reliableDataInTransit > 0)
+    {
+        if ((count = bench_host_pair_pump (server, client, NULL, NULL)) < 0 || ! ENET_TIME_LESS (enet_time_get (), deadline))
+          return 0;
+
+        received += (size_t) count;
+    }
+
+    return bench_ticks_fallback () - start + 1;
+}
+
+static size_t
+trace_drain (ENetHost * host)
+{
+    static ENetTraceEvent events [4096];
+    size_t total = 0, count;
+
+    while ((count = enet_host_trace_read (host, events, sizeof (events) / sizeof (events [0]))) > 0)
+      total += count;
+
+    return total;
+}
+
+int
+bench_trace (void)
+{
+    ENetHost * server [2] = { NULL, NULL }, * client [2] = { NULL, NULL };
+    ENetPeer * serverPeer, * clientPeer [2];
+    enet_uint8 payload [TRACE_PACKET_SIZE];
+    bench_ticks fastest [2] = { 0, 0 };
+    size_t events = 0, round;
+    int result = 0, traced;
+
+    memset (payload, 0x7E, sizeof (payload));
+
+    for (traced = 0; traced < 2; ++ traced)
+      if (bench_host_pair_create (1, & server [traced], & client [traced], & serverPeer, & clientPeer [traced]) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    if (enet_host_trace_enable (server [1], TRACE_RING) < 0 || enet_host_trace_enable (client [1], TRACE_RING) < 0)
+    {
+        fprintf (stderr, "the tracepoints are compiled out (ENET_NO_TRACE)\n");
+        result = -1;
+        goto done;
+    }
+
+    for (round = 0; round < TRACE_ROUNDS; ++ round)
+    {
+        bench_ticks elapsed;
+
+        traced = (int) (round & 1);
+
+        elapsed = trace_round (server [traced], client [traced], clientPeer [traced], payload);
+        if (elapsed == 0)
+        {
+            result = -1;
+            goto done;
+        }
+
+        if (traced)
+          events += trace_drain (server [1]) + trace_drain (client [1]);
+
+        if (fastest [traced] == 0 || elapsed < fastest [traced])
+          fastest [traced] = elapsed;
+    }
+
+    bench_report ("untraced_per_packet", (double) fastest [0] / TRACE_PACKETS, "ns");
+    bench_report ("traced_per_packet", (double) fastest [1] / TRACE_PACKETS, "ns");
+    bench_report ("events_per_packet", (double) events / (TRACE_ROUNDS / 2 * TRACE_PACKETS), "events");
+    bench_report ("overhead", ((double) fastest [1] - (double) fastest [0]) * 100.0 / (double) fastest [0], "%");
+
+done:
+    for (traced = 0; traced < 2; ++ traced)
+      bench_host_pair_destroy (server [traced], client [traced]);
+    return result;
+}
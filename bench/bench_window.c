@@ -0,0 +1,108 @@
+/**
+ @file  bench_window.c
+ @brief Throughput of a reliable bulk transfer over a 100 ms round trip, with the default and scaled flow control windows
+
+ The client sends 8 MB of reliable data as 1 MB packets through a relay that delays every
+ datagram by 50 ms each way. With the default 64 KB window the sender can only have 64 KB in
+ flight per round trip, about 640 KB/s. With enet_host_window_limit raised on both hosts the
+ window negotiated at connection is larger and the link is used that much more.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#define WINDOW_PACKETS     8
+#define WINDOW_PACKET_SIZE (1024 * 1024)
+#define WINDOW_DELAY_US    50000
+
+static void
+window_received (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet, void * userData)
+{
+    size_t * received = (size_t *) userData;
+
+    (void) peer;
+    (void) channelID;
+
+    if (packet -> dataLength == WINDOW_PACKET_SIZE)
+      ++ * received;
+
+    enet_packet_destroy (packet);
+}
+
+static int
+window_run (const char * label, enet_uint32 windowLimit)
+{
+    static BenchRelay relay;
+    ENetHost * server, * client;
+    ENetPeer * clientPeer;
+    enet_uint8 * payload;
+    size_t received = 0, packet;
+    enet_uint32 deadline;
+    bench_ticks elapsed;
+    char metric [64];
+    int result = 0;
+
+    payload = (enet_uint8 *) malloc (WINDOW_PACKET_SIZE);
+    if (payload == NULL)
+      return -1;
+
+    memset (payload, 0x5A, WINDOW_PACKET_SIZE);
+
+    if (bench_relay_pair_create (& relay, 1, WINDOW_DELAY_US, windowLimit, & server, & client, & clientPeer) < 0)
+    {
+        free (payload);
+        return -1;
+    }
+
+    elapsed = bench_ticks_fallback ();
+
+    for (packet = 0; packet < WINDOW_PACKETS; ++ packet)
+      if (enet_peer_send (clientPeer, 0, enet_packet_create (payload, WINDOW_PACKET_SIZE, ENET_PACKET_FLAG_RELIABLE)) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    deadline = enet_time_get () + 60000;
+    while (received < WINDOW_PACKETS && ENET_TIME_LESS (enet_time_get (), deadline))
+      if (bench_relay_pump (& relay) < 0 ||
+          bench_host_pair_pump (server, client, window_received, & received) < 0)
+      {
+          result = -1;
+          goto done;
+      }
+
+    elapsed = bench_ticks_fallback () - elapsed;
+
+    if (received < WINDOW_PACKETS)
+    {
+        fprintf (stderr, "%s: only %u of %u packets delivered\n", label, (unsigned) received, (unsigned) WINDOW_PACKETS);
+        result = -1;
+        goto done;
+    }
+
+    sprintf (metric, "%s.window", label);
+    bench_report (metric, (double) clientPeer -> windowSize / 1024.0, "KB");
+    sprintf (metric, "%s.throughput", label);
+    bench_report (metric, elapsed > 0 ? (double) WINDOW_PACKETS * WINDOW_PACKET_SIZE / (1024.0 * 1024.0) * 1e9 / elapsed : 0.0, "MB/s");
+    sprintf (metric, "%s.transfer_time", label);
+    bench_report (metric, (double) elapsed / 1e6, "ms");
+
+done:
+    bench_relay_pair_destroy (& relay, server, client);
+    free (payload);
+    return result;
+}
+
+int
+bench_window (void)
+{
+    if (window_run ("default", 0) < 0 ||
+        window_run ("scaled_1m", 1024 * 1024) < 0 ||
+        window_run ("scaled_4m", 4 * 1024 * 1024) < 0)
+      return -1;
+
+    return 0;
+}
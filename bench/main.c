@@ -0,0 +1,812 @@
+/**
+ @file  main.c
+ @brief rcenet_bench entry point, scenario table and shared helpers
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rcenet/time.h"
+#include "bench.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+extern int bench_loopback (void);
+extern int bench_connect (void);
+extern int bench_codec (void);
+extern int bench_latency (void);
+extern int bench_pipeline (void);
+extern int bench_broadcast (void);
+extern int bench_multicast (void);
+extern int bench_aggregation (void);
+extern int bench_coalescing (void);
+extern int bench_fec (void);
+extern int bench_retransmit (void);
+extern int bench_bulk (void);
+extern int bench_stream (void);
+extern int bench_priority (void);
+extern int bench_expiry (void);
+extern int bench_supersede (void);
+extern int bench_window (void);
+extern int bench_acks (void);
+extern int bench_reorder (void);
+extern int bench_sweep (void);
+extern int bench_capacity (void);
+extern int bench_churn (void);
+extern int bench_trace (void);
+extern int bench_replay (void);
+extern int bench_network (void);
+
+static const BenchScenario scenarios [] =
+{
+   { "loopback", "1 s of unreliable, reliable and fragmented traffic over loopback: packets/s and MB/s per kind", bench_loopback },
+   { "connect", "1024 connections started at once, then dropped at once: connects/s and disconnects/s, best of 3", bench_connect },
+   { "codec", "range coder on 1400-byte snapshots and enet_crc32 on 1400 B/64 KB buffers: MB/s and compression ratio", bench_codec },
+   { "latency", "reliable 1 ms probes echoed by the server: RTT percentiles idle and behind a bulk reliable stream", bench_latency },
+   { "pipeline", "per-stage ticks of the compress/encrypt transform pipeline, in place vs out of place", bench_pipeline },
+   { "broadcast", "fragmented broadcast to many peers: serialize-once fan-out vs enet_peer_send loop", bench_broadcast },
+   { "multicast", "area-of-interest sends to 50-200 peers: enet_host_send_to_peers vs enet_peer_send loop", bench_multicast },
+   { "aggregation", "bursts of 20-byte messages: datagrams and header overhead with and without channel aggregation", bench_aggregation },
+   { "coalescing", "one small send + enet_host_flush every 20us: datagram fill and latency with per-peer coalescing", bench_coalescing },
+   { "fec", "1-10% datagram loss: delivery rate and p99 latency with and without channel FEC", bench_fec },
+   { "retransmit", "reliable stream over a lossy 100ms-RTT relay: channel stalls with and without fast retransmit", bench_retransmit },
+   { "bulk", "4 MB reliable packets: throughput and copies, ENet-allocated vs reassembled in place", bench_bulk },
+   { "stream", "24 MB transfer: peak library heap and time to first byte, one packet vs enet_peer_stream_open", bench_stream },
+   { "priority", "input latency on channel 0 behind a 4 MB bulk backlog on channel 1, FIFO vs channel priority", bench_priority },
+   { "expiry", "reliable updates offered at 3x a 100ms-RTT link: age of delivered updates with and without a time to live", bench_expiry },
+   { "supersede", "keyed updates for 32 entities offered at 3x a 100ms-RTT link: age and wire bytes, queued vs superseded", bench_supersede },
+   { "window", "8 MB reliable transfer over a 100ms-RTT relay: throughput with the default 64 KB window vs enet_host_window_limit", bench_window },
+   { "acks", "256-8191 reliable commands in flight: cost per acknowledgement, in order and in reverse order", bench_acks },
+   { "reorder", "bursts of 256-8191 reliable packets delivered in order or reversed: receive cost per packet", bench_reorder },
+   { "sweep", "1k, 5k, 10k and 20k idle connected peers: enet_host_service ticks per peer", bench_sweep },
+   { "capacity", "host created for 65535 peers: resident memory with 0, 1k and 10k connected peers and after release", bench_capacity },
+   { "churn", "an hour of simulated connect/disconnect churn: enet_malloc calls per session and resident memory growth", bench_churn },
+   { "trace", "reliable packet stream: per-packet cost with the protocol tracepoints disabled vs tracing into a ring", bench_trace },
+   { "replay", "captured server session replayed into fresh hosts: cost per datagram and events matching the live run", bench_replay },
+   { "network", "2 MB reliable transfer over simulated 50ms-RTT 2 MB/s links with 0-5% loss: goodput, determinism and speed vs real time", bench_network }
+};
+
+static const BenchScenario * currentScenario = NULL;
+static int jsonOutput = 0;
+static size_t jsonResults = 0;
+static size_t allocations = 0;
+static size_t heapInUse = 0;
+static size_t heapPeak = 0;
+
+/* Every block handed to the library is preceded by its size, kept in a header large enough to preserve alignment. */
+#define BENCH_HEAP_HEADER 16
+
+static void * ENET_CALLBACK
+bench_malloc (size_t size)
+{
+    unsigned char * block = (unsigned char *) malloc (BENCH_HEAP_HEADER + size);
+
+    ++ allocations;
+
+    if (block == NULL)
+      return NULL;
+
+    memcpy (block, & size, sizeof (size));
+
+    heapInUse += size;
+    if (heapInUse > heapPeak)
+      heapPeak = heapInUse;
+
+    return block + BENCH_HEAP_HEADER;
+}
+
+static void ENET_CALLBACK
+bench_free (void * memory)
+{
+    unsigned char * block;
+    size_t size;
+
+    if (memory == NULL)
+      return;
+
+    block = (unsigned char *) memory - BENCH_HEAP_HEADER;
+    memcpy (& size, block, sizeof (size));
+
+    heapInUse -= size;
+
+    free (block);
+}
+
+size_t
+bench_allocations (void)
+{
+    return allocations;
+}
+
+size_t
+bench_heap_in_use (void)
+{
+    return heapInUse;
+}
+
+size_t
+bench_heap_peak (void)
+{
+    return heapPeak;
+}
+
+void
+bench_heap_reset_peak (void)
+{
+    heapPeak = heapInUse;
+}
+
+bench_ticks
+bench_ticks_fallback (void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+
+    QueryPerformanceCounter (& counter);
+    QueryPerformanceFrequency (& frequency);
+
+    return (bench_ticks) (counter.QuadPart * 1000000000.0 / frequency.QuadPart);
+#else
+    struct timespec now;
+
+    clock_gettime (CLOCK_MONOTONIC, & now);
+
+    return (bench_ticks) now.tv_sec * 1000000000ULL + (bench_ticks) now.tv_nsec;
+#endif
+}
+
+size_t
+bench_resident_memory (void)
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (! GetProcessMemoryInfo (GetCurrentProcess (), & counters, sizeof (counters)))
+      return 0;
+
+    return (size_t) counters.WorkingSetSize;
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+    if (task_info (mach_task_self (), MACH_TASK_BASIC_INFO, (task_info_t) & info, & count) != KERN_SUCCESS)
+      return 0;
+
+    return (size_t) info.resident_size;
+#else
+    unsigned long size, resident;
+    FILE * statm = fopen ("/proc/self/statm", "r");
+    int parsed;
+
+    if (statm == NULL)
+      return 0;
+
+    parsed = fscanf (statm, "%lu %lu", & size, & resident);
+    fclose (statm);
+
+    return parsed == 2 ? (size_t) resident * (size_t) sysconf (_SC_PAGESIZE) : 0;
+#endif
+}
+
+/** Prints a JSON string; the names printed contain no control characters. */
+static void
+bench_json_string (const char * string)
+{
+    putchar ('"');
+    for (; * string != '\0'; ++ string)
+    {
+        if (* string == '"' || * string == '\\')
+          putchar ('\\');
+        putchar (* string);
+    }
+    putchar ('"');
+}
+
+void
+bench_report (const char * metric, double value, const char * unit)
+{
+    const char * scenario = currentScenario != NULL ? currentScenario -> name : "-";
+
+    if (! jsonOutput)
+      printf ("%-12s %-48s %16.2f %s\n", scenario, metric, value, unit);
+    else
+    {
+        printf ("%s\n    { \"scenario\": ", jsonResults > 0 ? "," : "");
+        bench_json_string (scenario);
+        printf (", \"metric\": ");
+        bench_json_string (metric);
+        if (isfinite (value))
+          printf (", \"value\": %.17g, \"unit\": ", value);
+        else
+          printf (", \"value\": null, \"unit\": ");
+        bench_json_string (unit);
+        printf (" }");
+
+        ++ jsonResults;
+    }
+
+    fflush (stdout);
+}
+
+int
+bench_host_pair_create (size_t channelCount, ENetHost ** server, ENetHost ** client, ENetPeer ** serverPeer, ENetPeer ** clientPeer)
+{
+    ENetAddress address;
+    ENetEvent event;
+    enet_uint32 deadline;
+
+    * server = NULL;
+    * client = NULL;
+    * serverPeer = NULL;
+    * clientPeer = NULL;
+
+    enet_address_build_loopback (& address, ENET_ADDRESS_TYPE_IPV4);
+
+    * server = enet_host_create (ENET_ADDRESS_TYPE_IPV4, & address, 1, channelCount, 0, 0);
+    * client = enet_host_create (ENET_ADDRESS_TYPE_IPV4, NULL, 1, channelCount, 0, 0);
+    if (* server == NULL || * client == NULL)
+      goto fail;
+
+    * clientPeer = enet_host_connect (* client, & (* server) -> address, channelCount, 0);
+    if (* clientPeer == NULL)
+      goto fail;
+
+    deadline = enet_time_get () + 5000;
+    while ((* serverPeer == NULL || (* clientPeer) -> state != ENET_PEER_STATE_CONNECTED) &&
+           ENET_TIME_LESS (enet_time_get (), deadline))
+    {
+        if (enet_host_service (* client, & event, 1) < 0 ||
+            enet_host_service (* server, & event, 1) < 0)
+          goto fail;
+
+        if (event.type == ENET_EVENT_TYPE_CONNECT)
+          * serverPeer = event.peer;
+    }
+
+    if (* serverPeer != NULL && (* clientPeer) -> state == ENET_PEER_STATE_CONNECTED)
+      return 0;
+
+fail:
+    bench_host_pair_destroy (* server, * client);
+    * server = NULL;
+    * client = NULL;
+    return -1;
+}
+
+void
+bench_host_pair_destroy (ENetHost * server, ENetHost * client)
+{
+    if (client != NULL)
+      enet_host_destroy (client);
+    if (server != NULL)
+      enet_host_destroy (server);
+}
+
+static int
+bench_relay_create (BenchRelay * relay, const ENetAddress * serverAddress, enet_uint32 delay)
+{
+    memset (relay, 0, sizeof (BenchRelay));
+
+    relay -> serverAddress = * serverAddress;
+    relay -> delay = delay;
+    relay -> seed = 0x9E3779B9;
+
+    enet_address_build_loopback (& relay -> address, ENET_ADDRESS_TYPE_IPV4);
+
+    relay -> socket = enet_socket_create (ENET_ADDRESS_TYPE_IPV4, ENET_SOCKET_TYPE_DATAGRAM);
+    if (relay -> socket == ENET_SOCKET_NULL)
+      return -1;
+
+    if (enet_socket_bind (relay -> socket, & relay -> address) < 0 ||
+        enet_socket_get_address (relay -> socket, & relay -> address) < 0)
+    {
+        enet_socket_destroy (relay -> socket);
+        relay -> socket = ENET_SOCKET_NULL;
+        return -1;
+    }
+
+    enet_socket_set_option (relay -> socket, ENET_SOCKOPT_NONBLOCK, 1);
+    enet_socket_set_option (relay -> socket, ENET_SOCKOPT_RCVBUF, BENCH_RELAY_BUFFER_SIZE);
+    enet_socket_set_option (relay -> socket, ENET_SOCKOPT_SNDBUF, BENCH_RELAY_BUFFER_SIZE);
+
+    return 0;
+}
+
+int
+bench_relay_pump (BenchRelay * relay)
+{
+    enet_uint32 now = enet_time_get_us ();
+
+    for (;;)
+    {
+        BenchRelayDatagram * datagram = & relay -> queue [(relay -> head + relay -> count) % BENCH_RELAY_SLOTS];
+        ENetAddress address;
+        ENetBuffer buffer;
+        int receivedLength;
+
+        buffer.data = datagram -> data;
+        buffer.dataLength = sizeof (datagram -> data);
+
+        receivedLength = enet_socket_receive (relay -> socket, & address, & buffer, 1);
+        if (receivedLength == 0)
+          break;
+        if (receivedLength < 0)
+          return -1;
+
+        datagram -> toServer = ! enet_address_equal (& address, & relay -> serverAddress);
+        if (datagram -> toServer)
+          relay -> clientAddress = address;
+
+        relay -> seed = relay -> seed * 1664525 + 1013904223;
+        if ((relay -> seed >> 8) % 100 < relay -> lossPercent || relay -> count >= BENCH_RELAY_SLOTS)
+          continue;
+
+        datagram -> deliverTime = now + relay -> delay;
+        datagram -> dataLength = (size_t) receivedLength;
+        ++ relay -> count;
+    }
+
+    while (relay -> count > 0 && ! relay -> held)
+    {
+        BenchRelayDatagram * datagram = & relay -> queue [relay -> head];
+        ENetBuffer buffer;
+
+        if ((enet_uint32) (now - datagram -> deliverTime) >= 0x80000000)
+          break;
+
+        buffer.data = datagram -> data;
+        buffer.dataLength = datagram -> dataLength;
+
+        if (enet_socket_send (relay -> socket, datagram -> toServer ? & relay -> serverAddress : & relay -> clientAddress, & buffer, 1) < 0)
+          return -1;
+
+        relay -> head = (relay -> head + 1) % BENCH_RELAY_SLOTS;
+        -- relay -> count;
+    }
+
+    return 0;
+}
+
+int
+bench_relay_release (BenchRelay * relay, int reversed)
+{
+    size_t i;
+
+    for (i = 0; reversed && i < relay -> count / 2; ++ i)
+    {
+        static BenchRelayDatagram swap;
+        BenchRelayDatagram * first = & relay -> queue [(relay -> head + i) % BENCH_RELAY_SLOTS],
+                           * last = & relay -> queue [(relay -> head + relay -> count - 1 - i) % BENCH_RELAY_SLOTS];
+
+        swap = * first;
+        * first = * last;
+        * last = swap;
+    }
+
+    for (; relay -> count > 0; -- relay -> count)
+    {
+        BenchRelayDatagram * datagram = & relay -> queue [relay -> head];
+        ENetBuffer buffer;
+
+        buffer.data = datagram -> data;
+        buffer.dataLength = datagram -> dataLength;
+
+        if (enet_socket_send (relay -> socket, datagram -> toServer ? & relay -> serverAddress : & relay -> clientAddress, & buffer, 1) < 0)
+          return -1;
+
+        relay -> head = (relay -> head + 1) % BENCH_RELAY_SLOTS;
+    }
+
+    return 0;
+}
+
+int
+bench_relay_pair_create (BenchRelay * relay, size_t channelCount, enet_uint32 delay, enet_uint32 windowLimit, ENetHost ** server, ENetHost ** client, ENetPeer ** clientPeer)
+{
+    ENetAddress address;
+    ENetEvent event;
+    enet_uint32 deadline;
+
+    * client = NULL;
+    * clientPeer = NULL;
+    relay -> socket = ENET_SOCKET_NULL;
+
+    enet_address_build_loopback (& address, ENET_ADDRESS_TYPE_IPV4);
+
+    * server = enet_host_create (ENET_ADDRESS_TYPE_IPV4, & address, 1, channelCount, 0, 0);
+    if (* server == NULL ||
+        bench_relay_create (relay, & (* server) -> address, delay) < 0)
+      goto fail;
+
+    * client = enet_host_create (ENET_ADDRESS_TYPE_IPV4, NULL, 1, channelCount, 0, 0);
+    if (* client == NULL)
+      goto fail;
+
+    enet_host_window_limit (* server, windowLimit);
+    enet_host_window_limit (* client, windowLimit);
+
+    * clientPeer = enet_host_connect (* client, & relay -> address, channelCount, 0);
+    if (* clientPeer == NULL)
+      goto fail;
+
+    /* The server peer only leaves ENET_PEER_STATE_ACKNOWLEDGING_CONNECT when the acknowledgement
+       of its verify connect, which the client sends last, has gone through the relay. */
+    deadline = enet_time_get () + 5000;
+    while (((* clientPeer) -> state != ENET_PEER_STATE_CONNECTED || (* server) -> committedPeers == 0 || (* server) -> peers [0].state != ENET_PEER_STATE_CONNECTED) &&
+           ENET_TIME_LESS (enet_time_get (), deadline))
+    {
+        if (bench_relay_pump (relay) < 0 ||
+            enet_host_service (* client, & event, 0) < 0 ||
+            enet_host_service (* server, & event, 0) < 0)
+          goto fail;
+    }
+
+    if ((* clientPeer) -> state == ENET_PEER_STATE_CONNECTED && (* server) -> committedPeers > 0 && (* server) -> peers [0].state == ENET_PEER_STATE_CONNECTED)
+      return 0;
+
+    fprintf (stderr, "could not connect through the relay\n");
+
+fail:
+    bench_relay_pair_destroy (relay, * server, * client);
+    * server = NULL;
+    * client = NULL;
+    return -1;
+}
+
+void
+bench_relay_pair_destroy (BenchRelay * relay, ENetHost * server, ENetHost * client)
+{
+    bench_host_pair_destroy (server, client);
+
+    if (relay -> socket != ENET_SOCKET_NULL)
+    {
+        enet_socket_destroy (relay -> socket);
+        relay -> socket = ENET_SOCKET_NULL;
+    }
+}
+
+int
+bench_host_star_create (size_t clientCount, size_t channelCount, ENetHost ** server, ENetHost ** clients)
+{
+    ENetAddress address;
+    ENetEvent event;
+    enet_uint32 deadline;
+    size_t i, connected = 0;
+
+    memset (clients, 0, clientCount * sizeof (ENetHost *));
+
+    enet_address_build_loopback (& address, ENET_ADDRESS_TYPE_IPV4);
+
+    * server = enet_host_create (ENET_ADDRESS_TYPE_IPV4, & address, clientCount, channelCount, 0, 0);
+    if (* server == NULL)
+      return -1;
+
+    for (i = 0; i < clientCount; ++ i)
+    {
+        clients [i] = enet_host_create (ENET_ADDRESS_TYPE_IPV4, NULL, 1, channelCount, 0, 0);
+        if (clients [i] == NULL ||
+            enet_host_connect (clients [i], & (* server) -> address, channelCount, 0) == NULL)
+          goto fail;
+    }
+
+    deadline = enet_time_get () + 10000;
+    while (connected < clientCount && ENET_TIME_LESS (enet_time_get (), deadline))
+    {
+        for (i = 0; i < clientCount; ++ i)
+          if (enet_host_service (clients [i], & event, 0) < 0)
+            goto fail;
+
+        while (enet_host_service (* server, & event, 1) > 0)
+          if (event.type == ENET_EVENT_TYPE_CONNECT)
+            ++ connected;
+    }
+
+    /* Let the clients see the verify-connect as well. */
+    for (i = 0; i < clientCount; ++ i)
+      while (enet_host_service (clients [i], & event, 0) > 0);
+
+    if (connected == clientCount)
+      return 0;
+
+fail:
+    bench_host_star_destroy (* server, clients, clientCount);
+    * server = NULL;
+    return -1;
+}
+
+void
+bench_host_star_destroy (ENetHost * server, ENetHost ** clients, size_t clientCount)
+{
+    size_t i;
+
+    for (i = 0; i < clientCount; ++ i)
+      if (clients [i] != NULL)
+      {
+          enet_host_destroy (clients [i]);
+          clients [i] = NULL;
+      }
+
+    if (server != NULL)
+      enet_host_destroy (server);
+}
+
+int
+bench_host_star_pump (ENetHost * server, ENetHost ** clients, size_t clientCount)
+{
+    size_t i;
+    int count = 0, result;
+
+    for (i = 0; i < clientCount; ++ i)
+    {
+        result = bench_host_pair_pump (server, clients [i], NULL, NULL);
+        if (result < 0)
+          return -1;
+        count += result;
+    }
+
+    return count;
+}
+
+static int
+bench_host_fan_service (ENetHost * host, size_t * connected, size_t * failed)
+{
+    ENetEvent event;
+    int result;
+
+    for (result = enet_host_service (host, & event, 0);
+         result > 0;
+         result = enet_host_check_events (host, & event))
+      switch (event.type)
+      {
+      case ENET_EVENT_TYPE_CONNECT:
+          /* Idle peers would otherwise ping every 500 ms, which at tens of thousands of peers
+             is more traffic than anything measured on them. */
+          enet_peer_ping_interval (event.peer, BENCH_FAN_PING_INTERVAL);
+          enet_peer_timeout (event.peer, 0, BENCH_FAN_PING_INTERVAL * 2, BENCH_FAN_PING_INTERVAL * 4);
+
+          if (connected != NULL)
+            ++ * connected;
+          break;
+
+      case ENET_EVENT_TYPE_DISCONNECT:
+      case ENET_EVENT_TYPE_DISCONNECT_TIMEOUT:
+          if (failed != NULL)
+            ++ * failed;
+          break;
+
+      case ENET_EVENT_TYPE_RECEIVE:
+          enet_packet_destroy (event.packet);
+          break;
+
+      default:
+          break;
+      }
+
+    return result;
+}
+
+int
+bench_host_fan_connect (ENetHost * server, size_t peerCount, ENetHost ** clients, size_t * clientCount)
+{
+    size_t requested = 0, connected = 0, failed = 0, i;
+    enet_uint32 deadline;
+
+    * clientCount = (peerCount + BENCH_FAN_CLIENT_PEERS - 1) / BENCH_FAN_CLIENT_PEERS;
+    memset (clients, 0, * clientCount * sizeof (ENetHost *));
+
+    enet_socket_set_option (server -> socket, ENET_SOCKOPT_RCVBUF, BENCH_RELAY_BUFFER_SIZE);
+
+    for (i = 0; i < * clientCount; ++ i)
+    {
+        clients [i] = enet_host_create (ENET_ADDRESS_TYPE_IPV4, NULL, BENCH_FAN_CLIENT_PEERS, 1, 0, 0);
+        if (clients [i] == NULL)
+          goto fail;
+
+        enet_socket_set_option (clients [i] -> socket, ENET_SOCKOPT_RCVBUF, BENCH_RELAY_BUFFER_SIZE);
+    }
+
+    deadline = enet_time_get () + 120000;
+    while (connected < peerCount - peerCount / 100 && ENET_TIME_LESS (enet_time_get (), deadline))
+    {
+        /* Keep a bounded number of handshakes in flight so that they do not overflow the socket
+           buffers, and retry the attempts that timed out. */
+        while (requested - failed < peerCount && requested - failed < connected + BENCH_FAN_CONNECT_BATCH)
+        {
+            if (enet_host_connect (clients [(requested - failed) / BENCH_FAN_CLIENT_PEERS], & server -> address, 1, 0) == NULL)
+              goto fail;
+
+            ++ requested;
+        }
+
+        if (bench_host_fan_service (server, & connected, NULL) < 0)
+          goto fail;
+
+        for (i = 0; i < * clientCount; ++ i)
+          if (bench_host_fan_service (clients [i], NULL, & failed) < 0)
+            goto fail;
+    }
+
+    if (connected < peerCount - peerCount / 100)
+    {
+        fprintf (stderr, "%u peers: only %u of them connected\n", (unsigned) peerCount, (unsigned) connected);
+        goto fail;
+    }
+
+    /* Let the last acknowledgements and bandwidth limits settle. */
+    deadline = enet_time_get () + 2 * ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL;
+    while (ENET_TIME_LESS (enet_time_get (), deadline))
+      if (bench_host_fan_pump (server, clients, * clientCount) < 0)
+        goto fail;
+
+    return 0;
+
+fail:
+    bench_host_fan_destroy (clients, * clientCount);
+    * clientCount = 0;
+    return -1;
+}
+
+int
+bench_host_fan_pump (ENetHost * server, ENetHost ** clients, size_t clientCount)
+{
+    size_t i;
+
+    if (bench_host_fan_service (server, NULL, NULL) < 0)
+      return -1;
+
+    for (i = 0; i < clientCount; ++ i)
+      if (bench_host_fan_service (clients [i], NULL, NULL) < 0)
+        return -1;
+
+    return 0;
+}
+
+void
+bench_host_fan_destroy (ENetHost ** clients, size_t clientCount)
+{
+    size_t i;
+
+    for (i = 0; i < clientCount; ++ i)
+      if (clients [i] != NULL)
+      {
+          enet_host_destroy (clients [i]);
+          clients [i] = NULL;
+      }
+}
+
+int
+bench_host_pair_pump (ENetHost * server, ENetHost * client, void (* received) (ENetPeer *, enet_uint8, ENetPacket *, void *), void * userData)
+{
+    ENetHost * hosts [2];
+    ENetEvent event;
+    int count = 0, result;
+    size_t i;
+
+    hosts [0] = client;
+    hosts [1] = server;
+
+    for (i = 0; i < sizeof (hosts) / sizeof (hosts [0]); ++ i)
+    {
+        for (result = enet_host_service (hosts [i], & event, 0);
+             result > 0;
+             result = enet_host_check_events (hosts [i], & event))
+        {
+            if (event.type != ENET_EVENT_TYPE_RECEIVE)
+              continue;
+
+            ++ count;
+            if (received != NULL)
+              received (event.peer, event.channelID, event.packet, userData);
+            else
+              enet_packet_destroy (event.packet);
+        }
+
+        if (result < 0)
+          return -1;
+    }
+
+    return count;
+}
+
+static void
+usage (const char * program)
+{
+    size_t i;
+
+    printf ("usage: %s [--json] [scenario...]\n\n"
+            "  --json       print the results as one JSON document, to compare runs and releases\n\n"
+            "scenarios:\n", program);
+    for (i = 0; i < sizeof (scenarios) / sizeof (scenarios [0]); ++ i)
+      printf ("  %-12s %s\n", scenarios [i].name, scenarios [i].description);
+}
+
+int
+main (int argc, char ** argv)
+{
+    int selected [sizeof (scenarios) / sizeof (scenarios [0])], failed [sizeof (scenarios) / sizeof (scenarios [0])];
+    size_t i, selectedCount = 0;
+    int argi, failures = 0;
+    ENetCallbacks callbacks;
+
+    memset (selected, 0, sizeof (selected));
+    memset (failed, 0, sizeof (failed));
+
+    for (argi = 1; argi < argc; ++ argi)
+    {
+        if (strcmp (argv [argi], "--json") == 0)
+        {
+            jsonOutput = 1;
+            continue;
+        }
+
+        for (i = 0; i < sizeof (scenarios) / sizeof (scenarios [0]); ++ i)
+          if (strcmp (argv [argi], scenarios [i].name) == 0)
+            break;
+
+        if (i >= sizeof (scenarios) / sizeof (scenarios [0]))
+        {
+            usage (argv [0]);
+            return 1;
+        }
+
+        selected [i] = 1;
+        ++ selectedCount;
+    }
+
+    memset (& callbacks, 0, sizeof (callbacks));
+    callbacks.malloc = bench_malloc;
+    callbacks.free = bench_free;
+
+    if (enet_initialize_with_callbacks (ENET_VERSION, & callbacks) != 0)
+    {
+        fprintf (stderr, "rcenet_bench: enet_initialize failed\n");
+        return 1;
+    }
+
+    if (jsonOutput)
+      printf ("{\n  \"version\": \"%d.%d.%d\",\n  \"results\": [", ENET_VERSION_MAJOR, ENET_VERSION_MINOR, ENET_VERSION_PATCH);
+
+    for (i = 0; i < sizeof (scenarios) / sizeof (scenarios [0]); ++ i)
+    {
+        if (selectedCount > 0 && ! selected [i])
+          continue;
+
+        currentScenario = & scenarios [i];
+        if (scenarios [i].run () != 0)
+        {
+            fprintf (stderr, "rcenet_bench: scenario %s failed\n", scenarios [i].name);
+            failed [i] = 1;
+            ++ failures;
+        }
+        currentScenario = NULL;
+    }
+
+    if (jsonOutput)
+    {
+        int first = 1;
+
+        printf ("\n  ],\n  \"failures\": [");
+        for (i = 0; i < sizeof (scenarios) / sizeof (scenarios [0]); ++ i)
+          if (failed [i])
+          {
+              printf ("%s", first ? " " : ", ");
+              bench_json_string (scenarios [i].name);
+              first = 0;
+          }
+        printf ("%s]\n}\n", first ? "" : " ");
+    }
+
+    enet_deinitialize ();
+
+    return failures > 0 ? 1 : 0;
+}
@@ -29,13 +29,17 @@ export default defineConfig({
               items: [
                 { text: 'rcenet', link: '/api/rcenet' },
                 { text: 'rcenet_address', link: '/api/rcenet_address' },
+                { text: 'rcenet_capture', link: '/api/rcenet_capture' },
+                { text: 'rcenet_histogram', link: '/api/rcenet_histogram' },
                 { text: 'rcenet_host', link: '/api/rcenet_host' },
+                { text: 'rcenet_network', link: '/api/rcenet_network' },
                 { text: 'rcenet_packet', link: '/api/rcenet_packet' },
                 { text: 'rcenet_peer', link: '/api/rcenet_peer' },
                 { text: 'rcenet_protocol', link: '/api/rcenet_protocol' },
                 { text: 'rcenet_range', link: '/api/rcenet_range' },
                 { text: 'rcenet_socket', link: '/api/rcenet_socket' },
                 { text: 'rcenet_time', link: '/api/rcenet_time' },
+                { text: 'rcenet_trace', link: '/api/rcenet_trace' },
               ]
             },
           ],
@@ -52,6 +56,7 @@ export default defineConfig({
                   ] 
                 },
                 { text: 'Distribution', link: '/guides/distribution' },
+                { text: 'Benchmarks', link: '/guides/benchmarks' },
               ]
             },
           ],
@@ -81,13 +86,17 @@ export default defineConfig({
               items: [
                 { text: 'rcenet', link: '/fr/api/rcenet' },
                 { text: 'rcenet_address', link: '/fr/api/rcenet_address' },
+                { text: 'rcenet_capture', link: '/fr/api/rcenet_capture' },
+                { text: 'rcenet_histogram', link: '/fr/api/rcenet_histogram' },
                 { text: 'rcenet_host', link: '/fr/api/rcenet_host' },
+                { text: 'rcenet_network', link: '/fr/api/rcenet_network' },
                 { text: 'rcenet_packet', link: '/fr/api/rcenet_packet' },
                 { text: 'rcenet_peer', link: '/fr/api/rcenet_peer' },
                 { text: 'rcenet_protocol', link: '/fr/api/rcenet_protocol' },
                 { text: 'rcenet_range', link: '/fr/api/rcenet_range' },
                 { text: 'rcenet_socket', link: '/fr/api/rcenet_socket' },
                 { text: 'rcenet_time', link: '/fr/api/rcenet_time' },
+                { text: 'rcenet_trace', link: '/fr/api/rcenet_trace' },
               ]
             },
           ],
@@ -104,6 +113,7 @@ export default defineConfig({
                   ] 
                 },
                 { text: 'Distribution', link: '/fr/guides/distribution' },
+                { text: 'Benchmarks', link: '/fr/guides/benchmarks' },
               ]
             },
           ],
@@ -175,6 +175,9 @@ typedef struct _ENetAddress
  * @property {number} ENET_PACKET_FLAG_NO_ALLOCATE - Signifie que le paquet n'allouera pas de données, l'utilisateur doit fournir la mémoire pour les données du paquet.
  * @property {number} ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT - Permet au paquet d'être fragmenté en utilisant des envois non fiables si sa taille dépasse l'unité de transmission maximale (MTU).
  * @property {number} ENET_PACKET_FLAG_SENT - Indique si le paquet a été envoyé depuis toutes les files dans lesquelles il a été inséré.
+ * @property {number} ENET_PACKET_FLAG_STREAM - Paquet reçu contenant un morceau d'un flux (voir enet_peer_stream_open).
+ * @property {number} ENET_PACKET_FLAG_STREAM_START - Paquet reçu contenant le premier morceau d'un flux.
+ * @property {number} ENET_PACKET_FLAG_STREAM_END - Paquet reçu, vide, marquant la fin d'un flux.
  */
 typedef enum _ENetPacketFlag
 {
@@ -182,6 +185,9 @@ typedef enum _ENetPacketFlag
    ENET_PACKET_FLAG_UNSEQUENCED = (1 << 1),
    ENET_PACKET_FLAG_NO_ALLOCATE = (1 << 2),
    ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT = (1 << 3),
+   ENET_PACKET_FLAG_STREAM = (1 << 4),
+   ENET_PACKET_FLAG_STREAM_START = (1 << 5),
+   ENET_PACKET_FLAG_STREAM_END = (1 << 6),
    ENET_PACKET_FLAG_SENT = (1<<8)
 } ENetPacketFlag;
 
@@ -255,6 +261,18 @@ typedef struct _ENetAcknowledgement
  * @property sendAttempts - Nombre de tentatives d'envoi de la commande.
  * @property command - La commande protocolaire à envoyer.
  * @property packet - Le paquet associé à la commande, le cas échéant.
+ * @property sentDatagram - Numéro (peer->datagramsSent) du datagramme dans lequel la commande a été envoyée en dernier.
+ * @property gapAcknowledgements - Nombre de datagrammes envoyés après la commande et déjà acquittés alors qu'elle ne l'est pas.
+ * @property fastRetransmitted - Vaut 1 si la commande a été renvoyée par retransmission rapide plutôt qu'à l'expiration de son délai.
+ * @property priority - Priorité du canal de la commande au moment de sa mise en file.
+ * @property scheduleTime - Temps virtuel de fin de la commande dans l'ordonnancement équitable pondéré du pair (voir enet_peer_set_channel_priority).
+ * @property expireTime - Instant (enet_time_get) à partir duquel la commande n'est plus envoyée, 0 si elle n'expire pas (voir enet_peer_set_channel_time_to_live).
+ * @property supersedeSlot - Case de la table de remplacement du canal qui désigne la commande, NULL si elle n'y est pas indexée (voir enet_peer_send_superseding).
+ * @property supersedeKey - Clé applicative du paquet de la commande lorsqu'elle est indexée.
+ * @property inTransit - Vaut 1 tant que la commande envoyée attend son acquittement dans sentReliableCommands, 0 si elle n'a pas été envoyée ou a été remise en file pour être renvoyée.
+ * @property queuedTime - Instant (enet_time_get) de la mise en file de la commande, 0 si aucun histogramme du pair ou de l'hôte n'était activé à ce moment.
+ * @property pendingFragments - Nombre de fragments du paquet que la commande doit encore envoyer après son fragment courant. Un paquet fragmenté n'est mis en file que sous la forme d'une seule commande, qui détache une commande par fragment au moment de son envoi (voir enet_peer_split_fragment_run).
+ * @property fragmentTable - Table de fragments partagée dont la commande lit les fragments suivants, NULL pour les calculer à la volée.
  */
 typedef struct _ENetOutgoingCommand
 {
@@ -269,8 +287,43 @@ typedef struct _ENetOutgoingCommand
    enet_uint16  sendAttempts;
    ENetProtocol command;
    ENetPacket * packet;
+   /* rcenet fields start here */
+   enet_uint32  sentDatagram;
+   enet_uint16  gapAcknowledgements;
+   enet_uint16  fastRetransmitted;
+   enet_uint8   priority;
+   enet_uint32  scheduleTime;
+   enet_uint32  expireTime;
+   struct _ENetOutgoingCommand ** supersedeSlot;
+   enet_uint32  supersedeKey;
+   enet_uint8   inTransit;
+   enet_uint32  queuedTime;
+   enet_uint32  pendingFragments;
+   struct _ENetFragmentTable * fragmentTable;
 } ENetOutgoingCommand;
 
+/** Compare deux temps virtuels d'ordonnancement (scheduleTime) en tenant compte du rebouclage. */
+#define ENET_SCHEDULE_LESS(a, b) ((enet_uint32) ((a) - (b)) >= 0x80000000u)
+
+/**
+ * Table de fragments d'un paquet, sérialisée une seule fois pour une longueur de fragment donnée et partagée
+ * en lecture seule par tous les pairs auxquels le paquet est diffusé. La commande mise en file pour chaque pair
+ * y lit ses fragments au fur et à mesure de leur envoi, et n'y ajoute que son numéro de commande et ses numéros
+ * de séquence. La table est libérée quand plus aucune commande ne la référence.
+ *
+ * @property referenceCount - Nombre de commandes (et de diffusions en cours) qui référencent la table.
+ * @property fragmentLength - Longueur maximale d'un fragment (dépend du MTU du pair).
+ * @property fragmentCount - Nombre de fragments du paquet.
+ * @property fragments - Commandes SEND_FRAGMENT pré-remplies (ordre réseau), allouées avec la table.
+ */
+typedef struct _ENetFragmentTable
+{
+   size_t                     referenceCount;
+   size_t                     fragmentLength;
+   enet_uint32                fragmentCount;
+   ENetProtocolSendFragment * fragments;
+} ENetFragmentTable;
+
 /**
  * Structure pour une commande entrante dans ENet.
  * Représente des données ou des actions reçues d'un pair.
@@ -283,6 +336,9 @@ typedef struct _ENetOutgoingCommand
  * @property fragmentsRemaining - Nombre de fragments restants à recevoir.
  * @property fragments - Tableau de bits pour le suivi des fragments reçus.
  * @property packet - Le paquet associé à la commande, une fois tous les fragments reçus.
+ * @property aggregateOffset - Position du prochain message à extraire d'une commande agrégée.
+ * @property fragmentNext - Commande suivante du même seau de peer->fragmentBuckets, tant que le paquet fragmenté est en file sur son canal.
+ * @property receivedTime - Instant (host->serviceTime) de la réception du premier fragment d'un paquet fragmenté.
  */
 typedef struct _ENetIncomingCommand
 {  
@@ -294,6 +350,10 @@ typedef struct _ENetIncomingCommand
    enet_uint32      fragmentsRemaining;
    enet_uint32 *    fragments;
    ENetPacket *     packet;
+   /* rcenet fields start here */
+   enet_uint32      aggregateOffset;
+   struct _ENetIncomingCommand * fragmentNext;
+   enet_uint32      receivedTime;
 } ENetIncomingCommand;
 
 /**
@@ -335,6 +395,20 @@ typedef enum _ENetPeerState
 #define ENET_BUFFER_MAXIMUM (1 + 2 * ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS)
 #endif
 
+/**
+ * Espace réservé avant (headroom) et après (tailroom) les données dans les buffers de paquets de l'hôte.
+ * Le headroom permet d'écrire l'en-tête du protocole directement devant les données transformées (compressées ou chiffrées)
+ * sans les recopier, et doit pouvoir contenir le plus grand en-tête possible (12 octets). Le tailroom laisse de la place
+ * à un chiffrement sur place qui ajoute des octets (tag d'authentification, padding).
+ */
+#ifndef ENET_PACKET_HEADROOM
+#define ENET_PACKET_HEADROOM 16
+#endif
+
+#ifndef ENET_PACKET_TAILROOM
+#define ENET_PACKET_TAILROOM 32
+#endif
+
 /**
  * @enum
  * Constantes de configuration pour les hôtes et pairs ENet.
@@ -348,6 +422,10 @@ typedef enum _ENetPeerState
  * @property {number} ENET_HOST_DEFAULT_MTU - Taille par défaut de l'Unité de Transmission Maximale (MTU) à 1392 octets.
  * @property {number} ENET_HOST_DEFAULT_MAXIMUM_PACKET_SIZE - Taille maximale par défaut d'un paquet à 32 Mo (Mégaoctets).
  * @property {number} ENET_HOST_DEFAULT_MAXIMUM_WAITING_DATA - Quantité maximale par défaut de données en attente avant la suspension de l'envoi, fixée à 32 Mo.
+ * @property {number} ENET_HOST_OUTGOING_COMMAND_POOL_SIZE - Nombre de commandes sortantes libérées que l'hôte conserve au moins pour les réutiliser sans allocation.
+ * @property {number} ENET_HOST_OUTGOING_COMMANDS_PER_PEER - Nombre de commandes sortantes libérées conservées par pair connecté, lorsque cela dépasse ENET_HOST_OUTGOING_COMMAND_POOL_SIZE.
+ * @property {number} ENET_HOST_PEER_COMMIT_COUNT - Nombre de pairs initialisés à la fois quand tous ceux déjà en usage sont occupés, et granularité de leur libération après inactivité.
+ * @property {number} ENET_HOST_CHANNEL_SLAB_SIZE - Taille minimale en octets d'un bloc de tableaux de canaux réservé par l'hôte pour ses connexions, fixée à 64 Ko.
  * @property {number} ENET_PEER_DEFAULT_ROUND_TRIP_TIME - Temps d'aller-retour (RTT) par défaut utilisé pour les estimations de latence, fixé à 500 millisecondes.
  * @property {number} ENET_PEER_DEFAULT_PACKET_THROTTLE - Taux de limitation de paquets par défaut, exprimé en pourcentage.
  * @property {number} ENET_PEER_PACKET_THROTTLE_SCALE - Échelle utilisée pour le calcul de la limitation dynamique des paquets.
@@ -368,6 +446,13 @@ typedef enum _ENetPeerState
  * @property {number} ENET_PEER_RELIABLE_WINDOWS - Nombre de fenêtres pour le suivi des paquets fiables.
  * @property {number} ENET_PEER_RELIABLE_WINDOW_SIZE - Taille d'une fenêtre pour le suivi des paquets fiables.
  * @property {number} ENET_PEER_FREE_RELIABLE_WINDOWS - Nombre de fenêtres fiables libres avant leur réinitialisation.
+ * @property {number} ENET_PEER_FEC_MAXIMUM_GROUP_SIZE - Nombre maximal de commandes protégées par une même parité FEC.
+ * @property {number} ENET_PEER_FEC_GROUP_TIMEOUT - Délai en millisecondes après lequel un groupe FEC incomplet envoie tout de même sa parité.
+ * @property {number} ENET_PEER_FAST_RETRANSMIT_THRESHOLD - Nombre par défaut de datagrammes postérieurs acquittés avant qu'une commande fiable non acquittée soit renvoyée sans attendre son délai.
+ * @property {number} ENET_PEER_FRAGMENT_BUCKETS - Nombre de seaux de la table de réassemblage des paquets fragmentés d'un pair (puissance de deux).
+ * @property {number} ENET_PEER_DEFAULT_CHANNEL_WEIGHT - Poids par défaut d'un canal dans l'ordonnancement équitable pondéré des commandes sortantes.
+ * @property {number} ENET_PEER_MAXIMUM_SUPERSEDE_SLOTS - Nombre maximal de cases de la table de remplacement d'un canal (voir enet_peer_set_channel_superseding).
+ * @property {number} ENET_PEER_RELIABLE_RING_SIZE - Taille initiale des anneaux de commandes fiables envoyées et reçues d'un canal (puissance de deux), doublée tant que deux numéros de séquence en attente y partagent une case.
  */
 enum
 {
@@ -377,6 +462,10 @@ enum
    ENET_HOST_DEFAULT_MTU                  = 1392,
    ENET_HOST_DEFAULT_MAXIMUM_PACKET_SIZE  = 32 * 1024 * 1024,
    ENET_HOST_DEFAULT_MAXIMUM_WAITING_DATA = 32 * 1024 * 1024,
+   ENET_HOST_OUTGOING_COMMAND_POOL_SIZE   = 4096,
+   ENET_HOST_OUTGOING_COMMANDS_PER_PEER   = 16,
+   ENET_HOST_PEER_COMMIT_COUNT            = 64,
+   ENET_HOST_CHANNEL_SLAB_SIZE            = 64 * 1024,
    ENET_PEER_DEFAULT_ROUND_TRIP_TIME      = 500,
    ENET_PEER_DEFAULT_PACKET_THROTTLE      = 32,
    ENET_PEER_PACKET_THROTTLE_SCALE        = 32,
@@ -396,9 +485,52 @@ enum
    ENET_PEER_FREE_UNSEQUENCED_WINDOWS     = 32,
    ENET_PEER_RELIABLE_WINDOWS             = 16,
    ENET_PEER_RELIABLE_WINDOW_SIZE         = 0x1000,
-   ENET_PEER_FREE_RELIABLE_WINDOWS        = 8
+   ENET_PEER_FREE_RELIABLE_WINDOWS        = 8,
+   ENET_PEER_FEC_MAXIMUM_GROUP_SIZE       = 16,
+   ENET_PEER_FEC_GROUP_TIMEOUT            = 50,
+   ENET_PEER_FAST_RETRANSMIT_THRESHOLD    = 3,
+   ENET_PEER_FRAGMENT_BUCKETS             = 64,
+   ENET_PEER_DEFAULT_CHANNEL_WEIGHT       = 16,
+   ENET_PEER_MAXIMUM_SUPERSEDE_SLOTS      = 65536,
+   ENET_PEER_RELIABLE_RING_SIZE           = 64
 };
 
+/**
+ * État de la correction d'erreurs (FEC) d'un canal, alloué par enet_peer_set_channel_fec.
+ * Côté émission, les données des commandes d'envoi sont combinées par XOR dans parity jusqu'à ce que le groupe soit complet.
+ * Côté réception, les dernières commandes reçues sont conservées dans un anneau pour reconstruire une commande perdue à partir d'une parité.
+ * Les tampons parity et historyData suivent la structure dans le même bloc mémoire.
+ *
+ * @typedef {struct} ENetChannelFec
+ * @property {enet_uint8} localGroupSize - Taille de groupe demandée localement.
+ * @property {enet_uint8} groupSize - Taille de groupe effective (minimum des deux extrémités), 0 tant que le pair distant n'a pas activé la FEC.
+ * @property {enet_uint8} memberCount - Nombre de commandes dans le groupe en cours d'émission.
+ * @property {enet_uint32} groupTime - Instant auquel la première commande du groupe en cours a été mise en file.
+ * @property {size_t} slotSize - Taille de la parité et de chaque entrée de l'historique (le MTU du pair).
+ * @property {size_t} parityLength - Longueur de la parité en cours (la plus longue donnée du groupe).
+ * @property {ENetProtocolParityMember[]} members - Identité des commandes du groupe en cours.
+ * @property {enet_uint8*} parity - XOR des données du groupe en cours.
+ * @property {size_t} historyCount - Nombre d'entrées de l'anneau de réception.
+ * @property {size_t} historyNext - Prochaine entrée de l'anneau à écraser.
+ * @property {ENetProtocolParityMember[]} history - Identité des dernières commandes reçues.
+ * @property {enet_uint8*} historyData - Données des dernières commandes reçues, slotSize octets par entrée.
+ */
+typedef struct _ENetChannelFec
+{
+   enet_uint8                localGroupSize;
+   enet_uint8                groupSize;
+   enet_uint8                memberCount;
+   enet_uint32               groupTime;
+   size_t                    slotSize;
+   size_t                    parityLength;
+   ENetProtocolParityMember  members [ENET_PEER_FEC_MAXIMUM_GROUP_SIZE];
+   enet_uint8 *              parity;
+   size_t                    historyCount;
+   size_t                    historyNext;
+   ENetProtocolParityMember  history [2 * ENET_PEER_FEC_MAXIMUM_GROUP_SIZE];
+   enet_uint8 *              historyData;
+} ENetChannelFec;
+
 /**
  * Représente un canal de communication entre pairs dans ENet. Chaque canal maintient son propre séquençage de paquets fiables et non fiables.
 
@@ -409,8 +541,27 @@ enum
  * @property {enet_uint16[]} reliableWindows - État des fenêtres de séquence fiable pour la retransmission.
  * @property {enet_uint16} incomingReliableSequenceNumber - Numéro de séquence du dernier paquet fiable reçu.
  * @property {enet_uint16} incomingUnreliableSequenceNumber - Numéro de séquence du dernier paquet non fiable reçu.
- * @property {ENetList} incomingReliableCommands - Liste des commandes fiables entrantes en attente d'être traitées.
+ * @property {ENetList} incomingReliableCommands - Liste des commandes fiables entrantes en attente d'être traitées, dans leur ordre d'arrivée ; l'ordre de séquence est donné par incomingReliableRing.
  * @property {ENetList} incomingUnreliableCommands - Liste des commandes non fiables entrantes en attente d'être traitées.
+ * @property {ENetList} aggregateCommands - Messages en attente d'agrégation (une ENetOutgoingCommand par message, qui garde une référence sur le paquet).
+ * @property {size_t} aggregateLength - Taille du lot en attente, préfixes de longueur compris.
+ * @property {enet_uint32} aggregateFlags - Drapeaux de paquet (fiable / non séquencé) communs aux messages du lot.
+ * @property {enet_uint32} aggregateTimeout - Délai maximal en millisecondes avant l'envoi d'un lot incomplet.
+ * @property {enet_uint32} aggregateDeadline - Instant auquel le lot en attente doit être envoyé.
+ * @property {int} aggregation - Vaut 1 si l'agrégation des petits messages est activée sur ce canal.
+ * @property {ENetChannelFec*} fec - État FEC du canal, NULL si la FEC n'est pas activée localement.
+ * @property {enet_uint8} fecRemoteGroupSize - Taille de groupe FEC annoncée par le pair distant, 0 s'il ne l'a pas activée.
+ * @property {enet_uint8} priority - Priorité d'envoi du canal : ses commandes passent avant celles des canaux de priorité inférieure.
+ * @property {enet_uint8} weight - Poids du canal parmi les canaux de même priorité (ENET_PEER_DEFAULT_CHANNEL_WEIGHT par défaut).
+ * @property {enet_uint32} scheduleTime - Temps virtuel de fin de la dernière commande mise en file sur le canal.
+ * @property {enet_uint32} timeToLive - Durée de vie en millisecondes des paquets mis en file sur le canal, 0 s'ils n'expirent pas.
+ * @property {int} expireReliable - Vaut 1 si les paquets fiables du canal expirent aussi.
+ * @property {ENetOutgoingCommand**} supersedeSlots - Table de remplacement du canal : pour chaque case, la dernière commande non encore envoyée mise en file par enet_peer_send_superseding avec une clé de cette case. NULL si le remplacement n'est pas activé.
+ * @property {size_t} supersedeSlotCount - Nombre de cases de la table de remplacement (puissance de deux).
+ * @property {ENetOutgoingCommand**} sentReliableRing - Commandes fiables du canal envoyées et non acquittées, indexées par numéro de séquence modulo sentReliableRingSize. Allouée au premier envoi ; NULL si elle n'a pas pu l'être, les acquittements sont alors recherchés dans les listes du pair.
+ * @property {size_t} sentReliableRingSize - Nombre de cases de sentReliableRing (puissance de deux).
+ * @property {ENetIncomingCommand**} incomingReliableRing - Commandes fiables reçues et pas encore délivrées, indexées par numéro de séquence modulo incomingReliableRingSize. NULL tant qu'aucune n'a dû attendre.
+ * @property {size_t} incomingReliableRingSize - Nombre de cases de incomingReliableRing (puissance de deux).
  */
 typedef struct _ENetChannel
 {
@@ -422,148 +573,355 @@ typedef struct _ENetChannel
    enet_uint16  incomingUnreliableSequenceNumber;
    ENetList     incomingReliableCommands;
    ENetList     incomingUnreliableCommands;
+   /* rcenet fields start here */
+   ENetList     aggregateCommands;
+   size_t       aggregateLength;
+   enet_uint32  aggregateFlags;
+   enet_uint32  aggregateTimeout;
+   enet_uint32  aggregateDeadline;
+   int          aggregation;
+   ENetChannelFec * fec;
+   enet_uint8   fecRemoteGroupSize;
+   enet_uint8   priority;
+   enet_uint8   weight;
+   enet_uint32  scheduleTime;
+   enet_uint32  timeToLive;
+   int          expireReliable;
+   ENetOutgoingCommand ** supersedeSlots;
+   size_t       supersedeSlotCount;
+   ENetOutgoingCommand ** sentReliableRing;
+   size_t       sentReliableRingSize;
+   ENetIncomingCommand ** incomingReliableRing;
+   size_t       incomingReliableRingSize;
 } ENetChannel;
 
+/**
+ * Bloc de mémoire réservé par un hôte, découpé en tableaux de canaux attribués aux connexions (voir enet_host_acquire_channels).
+ * Les tableaux suivent directement l'en-tête.
+ *
+ * @typedef {Object} ENetChannelSlab
+ * @property {ENetListNode} slabList - Nœud dans la liste channelSlabs de l'hôte.
+ * @property {size_t} size - Taille du bloc en octets, en-tête compris.
+ */
+typedef struct _ENetChannelSlab
+{
+   ENetListNode slabList;
+   size_t       size;
+} ENetChannelSlab;
+
+struct _ENetStream;
+
+/**
+ * @callback ENetStreamReadCallback
+ * Callback appelé pour produire les données d'un flux au fur et à mesure que la fenêtre d'envoi se libère.
+ *
+ * @param {struct _ENetStream*} stream - Le flux à alimenter.
+ * @param {enet_uint8*} data - Tampon à remplir.
+ * @param {size_t} dataLength - Taille du tampon, au plus la taille d'un morceau.
+ * @returns {size_t} Le nombre d'octets écrits dans data, ou 0 à la fin du flux.
+ */
+typedef size_t (ENET_CALLBACK * ENetStreamReadCallback) (struct _ENetStream * stream, enet_uint8 * data, size_t dataLength);
+
+/**
+ * @enum _ENetStreamFlag
+ * Drapeaux d'état d'un flux sortant.
+ *
+ * @property {number} ENET_STREAM_FLAG_STARTED - Le premier morceau du flux a été mis en file.
+ * @property {number} ENET_STREAM_FLAG_CLOSING - Le flux n'accepte plus de données ; son morceau de fin reste à mettre en file.
+ * @property {number} ENET_STREAM_FLAG_ENDED - Le morceau de fin a été mis en file ; le flux est libéré une fois ses morceaux acquittés.
+ */
+typedef enum _ENetStreamFlag
+{
+   ENET_STREAM_FLAG_STARTED = (1 << 0),
+   ENET_STREAM_FLAG_CLOSING = (1 << 1),
+   ENET_STREAM_FLAG_ENDED   = (1 << 2)
+} ENetStreamFlag;
+
+/**
+ * Flux sortant ouvert par enet_peer_stream_open. Ses données sont découpées en morceaux fiables d'au plus un MTU,
+ * mis en file tant que les morceaux non acquittés tiennent dans la fenêtre du pair, ce qui borne la mémoire utilisée
+ * quelle que soit la taille du flux. Libéré par ENet après sa fermeture ou la réinitialisation du pair.
+ *
+ * @typedef {struct} ENetStream
+ * @property {ENetListNode} streamList - Nœud dans la liste peer->streams.
+ * @property {struct _ENetPeer*} peer - Le pair destinataire.
+ * @property {enet_uint8} channelID - Le canal fiable portant le flux.
+ * @property {enet_uint32} flags - Combinaison de valeurs ENetStreamFlag.
+ * @property {ENetStreamReadCallback} read - Callback produisant les données, NULL si elles sont fournies par enet_peer_stream_write.
+ * @property {void*} data - Données utilisateur pouvant être modifiées librement par l'application.
+ * @property {size_t} queuedChunks - Nombre de morceaux mis en file et pas encore acquittés.
+ * @property {size_t} queuedLength - Nombre d'octets de données dans ces morceaux.
+ * @property {size_t} sentLength - Nombre total d'octets de données mis en file depuis l'ouverture du flux.
+ */
+typedef struct _ENetStream
+{
+   ENetListNode              streamList;
+   struct _ENetPeer *        peer;
+   enet_uint8                channelID;
+   enet_uint32               flags;
+   ENetStreamReadCallback    read;
+   void *                    data;
+   size_t                    queuedChunks;
+   size_t                    queuedLength;
+   size_t                    sentLength;
+} ENetStream;
+
 /**
  * @enum _ENetPeerFlag
  * Drapeaux utilisés pour contrôler l'état et le comportement des pairs ENet.
  * 
  * @property {number} ENET_PEER_FLAG_NEEDS_DISPATCH - Indique que le pair nécessite une expédition de messages en attente.
  * @property {number} ENET_PEER_FLAG_CONTINUE_SENDING - Indique que le pair doit continuer à envoyer des paquets même après avoir atteint la limite de bande passante.
+ * @property {number} ENET_PEER_FLAG_FLUSH - Indique que les commandes retenues par le regroupement doivent partir au prochain envoi (voir enet_peer_flush).
+ * @property {number} ENET_PEER_FLAG_AGGREGATE - Indique que le pair distant a annoncé à la connexion qu'il comprend les commandes agrégées (ENET_PROTOCOL_COMMAND_FLAG_AGGREGATE sur CONNECT ou VERIFY_CONNECT).
+ * @property {number} ENET_PEER_FLAG_FEC - Indique que le pair distant a annoncé à la connexion qu'il comprend la FEC (ENET_PROTOCOL_COMMAND_FLAG_FEC sur CONNECT ou VERIFY_CONNECT).
+ * @property {number} ENET_PEER_FLAG_STREAM - Indique que le pair distant a annoncé à la connexion qu'il comprend les morceaux de flux (ENET_PROTOCOL_COMMAND_FLAG_STREAM sur CONNECT ou VERIFY_CONNECT).
  */
 typedef enum _ENetPeerFlag
 {
    ENET_PEER_FLAG_NEEDS_DISPATCH   = (1 << 0),
-   ENET_PEER_FLAG_CONTINUE_SENDING = (1 << 1)
+   ENET_PEER_FLAG_CONTINUE_SENDING = (1 << 1),
+   ENET_PEER_FLAG_FLUSH            = (1 << 2),
+   ENET_PEER_FLAG_AGGREGATE        = (1 << 3),
+   ENET_PEER_FLAG_FEC              = (1 << 4),
+   ENET_PEER_FLAG_STREAM           = (1 << 5)
 } ENetPeerFlag;
 
+/**
+ * @enum _ENetHistogramKind
+ * Mesures enregistrées dans les histogrammes d'un pair ou d'un hôte (voir enet_peer_set_histograms et enet_host_set_histograms), toutes en millisecondes.
+ *
+ * @typedef {enum} ENetHistogramKind
+ * @property {number} ENET_HISTOGRAM_ROUND_TRIP_TIME - Temps d'aller-retour mesuré à chaque acquittement reçu, avant lissage.
+ * @property {number} ENET_HISTOGRAM_QUEUE_DELAY - Attente d'une commande entre sa mise en file et son premier envoi.
+ * @property {number} ENET_HISTOGRAM_DELIVERY_LATENCY - Délai entre la mise en file d'une commande fiable portant des données et son acquittement, renvois compris.
+ * @property {number} ENET_HISTOGRAM_REASSEMBLY_TIME - Délai entre la réception du premier fragment d'un paquet fragmenté et celle du dernier.
+ * @property {number} ENET_HISTOGRAM_COUNT - Nombre de mesures.
+ */
+typedef enum _ENetHistogramKind
+{
+   ENET_HISTOGRAM_ROUND_TRIP_TIME  = 0,
+   ENET_HISTOGRAM_QUEUE_DELAY      = 1,
+   ENET_HISTOGRAM_DELIVERY_LATENCY = 2,
+   ENET_HISTOGRAM_REASSEMBLY_TIME  = 3,
+   ENET_HISTOGRAM_COUNT            = 4
+} ENetHistogramKind;
+
+enum
+{
+   ENET_HISTOGRAM_SUB_BUCKET_BITS = 3,
+   ENET_HISTOGRAM_BUCKET_COUNT    = (2 << ENET_HISTOGRAM_SUB_BUCKET_BITS) + (31 - ENET_HISTOGRAM_SUB_BUCKET_BITS) * (1 << ENET_HISTOGRAM_SUB_BUCKET_BITS)
+};
+
+/**
+ * @typedef {struct} ENetHistogram
+ * Histogramme log-linéaire de taille fixe des valeurs sur 32 bits. Les valeurs inférieures à
+ * 2 << ENET_HISTOGRAM_SUB_BUCKET_BITS ont chacune leur seau ; au-delà, chaque puissance de deux
+ * est découpée en 1 << ENET_HISTOGRAM_SUB_BUCKET_BITS seaux de même largeur, ce qui borne
+ * l'erreur relative d'un centile à 12,5 %.
+ *
+ * @property {enet_uint64} count - Nombre de valeurs enregistrées.
+ * @property {enet_uint64} sum - Somme des valeurs enregistrées.
+ * @property {enet_uint32} minimum - Plus petite valeur enregistrée, 0 si l'histogramme est vide.
+ * @property {enet_uint32} maximum - Plus grande valeur enregistrée.
+ * @property {enet_uint64[]} buckets - Nombre de valeurs de chaque seau.
+ */
+typedef struct _ENetHistogram
+{
+   enet_uint64 count;
+   enet_uint64 sum;
+   enet_uint32 minimum;
+   enet_uint32 maximum;
+   enet_uint64 buckets [ENET_HISTOGRAM_BUCKET_COUNT];
+} ENetHistogram;
+
 /**
  * @typedef {struct} ENetPeer
  * Représente un pair distant avec lequel des paquets de données peuvent être échangés.
+ * Les champs sont regroupés selon la fréquence à laquelle la boucle de service les lit : le bloc
+ * chaud, parcouru pour chaque pair à chaque enet_host_service, tient dans les 144 premiers octets ;
+ * viennent ensuite les champs lus à l'envoi ou à la réception d'un datagramme, puis la
+ * configuration et les statistiques.
  * 
  * @property {ENetListNode} dispatchList - Utilisé en interne pour la gestion des messages.
+ * @property {ENetPeerState} state - État actuel de la connexion du pair.
+ * @property {enet_uint16} flags - Drapeaux de comportement pour ce pair.
+ * @property {enet_uint16} reserved - Champ réservé pour un usage futur.
+ * @property {enet_uint32} nextTimeout - Moment du prochain délai d'attente pour le contrôle de la connexion.
+ * @property {enet_uint32} lastReceiveTime - Dernier moment où des données ont été reçues.
+ * @property {enet_uint32} pingInterval - Intervalle entre les pings automatiques envoyés à ce pair.
+ * @property {enet_uint32} mtu - Unité de transmission maximale pour ce pair.
+ * @property {enet_uint32} coalesceTimeout - Délai maximal en microsecondes pendant lequel les commandes sont retenues pour remplir un datagramme (0 : désactivé).
+ * @property {enet_uint32} coalescedCommands - Nombre de commandes mises en file depuis le dernier datagramme envoyé.
+ * @property {size_t} aggregatingChannels - Nombre de canaux ayant des messages agrégés en attente d'envoi.
+ * @property {size_t} fecChannels - Nombre de canaux sur lesquels la FEC est activée localement.
+ * @property {ENetList} acknowledgements - Liste des accusés de réception à envoyer.
+ * @property {ENetList} sentReliableCommands - Liste des commandes fiables envoyées mais pas encore acquittées.
+ * @property {ENetList} outgoingSendReliableCommands - Liste des commandes fiables prêtes à être envoyées.
+ * @property {ENetList} outgoingCommands - Liste des commandes prêtes à être envoyées.
+ * @property {ENetList} streams - Flux sortants (ENetStream) ouverts ou en cours de fermeture vers ce pair.
  * @property {struct _ENetHost *} host - Pointeur vers l'hôte associé à ce pair.
  * @property {enet_uint16} outgoingPeerID - Identifiant du pair pour les connexions sortantes.
  * @property {enet_uint16} incomingPeerID - Identifiant du pair pour les connexions entrantes.
  * @property {enet_uint32} connectID - Identifiant unique de la connexion.
  * @property {enet_uint8} outgoingSessionID - Identifiant de session pour les données sortantes.
  * @property {enet_uint8} incomingSessionID - Identifiant de session pour les données entrantes.
- * @property {ENetAddress} address - Adresse Internet du pair.
- * @property {void *} data - Données privées de l'application, modifiables librement.
- * @property {ENetPeerState} state - État actuel de la connexion du pair.
+ * @property {enet_uint16} outgoingReliableSequenceNumber - Numéro de séquence pour le prochain paquet fiable sortant.
+ * @property {enet_uint16} incomingUnsequencedGroup - Groupe pour les paquets non séquencés entrants.
+ * @property {enet_uint16} outgoingUnsequencedGroup - Groupe pour les paquets non séquencés sortants.
  * @property {ENetChannel *} channels - Tableau des canaux de communication avec ce pair.
  * @property {size_t} channelCount - Nombre de canaux alloués pour ce pair.
- * @property {enet_uint32} incomingBandwidth - Bande passante entrante en octets par seconde.
- * @property {enet_uint32} outgoingBandwidth - Bande passante sortante en octets par seconde.
- * @property {enet_uint32} incomingBandwidthThrottleEpoch - Utilisé en interne pour le contrôle de la bande passante.
- * @property {enet_uint32} outgoingBandwidthThrottleEpoch - Utilisé en interne pour le contrôle de la bande passante.
+ * @property {ENetList} dispatchedCommands - Liste des commandes déjà expédiées.
  * @property {enet_uint32} incomingDataTotal - Total des données entrantes depuis la dernière évaluation.
  * @property {enet_uint32} outgoingDataTotal - Total des données sortantes depuis la dernière évaluation.
  * @property {enet_uint32} lastSendTime - Dernier moment où des données ont été envoyées.
- * @property {enet_uint32} lastReceiveTime - Dernier moment où des données ont été reçues.
- * @property {enet_uint32} nextTimeout - Moment du prochain délai d'attente pour le contrôle de la connexion.
  * @property {enet_uint32} earliestTimeout - Plus proche délai d'attente pour le contrôle de la connexion.
- * @property {enet_uint32} packetLossEpoch - Utilisé en interne pour le calcul de la perte de paquets.
  * @property {enet_uint32} packetsSent - Nombre total de paquets envoyés.
  * @property {enet_uint32} packetsLost - Nombre total de paquets perdus.
- * @property {enet_uint32} packetLoss - Perte de paquets moyenne en tant que ratio.
- * @property {enet_uint32} packetLossVariance - Variance de la perte de paquets.
  * @property {enet_uint32} packetThrottle - Limite actuelle de la régulation des paquets.
- * @property {enet_uint32} packetThrottleLimit - Limite maximale de la régulation des paquets.
  * @property {enet_uint32} packetThrottleCounter - Compteur utilisé pour la régulation des paquets.
- * @property {enet_uint32} packetThrottleEpoch - Dernière évaluation de la régulation des paquets.
- * @property {enet_uint32} packetThrottleAcceleration - Accélération de la régulation des paquets lors des transmissions réussies.
- * @property {enet_uint32} packetThrottleDeceleration - Décélération de la régulation des paquets lors des pertes.
- * @property {enet_uint32} packetThrottleInterval - Intervalle d'évaluation de la régulation des paquets.
- * @property {enet_uint32} pingInterval - Intervalle entre les pings automatiques envoyés à ce pair.
- * @property {enet_uint32} timeoutLimit - Limite de temps avant que le pair soit considéré comme déconnecté.
- * @property {enet_uint32} timeoutMinimum - Temps minimum avant déclaration de déconnexion.
- * @property {enet_uint32} timeoutMaximum - Temps maximum avant déclaration de déconnexion.
  * @property {enet_uint32} lastRoundTripTime - Dernier temps d'aller-retour mesuré.
  * @property {enet_uint32} lowestRoundTripTime - Plus bas temps d'aller-retour mesuré.
  * @property {enet_uint32} lastRoundTripTimeVariance - Variance du dernier temps d'aller-retour.
  * @property {enet_uint32} highestRoundTripTimeVariance - Plus haute variance du temps d'aller-retour mesurée.
  * @property {enet_uint32} roundTripTime - Temps d'aller-retour moyen.
  * @property {enet_uint32} roundTripTimeVariance - Variance du temps d'aller-retour.
- * @property {enet_uint32} mtu - Unité de transmission maximale pour ce pair.
+ * @property {enet_uint32} timeoutLimit - Limite de temps avant que le pair soit considéré comme déconnecté.
+ * @property {enet_uint32} timeoutMinimum - Temps minimum avant déclaration de déconnexion.
+ * @property {enet_uint32} timeoutMaximum - Temps maximum avant déclaration de déconnexion.
  * @property {enet_uint32} windowSize - Taille de la fenêtre de contrôle de flux.
+ * @property {enet_uint32} windowLimit - Plus grande fenêtre de contrôle de flux négociée avec le pair : ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE, ou davantage si les deux hôtes l'ont étendue.
  * @property {enet_uint32} reliableDataInTransit - Quantité de données fiables en transit.
- * @property {enet_uint16} outgoingReliableSequenceNumber - Numéro de séquence pour le prochain paquet fiable sortant.
- * @property {ENetList} acknowledgements - Liste des accusés de réception à envoyer.
- * @property {ENetList} sentReliableCommands - Liste des commandes fiables envoyées mais pas encore acquittées.
- * @property {ENetList} outgoingSendReliableCommands - Liste des commandes fiables prêtes à être envoyées.
- * @property {ENetList} outgoingCommands - Liste des commandes prêtes à être envoyées.
- * @property {ENetList} dispatchedCommands - Liste des commandes déjà expédiées.
- * @property {enet_uint16} flags - Drapeaux de comportement pour ce pair.
- * @property {enet_uint16} reserved - Champ réservé pour un usage futur.
- * @property {enet_uint16} incomingUnsequencedGroup - Groupe pour les paquets non séquencés entrants.
- * @property {enet_uint16} outgoingUnsequencedGroup - Groupe pour les paquets non séquencés sortants.
- * @property {enet_uint32[]} unsequencedWindow - Fenêtre pour le suivi des paquets non séquencés.
  * @property {enet_uint32} eventData - Données d'événement associées à la dernière action de ce pair.
  * @property {size_t} totalWaitingData - Quantité totale de données en attente d'être envoyées à ce pair.
+ * @property {enet_uint32} coalesceDeadline - Instant (enet_time_get_us) auquel les commandes retenues doivent partir.
+ * @property {size_t} coalescedDataLength - Taille de ces commandes, données comprises.
+ * @property {enet_uint32} datagramsSent - Nombre de datagrammes envoyés à ce pair.
+ * @property {enet_uint32} datagramFill - Moyenne glissante du remplissage des datagrammes par rapport au MTU, à l'échelle ENET_PEER_PACKET_LOSS_SCALE.
+ * @property {enet_uint32} fastRetransmitThreshold - Nombre de datagrammes postérieurs acquittés déclenchant la retransmission rapide (0 : désactivée).
+ * @property {enet_uint32} fastRetransmitDatagram - Plus récent datagramme dont l'acquittement a été compté par la retransmission rapide ; les acquittements de datagrammes antérieurs ne sont plus comptés.
+ * @property {ENetIncomingCommand**} fragmentBuckets - Table de réassemblage (ENET_PEER_FRAGMENT_BUCKETS seaux) des paquets fragmentés en file sur les canaux, indexée par (canal, numéro de séquence de départ). Allouée au premier paquet fragmenté reçu.
+ * @property {size_t} scheduledChannels - Nombre de canaux dont la priorité ou le poids diffère des valeurs par défaut ; les commandes sont alors ordonnancées par priorité puis par temps virtuel.
+ * @property {enet_uint32} scheduleClock - Temps virtuel de l'ordonnancement équitable pondéré : temps de fin de la dernière commande envoyée.
+ * @property {enet_uint64} totalSentData - Octets envoyés au pair depuis sa dernière réinitialisation.
+ * @property {enet_uint64} totalReceivedData - Octets reçus du pair depuis sa dernière réinitialisation.
+ * @property {enet_uint64} totalReceivedDatagrams - Datagrammes reçus du pair depuis sa dernière réinitialisation.
+ * @property {ENetHistogram*} histograms - ENET_HISTOGRAM_COUNT histogrammes propres au pair, indexés par ENetHistogramKind, NULL tant qu'enet_peer_set_histograms ne les a pas activés ; libérés à la réinitialisation du pair.
+ * @property {ENetAddress} address - Adresse Internet du pair.
+ * @property {void *} data - Données privées de l'application, modifiables librement.
+ * @property {enet_uint32} incomingBandwidth - Bande passante entrante en octets par seconde.
+ * @property {enet_uint32} outgoingBandwidth - Bande passante sortante en octets par seconde.
+ * @property {enet_uint32} incomingBandwidthThrottleEpoch - Utilisé en interne pour le contrôle de la bande passante.
+ * @property {enet_uint32} outgoingBandwidthThrottleEpoch - Utilisé en interne pour le contrôle de la bande passante.
+ * @property {enet_uint32} packetLossEpoch - Utilisé en interne pour le calcul de la perte de paquets.
+ * @property {enet_uint32} packetLoss - Perte de paquets moyenne en tant que ratio.
+ * @property {enet_uint32} packetLossVariance - Variance de la perte de paquets.
+ * @property {enet_uint32} packetThrottleLimit - Limite maximale de la régulation des paquets.
+ * @property {enet_uint32} packetThrottleEpoch - Dernière évaluation de la régulation des paquets.
+ * @property {enet_uint32} packetThrottleAcceleration - Accélération de la régulation des paquets lors des transmissions réussies.
+ * @property {enet_uint32} packetThrottleDeceleration - Décélération de la régulation des paquets lors des pertes.
+ * @property {enet_uint32} packetThrottleInterval - Intervalle d'évaluation de la régulation des paquets.
+ * @property {enet_uint32[]} unsequencedWindow - Fenêtre pour le suivi des paquets non séquencés.
+ * @property {size_t} connectedPeerIndex - Position du pair dans host->connectedPeerList lorsqu'il est connecté.
+ * @property {enet_uint32} retransmits - Nombre de commandes fiables renvoyées après expiration de leur délai d'acquittement.
+ * @property {enet_uint32} fastRetransmits - Nombre de commandes fiables renvoyées par retransmission rapide.
+ * @property {enet_uint32} spuriousRetransmits - Nombre de retransmissions rapides inutiles (l'envoi d'origine a finalement été acquitté).
+ * @property {enet_uint32} expiredPackets - Nombre de paquets abandonnés avant leur envoi parce que leur durée de vie était écoulée.
+ * @property {enet_uint32} supersededPackets - Nombre de paquets remplacés avant leur envoi par un paquet plus récent de même clé.
  */
 typedef struct _ENetPeer
-{ 
+{
+   /* Hot: read for every peer by each enet_host_service sweep, even when it has nothing to send.
+      dispatchList stays first since the dispatch queue casts its nodes back to the peer. */
    ENetListNode  dispatchList;
+   ENetPeerState state;
+   enet_uint16   flags;
+   enet_uint16   reserved;
+   enet_uint32   nextTimeout;
+   enet_uint32   lastReceiveTime;
+   enet_uint32   pingInterval;
+   enet_uint32   mtu;
+   enet_uint32   coalesceTimeout;
+   enet_uint32   coalescedCommands;
+   size_t        aggregatingChannels;
+   size_t        fecChannels;
+   ENetList      acknowledgements;
+   ENetList      sentReliableCommands;
+   ENetList      outgoingSendReliableCommands;
+   ENetList      outgoingCommands;
+   ENetList      streams;
+
+   /* Warm: read when a datagram is sent to or received from the peer. */
    struct _ENetHost * host;
    enet_uint16   outgoingPeerID;
    enet_uint16   incomingPeerID;
    enet_uint32   connectID;
    enet_uint8    outgoingSessionID;
    enet_uint8    incomingSessionID;
-   ENetAddress   address;
-   void *        data;
-   ENetPeerState state;
+   enet_uint16   outgoingReliableSequenceNumber;
+   enet_uint16   incomingUnsequencedGroup;
+   enet_uint16   outgoingUnsequencedGroup;
    ENetChannel * channels;
    size_t        channelCount;
-   enet_uint32   incomingBandwidth;
-   enet_uint32   outgoingBandwidth;
-   enet_uint32   incomingBandwidthThrottleEpoch;
-   enet_uint32   outgoingBandwidthThrottleEpoch;
+   ENetList      dispatchedCommands;
    enet_uint32   incomingDataTotal;
    enet_uint32   outgoingDataTotal;
    enet_uint32   lastSendTime;
-   enet_uint32   lastReceiveTime;
-   enet_uint32   nextTimeout;
    enet_uint32   earliestTimeout;
-   enet_uint32   packetLossEpoch;
    enet_uint32   packetsSent;
    enet_uint32   packetsLost;
-   enet_uint32   packetLoss;
-   enet_uint32   packetLossVariance;
    enet_uint32   packetThrottle;
-   enet_uint32   packetThrottleLimit;
    enet_uint32   packetThrottleCounter;
-   enet_uint32   packetThrottleEpoch;
-   enet_uint32   packetThrottleAcceleration;
-   enet_uint32   packetThrottleDeceleration;
-   enet_uint32   packetThrottleInterval;
-   enet_uint32   pingInterval;
-   enet_uint32   timeoutLimit;
-   enet_uint32   timeoutMinimum;
-   enet_uint32   timeoutMaximum;
    enet_uint32   lastRoundTripTime;
    enet_uint32   lowestRoundTripTime;
    enet_uint32   lastRoundTripTimeVariance;
    enet_uint32   highestRoundTripTimeVariance;
    enet_uint32   roundTripTime;
    enet_uint32   roundTripTimeVariance;
-   enet_uint32   mtu;
+   enet_uint32   timeoutLimit;
+   enet_uint32   timeoutMinimum;
+   enet_uint32   timeoutMaximum;
    enet_uint32   windowSize;
+   enet_uint32   windowLimit;
    enet_uint32   reliableDataInTransit;
-   enet_uint16   outgoingReliableSequenceNumber;
-   ENetList      acknowledgements;
-   ENetList      sentReliableCommands;
-   ENetList      outgoingSendReliableCommands;
-   ENetList      outgoingCommands;
-   ENetList      dispatchedCommands;
-   enet_uint16   flags;
-   enet_uint16   reserved;
-   enet_uint16   incomingUnsequencedGroup;
-   enet_uint16   outgoingUnsequencedGroup;
-   enet_uint32   unsequencedWindow [ENET_PEER_UNSEQUENCED_WINDOW_SIZE / 32]; 
    enet_uint32   eventData;
    size_t        totalWaitingData;
+   enet_uint32   coalesceDeadline;
+   size_t        coalescedDataLength;
+   enet_uint32   datagramsSent;
+   enet_uint32   datagramFill;
+   enet_uint32   fastRetransmitThreshold;
+   enet_uint32   fastRetransmitDatagram;
+   ENetIncomingCommand ** fragmentBuckets;
+   size_t        scheduledChannels;
+   enet_uint32   scheduleClock;
+   enet_uint64   totalSentData;
+   enet_uint64   totalReceivedData;
+   enet_uint64   totalReceivedDatagrams;
+   ENetHistogram * histograms;
+
+   /* Cold: configuration and statistics, read on connection, on throttle updates or by the application. */
+   ENetAddress   address;
+   void *        data;
+   enet_uint32   incomingBandwidth;
+   enet_uint32   outgoingBandwidth;
+   enet_uint32   incomingBandwidthThrottleEpoch;
+   enet_uint32   outgoingBandwidthThrottleEpoch;
+   enet_uint32   packetLossEpoch;
+   enet_uint32   packetLoss;
+   enet_uint32   packetLossVariance;
+   enet_uint32   packetThrottleLimit;
+   enet_uint32   packetThrottleEpoch;
+   enet_uint32   packetThrottleAcceleration;
+   enet_uint32   packetThrottleDeceleration;
+   enet_uint32   packetThrottleInterval;
+   enet_uint32   unsequencedWindow [ENET_PEER_UNSEQUENCED_WINDOW_SIZE / 32];
+   size_t        connectedPeerIndex;
+   enet_uint32   retransmits;
+   enet_uint32   fastRetransmits;
+   enet_uint32   spuriousRetransmits;
+   enet_uint32   expiredPackets;
+   enet_uint32   supersededPackets;
 } ENetPeer;
 
 /**
@@ -596,6 +954,11 @@ typedef struct _ENetCompressor
  * @property {function} decrypt - Fonction pour déchiffrer un paquet reçu du pair (peut être NULL si paquet de connexion),
  * à partir de inData, contenant inLimit octets, déchiffre les données dans outData, et sort au maximum outLimit octets. Devrait retourner 0 en cas d'échec.
  * @property {function} destroy - Fonction appelée lorsque le chiffrement est désactivé ou que l'hôte est détruit. Peut être NULL.
+ * @property {function} encryptInPlace - Variante sur place de encrypt, optionnelle (NULL si non utilisée). Chiffre les dataLength octets de data
+ * dans le même buffer et peut l'agrandir jusqu'à dataLimit octets. Retourne la taille chiffrée, ou 0 en cas d'échec en laissant data intact.
+ * Prioritaire sur encrypt lorsqu'elle est définie : les données compressées sont alors chiffrées sans copie supplémentaire.
+ * @property {function} decryptInPlace - Variante sur place de decrypt, optionnelle (NULL si non utilisée). Déchiffre les dataLength octets de data
+ * dans le même buffer et retourne la taille déchiffrée (au plus dataLength), ou 0 en cas d'échec. Prioritaire sur decrypt lorsqu'elle est définie.
  */
 typedef struct _ENetEncryptor
 {
@@ -603,6 +966,8 @@ typedef struct _ENetEncryptor
    size_t (ENET_CALLBACK * encrypt) (void * context, ENetPeer * peer, const ENetBuffer * inBuffers, size_t inBufferCount, size_t inLimit, enet_uint8 * outData, size_t outLimit);
    size_t (ENET_CALLBACK * decrypt) (void * context, ENetPeer * peer, const enet_uint8 * inData, size_t inLimit, enet_uint8 * outData, size_t outLimit);
    void (ENET_CALLBACK * destroy) (void * context);
+   size_t (ENET_CALLBACK * encryptInPlace) (void * context, ENetPeer * peer, enet_uint8 * data, size_t dataLength, size_t dataLimit);
+   size_t (ENET_CALLBACK * decryptInPlace) (void * context, ENetPeer * peer, enet_uint8 * data, size_t dataLength);
 } ENetEncryptor;
 
 /**
@@ -616,6 +981,17 @@ typedef struct _ENetEncryptor
  */
 typedef enet_uint32 (ENET_CALLBACK * ENetChecksumCallback) (const ENetBuffer * buffers, size_t bufferCount);
 
+/**
+ * @callback ENetPeerFilterCallback
+ * Callback de filtrage des pairs pour enet_host_broadcast_filtered(). Permet de ne diffuser un paquet qu'aux pairs
+ * intéressés (gestion d'intérêt, zones de jeu, etc.).
+ *
+ * @param {ENetPeer*} peer - Pair connecté candidat à la diffusion.
+ * @param {void*} context - Contexte fourni par l'appelant à enet_host_broadcast_filtered().
+ * @returns {int} Une valeur non nulle pour envoyer le paquet à ce pair, 0 pour l'ignorer.
+ */
+typedef int (ENET_CALLBACK * ENetPeerFilterCallback) (ENetPeer * peer, void * context);
+
 /**
  * @callback ENetInterceptCallback
  * Callback pour intercepter les paquets UDP bruts reçus. Cette fonction permet d'inspecter, de modifier ou d'ignorer
@@ -626,6 +1002,334 @@ typedef enet_uint32 (ENET_CALLBACK * ENetChecksumCallback) (const ENetBuffer * b
  * @returns {int} Doit retourner 1 pour intercepter le paquet, 0 pour l'ignorer, ou -1 pour propager une erreur.
  */
 typedef int (ENET_CALLBACK * ENetInterceptCallback) (struct _ENetHost * host, struct _ENetEvent * event);
+
+/**
+ * @callback ENetReassemblyCallback
+ * Callback appelé à la réception du premier fragment d'un paquet fragmenté, pour fournir le paquet dans lequel
+ * les fragments sont réassemblés. Permet de faire arriver les données directement à leur emplacement final
+ * (par exemple une région de fichier projetée en mémoire) en créant le paquet avec ENET_PACKET_FLAG_NO_ALLOCATE.
+ * Un paquet accepté appartient ensuite à ENet comme tout paquet reçu : il est remis par ENET_EVENT_TYPE_RECEIVE,
+ * ou détruit par enet_packet_destroy (qui appelle son freeCallback) si le transfert est abandonné. Un paquet refusé
+ * (dataLength différent de totalLength, data NULL ou referenceCount non nul) n'est jamais détruit ni modifié : il
+ * reste à l'application, et ENet réassemble alors les fragments dans un paquet qu'il alloue lui-même.
+ *
+ * @param {ENetPeer*} peer - Le pair qui envoie le paquet.
+ * @param {enet_uint8} channelID - Le canal sur lequel le paquet est reçu.
+ * @param {size_t} totalLength - Taille totale du paquet réassemblé.
+ * @param {enet_uint32} flags - Drapeaux que doit porter le paquet (ENET_PACKET_FLAG_RELIABLE ou ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT).
+ * @returns {ENetPacket*} Un paquet de totalLength octets, ou NULL pour qu'ENet alloue le paquet lui-même.
+ */
+typedef ENetPacket * (ENET_CALLBACK * ENetReassemblyCallback) (ENetPeer * peer, enet_uint8 channelID, size_t totalLength, enet_uint32 flags);
+
+/**
+ * @enum _ENetDropReason
+ * Raisons pour lesquelles un hôte écarte un datagramme ou une commande reçus, comptées dans ENetHostStats.
+ *
+ * @typedef {enum} ENetDropReason
+ * @property {number} ENET_DROP_REASON_MALFORMED - Datagramme tronqué, commande inconnue ou incomplète, échec du déchiffrement ou de la décompression.
+ * @property {number} ENET_DROP_REASON_CHECKSUM - Datagramme dont le checksum ne correspond pas.
+ * @property {number} ENET_DROP_REASON_SESSION - Datagramme destiné à un pair inconnu ou déconnecté, ou venant d'une autre adresse ou d'une autre session que celles du pair.
+ * @property {number} ENET_DROP_REASON_WINDOW - Commande dont le numéro de séquence fiable est hors de la fenêtre de réception.
+ * @property {number} ENET_DROP_REASON_DUPLICATE - Commande déjà reçue, ou commande non fiable plus ancienne que la dernière délivrée.
+ * @property {number} ENET_DROP_REASON_WAITING_DATA - Commande refusée parce que le pair a déjà maximumWaitingData octets en attente d'être délivrés.
+ * @property {number} ENET_DROP_REASON_COUNT - Nombre de raisons.
+ */
+typedef enum _ENetDropReason
+{
+   ENET_DROP_REASON_MALFORMED    = 0,
+   ENET_DROP_REASON_CHECKSUM     = 1,
+   ENET_DROP_REASON_SESSION      = 2,
+   ENET_DROP_REASON_WINDOW       = 3,
+   ENET_DROP_REASON_DUPLICATE    = 4,
+   ENET_DROP_REASON_WAITING_DATA = 5,
+   ENET_DROP_REASON_COUNT        = 6
+} ENetDropReason;
+
+/**
+ * Compteurs cumulés d'un hôte depuis sa création, sur 64 bits. L'hôte les tient à jour directement dans son champ
+ * stats, par simple incrément là où l'événement se produit ; enet_host_get_stats() en copie un instantané cohérent.
+ *
+ * @typedef {Object} ENetHostStats
+ * @property {enet_uint64} sentData - Octets envoyés, en-têtes de datagramme compris.
+ * @property {enet_uint64} receivedData - Octets reçus, datagrammes écartés compris.
+ * @property {enet_uint64} sentDatagrams - Datagrammes envoyés.
+ * @property {enet_uint64} receivedDatagrams - Datagrammes reçus, écartés compris.
+ * @property {enet_uint64[]} sentCommands - Commandes envoyées, indexées par numéro de commande (ENET_PROTOCOL_COMMAND_*), retransmissions comprises.
+ * @property {enet_uint64[]} receivedCommands - Commandes reçues et décodées, indexées par numéro de commande.
+ * @property {enet_uint64} retransmits - Commandes fiables renvoyées après expiration de leur délai d'acquittement.
+ * @property {enet_uint64} fastRetransmits - Commandes fiables renvoyées par retransmission rapide.
+ * @property {enet_uint64} spuriousRetransmits - Retransmissions rapides dont l'original a finalement été acquitté.
+ * @property {enet_uint64[]} drops - Datagrammes ou commandes reçus et écartés, indexés par ENetDropReason.
+ * @property {enet_uint64} compressionSavedData - Octets économisés par la compression des datagrammes envoyés.
+ * @property {enet_uint64} allocations - Allocations faites par l'hôte pour les commandes, les acquittements, les paquets reçus et les tableaux de canaux.
+ */
+typedef struct _ENetHostStats
+{
+   enet_uint64 sentData;
+   enet_uint64 receivedData;
+   enet_uint64 sentDatagrams;
+   enet_uint64 receivedDatagrams;
+   enet_uint64 sentCommands [ENET_PROTOCOL_COMMAND_COUNT];
+   enet_uint64 receivedCommands [ENET_PROTOCOL_COMMAND_COUNT];
+   enet_uint64 retransmits;
+   enet_uint64 fastRetransmits;
+   enet_uint64 spuriousRetransmits;
+   enet_uint64 drops [ENET_DROP_REASON_COUNT];
+   enet_uint64 compressionSavedData;
+   enet_uint64 allocations;
+} ENetHostStats;
+
+/**
+ * Instantané des compteurs et des mesures d'un pair, rempli par enet_peer_get_stats(). Les compteurs couvrent la
+ * connexion en cours : ils repartent de zéro quand le pair est réinitialisé.
+ *
+ * @typedef {Object} ENetPeerStats
+ * @property {enet_uint64} sentData - Octets envoyés au pair, en-têtes de datagramme compris.
+ * @property {enet_uint64} receivedData - Octets reçus du pair.
+ * @property {enet_uint64} sentDatagrams - Datagrammes envoyés au pair.
+ * @property {enet_uint64} receivedDatagrams - Datagrammes reçus du pair.
+ * @property {enet_uint64} retransmits - Commandes fiables renvoyées après expiration de leur délai d'acquittement.
+ * @property {enet_uint64} fastRetransmits - Commandes fiables renvoyées par retransmission rapide.
+ * @property {enet_uint64} spuriousRetransmits - Retransmissions rapides inutiles.
+ * @property {enet_uint64} expiredPackets - Paquets abandonnés à l'expiration de leur durée de vie.
+ * @property {enet_uint64} supersededPackets - Paquets remplacés par une valeur plus récente avant leur envoi.
+ * @property {enet_uint32} roundTripTime - Temps d'aller-retour lissé, en millisecondes.
+ * @property {enet_uint32} roundTripTimeVariance - Variance lissée du temps d'aller-retour.
+ * @property {enet_uint32} lastRoundTripTime - Dernier temps d'aller-retour mesuré.
+ * @property {enet_uint32} lowestRoundTripTime - Plus petit temps d'aller-retour de la période de limitation en cours.
+ * @property {enet_uint32} packetLoss - Taux de perte lissé, sur ENET_PEER_PACKET_LOSS_SCALE.
+ * @property {enet_uint32} packetLossVariance - Variance du taux de perte.
+ * @property {enet_uint32} packetThrottle - Limitation courante des paquets non fiables, sur ENET_PEER_PACKET_THROTTLE_SCALE.
+ * @property {enet_uint32} mtu - MTU négocié avec le pair.
+ * @property {enet_uint32} windowSize - Fenêtre de contrôle de flux en octets.
+ * @property {enet_uint32} reliableDataInTransit - Octets fiables envoyés et pas encore acquittés.
+ * @property {size_t} totalWaitingData - Octets reçus en attente d'être délivrés à l'application.
+ */
+typedef struct _ENetPeerStats
+{
+   enet_uint64 sentData;
+   enet_uint64 receivedData;
+   enet_uint64 sentDatagrams;
+   enet_uint64 receivedDatagrams;
+   enet_uint64 retransmits;
+   enet_uint64 fastRetransmits;
+   enet_uint64 spuriousRetransmits;
+   enet_uint64 expiredPackets;
+   enet_uint64 supersededPackets;
+   enet_uint32 roundTripTime;
+   enet_uint32 roundTripTimeVariance;
+   enet_uint32 lastRoundTripTime;
+   enet_uint32 lowestRoundTripTime;
+   enet_uint32 packetLoss;
+   enet_uint32 packetLossVariance;
+   enet_uint32 packetThrottle;
+   enet_uint32 mtu;
+   enet_uint32 windowSize;
+   enet_uint32 reliableDataInTransit;
+   size_t      totalWaitingData;
+} ENetPeerStats;
+
+/**
+ * @enum _ENetTraceEventType
+ * Types des événements enregistrés dans la trace d'un hôte (voir enet_host_trace_enable). Les
+ * champs detail, value et extra de ENetTraceEvent en dépendent ; channel << 16 | sequence désigne
+ * le canal et le numéro de séquence fiable d'une commande.
+ *
+ * @typedef {enum} ENetTraceEventType
+ * @property {number} ENET_TRACE_EVENT_NONE - Aucun événement.
+ * @property {number} ENET_TRACE_EVENT_LOST - Événements écrasés avant d'être lus ; value : leur nombre.
+ * @property {number} ENET_TRACE_EVENT_DATAGRAM_RECEIVE - Datagramme reçu et accepté ; value : taille reçue, extra : taille décodée.
+ * @property {number} ENET_TRACE_EVENT_DATAGRAM_SEND - Datagramme envoyé ; detail : nombre de commandes, value : taille envoyée.
+ * @property {number} ENET_TRACE_EVENT_COMMAND_QUEUE - Commande mise en file ; detail : numéro de commande, value : canal et séquence, extra : taille des données.
+ * @property {number} ENET_TRACE_EVENT_COMMAND_SEND - Commande retirée de la file et placée dans un datagramme ; mêmes champs.
+ * @property {number} ENET_TRACE_EVENT_RETRANSMIT - Commande fiable remise en file pour être renvoyée ; detail : 1 pour une retransmission rapide, value : canal et séquence, extra : nombre d'envois.
+ * @property {number} ENET_TRACE_EVENT_ACKNOWLEDGE - Acquittement reçu ; detail : numéro de la commande acquittée, value : canal et séquence, extra : temps d'aller-retour en millisecondes.
+ * @property {number} ENET_TRACE_EVENT_THROTTLE - Changement de la régulation du pair ; value : nouvelle valeur, extra : ancienne valeur.
+ * @property {number} ENET_TRACE_EVENT_STATE - Changement d'état du pair ; detail : nouvel état, value : ancien état.
+ * @property {number} ENET_TRACE_EVENT_COUNT - Nombre de types.
+ */
+typedef enum _ENetTraceEventType
+{
+   ENET_TRACE_EVENT_NONE             = 0,
+   ENET_TRACE_EVENT_LOST             = 1,
+   ENET_TRACE_EVENT_DATAGRAM_RECEIVE = 2,
+   ENET_TRACE_EVENT_DATAGRAM_SEND    = 3,
+   ENET_TRACE_EVENT_COMMAND_QUEUE    = 4,
+   ENET_TRACE_EVENT_COMMAND_SEND     = 5,
+   ENET_TRACE_EVENT_RETRANSMIT       = 6,
+   ENET_TRACE_EVENT_ACKNOWLEDGE      = 7,
+   ENET_TRACE_EVENT_THROTTLE         = 8,
+   ENET_TRACE_EVENT_STATE            = 9,
+   ENET_TRACE_EVENT_COUNT            = 10
+} ENetTraceEventType;
+
+enum
+{
+   ENET_TRACE_FILE_HEADER_SIZE = 16,
+   ENET_TRACE_EVENT_SIZE       = 16,
+   ENET_TRACE_FILE_VERSION     = 1
+};
+
+/**
+ * @typedef {struct} ENetTraceEvent
+ * Événement de la trace d'un hôte. Dans un fichier écrit par enet_host_trace_write, chaque
+ * événement occupe ENET_TRACE_EVENT_SIZE octets, les champs dans cet ordre en petit-boutiste,
+ * après un en-tête de ENET_TRACE_FILE_HEADER_SIZE octets : "RCETRACE", la version
+ * (ENET_TRACE_FILE_VERSION) et la taille d'un événement sur 16 bits, puis 4 octets réservés.
+ *
+ * @property {enet_uint32} time - Instant de l'événement en microsecondes (enet_time_get_us), qui revient à zéro toutes les 71 minutes. L'horloge n'est lue qu'au premier événement de chaque lot de travail (réception des datagrammes en attente, passe d'envoi, commandes mises en file par l'application entre deux appels à enet_host_service, changement d'état demandé par l'application) : les événements suivants du lot portent cet instant, leur ordre dans la trace restant exact.
+ * @property {enet_uint8} type - Type de l'événement (ENetTraceEventType).
+ * @property {enet_uint8} detail - Détail dépendant du type.
+ * @property {enet_uint16} peerID - Identifiant (incomingPeerID) du pair concerné, ENET_PROTOCOL_MAXIMUM_PEER_ID s'il n'y en a pas.
+ * @property {enet_uint32} value - Valeur dépendant du type.
+ * @property {enet_uint32} extra - Seconde valeur dépendant du type.
+ */
+typedef struct _ENetTraceEvent
+{
+   enet_uint32 time;
+   enet_uint8  type;
+   enet_uint8  detail;
+   enet_uint16 peerID;
+   enet_uint32 value;
+   enet_uint32 extra;
+} ENetTraceEvent;
+
+/**
+ * Point de trace de la bibliothèque : écrit un événement dans l'anneau de l'hôte si la trace est
+ * activée, sans appel de fonction, au prix d'un test de pointeur sinon. ENET_TRACE_CLOCK signale
+ * le début d'un lot de travail : l'horloge sera relue au prochain événement et les suivants
+ * reprendront cette lecture, une lecture d'horloge coûtant plus que l'écriture d'un événement.
+ * Tous deux sont définis à vide quand ENET_NO_TRACE est défini à la compilation de la
+ * bibliothèque (option RCENET_TRACE de CMake, trace de xmake).
+ */
+#ifdef ENET_NO_TRACE
+#define ENET_TRACE(host, eventType, eventPeer, eventDetail, eventValue, eventExtra) ((void) 0)
+#define ENET_TRACE_CLOCK(host) ((void) 0)
+#else
+#define ENET_TRACE(host, eventType, eventPeer, eventDetail, eventValue, eventExtra) \
+    do \
+    { \
+       ENetHost * traceHost = (host); \
+       if (traceHost -> traceEvents != NULL) \
+       { \
+          ENetTraceEvent * traceEvent = & traceHost -> traceEvents [traceHost -> traceWritten & (traceHost -> traceCapacity - 1)]; \
+          if (traceHost -> traceTimeStale) \
+          { \
+             traceHost -> traceTime = enet_time_get_us (); \
+             traceHost -> traceTimeStale = 0; \
+          } \
+          traceEvent -> time = traceHost -> traceTime; \
+          traceEvent -> type = (enet_uint8) (eventType); \
+          traceEvent -> detail = (enet_uint8) (eventDetail); \
+          traceEvent -> peerID = (eventPeer) != NULL ? (eventPeer) -> incomingPeerID : ENET_PROTOCOL_MAXIMUM_PEER_ID; \
+          traceEvent -> value = (eventValue); \
+          traceEvent -> extra = (eventExtra); \
+          ++ traceHost -> traceWritten; \
+       } \
+    } while (0)
+#define ENET_TRACE_CLOCK(host) \
+    ((host) -> traceTimeStale = 1)
+#endif
+
+/**
+ * @typedef {struct} ENetReplay
+ * Relecture d'une capture pcap écrite par enet_host_capture_open : les datagrammes reçus par
+ * l'hôte capturé sont rejoués dans un autre hôte, à l'heure de leur capture, par
+ * enet_replay_service. Structure opaque créée par enet_replay_create.
+ */
+typedef struct _ENetReplay ENetReplay;
+
+/**
+ * @typedef {struct} ENetSocketBackend
+ * Remplace la socket UDP d'un hôte pour l'envoi, la réception et l'attente des datagrammes (voir enet_host_socket_backend).
+ * Permet de faire passer le trafic d'un hôte par un autre transport, comme le réseau virtuel ENetNetwork.
+ *
+ * @property {void*} context - Données de contexte du backend. Doit être non NULL ; l'hôte utilise sa socket tant qu'il est NULL.
+ * @property {function} send - Envoie les bufferCount buffers en un datagramme à address, comme enet_socket_send. Retourne le nombre
+ * d'octets envoyés, 0 si le datagramme n'a pas pu partir tout de suite, ou < 0 en cas d'échec.
+ * @property {function} receive - Reçoit un datagramme dans buffer et son expéditeur dans address, comme enet_socket_receive.
+ * Retourne le nombre d'octets reçus, 0 s'il n'y en a aucun, -2 si le datagramme était tronqué ou < 0 en cas d'échec.
+ * @property {function} wait - Attend au plus timeout millisecondes un datagramme, comme enet_socket_wait : condition contient
+ * ENET_SOCKET_WAIT_RECEIVE en entrée et reçoit ENET_SOCKET_WAIT_RECEIVE si un datagramme est arrivé, ENET_SOCKET_WAIT_NONE sinon.
+ * Retourne 0, ou < 0 en cas d'échec.
+ * @property {function} destroy - Fonction appelée lorsque le backend est remplacé ou que l'hôte est détruit. Peut être NULL.
+ */
+typedef struct _ENetSocketBackend
+{
+   void * context;
+   int (ENET_CALLBACK * send) (void * context, struct _ENetHost * host, const ENetAddress * address, const ENetBuffer * buffers, size_t bufferCount);
+   int (ENET_CALLBACK * receive) (void * context, struct _ENetHost * host, ENetAddress * address, ENetBuffer * buffer);
+   int (ENET_CALLBACK * wait) (void * context, struct _ENetHost * host, enet_uint32 * condition, enet_uint32 timeout);
+   void (ENET_CALLBACK * destroy) (void * context);
+} ENetSocketBackend;
+
+/**
+ * @typedef {struct} ENetNetwork
+ * Réseau virtuel en mémoire entre des hôtes d'un même processus, avec son horloge virtuelle. Structure opaque créée par
+ * enet_network_create : tant qu'il existe, enet_time_get et enet_time_get_us donnent le temps virtuel, qui n'avance que
+ * par enet_network_advance ou quand un hôte du réseau attend dans enet_host_service.
+ */
+typedef struct _ENetNetwork ENetNetwork;
+
+/**
+ * @enum {number} ENetLinkChance
+ * Échelle des probabilités d'un lien : une chance de ENET_LINK_CHANCE_SCALE vaut 100 %.
+ */
+enum
+{
+   ENET_LINK_CHANCE_SCALE = 65536
+};
+
+/**
+ * @typedef {struct} ENetLink
+ * Caractéristiques d'un lien dirigé du réseau virtuel, d'un hôte vers un autre (voir enet_network_link). Tous les tirages
+ * aléatoires viennent du générateur du réseau, de sorte qu'une simulation rejouée avec la même graine donne le même résultat.
+ *
+ * @property {enet_uint32} latency - Délai de propagation en microsecondes.
+ * @property {enet_uint32} jitter - Délai supplémentaire tiré uniformément entre 0 et jitter microsecondes pour chaque datagramme,
+ * qui peut réordonner des datagrammes proches.
+ * @property {enet_uint32} loss - Probabilité de perte d'un datagramme, sur ENET_LINK_CHANCE_SCALE.
+ * @property {enet_uint32} reorder - Probabilité qu'un datagramme soit retenu d'une latence de plus (au moins une milliseconde) et arrive
+ * après ceux envoyés ensuite, sur ENET_LINK_CHANCE_SCALE.
+ * @property {enet_uint32} duplicate - Probabilité qu'un datagramme soit livré deux fois, sur ENET_LINK_CHANCE_SCALE.
+ * @property {enet_uint32} bandwidth - Débit du lien en octets par seconde, 0 pour un débit illimité. Les datagrammes attendent leur tour
+ * dans la file du lien avant d'être transmis.
+ * @property {enet_uint32} queueLimit - Octets au plus en attente dans la file du lien, au-delà desquels les datagrammes sont perdus ;
+ * 0 pour une file illimitée. Sans effet sans bandwidth.
+ * @property {enet_uint32} mtu - Taille maximale d'un datagramme, au-delà de laquelle il est perdu ; 0 pour aucune limite.
+ */
+typedef struct _ENetLink
+{
+   enet_uint32 latency;
+   enet_uint32 jitter;
+   enet_uint32 loss;
+   enet_uint32 reorder;
+   enet_uint32 duplicate;
+   enet_uint32 bandwidth;
+   enet_uint32 queueLimit;
+   enet_uint32 mtu;
+} ENetLink;
+
+/**
+ * @typedef {struct} ENetNetworkStats
+ * Compteurs d'un réseau virtuel depuis sa création, remplis par enet_network_get_stats().
+ *
+ * @property {enet_uint64} sentDatagrams - Datagrammes envoyés par les hôtes du réseau.
+ * @property {enet_uint64} deliveredDatagrams - Datagrammes reçus par les hôtes du réseau, doublons compris.
+ * @property {enet_uint64} lostDatagrams - Datagrammes perdus par tirage (loss).
+ * @property {enet_uint64} droppedDatagrams - Datagrammes perdus parce qu'ils dépassaient le MTU ou la file du lien, ou qu'aucun hôte n'avait leur adresse.
+ * @property {enet_uint64} reorderedDatagrams - Datagrammes retenus par tirage (reorder).
+ * @property {enet_uint64} duplicatedDatagrams - Doublons créés par tirage (duplicate).
+ */
+typedef struct _ENetNetworkStats
+{
+   enet_uint64 sentDatagrams;
+   enet_uint64 deliveredDatagrams;
+   enet_uint64 lostDatagrams;
+   enet_uint64 droppedDatagrams;
+   enet_uint64 reorderedDatagrams;
+   enet_uint64 duplicatedDatagrams;
+} ENetNetworkStats;
  
 /**
  * Représente un hôte ENet pour la communication avec les pairs. C'est le point central pour gérer les connexions réseau.
@@ -652,7 +1356,7 @@ typedef int (ENET_CALLBACK * ENetInterceptCallback) (struct _ENetHost * host, st
  * @property {enet_uint32} mtu - Unité de transmission maximale pour les paquets envoyés par cet hôte.
  * @property {enet_uint32} randomSeed - Graine aléatoire utilisée en interne par ENet.
  * @property {int} recalculateBandwidthLimits - Indique si les limites de bande passante doivent être recalculées.
- * @property {ENetPeer*} peers - Tableau de pairs alloués pour cet hôte.
+ * @property {ENetPeer*} peers - Tableau des peerCount pairs de l'hôte. Sa mémoire est réservée sans être engagée : seuls les committedPeers premiers pairs sont initialisés et peuvent être lus. Les suivants ne doivent pas être touchés (leurs pages peuvent ne pas être engagées, sous Windows notamment) ; un parcours des pairs s'arrête donc à committedPeers et non à peerCount.
  * @property {size_t} peerCount - Nombre de pairs alloués pour cet hôte.
  * @property {size_t} channelLimit - Limite maximale du nombre de canaux autorisés pour les pairs connectés.
  * @property {enet_uint32} serviceTime - Horodatage du dernier appel à enet_host_service().
@@ -666,14 +1370,14 @@ typedef int (ENET_CALLBACK * ENetInterceptCallback) (struct _ENetHost * host, st
  * @property {size_t} bufferCount - Nombre de buffers utilisés.
  * @property {ENetChecksumCallback} checksum - Callback pour le calcul de checksum des paquets.
  * @property {ENetCompressor} compressor - Compresseur pour la compression des données des paquets.
- * @property {enet_uint8[][]} packetData - Deux tableaux de données de paquets pour l'envoi et la réception.
+ * @property {enet_uint8[][]} packetData - Deux tableaux de données de paquets pour l'envoi et la réception, avec ENET_PACKET_HEADROOM octets réservés devant et ENET_PACKET_TAILROOM octets derrière.
  * @property {ENetAddress} receivedAddress - Adresse de l'expéditeur du dernier paquet reçu.
  * @property {enet_uint8*} receivedData - Données du dernier paquet reçu.
  * @property {size_t} receivedDataLength - Longueur des données du dernier paquet reçu.
- * @property {enet_uint32} totalSentData - Total des données envoyées.
- * @property {enet_uint32} totalSentPackets - Total des paquets UDP envoyés.
- * @property {enet_uint32} totalReceivedData - Total des données reçues.
- * @property {enet_uint32} totalReceivedPackets - Total des paquets UDP reçus.
+ * @property {enet_uint32} totalSentData - Total des données envoyées, que l'application peut remettre à zéro ; sur 32 bits, il revient à zéro tous les 4 Go (voir stats).
+ * @property {enet_uint32} totalSentPackets - Total des paquets UDP envoyés, remis à zéro à volonté comme totalSentData.
+ * @property {enet_uint32} totalReceivedData - Total des données reçues, remis à zéro à volonté comme totalSentData.
+ * @property {enet_uint32} totalReceivedPackets - Total des paquets UDP reçus, remis à zéro à volonté comme totalSentData.
  * @property {ENetInterceptCallback} intercept - Callback pour l'interception des paquets UDP bruts reçus.
  * @property {size_t} connectedPeers - Nombre de pairs actuellement connectés.
  * @property {size_t} bandwidthLimitedPeers - Nombre de pairs avec la bande passante limitée.
@@ -681,6 +1385,34 @@ typedef int (ENET_CALLBACK * ENetInterceptCallback) (struct _ENetHost * host, st
  * @property {size_t} maximumPacketSize - Taille maximale autorisée des paquets pouvant être envoyés ou reçus.
  * @property {size_t} maximumWaitingData - Quantité maximale agrégée de données qu'un pair peut utiliser en attente de la livraison des paquets.
  * @property {ENetEncryptor} encryptor - Encrypteur pour le chiffrement des paquets UDP avant leur envoi ou réception.
+ * @property {ENetPeer**} connectedPeerList - Tableau compact des pairs connectés (connectedPeers entrées), parcouru par les diffusions au lieu de tous les pairs.
+ * @property {ENetList} outgoingCommandPool - Commandes sortantes libérées, réutilisées avant toute nouvelle allocation.
+ * @property {size_t} outgoingCommandPoolSize - Nombre de commandes dans outgoingCommandPool.
+ * @property {ENetReassemblyCallback} reassembly - Callback fournissant le paquet de destination des paquets fragmentés reçus, NULL par défaut.
+ * @property {enet_uint32} windowLimit - Plus grande fenêtre de contrôle de flux proposée aux nouvelles connexions (ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE par défaut, voir enet_host_window_limit).
+ * @property {size_t} committedPeers - Nombre de pairs initialisés en tête de peers, les seuls qui peuvent être lus ; il croît par ENET_HOST_PEER_COMMIT_COUNT quand tous sont occupés et peut décroître quand des pairs inutilisés sont rendus (voir enet_host_set_peer_release_timeout).
+ * @property {enet_uint32} peerReleaseTimeout - Durée en millisecondes au-delà de laquelle les pairs inutilisés en fin de peers rendent leur mémoire au système, 0 pour ne jamais la rendre (voir enet_host_set_peer_release_timeout).
+ * @property {enet_uint32} peerReleaseEpoch - Dernier instant où aucun pair inutilisé ne pouvait être rendu en fin de peers.
+ * @property {ENetList} channelSlabs - Blocs de tableaux de canaux réservés par l'hôte, rendus à sa destruction ou quand plus aucune connexion ne les utilise.
+ * @property {ENetList} channelPool - Tableaux de canaux rendus par les connexions réinitialisées, réutilisés avant d'en découper de nouveaux.
+ * @property {size_t} channelArraySize - Nombre de canaux de chaque tableau découpé dans les blocs, la valeur de channelLimit quand ils ont été réservés.
+ * @property {size_t} channelArraysInUse - Nombre de tableaux des blocs attribués à des connexions.
+ * @property {enet_uint8*} channelSlabNext - Début de la partie encore jamais attribuée du dernier bloc.
+ * @property {enet_uint8*} channelSlabEnd - Fin du dernier bloc.
+ * @property {ENetHostStats} stats - Compteurs cumulés sur 64 bits depuis la création de l'hôte, lus avec enet_host_get_stats().
+ * @property {ENetHistogram*} histograms - ENET_HISTOGRAM_COUNT histogrammes regroupant les mesures de tous les pairs, indexés par ENetHistogramKind, NULL tant qu'enet_host_set_histograms ne les a pas activés.
+ * @property {ENetTraceEvent*} traceEvents - Anneau de traceCapacity événements de la trace de l'hôte, NULL tant qu'enet_host_trace_enable ne l'a pas activée.
+ * @property {size_t} traceCapacity - Nombre d'événements de l'anneau, une puissance de deux.
+ * @property {size_t} traceWritten - Nombre d'événements écrits dans l'anneau depuis son activation, modulo SIZE_MAX + 1.
+ * @property {size_t} traceRead - Nombre d'événements lus ou écrasés depuis son activation.
+ * @property {enet_uint32} traceTime - Instant en microsecondes donné aux événements de la trace.
+ * @property {int} traceTimeStale - Non nul si traceTime doit être relu au prochain événement (voir ENET_TRACE_CLOCK).
+ * @property {void*} captureFile - Fichier pcap (FILE *) où enet_host_capture_open écrit les datagrammes envoyés et reçus, NULL sans capture.
+ * @property {enet_uint32} captureEpoch - Heure (time) à l'ouverture de la capture, en secondes, à laquelle les horodatages des datagrammes sont relatifs.
+ * @property {enet_uint32} captureClock - Dernière lecture de enet_time_get_us par la capture.
+ * @property {enet_uint64} captureElapsed - Microsecondes écoulées depuis l'ouverture de la capture.
+ * @property {ENetReplay*} replay - Relecture qui alimente l'hôte (voir enet_replay_service). Une fois définie, l'hôte n'envoie plus rien sur sa socket.
+ * @property {ENetSocketBackend} socketBackend - Backend qui remplace la socket de l'hôte (voir enet_host_socket_backend), inactif si son contexte est NULL.
  */
 typedef struct _ENetHost
 {
@@ -706,7 +1438,7 @@ typedef struct _ENetHost
    size_t               bufferCount;
    ENetChecksumCallback checksum;
    ENetCompressor       compressor;
-   enet_uint8           packetData [2][ENET_PROTOCOL_MAXIMUM_MTU];
+   enet_uint8           packetData [2][ENET_PACKET_HEADROOM + ENET_PROTOCOL_MAXIMUM_MTU + ENET_PACKET_TAILROOM];
    ENetAddress          receivedAddress;
    enet_uint8 *         receivedData;
    size_t               receivedDataLength;
@@ -722,6 +1454,34 @@ typedef struct _ENetHost
    size_t               maximumWaitingData;
    /* rcenet fields start here */
    ENetEncryptor        encryptor;
+   ENetPeer **          connectedPeerList;
+   ENetList             outgoingCommandPool;
+   size_t               outgoingCommandPoolSize;
+   ENetReassemblyCallback reassembly;
+   enet_uint32          windowLimit;
+   size_t               committedPeers;
+   enet_uint32          peerReleaseTimeout;
+   enet_uint32          peerReleaseEpoch;
+   ENetList             channelSlabs;
+   ENetList             channelPool;
+   size_t               channelArraySize;
+   size_t               channelArraysInUse;
+   enet_uint8 *         channelSlabNext;
+   enet_uint8 *         channelSlabEnd;
+   ENetHostStats        stats;
+   ENetHistogram *      histograms;
+   ENetTraceEvent *     traceEvents;
+   size_t               traceCapacity;
+   size_t               traceWritten;
+   size_t               traceRead;
+   enet_uint32          traceTime;
+   int                  traceTimeStale;
+   void *               captureFile;
+   enet_uint32          captureEpoch;
+   enet_uint32          captureClock;
+   enet_uint64          captureElapsed;
+   ENetReplay *         replay;
+   ENetSocketBackend    socketBackend;
 } ENetHost;
 
 /**
@@ -806,6 +1566,40 @@ ENET_API enet_uint32 enet_time_get (void);
   Sets the current wall-time in milliseconds.
   */
 ENET_API void enet_time_set (enet_uint32);
+/**
+  Returns a monotonic time in microseconds, wrapping every 2^32 microseconds.
+  Its origin is unspecified and unaffected by enet_time_set; only differences are meaningful.
+  */
+ENET_API enet_uint32 enet_time_get_us (void);
+/**
+  Virtual time in microseconds while an ENetNetwork drives the clock, NULL otherwise.
+  */
+extern const enet_uint64 * enet_time_virtual;
+
+/** @defgroup memory ENet memory functions backing the peers of a host
+*/
+/**
+  Reserves size bytes of address space. The pages must be committed with enet_memory_commit
+  before they are used; they read as zeros until first written.
+  @returns the memory, or NULL on failure
+  */
+extern void * enet_memory_reserve (size_t);
+/**
+  Commits the pages holding size bytes of reserved memory so that they can be used. Committing
+  pages again is harmless.
+  @returns 0 on success, < 0 on failure
+  */
+extern int    enet_memory_commit (void *, size_t);
+/**
+  Gives the physical memory behind whole pages of reserved memory back to the system. The pages
+  must be committed again before they are used, and read as zeros afterwards.
+  @returns 0 on success, < 0 on failure
+  */
+extern int    enet_memory_discard (void *, size_t);
+/** Releases memory obtained from enet_memory_reserve. */
+extern void   enet_memory_release (void *, size_t);
+/** Returns the size in bytes of a memory page. */
+extern size_t enet_memory_page_size (void);
 
 /** @defgroup socket ENet socket functions
 */
@@ -922,13 +1716,32 @@ ENET_API int        enet_host_check_events (ENetHost *, ENetEvent *);
 ENET_API int        enet_host_service (ENetHost *, ENetEvent *, enet_uint32);
 ENET_API void       enet_host_flush (ENetHost *);
 ENET_API void       enet_host_broadcast (ENetHost *, enet_uint8, ENetPacket *);
+ENET_API void       enet_host_broadcast_filtered (ENetHost *, enet_uint8, ENetPacket *, ENetPeerFilterCallback, void *);
+ENET_API int        enet_host_send_to_peers (ENetHost *, enet_uint8, ENetPacket *, ENetPeer **, size_t);
 ENET_API void       enet_host_compress (ENetHost *, const ENetCompressor *);
 ENET_API int        enet_host_compress_with_range_coder (ENetHost * host);
 ENET_API void       enet_host_channel_limit (ENetHost *, size_t);
 ENET_API void       enet_host_bandwidth_limit (ENetHost *, enet_uint32, enet_uint32);
+ENET_API void       enet_host_window_limit (ENetHost *, enet_uint32);
+ENET_API void       enet_host_set_peer_release_timeout (ENetHost *, enet_uint32);
+ENET_API int        enet_host_set_histograms (ENetHost *, int);
+ENET_API int        enet_host_trace_enable (ENetHost *, size_t);
+ENET_API size_t     enet_host_trace_read (ENetHost *, ENetTraceEvent *, size_t);
+ENET_API int        enet_host_trace_write (ENetHost *, const char *);
+ENET_API int        enet_host_capture_open (ENetHost *, const char *);
+ENET_API void       enet_host_capture_close (ENetHost *);
+ENET_API void       enet_host_socket_backend (ENetHost *, const ENetSocketBackend *);
+extern   void       enet_host_capture_datagram (ENetHost *, const ENetAddress *, int, const ENetBuffer *, size_t);
+extern   int        enet_host_commit_peers (ENetHost *, size_t);
+extern   void       enet_host_release_peers (ENetHost *);
 extern   void       enet_host_bandwidth_throttle (ENetHost *);
 extern  enet_uint32 enet_host_random_seed (void);
 extern  enet_uint32 enet_host_random (ENetHost *);
+extern  ENetOutgoingCommand * enet_host_allocate_outgoing_command (ENetHost *);
+extern  void        enet_host_release_outgoing_command (ENetHost *, ENetOutgoingCommand *);
+extern  ENetChannel * enet_host_acquire_channels (ENetHost *, size_t);
+extern  void        enet_host_release_channels (ENetHost *, ENetChannel *);
+extern  void        enet_host_release_channel_slabs (ENetHost *);
 ENET_API void       enet_host_encrypt(ENetHost*, const ENetEncryptor*);
 
 ENET_API int                 enet_peer_send (ENetPeer *, enet_uint8, ENetPacket *);
@@ -941,12 +1754,39 @@ ENET_API void                enet_peer_disconnect (ENetPeer *, enet_uint32);
 ENET_API void                enet_peer_disconnect_now (ENetPeer *, enet_uint32);
 ENET_API void                enet_peer_disconnect_later (ENetPeer *, enet_uint32);
 ENET_API void                enet_peer_throttle_configure (ENetPeer *, enet_uint32, enet_uint32, enet_uint32);
+ENET_API int                 enet_peer_set_channel_aggregation (ENetPeer *, enet_uint8, int, enet_uint32);
+ENET_API void                enet_peer_set_coalescing (ENetPeer *, enet_uint32);
+ENET_API void                enet_peer_flush (ENetPeer *);
+ENET_API int                 enet_peer_set_channel_fec (ENetPeer *, enet_uint8, enet_uint8);
+ENET_API void                enet_peer_set_fast_retransmit (ENetPeer *, enet_uint32);
+ENET_API int                 enet_peer_set_channel_priority (ENetPeer *, enet_uint8, enet_uint8, enet_uint8);
+ENET_API int                 enet_peer_set_channel_time_to_live (ENetPeer *, enet_uint8, enet_uint32, int);
+ENET_API int                 enet_peer_set_channel_superseding (ENetPeer *, enet_uint8, size_t);
+ENET_API int                 enet_peer_send_superseding (ENetPeer *, enet_uint8, ENetPacket *, enet_uint32);
+ENET_API int                 enet_peer_set_histograms (ENetPeer *, int);
+ENET_API ENetStream *        enet_peer_stream_open (ENetPeer *, enet_uint8, ENetStreamReadCallback, void *);
+ENET_API int                 enet_peer_stream_write (ENetStream *, const void *, size_t);
+ENET_API int                 enet_peer_stream_close (ENetStream *);
 extern int                   enet_peer_throttle (ENetPeer *, enet_uint32);
 extern void                  enet_peer_reset_queues (ENetPeer *);
 extern int                   enet_peer_has_outgoing_commands (ENetPeer *);
 extern void                  enet_peer_setup_outgoing_command (ENetPeer *, ENetOutgoingCommand *);
+extern size_t                enet_peer_fragment_length (const ENetPeer *);
+extern int                   enet_peer_send_fragments (ENetPeer *, enet_uint8, ENetPacket *, size_t, ENetFragmentTable *);
+extern ENetOutgoingCommand * enet_peer_split_fragment_run (ENetPeer *, ENetOutgoingCommand *);
+extern void                  enet_peer_build_send_command (ENetProtocol *, enet_uint8, const ENetPacket *, enet_uint8);
+extern int                   enet_peer_send_command (ENetPeer *, ENetPacket *, const ENetProtocol *, size_t);
+extern int                   enet_peer_flush_aggregate (ENetPeer *, enet_uint8);
+extern void                  enet_peer_flush_aggregates (ENetPeer *, int);
+extern void                  enet_peer_flush_parity (ENetPeer *);
+extern void                  enet_peer_pump_streams (ENetPeer *);
+extern void                  enet_peer_reset_fec (ENetChannel *);
+extern void                  enet_peer_unindex_outgoing_command (ENetOutgoingCommand *);
+extern ENetFragmentTable *   enet_fragment_table_create (const ENetPacket *, size_t);
+extern void                  enet_fragment_table_release (ENetFragmentTable *);
 extern ENetOutgoingCommand * enet_peer_queue_outgoing_command (ENetPeer *, const ENetProtocol *, ENetPacket *, enet_uint32, enet_uint16);
 extern ENetIncomingCommand * enet_peer_queue_incoming_command (ENetPeer *, const ENetProtocol *, const void *, size_t, enet_uint32, enet_uint32);
+extern ENetIncomingCommand * enet_peer_find_incoming_fragments (ENetPeer *, enet_uint8, enet_uint8, enet_uint16, enet_uint16);
 extern ENetAcknowledgement * enet_peer_queue_acknowledgement (ENetPeer *, const ENetProtocol *, enet_uint16);
 extern void                  enet_peer_dispatch_incoming_unreliable_commands (ENetPeer *, ENetChannel *, ENetIncomingCommand *);
 extern void                  enet_peer_dispatch_incoming_reliable_commands (ENetPeer *, ENetChannel *, ENetIncomingCommand *);
@@ -958,7 +1798,24 @@ ENET_API void   enet_range_coder_destroy (void *);
 ENET_API size_t enet_range_coder_compress (void *, const ENetBuffer *, size_t, size_t, enet_uint8 *, size_t);
 ENET_API size_t enet_range_coder_decompress (void *, const enet_uint8 *, size_t, enet_uint8 *, size_t);
 
+ENET_API void        enet_histogram_reset (ENetHistogram *);
+ENET_API void        enet_histogram_record (ENetHistogram *, enet_uint32);
+ENET_API void        enet_histogram_merge (ENetHistogram *, const ENetHistogram *);
+ENET_API enet_uint32 enet_histogram_percentile (const ENetHistogram *, double);
+
+ENET_API ENetReplay * enet_replay_create (const char *);
+ENET_API void         enet_replay_destroy (ENetReplay *);
+ENET_API int          enet_replay_service (ENetReplay *, ENetHost *, ENetEvent *);
+
+ENET_API ENetNetwork * enet_network_create (enet_uint32);
+ENET_API void          enet_network_destroy (ENetNetwork *);
+ENET_API int           enet_network_attach (ENetNetwork *, ENetHost *);
+ENET_API int           enet_network_link (ENetNetwork *, const ENetAddress *, const ENetAddress *, const ENetLink *);
+ENET_API void          enet_network_advance (ENetNetwork *, enet_uint32);
+ENET_API void          enet_network_get_stats (const ENetNetwork *, ENetNetworkStats *);
+
 extern size_t enet_protocol_command_size (enet_uint8);
+extern int    enet_protocol_receive_datagram (ENetHost *, ENetEvent *);
 
 /** @defgroup Extended API for easier binding in other programming languages
    For binding ENet to other programming languages, 
@@ -980,8 +1837,11 @@ ENET_API enet_uint32 enet_host_get_packets_sent(const ENetHost*);
 ENET_API enet_uint32 enet_host_get_packets_received(const ENetHost*);
 ENET_API enet_uint32 enet_host_get_bytes_sent(const ENetHost*);
 ENET_API enet_uint32 enet_host_get_bytes_received(const ENetHost*);
+ENET_API void enet_host_get_stats(const ENetHost*, ENetHostStats*);
+ENET_API const ENetHistogram* enet_host_get_histogram(const ENetHost*, ENetHistogramKind);
 ENET_API void enet_host_set_max_duplicate_peers(ENetHost*, enet_uint16);
 ENET_API void enet_host_set_intercept_callback(ENetHost*, ENetInterceptCallback);
+ENET_API void enet_host_set_reassembly_callback(ENetHost*, ENetReassemblyCallback);
 ENET_API void enet_host_set_checksum_callback(ENetHost*, ENetChecksumCallback);
 
 ENET_API enet_uint32 enet_peer_get_id(const ENetPeer*);
@@ -994,6 +1854,13 @@ ENET_API enet_uint32 enet_peer_get_last_rtt(const ENetPeer* peer);
 ENET_API enet_uint32 enet_peer_get_lastsendtime(const ENetPeer*);
 ENET_API enet_uint32 enet_peer_get_lastreceivetime(const ENetPeer*);
 ENET_API float enet_peer_get_packets_throttle(const ENetPeer*);
+ENET_API float enet_peer_get_datagram_fill_ratio(const ENetPeer*);
+ENET_API enet_uint32 enet_peer_get_fast_retransmits(const ENetPeer*);
+ENET_API enet_uint32 enet_peer_get_spurious_retransmits(const ENetPeer*);
+ENET_API enet_uint32 enet_peer_get_expired_packets(const ENetPeer*);
+ENET_API enet_uint32 enet_peer_get_superseded_packets(const ENetPeer*);
+ENET_API void enet_peer_get_stats(const ENetPeer*, ENetPeerStats*);
+ENET_API const ENetHistogram* enet_peer_get_histogram(const ENetPeer*, ENetHistogramKind);
 ENET_API void* enet_peer_get_data(const ENetPeer*);
 ENET_API void enet_peer_set_data(ENetPeer*, const void*);
 
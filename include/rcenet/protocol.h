@@ -24,6 +24,7 @@
  * @property {number} ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS - Nombre maximum de commandes pouvant être incluses dans un seul paquet.
  * @property {number} ENET_PROTOCOL_MINIMUM_WINDOW_SIZE - Taille minimale de la fenêtre de congestion, pour un contrôle de flux efficace.
  * @property {number} ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE - Taille maximale de la fenêtre de congestion, permettant de grandes rafales de données.
+ * @property {number} ENET_PROTOCOL_MAXIMUM_SCALED_WINDOW_SIZE - Taille maximale de la fenêtre de congestion lorsque les deux pairs l'ont étendue (voir enet_host_window_limit). Une fenêtre plus grande est annoncée dans le champ windowSize des commandes de connexion, qu'un pair ENet d'origine ramène à ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE.
  * @property {number} ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT - Nombre minimal de canaux de communication, assurant au moins un canal.
  * @property {number} ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT - Nombre maximal de canaux de communication, pour une multiplexage efficace.
  * @property {number} ENET_PROTOCOL_MAXIMUM_PEER_ID - Identifiant maximal pour les pairs, limitant le nombre de pairs simultanés.
@@ -36,6 +37,7 @@ enum
    ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS = 32,
    ENET_PROTOCOL_MINIMUM_WINDOW_SIZE     = 4096,
    ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE     = 65536,
+   ENET_PROTOCOL_MAXIMUM_SCALED_WINDOW_SIZE = 16 * 1024 * 1024,
    ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT   = 1,
    ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT   = 255,
    ENET_PROTOCOL_MAXIMUM_PEER_ID         = 0xFFFF, // 65535
@@ -61,6 +63,8 @@ enum
  * @property {number} ENET_PROTOCOL_COMMAND_BANDWIDTH_LIMIT - Commande pour définir la limite de bande passante.
  * @property {number} ENET_PROTOCOL_COMMAND_THROTTLE_CONFIGURE - Commande pour configurer l'étranglement du trafic.
  * @property {number} ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT - Commande pour envoyer des fragments de données de manière non fiable.
+ * @property {number} ENET_PROTOCOL_COMMAND_FEC_CONFIGURE - Commande pour annoncer la taille des groupes de correction d'erreurs (FEC) d'un canal.
+ * @property {number} ENET_PROTOCOL_COMMAND_SEND_PARITY - Commande transportant la parité XOR d'un groupe de commandes d'envoi, permettant de reconstruire une commande perdue.
  * @property {number} ENET_PROTOCOL_COMMAND_COUNT - Nombre total de commandes définies dans le protocole.
  * @property {number} ENET_PROTOCOL_COMMAND_MASK - Masque utilisé pour isoler le type de commande dans un entête de protocole.
  */
@@ -79,7 +83,9 @@ typedef enum _ENetProtocolCommand
    ENET_PROTOCOL_COMMAND_BANDWIDTH_LIMIT    = 10,
    ENET_PROTOCOL_COMMAND_THROTTLE_CONFIGURE = 11,
    ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT = 12,
-   ENET_PROTOCOL_COMMAND_COUNT              = 13,
+   ENET_PROTOCOL_COMMAND_FEC_CONFIGURE      = 13,
+   ENET_PROTOCOL_COMMAND_SEND_PARITY        = 14,
+   ENET_PROTOCOL_COMMAND_COUNT              = 15,
 
    ENET_PROTOCOL_COMMAND_MASK               = 0x0F
 } ENetProtocolCommand;
@@ -92,6 +98,9 @@ typedef enum _ENetProtocolCommand
  * @typedef {enum} ENetProtocolFlag
  * @property {number} ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE - Indique qu'une commande nécessite un accusé de réception.
  * @property {number} ENET_PROTOCOL_COMMAND_FLAG_UNSEQUENCED - Indique qu'une commande est envoyée sans séquence définie.
+ * @property {number} ENET_PROTOCOL_COMMAND_FLAG_AGGREGATE - Indique que la charge utile d'une commande SEND_* est une suite de messages [longueur varint][octets] (rcenet). Sur CONNECT et VERIFY_CONNECT, annonce que l'émetteur comprend ces commandes ; ENet d'origine ignore ce bit et ne le met jamais, si bien qu'aucune commande agrégée ne lui est envoyée. Un SEND_RELIABLE agrégé vide annule un paquet fiable expiré : le récepteur l'acquitte sans rien délivrer.
+ * @property {number} ENET_PROTOCOL_COMMAND_FLAG_STREAM - Indique que la charge utile d'une commande SEND_RELIABLE est un morceau de flux, précédé d'un octet de drapeaux ENET_PROTOCOL_STREAM_FLAG_* (rcenet). Sur CONNECT et VERIFY_CONNECT, annonce que l'émetteur comprend ces morceaux ; ENet d'origine ignore ce bit et ne le met jamais, si bien qu'aucun flux ne peut lui être ouvert, il livrerait l'octet de drapeaux avec les données.
+ * @property {number} ENET_PROTOCOL_COMMAND_FLAG_FEC - Sur CONNECT et VERIFY_CONNECT uniquement, annonce que l'émetteur comprend FEC_CONFIGURE et SEND_PARITY (rcenet). Partage le bit de ENET_PROTOCOL_COMMAND_FLAG_UNSEQUENCED, que ces commandes n'utilisent pas ; ENet d'origine l'ignore et ne le met jamais, si bien qu'aucune de ces commandes, qu'il prendrait pour inconnues, ne lui est envoyée.
  * @property {number} ENET_PROTOCOL_HEADER_FLAG_COMPRESSED - Indique que l'en-tête du paquet est compressé.
  * @property {number} ENET_PROTOCOL_HEADER_FLAG_SENT_TIME - Indique que le temps d'envoi est inclus dans l'en-tête du paquet.
  * @property {number} ENET_PROTOCOL_HEADER_FLAG_MASK - Masque combinant les drapeaux de l'en-tête pour une vérification rapide.
@@ -102,6 +111,9 @@ typedef enum _ENetProtocolFlag
 {
    ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE = (1 << 7),
    ENET_PROTOCOL_COMMAND_FLAG_UNSEQUENCED = (1 << 6),
+   ENET_PROTOCOL_COMMAND_FLAG_AGGREGATE   = (1 << 5),
+   ENET_PROTOCOL_COMMAND_FLAG_STREAM      = (1 << 4),
+   ENET_PROTOCOL_COMMAND_FLAG_FEC         = (1 << 6),
 
    ENET_PROTOCOL_HEADER_FLAG_COMPRESSED = (1 << 14),
    ENET_PROTOCOL_HEADER_FLAG_SENT_TIME  = (1 << 15),
@@ -111,6 +123,19 @@ typedef enum _ENetProtocolFlag
    ENET_PROTOCOL_HEADER_SESSION_SHIFT   = 12
 } ENetProtocolFlag;
 
+/**
+ * Drapeaux de l'octet qui précède les données d'un morceau de flux (commande portant ENET_PROTOCOL_COMMAND_FLAG_STREAM).
+ *
+ * @typedef {enum} ENetProtocolStreamFlag
+ * @property {number} ENET_PROTOCOL_STREAM_FLAG_START - Premier morceau du flux.
+ * @property {number} ENET_PROTOCOL_STREAM_FLAG_END - Dernier morceau du flux, sans données.
+ */
+typedef enum _ENetProtocolStreamFlag
+{
+   ENET_PROTOCOL_STREAM_FLAG_START = (1 << 0),
+   ENET_PROTOCOL_STREAM_FLAG_END   = (1 << 1)
+} ENetProtocolStreamFlag;
+
 /**
  * Enumération des drapeaux étendus pour les en-têtes de protocole RCENet.
  * Ces drapeaux permettent d'ajouter des fonctionnalités supplémentaires et des extensions futures au protocole sans perturber la compatibilité.
@@ -386,6 +411,57 @@ typedef struct _ENetProtocolSendFragment
    enet_uint32 fragmentOffset;
 } ENET_PACKED ENetProtocolSendFragment;
 
+/**
+ * Structure pour la configuration de la correction d'erreurs (FEC) d'un canal.
+ * Chaque extrémité annonce la taille de groupe qu'elle souhaite ; la taille effective est le minimum des deux.
+ * 
+ * @typedef {struct} _ENetProtocolFecConfigure
+ * @property {ENetProtocolCommandHeader} header - L'en-tête de la commande.
+ * @property {enet_uint8} channelID - Le canal concerné.
+ * @property {enet_uint8} groupSize - Le nombre de commandes protégées par une parité, 0 pour désactiver la FEC.
+ */
+typedef struct _ENetProtocolFecConfigure
+{
+   ENetProtocolCommandHeader header;
+   enet_uint8 channelID;
+   enet_uint8 groupSize;
+} ENET_PACKED ENetProtocolFecConfigure;
+
+/**
+ * Structure décrivant une commande membre d'un groupe de parité.
+ * Les champs reprennent ceux de la commande d'envoi d'origine, dans l'ordre réseau.
+ * 
+ * @typedef {struct} _ENetProtocolParityMember
+ * @property {enet_uint8} command - L'octet de commande d'origine, drapeaux compris.
+ * @property {enet_uint16} reliableSequenceNumber - Le numéro de séquence fiable de la commande.
+ * @property {enet_uint16} sequenceNumber - Le numéro de séquence non fiable ou le groupe non séquencé, 0 pour une commande fiable.
+ * @property {enet_uint16} dataLength - La longueur des données de la commande.
+ */
+typedef struct _ENetProtocolParityMember
+{
+   enet_uint8 command;
+   enet_uint16 reliableSequenceNumber;
+   enet_uint16 sequenceNumber;
+   enet_uint16 dataLength;
+} ENET_PACKED ENetProtocolParityMember;
+
+/**
+ * Structure pour l'envoi d'une parité FEC.
+ * Les données contiennent memberCount ENetProtocolParityMember suivis du XOR des données des membres,
+ * aussi long que le plus long d'entre eux.
+ * 
+ * @typedef {struct} _ENetProtocolSendParity
+ * @property {ENetProtocolCommandHeader} header - L'en-tête de la commande.
+ * @property {enet_uint8} memberCount - Le nombre de commandes protégées.
+ * @property {enet_uint16} dataLength - La longueur des données (table des membres et parité).
+ */
+typedef struct _ENetProtocolSendParity
+{
+   ENetProtocolCommandHeader header;
+   enet_uint8 memberCount;
+   enet_uint16 dataLength;
+} ENET_PACKED ENetProtocolSendParity;
+
 /**
  * Union représentant les différents types de paquets pouvant être envoyés ou reçus dans le protocole ENet.
  * Cette structure permet de manipuler facilement les différents types de paquets comme s'ils étaient du même type,
@@ -405,6 +481,8 @@ typedef struct _ENetProtocolSendFragment
  * @property {ENetProtocolSendFragment} sendFragment - Paquet contenant un fragment de données plus grandes que la taille maximale de paquet.
  * @property {ENetProtocolBandwidthLimit} bandwidthLimit - Paquet définissant les limites de bande passante entrante et sortante.
  * @property {ENetProtocolThrottleConfigure} throttleConfigure - Paquet configurant la gestion de la régulation du débit de paquets.
+ * @property {ENetProtocolFecConfigure} fecConfigure - Paquet annonçant la taille des groupes FEC d'un canal.
+ * @property {ENetProtocolSendParity} sendParity - Paquet contenant la parité XOR d'un groupe de commandes d'envoi.
  */
 typedef union _ENetProtocol
 {
@@ -420,6 +498,8 @@ typedef union _ENetProtocol
    ENetProtocolSendFragment sendFragment;
    ENetProtocolBandwidthLimit bandwidthLimit;
    ENetProtocolThrottleConfigure throttleConfigure;
+   ENetProtocolFecConfigure fecConfigure;
+   ENetProtocolSendParity sendParity;
 } ENET_PACKED ENetProtocol;
 
 #ifdef _MSC_VER
@@ -37,4 +37,13 @@ typedef unsigned short enet_uint16;
  */
 typedef unsigned int enet_uint32;
 
+/**
+ * @typedef enet_uint64
+ * @brief Type entier non signé de 64 bits.
+ * 
+ * Utilisé pour les compteurs cumulés de trafic et d'événements, qui ne doivent pas revenir à zéro
+ * pendant la durée de vie d'un hôte.
+ */
+typedef unsigned long long enet_uint64;
+
 #endif // RCENET_TYPES_H
\ No newline at end of file
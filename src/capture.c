@@ -0,0 +1,530 @@
+/**
+ @file  capture.c
+ @brief ENet pcap capture of host traffic and deterministic replay
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#define ENET_BUILDING_LIB 1
+#include "rcenet/enet.h"
+#include "rcenet/time.h"
+
+/** @defgroup Capture ENet traffic capture and replay
+    @{
+*/
+
+enum
+{
+   ENET_CAPTURE_FILE_HEADER_SIZE   = 24,
+   ENET_CAPTURE_RECORD_HEADER_SIZE = 16,
+   ENET_CAPTURE_LINK_HEADER_SIZE   = 16,
+   ENET_CAPTURE_IPV4_HEADER_SIZE   = 20,
+   ENET_CAPTURE_IPV6_HEADER_SIZE   = 40,
+   ENET_CAPTURE_UDP_HEADER_SIZE    = 8,
+   ENET_CAPTURE_MAXIMUM_HEADERS    = ENET_CAPTURE_LINK_HEADER_SIZE + ENET_CAPTURE_IPV6_HEADER_SIZE + ENET_CAPTURE_UDP_HEADER_SIZE,
+   ENET_CAPTURE_MAXIMUM_RECORD     = ENET_CAPTURE_MAXIMUM_HEADERS + ENET_PROTOCOL_MAXIMUM_MTU,
+
+   /* Linux cooked capture: a 16-byte link header carries the direction of each datagram. */
+   ENET_CAPTURE_LINKTYPE_LINUX_SLL = 113,
+   ENET_CAPTURE_PACKET_INCOMING    = 0,
+   ENET_CAPTURE_PACKET_OUTGOING    = 4,
+   ENET_CAPTURE_ARPHRD_NONE        = 0xFFFE,
+   ENET_CAPTURE_ETHERTYPE_IPV4     = 0x0800,
+   ENET_CAPTURE_ETHERTYPE_IPV6     = 0x86DD,
+   ENET_CAPTURE_IPPROTO_UDP        = 17
+};
+
+struct _ENetReplay
+{
+   FILE *      file;
+   int         swapped;
+   int         nanoseconds;
+   enet_uint32 clockOffset;
+   enet_uint8  record [ENET_CAPTURE_MAXIMUM_RECORD];
+};
+
+static void
+enet_capture_put_16 (enet_uint8 * data, enet_uint16 value)
+{
+    data [0] = (enet_uint8) value;
+    data [1] = (enet_uint8) (value >> 8);
+}
+
+static void
+enet_capture_put_32 (enet_uint8 * data, enet_uint32 value)
+{
+    data [0] = (enet_uint8) value;
+    data [1] = (enet_uint8) (value >> 8);
+    data [2] = (enet_uint8) (value >> 16);
+    data [3] = (enet_uint8) (value >> 24);
+}
+
+static void
+enet_capture_put_net_16 (enet_uint8 * data, enet_uint16 value)
+{
+    data [0] = (enet_uint8) (value >> 8);
+    data [1] = (enet_uint8) value;
+}
+
+static enet_uint16
+enet_capture_get_net_16 (const enet_uint8 * data)
+{
+    return (enet_uint16) (data [0] << 8 | data [1]);
+}
+
+/** Writes the 4 or 16 bytes of an address in network order, an IPv6 address into an IPv4 header
+    being left unspecified. */
+static void
+enet_capture_put_address (enet_uint8 * data, const ENetAddress * address, int ipv6)
+{
+    int i;
+
+    if (! ipv6)
+    {
+       if (address -> type == ENET_ADDRESS_TYPE_IPV4)
+         memcpy (data, address -> host.v4, 4);
+       else
+         memset (data, 0, 4);
+       return;
+    }
+
+    if (address -> type == ENET_ADDRESS_TYPE_IPV4)
+    {
+       /* IPv4-mapped IPv6 address */
+       memset (data, 0, 10);
+       data [10] = 0xFF;
+       data [11] = 0xFF;
+       memcpy (& data [12], address -> host.v4, 4);
+       return;
+    }
+
+    for (i = 0; i < 8; ++ i)
+      enet_capture_put_net_16 (& data [i * 2], address -> host.v6 [i]);
+}
+
+static enet_uint32
+enet_capture_sum (enet_uint32 sum, const enet_uint8 * data, size_t length)
+{
+    for (; length > 1; data += 2, length -= 2)
+      sum += (enet_uint32) (data [0] << 8 | data [1]);
+
+    if (length > 0)
+      sum += (enet_uint32) (data [0] << 8);
+
+    return sum;
+}
+
+static enet_uint16
+enet_capture_fold (enet_uint32 sum)
+{
+    while (sum >> 16)
+      sum = (sum & 0xFFFF) + (sum >> 16);
+
+    return (enet_uint16) ~ sum;
+}
+
+/** Starts capturing the datagrams a host sends and receives to a pcap file, which Wireshark and
+    tcpdump read and enet_replay_create replays. Each datagram is written with a microsecond
+    timestamp and synthesized IP and UDP headers, in a Linux cooked capture that records whether
+    the host sent or received it. Capturing is meant for reproducing incidents and building
+    benchmark workloads: every datagram costs a file write from the thread servicing the host.
+    @param host host to capture
+    @param fileName path of the pcap file, replaced if it exists
+    @retval 0 on success
+    @retval < 0 if the file could not be created
+*/
+int
+enet_host_capture_open (ENetHost * host, const char * fileName)
+{
+    enet_uint8 header [ENET_CAPTURE_FILE_HEADER_SIZE];
+    FILE * file;
+
+    enet_host_capture_close (host);
+
+    file = fopen (fileName, "wb");
+    if (file == NULL)
+      return -1;
+
+    memset (header, 0, sizeof (header));
+    enet_capture_put_32 (& header [0], 0xA1B2C3D4);
+    enet_capture_put_16 (& header [4], 2);
+    enet_capture_put_16 (& header [6], 4);
+    enet_capture_put_32 (& header [16], 65535);
+    enet_capture_put_32 (& header [20], ENET_CAPTURE_LINKTYPE_LINUX_SLL);
+
+    if (fwrite (header, sizeof (header), 1, file) != 1)
+    {
+       fclose (file);
+       return -1;
+    }
+
+    host -> captureFile = file;
+    host -> captureEpoch = (enet_uint32) time (NULL);
+    host -> captureClock = enet_time_get_us ();
+    host -> captureElapsed = 0;
+
+    return 0;
+}
+
+/** Stops capturing the traffic of a host and closes its capture file.
+    @param host host whose capture is closed
+*/
+void
+enet_host_capture_close (ENetHost * host)
+{
+    if (host -> captureFile == NULL)
+      return;
+
+    fclose ((FILE *) host -> captureFile);
+
+    host -> captureFile = NULL;
+}
+
+/** Appends a datagram sent or received by a host to its capture. A datagram that cannot be
+    written stops the capture rather than failing the host.
+    @param host host whose capture is written
+    @param address address of the peer
+    @param outgoing nonzero if the host sent the datagram, 0 if it received it
+    @param buffers data of the datagram
+    @param bufferCount number of buffers
+*/
+void
+enet_host_capture_datagram (ENetHost * host, const ENetAddress * address, int outgoing, const ENetBuffer * buffers, size_t bufferCount)
+{
+    enet_uint8 record [ENET_CAPTURE_RECORD_HEADER_SIZE + ENET_CAPTURE_MAXIMUM_RECORD];
+    enet_uint8 * link = & record [ENET_CAPTURE_RECORD_HEADER_SIZE],
+               * ip = & link [ENET_CAPTURE_LINK_HEADER_SIZE],
+               * udp, * payload;
+    const ENetAddress * source = outgoing ? & host -> address : address,
+                      * destination = outgoing ? address : & host -> address;
+    int ipv6 = address -> type != ENET_ADDRESS_TYPE_IPV4;
+    size_t length = 0, recordLength;
+    enet_uint32 clock = enet_time_get_us (), sum;
+    enet_uint64 seconds;
+
+    udp = & ip [ipv6 ? ENET_CAPTURE_IPV6_HEADER_SIZE : ENET_CAPTURE_IPV4_HEADER_SIZE];
+    payload = & udp [ENET_CAPTURE_UDP_HEADER_SIZE];
+
+    for (; bufferCount > 0; -- bufferCount, ++ buffers)
+    {
+       if (length + buffers -> dataLength > ENET_PROTOCOL_MAXIMUM_MTU)
+         return;
+
+       memcpy (& payload [length], buffers -> data, buffers -> dataLength);
+       length += buffers -> dataLength;
+    }
+
+    memset (link, 0, ENET_CAPTURE_LINK_HEADER_SIZE);
+    enet_capture_put_net_16 (& link [0], outgoing ? ENET_CAPTURE_PACKET_OUTGOING : ENET_CAPTURE_PACKET_INCOMING);
+    enet_capture_put_net_16 (& link [2], ENET_CAPTURE_ARPHRD_NONE);
+    enet_capture_put_net_16 (& link [14], ipv6 ? ENET_CAPTURE_ETHERTYPE_IPV6 : ENET_CAPTURE_ETHERTYPE_IPV4);
+
+    enet_capture_put_net_16 (& udp [0], source -> port);
+    enet_capture_put_net_16 (& udp [2], destination -> port);
+    enet_capture_put_net_16 (& udp [4], (enet_uint16) (ENET_CAPTURE_UDP_HEADER_SIZE + length));
+    enet_capture_put_net_16 (& udp [6], 0);
+
+    if (ipv6)
+    {
+       memset (ip, 0, ENET_CAPTURE_IPV6_HEADER_SIZE);
+       ip [0] = 0x60;
+       enet_capture_put_net_16 (& ip [4], (enet_uint16) (ENET_CAPTURE_UDP_HEADER_SIZE + length));
+       ip [6] = ENET_CAPTURE_IPPROTO_UDP;
+       ip [7] = 64;
+       enet_capture_put_address (& ip [8], source, 1);
+       enet_capture_put_address (& ip [24], destination, 1);
+
+       /* The UDP checksum is mandatory over IPv6, computed with the pseudo-header. */
+       sum = enet_capture_sum (0, & ip [8], 32);
+       sum += ENET_CAPTURE_IPPROTO_UDP + (enet_uint32) (ENET_CAPTURE_UDP_HEADER_SIZE + length);
+       sum = enet_capture_sum (sum, udp, ENET_CAPTURE_UDP_HEADER_SIZE + length);
+       enet_capture_put_net_16 (& udp [6], enet_capture_fold (sum) != 0 ? enet_capture_fold (sum) : 0xFFFF);
+    }
+    else
+    {
+       memset (ip, 0, ENET_CAPTURE_IPV4_HEADER_SIZE);
+       ip [0] = 0x45;
+       enet_capture_put_net_16 (& ip [2], (enet_uint16) (ENET_CAPTURE_IPV4_HEADER_SIZE + ENET_CAPTURE_UDP_HEADER_SIZE + length));
+       enet_capture_put_net_16 (& ip [6], 0x4000);
+       ip [8] = 64;
+       ip [9] = ENET_CAPTURE_IPPROTO_UDP;
+       enet_capture_put_address (& ip [12], source, 0);
+       enet_capture_put_address (& ip [16], destination, 0);
+       enet_capture_put_net_16 (& ip [10], enet_capture_fold (enet_capture_sum (0, ip, ENET_CAPTURE_IPV4_HEADER_SIZE)));
+    }
+
+    recordLength = (size_t) (payload - link) + length;
+
+    host -> captureElapsed += (enet_uint32) (clock - host -> captureClock);
+    host -> captureClock = clock;
+    seconds = host -> captureEpoch + host -> captureElapsed / 1000000;
+
+    enet_capture_put_32 (& record [0], (enet_uint32) seconds);
+    enet_capture_put_32 (& record [4], (enet_uint32) (host -> captureElapsed % 1000000));
+    enet_capture_put_32 (& record [8], (enet_uint32) recordLength);
+    enet_capture_put_32 (& record [12], (enet_uint32) recordLength);
+
+    if (fwrite (record, ENET_CAPTURE_RECORD_HEADER_SIZE + recordLength, 1, (FILE *) host -> captureFile) != 1)
+      enet_host_capture_close (host);
+}
+
+static enet_uint32
+enet_replay_get_32 (const ENetReplay * replay, const enet_uint8 * data)
+{
+    if (replay -> swapped)
+      return (enet_uint32) data [0] << 24 | (enet_uint32) data [1] << 16 | (enet_uint32) data [2] << 8 | data [3];
+
+    return (enet_uint32) data [0] | (enet_uint32) data [1] << 8 | (enet_uint32) data [2] << 16 | (enet_uint32) data [3] << 24;
+}
+
+/** Reads the next UDP datagram of a capture, skipping the records that hold anything else.
+    @param time receives the capture time of the datagram in milliseconds
+    @retval 1 if a datagram was read into replay -> record
+    @retval 0 at the end of the capture
+    @retval < 0 if the capture is truncated
+*/
+static int
+enet_replay_read (ENetReplay * replay, int * outgoing, enet_uint32 * time, ENetAddress * address, const enet_uint8 ** data, size_t * length)
+{
+    enet_uint8 header [ENET_CAPTURE_RECORD_HEADER_SIZE];
+
+    for (;;)
+    {
+       const enet_uint8 * ip = & replay -> record [ENET_CAPTURE_LINK_HEADER_SIZE], * udp;
+       enet_uint32 seconds, fraction, recordLength;
+       size_t ipLength, udpLength;
+       int i;
+
+       if (fread (header, sizeof (header), 1, replay -> file) != 1)
+         return feof (replay -> file) ? 0 : -1;
+
+       seconds = enet_replay_get_32 (replay, & header [0]);
+       fraction = enet_replay_get_32 (replay, & header [4]);
+       recordLength = enet_replay_get_32 (replay, & header [8]);
+
+       if (recordLength > sizeof (replay -> record))
+       {
+          if (fseek (replay -> file, (long) recordLength, SEEK_CUR) != 0)
+            return -1;
+          continue;
+       }
+
+       if (fread (replay -> record, recordLength, 1, replay -> file) != 1)
+         return recordLength > 0 ? -1 : 0;
+
+       if (recordLength < ENET_CAPTURE_LINK_HEADER_SIZE + ENET_CAPTURE_IPV4_HEADER_SIZE + ENET_CAPTURE_UDP_HEADER_SIZE)
+         continue;
+
+       switch (enet_capture_get_net_16 (& replay -> record [14]))
+       {
+       case ENET_CAPTURE_ETHERTYPE_IPV4:
+          ipLength = (size_t) (ip [0] & 0x0F) * 4;
+          if ((ip [0] >> 4) != 4 || ip [9] != ENET_CAPTURE_IPPROTO_UDP || ipLength < ENET_CAPTURE_IPV4_HEADER_SIZE)
+            continue;
+
+          address -> type = ENET_ADDRESS_TYPE_IPV4;
+          memcpy (address -> host.v4, & ip [12], 4);
+          break;
+
+       case ENET_CAPTURE_ETHERTYPE_IPV6:
+          ipLength = ENET_CAPTURE_IPV6_HEADER_SIZE;
+          if ((ip [0] >> 4) != 6 || ip [6] != ENET_CAPTURE_IPPROTO_UDP)
+            continue;
+
+          address -> type = ENET_ADDRESS_TYPE_IPV6;
+          for (i = 0; i < 8; ++ i)
+            address -> host.v6 [i] = enet_capture_get_net_16 (& ip [8 + i * 2]);
+          break;
+
+       default:
+          continue;
+       }
+
+       if (ENET_CAPTURE_LINK_HEADER_SIZE + ipLength + ENET_CAPTURE_UDP_HEADER_SIZE > recordLength)
+         continue;
+
+       udp = & ip [ipLength];
+       udpLength = enet_capture_get_net_16 (& udp [4]);
+       if (udpLength < ENET_CAPTURE_UDP_HEADER_SIZE || ENET_CAPTURE_LINK_HEADER_SIZE + ipLength + udpLength > recordLength)
+         continue;
+
+       address -> port = enet_capture_get_net_16 (& udp [0]);
+
+       * outgoing = enet_capture_get_net_16 (& replay -> record [0]) == ENET_CAPTURE_PACKET_OUTGOING;
+       * time = seconds * 1000 + (replay -> nanoseconds ? fraction / 1000000 : fraction / 1000);
+       * data = & udp [ENET_CAPTURE_UDP_HEADER_SIZE];
+       * length = udpLength - ENET_CAPTURE_UDP_HEADER_SIZE;
+
+       return 1;
+    }
+}
+
+/** Opens a capture written by enet_host_capture_open for replay with enet_replay_service.
+
+    The clock of the replayed host is aligned on the clock of the captured host, which stamped its
+    datagrams with the low 16 bits of its service time: acknowledgements then match the commands
+    they acknowledge and round trip times come out as captured, whatever the clock of the process
+    replaying the capture.
+
+    @param fileName path of the pcap file
+    @returns the replay, or NULL if the file could not be read or is not a capture of a host
+*/
+ENetReplay *
+enet_replay_create (const char * fileName)
+{
+    enet_uint8 header [ENET_CAPTURE_FILE_HEADER_SIZE];
+    ENetReplay * replay;
+    ENetAddress address;
+    const enet_uint8 * data;
+    enet_uint32 time, reference = 0;
+    int latest = 0;
+    size_t length;
+    int outgoing, result, aligned = 0;
+
+    replay = (ENetReplay *) enet_malloc (sizeof (ENetReplay));
+    if (replay == NULL)
+      return NULL;
+
+    memset (replay, 0, sizeof (ENetReplay));
+
+    replay -> file = fopen (fileName, "rb");
+    if (replay -> file == NULL)
+    {
+       enet_free (replay);
+       return NULL;
+    }
+
+    if (fread (header, sizeof (header), 1, replay -> file) != 1)
+      goto fail;
+
+    switch (enet_replay_get_32 (replay, header))
+    {
+    case 0xA1B2C3D4: break;
+    case 0xA1B23C4D: replay -> nanoseconds = 1; break;
+    case 0xD4C3B2A1: replay -> swapped = 1; break;
+    case 0x4D3CB2A1: replay -> swapped = 1; replay -> nanoseconds = 1; break;
+    default: goto fail;
+    }
+
+    if (enet_replay_get_32 (replay, & header [20]) != ENET_CAPTURE_LINKTYPE_LINUX_SLL)
+      goto fail;
+
+    /* The clock offset is taken so that the replayed host is never behind the captured one when it
+       sends, as an acknowledgement echoing a time still in the future would be dropped. */
+    while ((result = enet_replay_read (replay, & outgoing, & time, & address, & data, & length)) > 0)
+    {
+       enet_uint16 offset;
+
+       if (! outgoing || length < sizeof (ENetProtocolHeader) ||
+           ! (enet_capture_get_net_16 (data) & ENET_PROTOCOL_HEADER_FLAG_SENT_TIME))
+         continue;
+
+       offset = (enet_uint16) (enet_capture_get_net_16 (& data [2]) - time);
+       if (! aligned)
+       {
+          reference = offset;
+          aligned = 1;
+       }
+       else
+       {
+          int difference = (enet_uint16) (offset - reference);
+
+          if (difference >= 0x8000)
+            difference -= 0x10000;
+
+          if (difference > latest)
+            latest = difference;
+       }
+    }
+
+    if (result < 0 || fseek (replay -> file, ENET_CAPTURE_FILE_HEADER_SIZE, SEEK_SET) != 0)
+      goto fail;
+
+    replay -> clockOffset = (enet_uint16) (reference + (enet_uint32) latest);
+
+    return replay;
+
+fail:
+    fclose (replay -> file);
+    enet_free (replay);
+    return NULL;
+}
+
+/** Closes a replay. The hosts it fed stay detached from their sockets.
+    @param replay replay to close
+*/
+void
+enet_replay_destroy (ENetReplay * replay)
+{
+    fclose (replay -> file);
+    enet_free (replay);
+}
+
+/** Feeds the next datagrams of a capture to a host, as enet_host_service would with datagrams
+    from its socket, until an event occurs or the capture ends.
+
+    Only the datagrams the captured host received are fed, each at the time it was captured: the
+    library clock is set with enet_time_set, so a replay runs as fast as the host can process it
+    while every timeout and round trip time follows the captured timeline. The host then never
+    sends on its socket again, as its peers only exist in the capture; its datagrams are still
+    counted, and captured if the host has a capture open. To reproduce the captured behaviour the
+    host should be created with the same peer count, channel limit, bandwidth and callbacks as the
+    captured one.
+
+    @param replay replay to read
+    @param host host to feed, dedicated to the replay
+    @param event receives the event, as with enet_host_service
+    @retval > 0 if an event occurred
+    @retval 0 once the capture is exhausted and no event is pending
+    @retval < 0 on failure or if the capture is truncated
+*/
+int
+enet_replay_service (ENetReplay * replay, ENetHost * host, ENetEvent * event)
+{
+    ENetAddress address;
+    const enet_uint8 * data;
+    enet_uint32 time;
+    size_t length;
+    int outgoing, result;
+
+    host -> replay = replay;
+
+    for (;;)
+    {
+       result = enet_host_service (host, event, 0);
+       if (result != 0)
+         return result;
+
+       do result = enet_replay_read (replay, & outgoing, & time, & address, & data, & length);
+       while (result > 0 && outgoing);
+
+       if (result <= 0)
+         return result;
+
+       if (length > ENET_PROTOCOL_MAXIMUM_MTU)
+         continue;
+
+       enet_time_set (time + replay -> clockOffset);
+       host -> serviceTime = time + replay -> clockOffset;
+
+       memcpy (host -> packetData [0] + ENET_PACKET_HEADROOM, data, length);
+       host -> receivedAddress = address;
+       host -> receivedData = host -> packetData [0] + ENET_PACKET_HEADROOM;
+       host -> receivedDataLength = length;
+
+       ENET_TRACE_CLOCK (host);
+
+       if (event != NULL)
+       {
+          event -> type = ENET_EVENT_TYPE_NONE;
+          event -> peer = NULL;
+          event -> packet = NULL;
+       }
+
+       result = enet_protocol_receive_datagram (host, event);
+       if (result != 0)
+         return result;
+    }
+}
+
+/** @} */
@@ -0,0 +1,159 @@
+/**
+ @file  histogram.c
+ @brief ENet log-linear latency histograms
+*/
+#include <string.h>
+#define ENET_BUILDING_LIB 1
+#include "rcenet/utility.h"
+#include "rcenet/enet.h"
+
+/** @defgroup Histogram ENet histogram functions
+    @{
+*/
+
+#define ENET_HISTOGRAM_SUB_BUCKETS (1u << ENET_HISTOGRAM_SUB_BUCKET_BITS)
+#define ENET_HISTOGRAM_LINEAR_LIMIT (2u << ENET_HISTOGRAM_SUB_BUCKET_BITS)
+
+static enet_uint32
+enet_histogram_highest_bit (enet_uint32 value)
+{
+    enet_uint32 bit = 0;
+
+    if (value >= 1u << 16) { value >>= 16; bit += 16; }
+    if (value >= 1u << 8) { value >>= 8; bit += 8; }
+    if (value >= 1u << 4) { value >>= 4; bit += 4; }
+    if (value >= 1u << 2) { value >>= 2; bit += 2; }
+    if (value >= 1u << 1) bit += 1;
+
+    return bit;
+}
+
+static size_t
+enet_histogram_bucket (enet_uint32 value)
+{
+    enet_uint32 exponent;
+
+    if (value < ENET_HISTOGRAM_LINEAR_LIMIT)
+      return value;
+
+    exponent = enet_histogram_highest_bit (value);
+
+    return ENET_HISTOGRAM_LINEAR_LIMIT +
+           (exponent - ENET_HISTOGRAM_SUB_BUCKET_BITS - 1) * ENET_HISTOGRAM_SUB_BUCKETS +
+           ((value >> (exponent - ENET_HISTOGRAM_SUB_BUCKET_BITS)) & (ENET_HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+/** Returns the highest value counted in a bucket. */
+static enet_uint32
+enet_histogram_bucket_highest (size_t bucket)
+{
+    enet_uint32 shift, subBucket;
+
+    if (bucket < ENET_HISTOGRAM_LINEAR_LIMIT)
+      return (enet_uint32) bucket;
+
+    bucket -= ENET_HISTOGRAM_LINEAR_LIMIT;
+    shift = (enet_uint32) (bucket / ENET_HISTOGRAM_SUB_BUCKETS) + 1;
+    subBucket = (enet_uint32) (bucket % ENET_HISTOGRAM_SUB_BUCKETS);
+
+    return ((ENET_HISTOGRAM_SUB_BUCKETS + subBucket) << shift) + ((1u << shift) - 1);
+}
+
+/** Empties a histogram.
+    @param histogram histogram to empty
+*/
+void
+enet_histogram_reset (ENetHistogram * histogram)
+{
+    memset (histogram, 0, sizeof (ENetHistogram));
+}
+
+/** Counts a value in a histogram.
+    @param histogram histogram to update
+    @param value value to count
+*/
+void
+enet_histogram_record (ENetHistogram * histogram, enet_uint32 value)
+{
+    if (histogram -> count == 0 || value < histogram -> minimum)
+      histogram -> minimum = value;
+    if (value > histogram -> maximum)
+      histogram -> maximum = value;
+
+    ++ histogram -> count;
+    histogram -> sum += value;
+    ++ histogram -> buckets [enet_histogram_bucket (value)];
+}
+
+/** Adds the values counted in a histogram to another, for instance to aggregate the histograms
+    of several peers before reading their percentiles.
+    @param histogram histogram to update
+    @param other histogram whose values are added, left unchanged
+*/
+void
+enet_histogram_merge (ENetHistogram * histogram, const ENetHistogram * other)
+{
+    size_t bucket;
+
+    if (other -> count == 0)
+      return;
+
+    if (histogram -> count == 0 || other -> minimum < histogram -> minimum)
+      histogram -> minimum = other -> minimum;
+    if (other -> maximum > histogram -> maximum)
+      histogram -> maximum = other -> maximum;
+
+    histogram -> count += other -> count;
+    histogram -> sum += other -> sum;
+
+    for (bucket = 0; bucket < ENET_HISTOGRAM_BUCKET_COUNT; ++ bucket)
+      histogram -> buckets [bucket] += other -> buckets [bucket];
+}
+
+/** Reads a percentile of the values counted in a histogram.
+    @param histogram histogram to read
+    @param percentile percentile to read, from 0 to 100, for instance 99.9
+    @returns a value at least as high as percentile percent of the counted values and at most
+    12.5% above the exact percentile, bounded by the smallest and highest values counted; 0 if
+    the histogram is empty
+*/
+enet_uint32
+enet_histogram_percentile (const ENetHistogram * histogram, double percentile)
+{
+    enet_uint64 rank, counted = 0;
+    double target;
+    size_t bucket;
+
+    if (histogram -> count == 0)
+      return 0;
+
+    if (percentile < 0.0)
+      percentile = 0.0;
+    else
+    if (percentile > 100.0)
+      percentile = 100.0;
+
+    target = percentile / 100.0 * (double) histogram -> count;
+    rank = (enet_uint64) target;
+    if ((double) rank < target)
+      ++ rank;
+    if (rank < 1)
+      rank = 1;
+    else
+    if (rank > histogram -> count)
+      rank = histogram -> count;
+
+    for (bucket = 0; bucket < ENET_HISTOGRAM_BUCKET_COUNT; ++ bucket)
+    {
+       counted += histogram -> buckets [bucket];
+       if (counted >= rank)
+         break;
+    }
+
+    if (bucket >= ENET_HISTOGRAM_BUCKET_COUNT)
+      return histogram -> maximum;
+
+    return ENET_MAX (histogram -> minimum, ENET_MIN (enet_histogram_bucket_highest (bucket), histogram -> maximum));
+}
+
+/** @} */
@@ -4,6 +4,8 @@
 */
 #define ENET_BUILDING_LIB 1
 #include <string.h>
+#include "rcenet/utility.h"
+#include "rcenet/time.h"
 #include "rcenet/enet.h"
 
 /** @defgroup host ENet host functions
@@ -25,11 +27,20 @@
     the window size of a connection which limits the amount of reliable packets that may be in transit
     at any given time.
 */
+/** Returns the size of the memory reserved for peerCount peers, a whole number of pages. */
+static size_t
+enet_host_peer_storage_size (size_t peerCount)
+{
+    size_t pageSize = enet_memory_page_size (),
+           storageSize = (peerCount * sizeof (ENetPeer) + pageSize - 1) / pageSize * pageSize;
+
+    return storageSize > 0 ? storageSize : pageSize;
+}
+
 ENetHost *
 enet_host_create (ENetAddressType type, const ENetAddress * address, size_t peerCount, size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth)
 {
     ENetHost * host;
-    ENetPeer * currentPeer;
 
     if (peerCount > ENET_PROTOCOL_MAXIMUM_PEER_ID)
       return NULL;
@@ -42,14 +53,23 @@ enet_host_create (ENetAddressType type, const ENetAddress * address, size_t peer
       return NULL;
     memset (host, 0, sizeof (ENetHost));
 
-    host -> peers = (ENetPeer *) enet_malloc (peerCount * sizeof (ENetPeer));
+    /* Only reserve the peers: they are initialized, and take memory, as connections need them. */
+    host -> peers = (ENetPeer *) enet_memory_reserve (enet_host_peer_storage_size (peerCount));
     if (host -> peers == NULL)
     {
        enet_free (host);
 
        return NULL;
     }
-    memset (host -> peers, 0, peerCount * sizeof (ENetPeer));
+
+    host -> connectedPeerList = (ENetPeer **) enet_malloc (peerCount * sizeof (ENetPeer *));
+    if (host -> connectedPeerList == NULL)
+    {
+       enet_memory_release (host -> peers, enet_host_peer_storage_size (peerCount));
+       enet_free (host);
+
+       return NULL;
+    }
 
     host -> socket = enet_socket_create (type, ENET_SOCKET_TYPE_DATAGRAM);
 
@@ -61,7 +81,8 @@ enet_host_create (ENetAddressType type, const ENetAddress * address, size_t peer
        if (host -> socket != ENET_SOCKET_NULL)
          enet_socket_destroy (host -> socket);
 
-       enet_free (host -> peers);
+       enet_free (host -> connectedPeerList);
+       enet_memory_release (host -> peers, enet_host_peer_storage_size (peerCount));
        enet_free (host);
 
        return NULL;
@@ -110,6 +131,10 @@ enet_host_create (ENetAddressType type, const ENetAddress * address, size_t peer
     host -> duplicatePeers = ENET_PROTOCOL_MAXIMUM_PEER_ID;
     host -> maximumPacketSize = ENET_HOST_DEFAULT_MAXIMUM_PACKET_SIZE;
     host -> maximumWaitingData = ENET_HOST_DEFAULT_MAXIMUM_WAITING_DATA;
+    host -> windowLimit = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+    host -> committedPeers = 0;
+    host -> peerReleaseTimeout = 0;
+    host -> peerReleaseEpoch = 0;
 
     host -> compressor.context = NULL;
     host -> compressor.compress = NULL;
@@ -120,13 +145,58 @@ enet_host_create (ENetAddressType type, const ENetAddress * address, size_t peer
     host -> encryptor.encrypt = NULL;
     host -> encryptor.decrypt = NULL;
     host -> encryptor.destroy = NULL;
+    host -> encryptor.encryptInPlace = NULL;
+    host -> encryptor.decryptInPlace = NULL;
+
+    host -> socketBackend.context = NULL;
+    host -> socketBackend.send = NULL;
+    host -> socketBackend.receive = NULL;
+    host -> socketBackend.wait = NULL;
+    host -> socketBackend.destroy = NULL;
 
     host -> intercept = NULL;
+    host -> reassembly = NULL;
 
     enet_list_clear (& host -> dispatchQueue);
+    enet_list_clear (& host -> outgoingCommandPool);
+    host -> outgoingCommandPoolSize = 0;
 
-    for (currentPeer = host -> peers;
-         currentPeer < & host -> peers [host -> peerCount];
+    enet_list_clear (& host -> channelSlabs);
+    enet_list_clear (& host -> channelPool);
+    host -> channelArraySize = host -> channelLimit;
+    host -> channelArraysInUse = 0;
+    host -> channelSlabNext = NULL;
+    host -> channelSlabEnd = NULL;
+
+    return host;
+}
+
+/** Initializes the peers of a host up to at least peerCount, ENET_HOST_PEER_COMMIT_COUNT at a
+    time, so that they can be used. The memory behind them is committed first.
+    @param host host whose peers to initialize
+    @param peerCount number of leading peers that must be usable, at most host -> peerCount
+    @returns 0 on success, < 0 if the memory could not be committed
+*/
+int
+enet_host_commit_peers (ENetHost * host, size_t peerCount)
+{
+    ENetPeer * currentPeer;
+
+    if (peerCount <= host -> committedPeers)
+      return 0;
+
+    peerCount = (peerCount + ENET_HOST_PEER_COMMIT_COUNT - 1) / ENET_HOST_PEER_COMMIT_COUNT * ENET_HOST_PEER_COMMIT_COUNT;
+    if (peerCount > host -> peerCount)
+      peerCount = host -> peerCount;
+
+    if (enet_memory_commit (& host -> peers [host -> committedPeers], (peerCount - host -> committedPeers) * sizeof (ENetPeer)) < 0)
+      return -1;
+
+    /* Released peers may still hold their old contents. */
+    memset (& host -> peers [host -> committedPeers], 0, (peerCount - host -> committedPeers) * sizeof (ENetPeer));
+
+    for (currentPeer = & host -> peers [host -> committedPeers];
+         currentPeer < & host -> peers [peerCount];
          ++ currentPeer)
     {
        currentPeer -> host = host;
@@ -139,11 +209,57 @@ enet_host_create (ENetAddressType type, const ENetAddress * address, size_t peer
        enet_list_clear (& currentPeer -> outgoingCommands);
        enet_list_clear (& currentPeer -> outgoingSendReliableCommands);
        enet_list_clear (& currentPeer -> dispatchedCommands);
+       enet_list_clear (& currentPeer -> streams);
 
        enet_peer_reset (currentPeer);
     }
 
-    return host;
+    host -> committedPeers = peerCount;
+
+    return 0;
+}
+
+/** Gives the memory of the unused peers at the end of the initialized ones back to the system,
+    once they stayed unused for the release timeout of the host. The slabs of channel arrays go
+    back as well if no connection is left.
+    @param host host whose peers to release
+    @sa enet_host_set_peer_release_timeout
+*/
+void
+enet_host_release_peers (ENetHost * host)
+{
+    size_t pageSize, usedPeers = host -> committedPeers, keptSize, committedSize;
+
+    if (host -> peerReleaseTimeout == 0)
+      return;
+
+    while (usedPeers > 0 && host -> peers [usedPeers - 1].state == ENET_PEER_STATE_DISCONNECTED)
+      -- usedPeers;
+
+    usedPeers = (usedPeers + ENET_HOST_PEER_COMMIT_COUNT - 1) / ENET_HOST_PEER_COMMIT_COUNT * ENET_HOST_PEER_COMMIT_COUNT;
+    if (usedPeers >= host -> committedPeers)
+    {
+        host -> peerReleaseEpoch = host -> serviceTime;
+        return;
+    }
+
+    if (ENET_TIME_DIFFERENCE (host -> serviceTime, host -> peerReleaseEpoch) < host -> peerReleaseTimeout)
+      return;
+
+    /* Only the pages entirely past the peers still in use go back; a partial page stays. */
+    pageSize = enet_memory_page_size ();
+    keptSize = (usedPeers * sizeof (ENetPeer) + pageSize - 1) / pageSize * pageSize;
+    committedSize = (host -> committedPeers * sizeof (ENetPeer) + pageSize - 1) / pageSize * pageSize;
+
+    if (committedSize > keptSize &&
+        enet_memory_discard ((enet_uint8 *) host -> peers + keptSize, committedSize - keptSize) < 0)
+      return;
+
+    host -> committedPeers = usedPeers;
+    host -> peerReleaseEpoch = host -> serviceTime;
+
+    if (host -> channelArraysInUse == 0)
+      enet_host_release_channel_slabs (host);
 }
 
 /** Destroys the host and all resources associated with it.
@@ -160,7 +276,7 @@ enet_host_destroy (ENetHost * host)
     enet_socket_destroy (host -> socket);
 
     for (currentPeer = host -> peers;
-         currentPeer < & host -> peers [host -> peerCount];
+         currentPeer < & host -> peers [host -> committedPeers];
          ++ currentPeer)
     {
        enet_peer_reset (currentPeer);
@@ -168,14 +284,213 @@ enet_host_destroy (ENetHost * host)
 
     if (host -> compressor.context != NULL && host -> compressor.destroy)
       (* host -> compressor.destroy) (host -> compressor.context);
+
+    if (host -> socketBackend.context != NULL && host -> socketBackend.destroy)
+      (* host -> socketBackend.destroy) (host -> socketBackend.context);
       
     if (host -> encryptor.context != NULL && host ->encryptor.destroy)
       (* host ->encryptor.destroy) (host ->encryptor.context);
 
-    enet_free (host -> peers);
+    while (! enet_list_empty (& host -> outgoingCommandPool))
+      enet_free (enet_list_remove (enet_list_begin (& host -> outgoingCommandPool)));
+
+    enet_host_release_channel_slabs (host);
+
+    if (host -> histograms != NULL)
+      enet_free (host -> histograms);
+
+    if (host -> traceEvents != NULL)
+      enet_free (host -> traceEvents);
+
+    enet_host_capture_close (host);
+
+    enet_free (host -> connectedPeerList);
+    enet_memory_release (host -> peers, enet_host_peer_storage_size (host -> peerCount));
     enet_free (host);
 }
 
+/** Returns an outgoing command from the host's pool, or a newly allocated one if the pool is empty.
+    @returns the command, or NULL on allocation failure
+*/
+ENetOutgoingCommand *
+enet_host_allocate_outgoing_command (ENetHost * host)
+{
+    ENetOutgoingCommand * outgoingCommand;
+
+    if (! enet_list_empty (& host -> outgoingCommandPool))
+    {
+       -- host -> outgoingCommandPoolSize;
+
+       return (ENetOutgoingCommand *) enet_list_remove (enet_list_begin (& host -> outgoingCommandPool));
+    }
+
+    outgoingCommand = (ENetOutgoingCommand *) enet_malloc (sizeof (ENetOutgoingCommand));
+    if (outgoingCommand != NULL)
+    {
+       outgoingCommand -> supersedeSlot = NULL;
+       outgoingCommand -> pendingFragments = 0;
+       outgoingCommand -> fragmentTable = NULL;
+
+       ++ host -> stats.allocations;
+    }
+
+    return outgoingCommand;
+}
+
+/** Gives an outgoing command, already unlinked from any peer queue, back to the host's pool.
+    The command leaves the superseding table of its channel if it was still indexed there, and
+    drops its reference to its fragment table if it still had fragments to send. The pool keeps
+    ENET_HOST_OUTGOING_COMMANDS_PER_PEER commands per connected peer, and at least
+    ENET_HOST_OUTGOING_COMMAND_POOL_SIZE; commands beyond that are freed.
+*/
+void
+enet_host_release_outgoing_command (ENetHost * host, ENetOutgoingCommand * outgoingCommand)
+{
+    enet_peer_unindex_outgoing_command (outgoingCommand);
+
+    if (outgoingCommand -> fragmentTable != NULL)
+    {
+       enet_fragment_table_release (outgoingCommand -> fragmentTable);
+
+       outgoingCommand -> fragmentTable = NULL;
+    }
+    outgoingCommand -> pendingFragments = 0;
+
+    if (host -> outgoingCommandPoolSize >= ENET_MAX (ENET_HOST_OUTGOING_COMMAND_POOL_SIZE, host -> connectedPeers * ENET_HOST_OUTGOING_COMMANDS_PER_PEER))
+    {
+       enet_free (outgoingCommand);
+
+       return;
+    }
+
+    enet_list_insert (enet_list_begin (& host -> outgoingCommandPool), outgoingCommand);
+    ++ host -> outgoingCommandPoolSize;
+}
+
+/** Returns a channel array for a new connection of channelCount channels.
+
+    Arrays of up to host -> channelArraySize channels are carved out of slabs reserved by the
+    host and come back to it when the connection is reset, so that connection churn does not
+    reach the allocator. Each new slab holds as many arrays as are already in use, and at least
+    ENET_HOST_CHANNEL_SLAB_SIZE bytes of them; its pages only take memory once written. Once no
+    connection uses the slabs anymore, a change of channel limit starts over with arrays of the
+    new size. Larger arrays are allocated on their own.
+    @param host host the connection belongs to
+    @param channelCount number of channels of the connection
+    @returns the channels, left uninitialized, or NULL on failure
+*/
+ENetChannel *
+enet_host_acquire_channels (ENetHost * host, size_t channelCount)
+{
+    size_t arraySize;
+    ENetChannel * channels;
+
+    if (host -> channelArraysInUse == 0 && host -> channelArraySize != host -> channelLimit)
+    {
+       enet_host_release_channel_slabs (host);
+
+       host -> channelArraySize = host -> channelLimit;
+    }
+
+    if (channelCount > host -> channelArraySize)
+    {
+       ++ host -> stats.allocations;
+
+       return (ENetChannel *) enet_malloc (channelCount * sizeof (ENetChannel));
+    }
+
+    arraySize = host -> channelArraySize * sizeof (ENetChannel);
+
+    if (! enet_list_empty (& host -> channelPool))
+      channels = (ENetChannel *) enet_list_remove (enet_list_begin (& host -> channelPool));
+    else
+    {
+       if ((size_t) (host -> channelSlabEnd - host -> channelSlabNext) < arraySize)
+       {
+          size_t arrayCount = host -> channelArraysInUse, slabSize;
+          ENetChannelSlab * slab;
+
+          if (arrayCount * arraySize < ENET_HOST_CHANNEL_SLAB_SIZE)
+            arrayCount = (ENET_HOST_CHANNEL_SLAB_SIZE + arraySize - 1) / arraySize;
+
+          slabSize = sizeof (ENetChannelSlab) + arrayCount * arraySize;
+          slab = (ENetChannelSlab *) enet_memory_reserve (slabSize);
+          if (slab == NULL)
+            return NULL;
+
+          if (enet_memory_commit (slab, sizeof (ENetChannelSlab)) < 0)
+          {
+             enet_memory_release (slab, slabSize);
+
+             return NULL;
+          }
+
+          ++ host -> stats.allocations;
+
+          slab -> size = slabSize;
+          enet_list_insert (enet_list_end (& host -> channelSlabs), slab);
+
+          host -> channelSlabNext = (enet_uint8 *) (slab + 1);
+          host -> channelSlabEnd = (enet_uint8 *) slab + slabSize;
+       }
+
+       /* Arrays are committed as the slab hands them out. */
+       if (enet_memory_commit (host -> channelSlabNext, arraySize) < 0)
+         return NULL;
+
+       channels = (ENetChannel *) host -> channelSlabNext;
+       host -> channelSlabNext += arraySize;
+    }
+
+    ++ host -> channelArraysInUse;
+
+    return channels;
+}
+
+/** Gives the channel array of a connection being reset back to the host.
+    @param host host the connection belongs to
+    @param channels array returned by enet_host_acquire_channels, with its channels already reset
+*/
+void
+enet_host_release_channels (ENetHost * host, ENetChannel * channels)
+{
+    ENetListIterator currentSlab;
+
+    for (currentSlab = enet_list_begin (& host -> channelSlabs);
+         currentSlab != enet_list_end (& host -> channelSlabs);
+         currentSlab = enet_list_next (currentSlab))
+    {
+       ENetChannelSlab * slab = (ENetChannelSlab *) currentSlab;
+
+       if ((enet_uint8 *) channels > (enet_uint8 *) slab &&
+           (enet_uint8 *) channels < (enet_uint8 *) slab + slab -> size)
+       {
+          enet_list_insert (enet_list_begin (& host -> channelPool), channels);
+          -- host -> channelArraysInUse;
+
+          return;
+       }
+    }
+
+    enet_free (channels);
+}
+
+/** Gives every slab of channel arrays back to the system. No connection may still use them. */
+void
+enet_host_release_channel_slabs (ENetHost * host)
+{
+    while (! enet_list_empty (& host -> channelSlabs))
+    {
+       ENetChannelSlab * slab = (ENetChannelSlab *) enet_list_remove (enet_list_begin (& host -> channelSlabs));
+
+       enet_memory_release (slab, slab -> size);
+    }
+
+    enet_list_clear (& host -> channelPool);
+    host -> channelSlabNext = NULL;
+    host -> channelSlabEnd = NULL;
+}
+
 enet_uint32
 enet_host_random (ENetHost * host)
 {
@@ -228,27 +543,35 @@ enet_host_connect (ENetHost * host, const ENetAddress * address, size_t channelC
       channelCount = ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT;
 
     for (currentPeer = host -> peers;
-         currentPeer < & host -> peers [host -> peerCount];
+         currentPeer < & host -> peers [host -> committedPeers];
          ++ currentPeer)
     {
        if (currentPeer -> state == ENET_PEER_STATE_DISCONNECTED)
          break;
     }
 
-    if (currentPeer >= & host -> peers [host -> peerCount])
-      return NULL;
+    if (currentPeer >= & host -> peers [host -> committedPeers])
+    {
+       if (host -> committedPeers >= host -> peerCount ||
+           enet_host_commit_peers (host, host -> committedPeers + 1) < 0)
+         return NULL;
+    }
 
-    currentPeer -> channels = (ENetChannel *) enet_malloc (channelCount * sizeof (ENetChannel));
+    currentPeer -> channels = enet_host_acquire_channels (host, channelCount);
     if (currentPeer -> channels == NULL)
       return NULL;
     currentPeer -> channelCount = channelCount;
+
+    ENET_TRACE_CLOCK (host);
+    ENET_TRACE (host, ENET_TRACE_EVENT_STATE, currentPeer, ENET_PEER_STATE_CONNECTING, currentPeer -> state, 0);
     currentPeer -> state = ENET_PEER_STATE_CONNECTING;
     currentPeer -> address = * address;
     currentPeer -> connectID = enet_host_random (host);
     currentPeer -> mtu = host -> mtu;
+    currentPeer -> windowLimit = host -> windowLimit;
 
     if (host -> outgoingBandwidth == 0)
-      currentPeer -> windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+      currentPeer -> windowSize = currentPeer -> windowLimit;
     else
       currentPeer -> windowSize = (host -> outgoingBandwidth /
                                     ENET_PEER_WINDOW_SIZE_SCALE) * 
@@ -257,8 +580,8 @@ enet_host_connect (ENetHost * host, const ENetAddress * address, size_t channelC
     if (currentPeer -> windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE)
       currentPeer -> windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
     else
-    if (currentPeer -> windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE)
-      currentPeer -> windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+    if (currentPeer -> windowSize > currentPeer -> windowLimit)
+      currentPeer -> windowSize = currentPeer -> windowLimit;
          
     for (channel = currentPeer -> channels;
          channel < & currentPeer -> channels [channelCount];
@@ -274,9 +597,29 @@ enet_host_connect (ENetHost * host, const ENetAddress * address, size_t channelC
 
         channel -> usedReliableWindows = 0;
         memset (channel -> reliableWindows, 0, sizeof (channel -> reliableWindows));
+
+        enet_list_clear (& channel -> aggregateCommands);
+        channel -> aggregateLength = 0;
+        channel -> aggregateFlags = 0;
+        channel -> aggregateTimeout = 0;
+        channel -> aggregateDeadline = 0;
+        channel -> aggregation = 0;
+        channel -> fec = NULL;
+        channel -> fecRemoteGroupSize = 0;
+        channel -> priority = 0;
+        channel -> weight = ENET_PEER_DEFAULT_CHANNEL_WEIGHT;
+        channel -> scheduleTime = 0;
+        channel -> timeToLive = 0;
+        channel -> expireReliable = 0;
+        channel -> supersedeSlots = NULL;
+        channel -> supersedeSlotCount = 0;
+        channel -> sentReliableRing = NULL;
+        channel -> sentReliableRingSize = 0;
+        channel -> incomingReliableRing = NULL;
+        channel -> incomingReliableRingSize = 0;
     }
 
-    command.header.command = ENET_PROTOCOL_COMMAND_CONNECT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
+    command.header.command = ENET_PROTOCOL_COMMAND_CONNECT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE | ENET_PROTOCOL_COMMAND_FLAG_AGGREGATE | ENET_PROTOCOL_COMMAND_FLAG_FEC | ENET_PROTOCOL_COMMAND_FLAG_STREAM;
     command.header.channelID = 0xFF;
     command.connect.outgoingPeerID = ENET_HOST_TO_NET_16 (currentPeer -> incomingPeerID);
     command.connect.incomingSessionID = currentPeer -> incomingSessionID;
@@ -297,28 +640,118 @@ enet_host_connect (ENetHost * host, const ENetAddress * address, size_t channelC
     return currentPeer;
 }
 
-/** Queues a packet to be sent to all peers associated with the host.
-    @param host host on which to broadcast the packet
-    @param channelID channel on which to broadcast
-    @param packet packet to broadcast
+/** Queues a packet to every peer of a list that is connected to host and selected by filter.
+
+    The packet is validated once. A packet that fits in one command has its SEND command built
+    once and copied to each peer, which costs about as much as a loop of enet_peer_send calls.
+    Fragmented packets are serialized once into a fragment table shared by all peers with the
+    same MTU, and each peer only queues one command that walks the table as its fragments are
+    sent. Peers with another MTU, or all of them if the table cannot be allocated, have their
+    fragments computed on the fly instead. If no peer references the packet afterwards, it is destroyed.
+    @returns the number of peers the packet was queued to, or < 0 if the packet could not be sent at all
 */
-void
-enet_host_broadcast (ENetHost * host, enet_uint8 channelID, ENetPacket * packet)
+static int
+enet_host_send_to_peer_list (ENetHost * host, enet_uint8 channelID, ENetPacket * packet, ENetPeer * const * peers, size_t peerCount, ENetPeerFilterCallback filter, void * context)
 {
-    ENetPeer * currentPeer;
+    ENetFragmentTable * fragmentTable = NULL;
+    size_t tableFragmentLength = 0;
+    ENetProtocol command;
+    size_t peerIndex;
+    int sentPeers = 0;
 
-    for (currentPeer = host -> peers;
-         currentPeer < & host -> peers [host -> peerCount];
-         ++ currentPeer)
+    if (packet -> dataLength > host -> maximumPacketSize)
+    {
+       if (packet -> referenceCount == 0)
+         enet_packet_destroy (packet);
+
+       return -1;
+    }
+
+    enet_peer_build_send_command (& command, channelID, packet, 0);
+
+    for (peerIndex = 0; peerIndex < peerCount; ++ peerIndex)
     {
-       if (currentPeer -> state != ENET_PEER_STATE_CONNECTED)
+       ENetPeer * currentPeer = peers [peerIndex];
+       size_t fragmentLength;
+
+       if (currentPeer == NULL ||
+           currentPeer -> host != host ||
+           currentPeer -> state != ENET_PEER_STATE_CONNECTED ||
+           channelID >= currentPeer -> channelCount ||
+           (filter != NULL && ! filter (currentPeer, context)))
          continue;
 
-       enet_peer_send (currentPeer, channelID, packet);
+       fragmentLength = enet_peer_fragment_length (currentPeer);
+       if (packet -> dataLength <= fragmentLength)
+       {
+          if (enet_peer_send_command (currentPeer, packet, & command, fragmentLength) == 0)
+            ++ sentPeers;
+          continue;
+       }
+
+       /* The table is built for the first fragmented peer; a failure only costs the sharing. */
+       if (tableFragmentLength == 0)
+       {
+          tableFragmentLength = fragmentLength;
+          fragmentTable = enet_fragment_table_create (packet, fragmentLength);
+       }
+
+       if (enet_peer_send_fragments (currentPeer, channelID, packet, fragmentLength,
+                                     fragmentLength == tableFragmentLength ? fragmentTable : NULL) == 0)
+         ++ sentPeers;
     }
 
+    if (fragmentTable != NULL)
+      enet_fragment_table_release (fragmentTable);
+
     if (packet -> referenceCount == 0)
       enet_packet_destroy (packet);
+
+    return sentPeers;
+}
+
+/** Queues a packet to be sent to all peers associated with the host.
+    @param host host on which to broadcast the packet
+    @param channelID channel on which to broadcast
+    @param packet packet to broadcast
+*/
+void
+enet_host_broadcast (ENetHost * host, enet_uint8 channelID, ENetPacket * packet)
+{
+    enet_host_send_to_peer_list (host, channelID, packet, host -> connectedPeerList, host -> connectedPeers, NULL, NULL);
+}
+
+/** Queues a packet to be sent to the connected peers accepted by a filter callback.
+    @param host host on which to broadcast the packet
+    @param channelID channel on which to broadcast
+    @param packet packet to broadcast
+    @param filter called once per connected peer; the packet is queued to the peer if it returns non-zero. If NULL, this is equivalent to enet_host_broadcast().
+    @param context opaque pointer passed back to filter
+*/
+void
+enet_host_broadcast_filtered (ENetHost * host, enet_uint8 channelID, ENetPacket * packet, ENetPeerFilterCallback filter, void * context)
+{
+    enet_host_send_to_peer_list (host, channelID, packet, host -> connectedPeerList, host -> connectedPeers, filter, context);
+}
+
+/** Queues a packet to be sent to an explicit list of peers, such as the players in an area of interest.
+
+    The packet is validated and, if it needs fragmenting, serialized once for the whole list; each
+    peer then only receives its own sequence numbers. Only fragmented packets are cheaper to queue
+    this way; a packet that fits in one command costs about as much as a loop of enet_peer_send
+    calls. Like enet_host_broadcast(), ENet takes ownership of the packet: it is destroyed right away
+    if it could not be queued to any peer.
+    @param host host the peers belong to
+    @param channelID channel on which to send
+    @param packet packet to send
+    @param peers peers to send the packet to; NULL entries, peers of another host and peers that are not connected or lack the channel are skipped
+    @param peerCount number of entries in peers
+    @returns the number of peers the packet was queued to, or < 0 on failure
+*/
+int
+enet_host_send_to_peers (ENetHost * host, enet_uint8 channelID, ENetPacket * packet, ENetPeer ** peers, size_t peerCount)
+{
+    return enet_host_send_to_peer_list (host, channelID, packet, peers, peerCount, NULL, NULL);
 }
 
 /** Sets the packet compressor the host should use to compress and decompress packets.
@@ -337,6 +770,24 @@ enet_host_compress (ENetHost * host, const ENetCompressor * compressor)
       host -> compressor.context = NULL;
 }
 
+/** Sets the backend the host should use instead of its socket to send, receive and wait for
+    datagrams, such as a virtual network (see enet_network_attach). The socket of the host stays
+    open and is used again once the backend is removed.
+    @param host host whose transport is replaced
+    @param socketBackend callbacks for the backend; if NULL, then the host uses its socket again
+*/
+void
+enet_host_socket_backend (ENetHost * host, const ENetSocketBackend * socketBackend)
+{
+    if (host -> socketBackend.context != NULL && host -> socketBackend.destroy)
+      (* host -> socketBackend.destroy) (host -> socketBackend.context);
+
+    if (socketBackend)
+      host -> socketBackend = * socketBackend;
+    else
+      host -> socketBackend.context = NULL;
+}
+
 /** Limits the maximum allowed channels of future incoming connections.
     @param host host to limit
     @param channelLimit the maximum number of channels allowed; if 0, then this is equivalent to ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT
@@ -353,6 +804,87 @@ enet_host_channel_limit (ENetHost * host, size_t channelLimit)
     host -> channelLimit = channelLimit;
 }
 
+/** Limits the flow control window of future connections.
+
+    A peer may not have more than its window of reliable data in flight, so with the default limit
+    of ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE a reliable transfer cannot exceed 64 KB per round trip,
+    about 640 KB/s at 100 ms. A larger limit is advertised in the window size of the connection
+    handshake, which an original ENet peer clamps back to ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE, so a
+    connection only uses it when both hosts raised their limit; the window actually used is the
+    smaller of the two, further reduced by any bandwidth limit. The socket buffers of the host are
+    grown to hold a full window, within what the system allows.
+
+    @param host host to limit
+    @param windowLimit largest window in bytes; if 0, then this is equivalent to ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE,
+    and it is clamped to ENET_PROTOCOL_MAXIMUM_SCALED_WINDOW_SIZE
+*/
+void
+enet_host_window_limit (ENetHost * host, enet_uint32 windowLimit)
+{
+    if (windowLimit < ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE)
+      windowLimit = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+    else
+    if (windowLimit > ENET_PROTOCOL_MAXIMUM_SCALED_WINDOW_SIZE)
+      windowLimit = ENET_PROTOCOL_MAXIMUM_SCALED_WINDOW_SIZE;
+
+    host -> windowLimit = windowLimit;
+
+    enet_socket_set_option (host -> socket, ENET_SOCKOPT_RCVBUF, ENET_MAX (ENET_HOST_RECEIVE_BUFFER_SIZE, windowLimit));
+    enet_socket_set_option (host -> socket, ENET_SOCKOPT_SNDBUF, ENET_MAX (ENET_HOST_SEND_BUFFER_SIZE, windowLimit));
+}
+
+/** Lets a host give the memory of its unused peers back to the system. The peers of a host only
+    take memory once a connection first needs them; with a release timeout, the unused peers past
+    the last one in use, ENET_HOST_PEER_COMMIT_COUNT at a time, give their memory back once they
+    stayed unused that long, and are initialized again when connections need them. The data field
+    of a released peer is lost.
+    @param host host to configure
+    @param releaseTimeout time in milliseconds the unused peers must stay unused; 0, the default,
+    keeps their memory for the lifetime of the host
+*/
+void
+enet_host_set_peer_release_timeout (ENetHost * host, enet_uint32 releaseTimeout)
+{
+    host -> peerReleaseTimeout = releaseTimeout;
+    host -> peerReleaseEpoch = enet_time_get ();
+}
+
+/** Enables or disables the histograms of a host. They gather the round trip times, queueing
+    delays, reliable delivery latencies and reassembly times of all the peers of the host, in
+    ENET_HISTOGRAM_COUNT histograms of fixed size read with enet_host_get_histogram. Each peer
+    can also keep histograms of its own with enet_peer_set_histograms. Nothing is measured for a
+    peer while neither it nor its host has histograms enabled.
+    @param host host to configure
+    @param enabled nonzero to enable the histograms, empty ones if they were disabled; 0 to disable
+    them and free their memory
+    @retval 0 on success
+    @retval < 0 if the histograms could not be allocated
+*/
+int
+enet_host_set_histograms (ENetHost * host, int enabled)
+{
+    if (! enabled)
+    {
+       if (host -> histograms != NULL)
+       {
+          enet_free (host -> histograms);
+          host -> histograms = NULL;
+       }
+
+       return 0;
+    }
+
+    if (host -> histograms != NULL)
+      return 0;
+
+    host -> histograms = (ENetHistogram *) enet_malloc (ENET_HISTOGRAM_COUNT * sizeof (ENetHistogram));
+    if (host -> histograms == NULL)
+      return -1;
+
+    memset (host -> histograms, 0, ENET_HISTOGRAM_COUNT * sizeof (ENetHistogram));
+
+    return 0;
+}
 
 /** Adjusts the bandwidth limits of a host.
     @param host host to adjust
@@ -397,7 +929,7 @@ enet_host_bandwidth_throttle (ENetHost * host)
         bandwidth = (host -> outgoingBandwidth * elapsedTime) / 1000;
 
         for (peer = host -> peers;
-             peer < & host -> peers [host -> peerCount];
+             peer < & host -> peers [host -> committedPeers];
             ++ peer)
         {
             if (peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER)
@@ -417,7 +949,7 @@ enet_host_bandwidth_throttle (ENetHost * host)
           throttle = (bandwidth * ENET_PEER_PACKET_THROTTLE_SCALE) / dataTotal;
 
         for (peer = host -> peers;
-             peer < & host -> peers [host -> peerCount];
+             peer < & host -> peers [host -> committedPeers];
              ++ peer)
         {
             enet_uint32 peerBandwidth;
@@ -460,7 +992,7 @@ enet_host_bandwidth_throttle (ENetHost * host)
           throttle = (bandwidth * ENET_PEER_PACKET_THROTTLE_SCALE) / dataTotal;
 
         for (peer = host -> peers;
-             peer < & host -> peers [host -> peerCount];
+             peer < & host -> peers [host -> committedPeers];
              ++ peer)
         {
             if ((peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER) ||
@@ -494,7 +1026,7 @@ enet_host_bandwidth_throttle (ENetHost * host)
            bandwidthLimit = bandwidth / peersRemaining;
 
            for (peer = host -> peers;
-                peer < & host -> peers [host -> peerCount];
+                peer < & host -> peers [host -> committedPeers];
                 ++ peer)
            {
                if ((peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER) ||
@@ -514,7 +1046,7 @@ enet_host_bandwidth_throttle (ENetHost * host)
        }
 
        for (peer = host -> peers;
-            peer < & host -> peers [host -> peerCount];
+            peer < & host -> peers [host -> committedPeers];
             ++ peer)
        {
            if (peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER)
@@ -554,6 +1086,17 @@ enet_uint32 enet_host_get_bytes_received(const ENetHost* host) {
   return host->totalReceivedData;
 }
 
+void enet_host_get_stats(const ENetHost* host, ENetHostStats* stats) {
+  *stats = host->stats;
+}
+
+const ENetHistogram* enet_host_get_histogram(const ENetHost* host, ENetHistogramKind kind) {
+  if (host->histograms == NULL || kind >= ENET_HISTOGRAM_COUNT)
+    return NULL;
+
+  return &host->histograms[kind];
+}
+
 void enet_host_set_max_duplicate_peers(ENetHost* host, enet_uint16 number) {
   if (number < 1)
     number = 1;
@@ -568,6 +1111,10 @@ void enet_host_set_intercept_callback(ENetHost* host, ENetInterceptCallback call
   host->intercept = callback;
 }
 
+void enet_host_set_reassembly_callback(ENetHost* host, ENetReassemblyCallback callback) {
+  host->reassembly = callback;
+}
+
 void enet_host_set_checksum_callback(ENetHost* host, ENetChecksumCallback callback) {
   host->checksum = callback;
 }
@@ -0,0 +1,650 @@
+/**
+ @file  network.c
+ @brief ENet in-process virtual network and link simulator
+*/
+#include <string.h>
+#define ENET_BUILDING_LIB 1
+#include "rcenet/enet.h"
+
+/** @defgroup Network ENet virtual network
+    @{
+*/
+
+/** Virtual time of a new network in microseconds, so that no host sees a zero service time. */
+#define ENET_NETWORK_EPOCH 1000000
+
+typedef struct _ENetNetworkNode ENetNetworkNode;
+
+typedef struct _ENetNetworkDatagram
+{
+   ENetListNode      inboxNode;
+   enet_uint64       time;
+   enet_uint64       sequence;
+   ENetNetworkNode * destination;
+   ENetAddress       source;
+   size_t            dataLength;
+} ENetNetworkDatagram;
+
+/** Transmission queue of a link with a limited bandwidth, from a node to one destination. */
+typedef struct _ENetNetworkQueue
+{
+   ENetNetworkNode * destination;
+   enet_uint64       busyUntil;
+} ENetNetworkQueue;
+
+struct _ENetNetworkNode
+{
+   ENetNetwork *      network;
+   ENetHost *         host;
+   ENetAddress        address;
+   ENetList           inbox;
+   ENetNetworkQueue * queues;
+   size_t             queueCount;
+   size_t             queueCapacity;
+};
+
+typedef struct _ENetNetworkRoute
+{
+   int         anySource;
+   int         anyDestination;
+   ENetAddress source;
+   ENetAddress destination;
+   ENetLink    link;
+} ENetNetworkRoute;
+
+struct _ENetNetwork
+{
+   enet_uint64            time;
+   enet_uint32            randomSeed;
+   enet_uint64            sequence;
+   enet_uint32            nextAddress;
+   ENetNetworkRoute *     routes;
+   size_t                 routeCount;
+   size_t                 routeCapacity;
+   ENetNetworkNode **     nodes;
+   size_t                 nodeCount;
+   size_t                 nodeCapacity;
+   ENetNetworkNode *      lastDestination;
+   ENetNetworkDatagram ** flight;
+   size_t                 flightCount;
+   size_t                 flightCapacity;
+   ENetNetworkStats       stats;
+};
+
+const enet_uint64 * enet_time_virtual = NULL;
+
+static const ENetLink enet_network_ideal_link = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+/** Makes room for at least one more element in an array allocated with enet_malloc.
+    @retval 0 on success
+    @retval < 0 if the array could not be grown
+*/
+static int
+enet_network_grow (void ** array, size_t * capacity, size_t count, size_t elementSize)
+{
+    size_t newCapacity;
+    void * newArray;
+
+    if (count < * capacity)
+      return 0;
+
+    newCapacity = * capacity > 0 ? * capacity * 2 : 16;
+    newArray = enet_malloc (newCapacity * elementSize);
+    if (newArray == NULL)
+      return -1;
+
+    if (* array != NULL)
+    {
+       memcpy (newArray, * array, count * elementSize);
+       enet_free (* array);
+    }
+
+    * array = newArray;
+    * capacity = newCapacity;
+
+    return 0;
+}
+
+static enet_uint32
+enet_network_random (ENetNetwork * network)
+{
+    enet_uint32 seed = network -> randomSeed;
+
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    network -> randomSeed = seed;
+
+    return seed;
+}
+
+static int
+enet_network_chance (ENetNetwork * network, enet_uint32 chance)
+{
+    return chance > 0 && enet_network_random (network) % ENET_LINK_CHANCE_SCALE < chance;
+}
+
+static int
+enet_network_datagram_before (const ENetNetworkDatagram * first, const ENetNetworkDatagram * second)
+{
+    return first -> time < second -> time || (first -> time == second -> time && first -> sequence < second -> sequence);
+}
+
+/** Adds a datagram in flight to the heap ordered by delivery time, ties in sending order. */
+static void
+enet_network_flight_push (ENetNetwork * network, ENetNetworkDatagram * datagram)
+{
+    size_t index = network -> flightCount ++;
+
+    while (index > 0)
+    {
+       size_t parent = (index - 1) / 2;
+
+       if (! enet_network_datagram_before (datagram, network -> flight [parent]))
+         break;
+
+       network -> flight [index] = network -> flight [parent];
+       index = parent;
+    }
+
+    network -> flight [index] = datagram;
+}
+
+static ENetNetworkDatagram *
+enet_network_flight_pop (ENetNetwork * network)
+{
+    ENetNetworkDatagram * first = network -> flight [0],
+                        * last = network -> flight [-- network -> flightCount];
+    size_t index = 0;
+
+    for (;;)
+    {
+       size_t child = index * 2 + 1;
+
+       if (child >= network -> flightCount)
+         break;
+
+       if (child + 1 < network -> flightCount && enet_network_datagram_before (network -> flight [child + 1], network -> flight [child]))
+         ++ child;
+
+       if (! enet_network_datagram_before (network -> flight [child], last))
+         break;
+
+       network -> flight [index] = network -> flight [child];
+       index = child;
+    }
+
+    if (network -> flightCount > 0)
+      network -> flight [index] = last;
+
+    return first;
+}
+
+/** Moves the datagrams whose delivery time has come to the inboxes of their destinations. */
+static void
+enet_network_release (ENetNetwork * network)
+{
+    while (network -> flightCount > 0 && network -> flight [0] -> time <= network -> time)
+    {
+       ENetNetworkDatagram * datagram = enet_network_flight_pop (network);
+
+       if (datagram -> destination != NULL)
+         enet_list_insert (enet_list_end (& datagram -> destination -> inbox), datagram);
+       else
+         enet_free (datagram);
+    }
+}
+
+static ENetNetworkNode *
+enet_network_find_node (ENetNetwork * network, const ENetAddress * address)
+{
+    size_t nodeIndex;
+
+    if (network -> lastDestination != NULL && enet_address_equal (& network -> lastDestination -> address, address))
+      return network -> lastDestination;
+
+    for (nodeIndex = 0; nodeIndex < network -> nodeCount; ++ nodeIndex)
+      if (enet_address_equal (& network -> nodes [nodeIndex] -> address, address))
+      {
+         network -> lastDestination = network -> nodes [nodeIndex];
+         return network -> lastDestination;
+      }
+
+    return NULL;
+}
+
+static const ENetLink *
+enet_network_find_link (const ENetNetwork * network, const ENetAddress * source, const ENetAddress * destination)
+{
+    size_t routeIndex;
+
+    for (routeIndex = network -> routeCount; routeIndex > 0; -- routeIndex)
+    {
+       const ENetNetworkRoute * route = & network -> routes [routeIndex - 1];
+
+       if ((route -> anySource || enet_address_equal (& route -> source, source)) &&
+           (route -> anyDestination || enet_address_equal (& route -> destination, destination)))
+         return & route -> link;
+    }
+
+    return & enet_network_ideal_link;
+}
+
+static ENetNetworkQueue *
+enet_network_find_queue (ENetNetworkNode * node, ENetNetworkNode * destination)
+{
+    ENetNetworkQueue * queue;
+    size_t queueIndex;
+
+    for (queueIndex = 0; queueIndex < node -> queueCount; ++ queueIndex)
+      if (node -> queues [queueIndex].destination == destination)
+        return & node -> queues [queueIndex];
+
+    if (enet_network_grow ((void **) & node -> queues, & node -> queueCapacity, node -> queueCount, sizeof (ENetNetworkQueue)) < 0)
+      return NULL;
+
+    queue = & node -> queues [node -> queueCount ++];
+    queue -> destination = destination;
+    queue -> busyUntil = 0;
+
+    return queue;
+}
+
+static int ENET_CALLBACK
+enet_network_send (void * context, ENetHost * host, const ENetAddress * address, const ENetBuffer * buffers, size_t bufferCount)
+{
+    ENetNetworkNode * node = (ENetNetworkNode *) context, * destination;
+    ENetNetwork * network = node -> network;
+    const ENetLink * link;
+    enet_uint64 departure = network -> time;
+    size_t length = 0, bufferIndex;
+    int copies;
+
+    (void) host;
+
+    for (bufferIndex = 0; bufferIndex < bufferCount; ++ bufferIndex)
+      length += buffers [bufferIndex].dataLength;
+
+    ++ network -> stats.sentDatagrams;
+
+    destination = enet_network_find_node (network, address);
+    link = enet_network_find_link (network, & node -> address, address);
+
+    if (destination == NULL || (link -> mtu > 0 && length > link -> mtu))
+    {
+       ++ network -> stats.droppedDatagrams;
+       return (int) length;
+    }
+
+    if (enet_network_chance (network, link -> loss))
+    {
+       ++ network -> stats.lostDatagrams;
+       return (int) length;
+    }
+
+    if (link -> bandwidth > 0)
+    {
+       ENetNetworkQueue * queue = enet_network_find_queue (node, destination);
+
+       if (queue == NULL)
+         return -1;
+
+       if (queue -> busyUntil > departure)
+       {
+          if (link -> queueLimit > 0 && (queue -> busyUntil - departure) * link -> bandwidth / 1000000 > link -> queueLimit)
+          {
+             ++ network -> stats.droppedDatagrams;
+             return (int) length;
+          }
+
+          departure = queue -> busyUntil;
+       }
+
+       departure += ((enet_uint64) length * 1000000 + link -> bandwidth - 1) / link -> bandwidth;
+       queue -> busyUntil = departure;
+    }
+
+    copies = 1;
+    if (enet_network_chance (network, link -> duplicate))
+    {
+       ++ network -> stats.duplicatedDatagrams;
+       ++ copies;
+    }
+
+    for (; copies > 0; -- copies)
+    {
+       ENetNetworkDatagram * datagram;
+       enet_uint8 * data;
+
+       if (enet_network_grow ((void **) & network -> flight, & network -> flightCapacity, network -> flightCount, sizeof (ENetNetworkDatagram *)) < 0)
+         return -1;
+
+       datagram = (ENetNetworkDatagram *) enet_malloc (sizeof (ENetNetworkDatagram) + length);
+       if (datagram == NULL)
+         return -1;
+
+       datagram -> time = departure + link -> latency;
+       if (link -> jitter > 0)
+         datagram -> time += enet_network_random (network) % (link -> jitter + 1);
+
+       if (enet_network_chance (network, link -> reorder))
+       {
+          datagram -> time += link -> latency > 1000 ? link -> latency : 1000;
+          ++ network -> stats.reorderedDatagrams;
+       }
+
+       datagram -> sequence = network -> sequence ++;
+       datagram -> destination = destination;
+       datagram -> source = node -> address;
+       datagram -> dataLength = length;
+
+       data = (enet_uint8 *) (datagram + 1);
+       for (bufferIndex = 0; bufferIndex < bufferCount; ++ bufferIndex)
+       {
+          memcpy (data, buffers [bufferIndex].data, buffers [bufferIndex].dataLength);
+          data += buffers [bufferIndex].dataLength;
+       }
+
+       enet_network_flight_push (network, datagram);
+    }
+
+    enet_network_release (network);
+
+    return (int) length;
+}
+
+static int ENET_CALLBACK
+enet_network_receive (void * context, ENetHost * host, ENetAddress * address, ENetBuffer * buffer)
+{
+    ENetNetworkNode * node = (ENetNetworkNode *) context;
+    ENetNetworkDatagram * datagram;
+    size_t length;
+
+    (void) host;
+
+    enet_network_release (node -> network);
+
+    if (enet_list_empty (& node -> inbox))
+      return 0;
+
+    datagram = (ENetNetworkDatagram *) enet_list_remove (enet_list_begin (& node -> inbox));
+    length = datagram -> dataLength;
+
+    ++ node -> network -> stats.deliveredDatagrams;
+
+    if (length > buffer -> dataLength)
+    {
+       enet_free (datagram);
+       return -2;
+    }
+
+    memcpy (buffer -> data, datagram + 1, length);
+    * address = datagram -> source;
+
+    enet_free (datagram);
+
+    return (int) length;
+}
+
+/** Waits for a datagram in virtual time: the clock of the network jumps to the delivery of the next
+    datagrams in flight until one arrives for the node, or to the end of the timeout. */
+static int ENET_CALLBACK
+enet_network_wait (void * context, ENetHost * host, enet_uint32 * condition, enet_uint32 timeout)
+{
+    ENetNetworkNode * node = (ENetNetworkNode *) context;
+    ENetNetwork * network = node -> network;
+    enet_uint64 deadline = network -> time + (enet_uint64) timeout * 1000;
+
+    (void) host;
+
+    enet_network_release (network);
+
+    while (enet_list_empty (& node -> inbox))
+    {
+       if (network -> flightCount == 0 || network -> flight [0] -> time > deadline)
+       {
+          network -> time = deadline;
+          * condition = ENET_SOCKET_WAIT_NONE;
+          return 0;
+       }
+
+       if (network -> flight [0] -> time > network -> time)
+         network -> time = network -> flight [0] -> time;
+
+       enet_network_release (network);
+    }
+
+    * condition = ENET_SOCKET_WAIT_RECEIVE;
+    return 0;
+}
+
+/** Detaches a node from its network when its host is destroyed or given another backend. */
+static void ENET_CALLBACK
+enet_network_detach (void * context)
+{
+    ENetNetworkNode * node = (ENetNetworkNode *) context;
+    ENetNetwork * network = node -> network;
+    size_t index;
+
+    for (index = 0; index < network -> nodeCount; ++ index)
+      if (network -> nodes [index] == node)
+      {
+         network -> nodes [index] = network -> nodes [-- network -> nodeCount];
+         break;
+      }
+
+    for (index = 0; index < network -> flightCount; ++ index)
+      if (network -> flight [index] -> destination == node)
+        network -> flight [index] -> destination = NULL;
+
+    for (index = 0; index < network -> nodeCount; ++ index)
+    {
+       ENetNetworkNode * other = network -> nodes [index];
+       size_t queueIndex;
+
+       for (queueIndex = 0; queueIndex < other -> queueCount; ++ queueIndex)
+         if (other -> queues [queueIndex].destination == node)
+         {
+            other -> queues [queueIndex] = other -> queues [-- other -> queueCount];
+            break;
+         }
+    }
+
+    if (network -> lastDestination == node)
+      network -> lastDestination = NULL;
+
+    while (! enet_list_empty (& node -> inbox))
+      enet_free (enet_list_remove (enet_list_begin (& node -> inbox)));
+
+    if (node -> queues != NULL)
+      enet_free (node -> queues);
+
+    enet_free (node);
+}
+
+/** Creates an in-memory network between hosts of the process, with a virtual clock.
+
+    While the network exists, enet_time_get and enet_time_get_us return its virtual time, which
+    starts at one second and only moves with enet_network_advance or while a host of the network
+    waits in enet_host_service. Hosts attached with enet_network_attach exchange their datagrams
+    through links whose latency, jitter, loss, reordering, duplication, bandwidth and MTU are set
+    with enet_network_link, all random draws coming from a generator seeded with seed: a
+    simulation driven the same way from the same seed gives the same result, and runs as fast as
+    the hosts can process it rather than in real time. The network should be created before the
+    hosts it connects, so that their clocks start in virtual time.
+
+    @param seed seed of the random draws of the links
+    @returns the network, or NULL if another network already drives the clock or on failure
+*/
+ENetNetwork *
+enet_network_create (enet_uint32 seed)
+{
+    ENetNetwork * network;
+
+    if (enet_time_virtual != NULL)
+      return NULL;
+
+    network = (ENetNetwork *) enet_malloc (sizeof (ENetNetwork));
+    if (network == NULL)
+      return NULL;
+
+    memset (network, 0, sizeof (ENetNetwork));
+
+    network -> time = ENET_NETWORK_EPOCH;
+    network -> randomSeed = seed != 0 ? seed : 0x9E3779B9;
+
+    enet_time_virtual = & network -> time;
+    enet_time_set (ENET_NETWORK_EPOCH / 1000);
+
+    return network;
+}
+
+/** Destroys a network. Its hosts are detached and use their sockets again, the datagrams in
+    flight are lost, and the clock goes back to real time, continuing from the virtual time.
+    @param network network to destroy
+*/
+void
+enet_network_destroy (ENetNetwork * network)
+{
+    enet_uint32 time;
+
+    while (network -> nodeCount > 0)
+      enet_host_socket_backend (network -> nodes [network -> nodeCount - 1] -> host, NULL);
+
+    while (network -> flightCount > 0)
+      enet_free (enet_network_flight_pop (network));
+
+    if (network -> flight != NULL)
+      enet_free (network -> flight);
+    if (network -> nodes != NULL)
+      enet_free (network -> nodes);
+    if (network -> routes != NULL)
+      enet_free (network -> routes);
+
+    time = enet_time_get ();
+    enet_time_virtual = NULL;
+    enet_time_set (time);
+
+    enet_free (network);
+}
+
+/** Attaches a host to a network, which then carries all its datagrams instead of its socket.
+    The host is given an IPv4 address of its own on the network, 10.0.0.1 for the first host
+    attached and so on, that peers connect to through host -> address.
+    @param network network to attach the host to
+    @param host host to attach, detached from any other backend
+    @retval 0 on success
+    @retval < 0 on failure
+*/
+int
+enet_network_attach (ENetNetwork * network, ENetHost * host)
+{
+    ENetSocketBackend socketBackend;
+    ENetNetworkNode * node;
+    enet_uint32 number;
+
+    if (enet_network_grow ((void **) & network -> nodes, & network -> nodeCapacity, network -> nodeCount, sizeof (ENetNetworkNode *)) < 0)
+      return -1;
+
+    node = (ENetNetworkNode *) enet_malloc (sizeof (ENetNetworkNode));
+    if (node == NULL)
+      return -1;
+
+    memset (node, 0, sizeof (ENetNetworkNode));
+
+    number = ++ network -> nextAddress;
+
+    node -> network = network;
+    node -> host = host;
+    node -> address.type = ENET_ADDRESS_TYPE_IPV4;
+    node -> address.port = 1;
+    node -> address.host.v4 [0] = 10;
+    node -> address.host.v4 [1] = (enet_uint8) (number >> 16);
+    node -> address.host.v4 [2] = (enet_uint8) (number >> 8);
+    node -> address.host.v4 [3] = (enet_uint8) number;
+    enet_list_clear (& node -> inbox);
+
+    socketBackend.context = node;
+    socketBackend.send = enet_network_send;
+    socketBackend.receive = enet_network_receive;
+    socketBackend.wait = enet_network_wait;
+    socketBackend.destroy = enet_network_detach;
+
+    enet_host_socket_backend (host, & socketBackend);
+
+    network -> nodes [network -> nodeCount ++] = node;
+    host -> address = node -> address;
+
+    return 0;
+}
+
+/** Sets the characteristics of the links from a host to another. The last setting that matches
+    a datagram applies to it; links nothing matches are ideal, delivering every datagram at once.
+    @param network network whose links are set
+    @param source address of the sending host, or NULL for every host
+    @param destination address of the receiving host, or NULL for every host
+    @param link characteristics of the links, or NULL for ideal links
+    @retval 0 on success
+    @retval < 0 on failure
+*/
+int
+enet_network_link (ENetNetwork * network, const ENetAddress * source, const ENetAddress * destination, const ENetLink * link)
+{
+    ENetNetworkRoute * route;
+    size_t routeIndex;
+
+    for (routeIndex = 0; routeIndex < network -> routeCount; ++ routeIndex)
+    {
+       route = & network -> routes [routeIndex];
+
+       if (route -> anySource == (source == NULL) && route -> anyDestination == (destination == NULL) &&
+           (source == NULL || enet_address_equal (& route -> source, source)) &&
+           (destination == NULL || enet_address_equal (& route -> destination, destination)))
+       {
+          memmove (route, route + 1, (network -> routeCount - routeIndex - 1) * sizeof (ENetNetworkRoute));
+          -- network -> routeCount;
+          break;
+       }
+    }
+
+    if (enet_network_grow ((void **) & network -> routes, & network -> routeCapacity, network -> routeCount, sizeof (ENetNetworkRoute)) < 0)
+      return -1;
+
+    route = & network -> routes [network -> routeCount ++];
+    memset (route, 0, sizeof (ENetNetworkRoute));
+
+    route -> anySource = source == NULL;
+    route -> anyDestination = destination == NULL;
+    if (source != NULL)
+      route -> source = * source;
+    if (destination != NULL)
+      route -> destination = * destination;
+    route -> link = link != NULL ? * link : enet_network_ideal_link;
+
+    return 0;
+}
+
+/** Advances the virtual clock of a network.
+    @param network network whose clock advances
+    @param microseconds time elapsed
+*/
+void
+enet_network_advance (ENetNetwork * network, enet_uint32 microseconds)
+{
+    network -> time += microseconds;
+
+    enet_network_release (network);
+}
+
+/** Gets the counters of a network since its creation.
+    @param network network to read
+    @param stats receives the counters
+*/
+void
+enet_network_get_stats (const ENetNetwork * network, ENetNetworkStats * stats)
+{
+    * stats = network -> stats;
+}
+
+/** @} */
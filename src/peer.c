@@ -6,11 +6,20 @@
 #define ENET_BUILDING_LIB 1
 #include "rcenet/utility.h"
 #include "rcenet/enet.h"
+#include "rcenet/time.h"
 
 /** @defgroup peer ENet peer functions 
     @{
 */
 
+static void enet_peer_prepare_outgoing_command (ENetPeer *, ENetOutgoingCommand *);
+static void enet_peer_remove_incoming_commands (ENetPeer *, ENetList *, ENetListIterator, ENetListIterator, ENetIncomingCommand *);
+static ENetOutgoingCommand * enet_peer_queue_send_command (ENetPeer *, enet_uint8, ENetPacket *, enet_uint8);
+static ENetOutgoingCommand * enet_peer_queue_built_send_command (ENetPeer *, ENetPacket *, const ENetProtocol *);
+static void enet_peer_protect_command (ENetPeer *, ENetChannel *, const ENetOutgoingCommand *);
+static ENetListIterator enet_peer_schedule_position (ENetPeer *, ENetList *, const ENetOutgoingCommand *);
+static int enet_peer_reserve_incoming_reliable_slot (ENetChannel *, enet_uint16);
+
 /** Configures throttle parameter for a peer.
 
     Unreliable packets are dropped by ENet in response to the varying conditions
@@ -90,6 +99,442 @@ enet_peer_throttle (ENetPeer * peer, enet_uint32 rtt)
     return 0;
 }
 
+/** Returns the largest payload a single SEND_FRAGMENT command can carry to peer. */
+size_t
+enet_peer_fragment_length (const ENetPeer * peer)
+{
+   size_t fragmentLength = peer -> mtu - sizeof (ENetProtocolHeader) - sizeof (ENetProtocolSendFragment);
+   if (peer -> host -> checksum != NULL)
+     fragmentLength -= sizeof(enet_uint32);
+
+   return fragmentLength;
+}
+
+/** Serializes the SEND_FRAGMENT commands of a packet once for a given fragment length.
+
+    The resulting table is immutable and can be shared by every peer whose enet_peer_fragment_length()
+    matches; the command queued to each peer reads its fragments from the table as they are sent and
+    only fills in its command number and sequence numbers. The caller holds the first reference.
+    @returns the table, or NULL on failure
+*/
+ENetFragmentTable *
+enet_fragment_table_create (const ENetPacket * packet, size_t fragmentLength)
+{
+   ENetFragmentTable * fragmentTable;
+   enet_uint32 fragmentCount = (enet_uint32) ((packet -> dataLength + fragmentLength - 1) / fragmentLength),
+          fragmentNumber,
+          fragmentOffset;
+
+   if (fragmentCount > ENET_PROTOCOL_MAXIMUM_FRAGMENT_COUNT)
+     return NULL;
+
+   fragmentTable = (ENetFragmentTable *) enet_malloc (sizeof (ENetFragmentTable) + fragmentCount * sizeof (ENetProtocolSendFragment));
+   if (fragmentTable == NULL)
+     return NULL;
+
+   fragmentTable -> referenceCount = 1;
+   fragmentTable -> fragmentLength = fragmentLength;
+   fragmentTable -> fragmentCount = fragmentCount;
+   fragmentTable -> fragments = (ENetProtocolSendFragment *) (fragmentTable + 1);
+
+   for (fragmentNumber = 0,
+          fragmentOffset = 0;
+        fragmentNumber < fragmentCount;
+        ++ fragmentNumber,
+          fragmentOffset += fragmentLength)
+   {
+      ENetProtocolSendFragment * fragment = & fragmentTable -> fragments [fragmentNumber];
+
+      if (packet -> dataLength - fragmentOffset < fragmentLength)
+        fragmentLength = packet -> dataLength - fragmentOffset;
+
+      fragment -> dataLength = ENET_HOST_TO_NET_16 (fragmentLength);
+      fragment -> fragmentCount = ENET_HOST_TO_NET_32 (fragmentCount);
+      fragment -> fragmentNumber = ENET_HOST_TO_NET_32 (fragmentNumber);
+      fragment -> totalLength = ENET_HOST_TO_NET_32 (packet -> dataLength);
+      fragment -> fragmentOffset = ENET_HOST_TO_NET_32 (fragmentOffset);
+   }
+
+   return fragmentTable;
+}
+
+void
+enet_fragment_table_release (ENetFragmentTable * fragmentTable)
+{
+   if (-- fragmentTable -> referenceCount == 0)
+     enet_free (fragmentTable);
+}
+
+/** Sets the SEND_FRAGMENT fields of a fragment command for the fragment at its fragmentOffset, from
+    its fragment table if it has one.
+*/
+static void
+enet_peer_fill_fragment (ENetOutgoingCommand * outgoingCommand, enet_uint32 fragmentNumber, enet_uint32 fragmentCount)
+{
+   ENetProtocolSendFragment * sendFragment = & outgoingCommand -> command.sendFragment;
+
+   if (outgoingCommand -> fragmentTable != NULL)
+   {
+      const ENetProtocolSendFragment * fragment = & outgoingCommand -> fragmentTable -> fragments [fragmentNumber];
+
+      sendFragment -> dataLength = fragment -> dataLength;
+      sendFragment -> fragmentCount = fragment -> fragmentCount;
+      sendFragment -> fragmentNumber = fragment -> fragmentNumber;
+      sendFragment -> totalLength = fragment -> totalLength;
+      sendFragment -> fragmentOffset = fragment -> fragmentOffset;
+   }
+   else
+   {
+      sendFragment -> dataLength = ENET_HOST_TO_NET_16 (outgoingCommand -> fragmentLength);
+      sendFragment -> fragmentCount = ENET_HOST_TO_NET_32 (fragmentCount);
+      sendFragment -> fragmentNumber = ENET_HOST_TO_NET_32 (fragmentNumber);
+      sendFragment -> totalLength = ENET_HOST_TO_NET_32 (outgoingCommand -> packet -> dataLength);
+      sendFragment -> fragmentOffset = ENET_HOST_TO_NET_32 (outgoingCommand -> fragmentOffset);
+   }
+}
+
+/** Queues every fragment of a packet to a peer as a single fragment run.
+
+    The run is one outgoing command that stands for the next fragment to send and for the
+    pendingFragments that follow it. Its sequence numbers are reserved for all fragments up front,
+    and the send loop detaches one command per fragment with enet_peer_split_fragment_run() only
+    when the fragment goes out, so queueing costs the same whatever the number of fragments.
+    The peer must be connected, channelID valid and fragmentLength equal to enet_peer_fragment_length (peer).
+    @param fragmentTable table built for fragmentLength that the run references, or NULL to compute the fragments on the fly
+    @retval 0 on success
+    @retval < 0 on failure, in which case nothing was queued
+*/
+int
+enet_peer_send_fragments (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet, size_t fragmentLength, ENetFragmentTable * fragmentTable)
+{
+   ENetChannel * channel = & peer -> channels [channelID];
+   enet_uint32 fragmentCount = (enet_uint32) ((packet -> dataLength + fragmentLength - 1) / fragmentLength);
+   ENetOutgoingCommand * outgoingCommand;
+   size_t pendingLength;
+
+   if (fragmentCount > ENET_PROTOCOL_MAXIMUM_FRAGMENT_COUNT)
+     return -1;
+
+   if (! enet_list_empty (& channel -> aggregateCommands) &&
+       enet_peer_flush_aggregate (peer, channelID) < 0)
+     return -1;
+
+   outgoingCommand = enet_host_allocate_outgoing_command (peer -> host);
+   if (outgoingCommand == NULL)
+     return -1;
+
+   if ((packet -> flags & (ENET_PACKET_FLAG_RELIABLE | ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT)) == ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT &&
+       channel -> outgoingUnreliableSequenceNumber < 0xFFFF)
+   {
+      outgoingCommand -> command.header.command = ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT;
+      outgoingCommand -> command.sendFragment.startSequenceNumber = ENET_HOST_TO_NET_16 (channel -> outgoingUnreliableSequenceNumber + 1);
+   }
+   else
+   {
+      outgoingCommand -> command.header.command = ENET_PROTOCOL_COMMAND_SEND_FRAGMENT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
+      outgoingCommand -> command.sendFragment.startSequenceNumber = ENET_HOST_TO_NET_16 (channel -> outgoingReliableSequenceNumber + 1);
+   }
+   outgoingCommand -> command.header.channelID = channelID;
+
+   outgoingCommand -> fragmentOffset = 0;
+   outgoingCommand -> fragmentLength = (enet_uint16) fragmentLength;
+   outgoingCommand -> packet = packet;
+   outgoingCommand -> pendingFragments = fragmentCount - 1;
+   outgoingCommand -> fragmentTable = fragmentTable;
+   if (fragmentTable != NULL)
+     ++ fragmentTable -> referenceCount;
+
+   enet_peer_fill_fragment (outgoingCommand, 0, fragmentCount);
+
+   packet -> remainingFragments = fragmentCount;
+   ++ packet -> referenceCount;
+
+   enet_peer_prepare_outgoing_command (peer, outgoingCommand);
+
+   /* The following fragments take the next reliable sequence numbers, and count as queued data already. */
+   if (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE)
+     channel -> outgoingReliableSequenceNumber += fragmentCount - 1;
+
+   pendingLength = (fragmentCount - 1) * enet_protocol_command_size (outgoingCommand -> command.header.command) + packet -> dataLength - fragmentLength;
+
+   peer -> outgoingDataTotal += (enet_uint32) pendingLength;
+
+   if (peer -> coalesceTimeout != 0)
+   {
+      peer -> coalescedCommands += fragmentCount - 1;
+      peer -> coalescedDataLength += pendingLength;
+   }
+
+   enet_list_insert (enet_peer_schedule_position (peer,
+                                                  outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE ? & peer -> outgoingSendReliableCommands : & peer -> outgoingCommands,
+                                                  outgoingCommand),
+                     outgoingCommand);
+
+   return 0;
+}
+
+/** Detaches the fragment a fragment run is about to send into a command of its own, and moves the
+    run on to its next fragment.
+
+    The detached command is queued right before the run and is then sent, acknowledged and
+    retransmitted like any other command. Once the run has detached its next to last fragment,
+    the run itself carries the last one. A run whose packet was cancelled detaches empty commands
+    that only keep its reliable sequence numbers.
+    @param outgoingCommand run with pendingFragments > 0
+    @returns the detached command, or NULL on allocation failure
+*/
+ENetOutgoingCommand *
+enet_peer_split_fragment_run (ENetPeer * peer, ENetOutgoingCommand * outgoingCommand)
+{
+   ENetOutgoingCommand * fragment = enet_host_allocate_outgoing_command (peer -> host);
+   enet_uint32 fragmentNumber, fragmentCount;
+
+   if (fragment == NULL)
+     return NULL;
+
+   * fragment = * outgoingCommand;
+   fragment -> pendingFragments = 0;
+   fragment -> fragmentTable = NULL;
+   fragment -> supersedeSlot = NULL;
+
+   enet_list_insert (& outgoingCommand -> outgoingCommandList, fragment);
+
+   if (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE)
+   {
+      ++ outgoingCommand -> reliableSequenceNumber;
+
+      outgoingCommand -> command.header.reliableSequenceNumber = ENET_HOST_TO_NET_16 (outgoingCommand -> reliableSequenceNumber);
+   }
+
+   -- outgoingCommand -> pendingFragments;
+
+   if (outgoingCommand -> packet != NULL)
+   {
+      ++ outgoingCommand -> packet -> referenceCount;
+
+      outgoingCommand -> fragmentOffset += outgoingCommand -> fragmentLength;
+      if (outgoingCommand -> packet -> dataLength - outgoingCommand -> fragmentOffset < outgoingCommand -> fragmentLength)
+        outgoingCommand -> fragmentLength = (enet_uint16) (outgoingCommand -> packet -> dataLength - outgoingCommand -> fragmentOffset);
+
+      fragmentNumber = ENET_NET_TO_HOST_32 (outgoingCommand -> command.sendFragment.fragmentNumber) + 1;
+      fragmentCount = ENET_NET_TO_HOST_32 (outgoingCommand -> command.sendFragment.fragmentCount);
+
+      enet_peer_fill_fragment (outgoingCommand, fragmentNumber, fragmentCount);
+   }
+
+   if (outgoingCommand -> pendingFragments == 0 && outgoingCommand -> fragmentTable != NULL)
+   {
+      enet_fragment_table_release (outgoingCommand -> fragmentTable);
+
+      outgoingCommand -> fragmentTable = NULL;
+   }
+
+   return fragment;
+}
+
+/** Number of bytes of the LEB128 length prefix written before each aggregated message. */
+static size_t
+enet_peer_aggregate_prefix_length (size_t dataLength)
+{
+   size_t prefixLength = 1;
+
+   for (; dataLength >= 0x80; dataLength >>= 7)
+     ++ prefixLength;
+
+   return prefixLength;
+}
+
+/** Packet flags that must match for two messages to share an aggregated command. */
+static enet_uint32
+enet_peer_aggregate_flags (const ENetPacket * packet)
+{
+   if (packet -> flags & ENET_PACKET_FLAG_RELIABLE)
+     return ENET_PACKET_FLAG_RELIABLE;
+
+   return packet -> flags & ENET_PACKET_FLAG_UNSEQUENCED;
+}
+
+/** Drops the pending messages of a channel, releasing their packet references. */
+static void
+enet_peer_reset_aggregate (ENetPeer * peer, ENetChannel * channel)
+{
+   ENetOutgoingCommand * outgoingCommand;
+
+   if (enet_list_empty (& channel -> aggregateCommands))
+     return;
+
+   while (! enet_list_empty (& channel -> aggregateCommands))
+   {
+      outgoingCommand = (ENetOutgoingCommand *) enet_list_remove (enet_list_begin (& channel -> aggregateCommands));
+
+      if (-- outgoingCommand -> packet -> referenceCount == 0)
+        enet_packet_destroy (outgoingCommand -> packet);
+
+      enet_host_release_outgoing_command (peer -> host, outgoingCommand);
+   }
+
+   channel -> aggregateLength = 0;
+
+   -- peer -> aggregatingChannels;
+}
+
+/** Appends a small packet to the pending batch of its channel, flushing the batch first if
+    the packet would overflow it or does not share its reliability.
+*/
+static int
+enet_peer_aggregate (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet, size_t fragmentLength)
+{
+   ENetChannel * channel = & peer -> channels [channelID];
+   size_t messageLength = enet_peer_aggregate_prefix_length (packet -> dataLength) + packet -> dataLength;
+   ENetOutgoingCommand * outgoingCommand;
+
+   if (! enet_list_empty (& channel -> aggregateCommands) &&
+       (channel -> aggregateFlags != enet_peer_aggregate_flags (packet) ||
+        channel -> aggregateLength + messageLength > fragmentLength) &&
+       enet_peer_flush_aggregate (peer, channelID) < 0)
+     return -1;
+
+   outgoingCommand = enet_host_allocate_outgoing_command (peer -> host);
+   if (outgoingCommand == NULL)
+     return -1;
+
+   outgoingCommand -> packet = packet;
+   ++ packet -> referenceCount;
+
+   if (enet_list_empty (& channel -> aggregateCommands))
+   {
+      channel -> aggregateFlags = enet_peer_aggregate_flags (packet);
+      channel -> aggregateDeadline = enet_time_get () + channel -> aggregateTimeout;
+
+      ++ peer -> aggregatingChannels;
+   }
+
+   channel -> aggregateLength += messageLength;
+
+   enet_list_insert (enet_list_end (& channel -> aggregateCommands), outgoingCommand);
+
+   return 0;
+}
+
+/** Queues the pending messages of a channel as a single SEND command flagged with
+    ENET_PROTOCOL_COMMAND_FLAG_AGGREGATE, whose payload is a sequence of [LEB128 length][data].
+    A lone pending message is queued as is.
+    @retval 0 on success
+    @retval < 0 on failure, in which case the messages stay pending
+*/
+int
+enet_peer_flush_aggregate (ENetPeer * peer, enet_uint8 channelID)
+{
+   ENetChannel * channel = & peer -> channels [channelID];
+   ENetOutgoingCommand * outgoingCommand;
+   ENetListIterator currentCommand;
+   ENetPacket * packet;
+   enet_uint8 * data;
+
+   if (enet_list_empty (& channel -> aggregateCommands))
+     return 0;
+
+   outgoingCommand = (ENetOutgoingCommand *) enet_list_front (& channel -> aggregateCommands);
+
+   if (enet_list_next (& outgoingCommand -> outgoingCommandList) == enet_list_end (& channel -> aggregateCommands))
+   {
+      if (enet_peer_queue_send_command (peer, channelID, outgoingCommand -> packet, 0) == NULL)
+        return -1;
+
+      enet_peer_reset_aggregate (peer, channel);
+
+      return 0;
+   }
+
+   packet = enet_packet_create (NULL, channel -> aggregateLength, channel -> aggregateFlags);
+   if (packet == NULL)
+     return -1;
+
+   data = packet -> data;
+
+   for (currentCommand = enet_list_begin (& channel -> aggregateCommands);
+        currentCommand != enet_list_end (& channel -> aggregateCommands);
+        currentCommand = enet_list_next (currentCommand))
+   {
+      const ENetPacket * message = ((ENetOutgoingCommand *) currentCommand) -> packet;
+      size_t dataLength = message -> dataLength;
+
+      for (; dataLength >= 0x80; dataLength >>= 7)
+        * data ++ = (enet_uint8) (dataLength | 0x80);
+      * data ++ = (enet_uint8) dataLength;
+
+      memcpy (data, message -> data, message -> dataLength);
+      data += message -> dataLength;
+   }
+
+   if (enet_peer_queue_send_command (peer, channelID, packet, ENET_PROTOCOL_COMMAND_FLAG_AGGREGATE) == NULL)
+   {
+      enet_packet_destroy (packet);
+
+      return -1;
+   }
+
+   enet_peer_reset_aggregate (peer, channel);
+
+   return 0;
+}
+
+/** Queues the pending aggregated messages of a peer whose flush deadline has passed, or all of them if force is set. */
+void
+enet_peer_flush_aggregates (ENetPeer * peer, int force)
+{
+   ENetChannel * channel;
+
+   for (channel = peer -> channels;
+        peer -> aggregatingChannels > 0 && channel < & peer -> channels [peer -> channelCount];
+        ++ channel)
+   {
+      if (enet_list_empty (& channel -> aggregateCommands) ||
+          (! force && ENET_TIME_LESS (peer -> host -> serviceTime, channel -> aggregateDeadline)))
+        continue;
+
+      enet_peer_flush_aggregate (peer, (enet_uint8) (channel - peer -> channels));
+   }
+}
+
+/** Enables or disables small-message aggregation on a channel of a connected peer.
+
+    While enabled, packets sent on the channel that fit in a single command are held and
+    packed together, each behind a 1 to 3 byte length prefix, into one SEND command. The
+    batch is queued once it would exceed the MTU, when a packet with a different reliability
+    or one too large to aggregate is sent on the channel, when flushTimeout milliseconds
+    have elapsed since its first message, or on enet_host_flush. The receiving side hands
+    every message back as a packet of its own. Both ends announce whether they understand
+    aggregated commands when connecting; toward a peer that did not, such as one running
+    the original ENet, the setting has no effect and every packet is sent on its own.
+
+    @param peer peer whose channel to configure
+    @param channelID channel to configure
+    @param enabled non-zero to enable aggregation, 0 to disable it and queue pending messages
+    @param flushTimeout maximum time in milliseconds a message is held; 0 queues pending messages on every service
+    @retval 0 on success
+    @retval < 0 on failure
+*/
+int
+enet_peer_set_channel_aggregation (ENetPeer * peer, enet_uint8 channelID, int enabled, enet_uint32 flushTimeout)
+{
+   ENetChannel * channel;
+
+   if (channelID >= peer -> channelCount)
+     return -1;
+
+   channel = & peer -> channels [channelID];
+
+   if (! enabled &&
+       enet_peer_flush_aggregate (peer, channelID) < 0)
+     return -1;
+
+   channel -> aggregation = enabled ? 1 : 0;
+   channel -> aggregateTimeout = flushTimeout;
+
+   return 0;
+}
+
 /** Queues a packet to be sent.
 
     On success, ENet will assume ownership of the packet, and so enet_packet_destroy
@@ -107,7 +552,6 @@ enet_peer_throttle (ENetPeer * peer, enet_uint32 rtt)
 int
 enet_peer_send (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet)
 {
-   ENetChannel * channel;
    ENetProtocol command;
    size_t fragmentLength;
 
@@ -116,150 +560,788 @@ enet_peer_send (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet)
        packet -> dataLength > peer -> host -> maximumPacketSize)
      return -1;
 
-   channel = & peer -> channels [channelID];
-   fragmentLength = peer -> mtu - sizeof (ENetProtocolHeader) - sizeof (ENetProtocolSendFragment);
-   if (peer -> host -> checksum != NULL)
-     fragmentLength -= sizeof(enet_uint32);
+   fragmentLength = enet_peer_fragment_length (peer);
 
    if (packet -> dataLength > fragmentLength)
-   {
-      enet_uint32 fragmentCount = (packet -> dataLength + fragmentLength - 1) / fragmentLength,
-             fragmentNumber,
-             fragmentOffset;
-      enet_uint8 commandNumber;
-      enet_uint16 startSequenceNumber; 
-      ENetList fragments;
-      ENetOutgoingCommand * fragment;
-
-      if (fragmentCount > ENET_PROTOCOL_MAXIMUM_FRAGMENT_COUNT)
-        return -1;
-
-      if ((packet -> flags & (ENET_PACKET_FLAG_RELIABLE | ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT)) == ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT &&
-          channel -> outgoingUnreliableSequenceNumber < 0xFFFF)
-      {
-         commandNumber = ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT;
-         startSequenceNumber = ENET_HOST_TO_NET_16 (channel -> outgoingUnreliableSequenceNumber + 1);
-      }
-      else
-      {
-         commandNumber = ENET_PROTOCOL_COMMAND_SEND_FRAGMENT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
-         startSequenceNumber = ENET_HOST_TO_NET_16 (channel -> outgoingReliableSequenceNumber + 1);
-      }
-        
-      enet_list_clear (& fragments);
-
-      packet -> remainingFragments = fragmentCount;
-
-      for (fragmentNumber = 0,
-             fragmentOffset = 0;
-           fragmentOffset < packet -> dataLength;
-           ++ fragmentNumber,
-             fragmentOffset += fragmentLength)
-      {
-         if (packet -> dataLength - fragmentOffset < fragmentLength)
-           fragmentLength = packet -> dataLength - fragmentOffset;
-
-         fragment = (ENetOutgoingCommand *) enet_malloc (sizeof (ENetOutgoingCommand));
-         if (fragment == NULL)
-         {
-            while (! enet_list_empty (& fragments))
-            {
-               fragment = (ENetOutgoingCommand *) enet_list_remove (enet_list_begin (& fragments));
-               
-               enet_free (fragment);
-            }
-            
-            return -1;
-         }
-         
-         fragment -> fragmentOffset = fragmentOffset;
-         fragment -> fragmentLength = fragmentLength;
-         fragment -> packet = packet;
-         fragment -> command.header.command = commandNumber;
-         fragment -> command.header.channelID = channelID;
-         fragment -> command.sendFragment.startSequenceNumber = startSequenceNumber;
-         fragment -> command.sendFragment.dataLength = ENET_HOST_TO_NET_16 (fragmentLength);
-         fragment -> command.sendFragment.fragmentCount = ENET_HOST_TO_NET_32 (fragmentCount);
-         fragment -> command.sendFragment.fragmentNumber = ENET_HOST_TO_NET_32 (fragmentNumber);
-         fragment -> command.sendFragment.totalLength = ENET_HOST_TO_NET_32 (packet -> dataLength);
-         fragment -> command.sendFragment.fragmentOffset = ENET_NET_TO_HOST_32 (fragmentOffset);
-        
-         enet_list_insert (enet_list_end (& fragments), fragment);
-      }
+     return enet_peer_send_fragments (peer, channelID, packet, fragmentLength, NULL);
 
-      packet -> referenceCount += fragmentNumber;
-
-      while (! enet_list_empty (& fragments))
-      {
-         fragment = (ENetOutgoingCommand *) enet_list_remove (enet_list_begin (& fragments));
- 
-         enet_peer_setup_outgoing_command (peer, fragment);
-      }
+   enet_peer_build_send_command (& command, channelID, packet, 0);
 
-      return 0;
-   }
+   return enet_peer_send_command (peer, packet, & command, fragmentLength);
+}
 
-   packet -> remainingFragments = 1;
+/** Builds the SEND_* command matching the flags of a packet that fits in one command.
 
-   command.header.channelID = channelID;
+    The command does not depend on the peer, so it can be built once and queued to every peer of a
+    list with enet_peer_send_command().
+    @param commandFlags extra ENET_PROTOCOL_COMMAND_FLAG_* bits to set on the command
+*/
+void
+enet_peer_build_send_command (ENetProtocol * command, enet_uint8 channelID, const ENetPacket * packet, enet_uint8 commandFlags)
+{
+   command -> header.channelID = channelID;
 
    if ((packet -> flags & (ENET_PACKET_FLAG_RELIABLE | ENET_PACKET_FLAG_UNSEQUENCED)) == ENET_PACKET_FLAG_UNSEQUENCED)
    {
-      command.header.command = ENET_PROTOCOL_COMMAND_SEND_UNSEQUENCED | ENET_PROTOCOL_COMMAND_FLAG_UNSEQUENCED;
-      command.sendUnsequenced.dataLength = ENET_HOST_TO_NET_16 (packet -> dataLength);
+      command -> header.command = ENET_PROTOCOL_COMMAND_SEND_UNSEQUENCED | ENET_PROTOCOL_COMMAND_FLAG_UNSEQUENCED;
+      command -> sendUnsequenced.dataLength = ENET_HOST_TO_NET_16 (packet -> dataLength);
    }
-   else 
-   if (packet -> flags & ENET_PACKET_FLAG_RELIABLE || channel -> outgoingUnreliableSequenceNumber >= 0xFFFF)
+   else
+   if (packet -> flags & ENET_PACKET_FLAG_RELIABLE)
    {
-      command.header.command = ENET_PROTOCOL_COMMAND_SEND_RELIABLE | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
-      command.sendReliable.dataLength = ENET_HOST_TO_NET_16 (packet -> dataLength);
+      command -> header.command = ENET_PROTOCOL_COMMAND_SEND_RELIABLE | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
+      command -> sendReliable.dataLength = ENET_HOST_TO_NET_16 (packet -> dataLength);
    }
    else
    {
-      command.header.command = ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE;
-      command.sendUnreliable.dataLength = ENET_HOST_TO_NET_16 (packet -> dataLength);
+      command -> header.command = ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE;
+      command -> sendUnreliable.dataLength = ENET_HOST_TO_NET_16 (packet -> dataLength);
    }
 
-   if (enet_peer_queue_outgoing_command (peer, & command, packet, 0, packet -> dataLength) == NULL)
-     return -1;
-
-   return 0;
+   command -> header.command |= commandFlags;
 }
 
-/** Attempts to dequeue any incoming queued packet.
-    @param peer peer to dequeue packets from
-    @param channelID holds the channel ID of the channel the packet was received on success
-    @returns a pointer to the packet, or NULL if there are no available incoming queued packets
+/** Queues a packet that fits in one command to a peer, aggregating it if its channel does.
+
+    The peer must be connected, the channel of command valid and fragmentLength equal to
+    enet_peer_fragment_length (peer).
+    @param command command built by enet_peer_build_send_command() for packet
+    @retval 0 on success
+    @retval < 0 on failure
 */
-ENetPacket *
-enet_peer_receive (ENetPeer * peer, enet_uint8 * channelID)
+int
+enet_peer_send_command (ENetPeer * peer, ENetPacket * packet, const ENetProtocol * command, size_t fragmentLength)
 {
-   ENetIncomingCommand * incomingCommand;
-   ENetPacket * packet;
-   
-   if (enet_list_empty (& peer -> dispatchedCommands))
-     return NULL;
-
-   incomingCommand = (ENetIncomingCommand *) enet_list_remove (enet_list_begin (& peer -> dispatchedCommands));
+   enet_uint8 channelID = command -> header.channelID;
+   ENetChannel * channel = & peer -> channels [channelID];
 
-   if (channelID != NULL)
-     * channelID = incomingCommand -> command.header.channelID;
+   if (channel -> aggregation &&
+       peer -> flags & ENET_PEER_FLAG_AGGREGATE &&
+       packet -> acknowledgeCallback == NULL &&
+       enet_peer_aggregate_prefix_length (packet -> dataLength) + packet -> dataLength <= fragmentLength)
+     return enet_peer_aggregate (peer, channelID, packet, fragmentLength);
 
-   packet = incomingCommand -> packet;
+   if (! enet_list_empty (& channel -> aggregateCommands) &&
+       enet_peer_flush_aggregate (peer, channelID) < 0)
+     return -1;
 
-   -- packet -> referenceCount;
+   return enet_peer_queue_built_send_command (peer, packet, command) != NULL ? 0 : -1;
+}
 
-   if (incomingCommand -> fragments != NULL)
-     enet_free (incomingCommand -> fragments);
+static size_t
+enet_peer_supersede_slot (const ENetChannel * channel, enet_uint32 key)
+{
+   key *= 0x9E3779B1u;
 
-   enet_free (incomingCommand);
+   return (key ^ (key >> 16)) & (channel -> supersedeSlotCount - 1);
+}
 
-   peer -> totalWaitingData -= ENET_MIN (peer -> totalWaitingData, packet -> dataLength);
+/** Queues a packet that supersedes any packet of the same key still waiting to be sent on the channel.
 
-   return packet;
-}
+    On a channel configured with enet_peer_set_channel_superseding, if a packet queued with the
+    same key and the same reliability flags has not been sent yet, the new packet takes its place
+    in the queue, keeping its sequence number and its turn, and the older packet is released
+    without ever being sent. Only the latest value of each key is thus carried across a congested
+    link. Packets that need fragmenting, or sent on a channel that does not supersede or that has
+    FEC enabled, are queued as with enet_peer_send. Ownership of the packet follows enet_peer_send.
 
-static void
+    @param peer destination for the packet
+    @param channelID channel on which to send
+    @param packet packet to send
+    @param key application key of the value carried by the packet, such as an entity identifier
+    @retval 0 on success
+    @retval < 0 on failure
+*/
+int
+enet_peer_send_superseding (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet, enet_uint32 key)
+{
+   ENetChannel * channel;
+   ENetOutgoingCommand ** slot, * outgoingCommand;
+   ENetPacket * supersededPacket;
+
+   if (peer -> state != ENET_PEER_STATE_CONNECTED ||
+       channelID >= peer -> channelCount ||
+       packet -> dataLength > peer -> host -> maximumPacketSize)
+     return -1;
+
+   channel = & peer -> channels [channelID];
+
+   if (channel -> supersedeSlots == NULL ||
+       channel -> fec != NULL ||
+       packet -> dataLength > enet_peer_fragment_length (peer))
+     return enet_peer_send (peer, channelID, packet);
+
+   slot = & channel -> supersedeSlots [enet_peer_supersede_slot (channel, key)];
+   outgoingCommand = * slot;
+
+   if (outgoingCommand == NULL ||
+       outgoingCommand -> supersedeKey != key ||
+       (outgoingCommand -> packet -> flags & (ENET_PACKET_FLAG_RELIABLE | ENET_PACKET_FLAG_UNSEQUENCED)) != (packet -> flags & (ENET_PACKET_FLAG_RELIABLE | ENET_PACKET_FLAG_UNSEQUENCED)))
+   {
+      if (! enet_list_empty (& channel -> aggregateCommands) &&
+          enet_peer_flush_aggregate (peer, channelID) < 0)
+        return -1;
+
+      outgoingCommand = enet_peer_queue_send_command (peer, channelID, packet, 0);
+      if (outgoingCommand == NULL)
+        return -1;
+
+      /* On a collision the older command stays queued, it just can no longer be superseded. */
+      if (* slot != NULL)
+        (* slot) -> supersedeSlot = NULL;
+
+      * slot = outgoingCommand;
+      outgoingCommand -> supersedeSlot = slot;
+      outgoingCommand -> supersedeKey = key;
+
+      return 0;
+   }
+
+   supersededPacket = outgoingCommand -> packet;
+
+   peer -> outgoingDataTotal += (enet_uint32) packet -> dataLength - (enet_uint32) supersededPacket -> dataLength;
+
+   packet -> remainingFragments = 1;
+   ++ packet -> referenceCount;
+
+   outgoingCommand -> packet = packet;
+   outgoingCommand -> fragmentLength = (enet_uint16) packet -> dataLength;
+
+   switch (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK)
+   {
+   case ENET_PROTOCOL_COMMAND_SEND_RELIABLE:
+      outgoingCommand -> command.sendReliable.dataLength = ENET_HOST_TO_NET_16 (packet -> dataLength);
+      break;
+
+   case ENET_PROTOCOL_COMMAND_SEND_UNSEQUENCED:
+      outgoingCommand -> command.sendUnsequenced.dataLength = ENET_HOST_TO_NET_16 (packet -> dataLength);
+      break;
+
+   default:
+      outgoingCommand -> command.sendUnreliable.dataLength = ENET_HOST_TO_NET_16 (packet -> dataLength);
+      break;
+   }
+
+   if (outgoingCommand -> expireTime != 0)
+     outgoingCommand -> expireTime = enet_time_get () + channel -> timeToLive;
+
+   -- supersededPacket -> referenceCount;
+
+   if (supersededPacket -> referenceCount == 0)
+     enet_packet_destroy (supersededPacket);
+
+   ++ peer -> supersededPackets;
+
+   return 0;
+}
+
+/** Removes an outgoing command from the superseding table of its channel, once it is sent or released. */
+void
+enet_peer_unindex_outgoing_command (ENetOutgoingCommand * outgoingCommand)
+{
+   if (outgoingCommand -> supersedeSlot == NULL)
+     return;
+
+   * outgoingCommand -> supersedeSlot = NULL;
+   outgoingCommand -> supersedeSlot = NULL;
+}
+
+/** Builds the SEND_* command matching the flags of a packet that fits in one command and queues it.
+    @param commandFlags extra ENET_PROTOCOL_COMMAND_FLAG_* bits to set on the command
+    @returns the queued command, or NULL on failure
+*/
+static ENetOutgoingCommand *
+enet_peer_queue_send_command (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet, enet_uint8 commandFlags)
+{
+   ENetProtocol command;
+
+   enet_peer_build_send_command (& command, channelID, packet, commandFlags);
+
+   return enet_peer_queue_built_send_command (peer, packet, & command);
+}
+
+/** Queues a SEND_* command built by enet_peer_build_send_command() for a packet.
+    @returns the queued command, or NULL on failure
+*/
+static ENetOutgoingCommand *
+enet_peer_queue_built_send_command (ENetPeer * peer, ENetPacket * packet, const ENetProtocol * command)
+{
+   ENetChannel * channel = & peer -> channels [command -> header.channelID];
+   ENetOutgoingCommand * outgoingCommand;
+   ENetProtocol reliableCommand;
+
+   packet -> remainingFragments = 1;
+
+   /* Once the unreliable sequence numbers of the channel run out, unreliable packets go reliably. */
+   if ((command -> header.command & ENET_PROTOCOL_COMMAND_MASK) == ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE &&
+       channel -> outgoingUnreliableSequenceNumber >= 0xFFFF)
+   {
+      reliableCommand.header.command = ENET_PROTOCOL_COMMAND_SEND_RELIABLE | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE |
+                                         (command -> header.command & ~ ENET_PROTOCOL_COMMAND_MASK);
+      reliableCommand.header.channelID = command -> header.channelID;
+      reliableCommand.sendReliable.dataLength = command -> sendUnreliable.dataLength;
+
+      command = & reliableCommand;
+   }
+
+   outgoingCommand = enet_peer_queue_outgoing_command (peer, command, packet, 0, packet -> dataLength);
+   if (outgoingCommand == NULL)
+     return NULL;
+
+   if (channel -> fec != NULL && channel -> fec -> groupSize > 0)
+     enet_peer_protect_command (peer, channel, outgoingCommand);
+
+   return outgoingCommand;
+}
+
+/** Queues the parity of the current FEC group of a channel and starts a new group.
+    The group is dropped unprotected if the parity cannot be allocated.
+*/
+static void
+enet_peer_send_parity (ENetPeer * peer, ENetChannel * channel)
+{
+   ENetChannelFec * fec = channel -> fec;
+   size_t membersLength = fec -> memberCount * sizeof (ENetProtocolParityMember);
+   ENetProtocol command;
+   ENetPacket * packet;
+
+   packet = enet_packet_create (NULL, membersLength + fec -> parityLength, 0);
+   if (packet != NULL)
+   {
+      memcpy (packet -> data, fec -> members, membersLength);
+      memcpy (packet -> data + membersLength, fec -> parity, fec -> parityLength);
+
+      command.header.command = ENET_PROTOCOL_COMMAND_SEND_PARITY;
+      command.header.channelID = (enet_uint8) (channel - peer -> channels);
+      command.sendParity.memberCount = fec -> memberCount;
+      command.sendParity.dataLength = ENET_HOST_TO_NET_16 ((enet_uint16) packet -> dataLength);
+
+      if (enet_peer_queue_outgoing_command (peer, & command, packet, 0, (enet_uint16) packet -> dataLength) == NULL)
+        enet_packet_destroy (packet);
+   }
+
+   memset (fec -> parity, 0, fec -> parityLength);
+
+   fec -> memberCount = 0;
+   fec -> parityLength = 0;
+}
+
+/** Adds a queued SEND command to the current FEC group of its channel.
+
+    The parity of a complete group is queued along with the next command of the channel
+    rather than right after its last member, so that the two do not share a datagram and
+    the loss of that datagram stays recoverable.
+*/
+static void
+enet_peer_protect_command (ENetPeer * peer, ENetChannel * channel, const ENetOutgoingCommand * outgoingCommand)
+{
+   ENetChannelFec * fec = channel -> fec;
+   ENetProtocolParityMember * member;
+   const enet_uint8 * data = outgoingCommand -> packet -> data + outgoingCommand -> fragmentOffset;
+   size_t dataLength = outgoingCommand -> fragmentLength,
+          parityLength = ENET_MAX (fec -> parityLength, dataLength),
+          i;
+
+   if (dataLength > fec -> slotSize)
+     return;
+
+   /* The parity must also fit in a datagram as well as the largest SEND_FRAGMENT does. */
+   if (fec -> memberCount >= fec -> groupSize ||
+       (fec -> memberCount > 0 &&
+        sizeof (ENetProtocolSendParity) + (fec -> memberCount + 1) * sizeof (ENetProtocolParityMember) + parityLength >
+          sizeof (ENetProtocolSendFragment) + enet_peer_fragment_length (peer)))
+     enet_peer_send_parity (peer, channel);
+
+   if (fec -> memberCount == 0)
+     fec -> groupTime = enet_time_get ();
+
+   member = & fec -> members [fec -> memberCount ++];
+   member -> command = outgoingCommand -> command.header.command;
+   member -> reliableSequenceNumber = outgoingCommand -> command.header.reliableSequenceNumber;
+   member -> dataLength = ENET_HOST_TO_NET_16 ((enet_uint16) dataLength);
+
+   switch (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK)
+   {
+   case ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE:
+      member -> sequenceNumber = outgoingCommand -> command.sendUnreliable.unreliableSequenceNumber;
+      break;
+
+   case ENET_PROTOCOL_COMMAND_SEND_UNSEQUENCED:
+      member -> sequenceNumber = outgoingCommand -> command.sendUnsequenced.unsequencedGroup;
+      break;
+
+   default:
+      member -> sequenceNumber = 0;
+      break;
+   }
+
+   for (i = 0; i < dataLength; ++ i)
+     fec -> parity [i] ^= data [i];
+
+   if (dataLength > fec -> parityLength)
+     fec -> parityLength = dataLength;
+}
+
+/** Queues the parity of every FEC group of a peer that has been open for ENET_PEER_FEC_GROUP_TIMEOUT. */
+void
+enet_peer_flush_parity (ENetPeer * peer)
+{
+   ENetChannel * channel;
+
+   for (channel = peer -> channels;
+        channel < & peer -> channels [peer -> channelCount];
+        ++ channel)
+   {
+      if (channel -> fec == NULL ||
+          channel -> fec -> memberCount == 0 ||
+          ENET_TIME_DIFFERENCE (peer -> host -> serviceTime, channel -> fec -> groupTime) < ENET_PEER_FEC_GROUP_TIMEOUT)
+        continue;
+
+      enet_peer_send_parity (peer, channel);
+   }
+}
+
+/** Recomputes the effective FEC group size of a channel from the local and remote settings
+    and discards the current group and the receive history.
+*/
+void
+enet_peer_reset_fec (ENetChannel * channel)
+{
+   ENetChannelFec * fec = channel -> fec;
+
+   if (fec == NULL)
+     return;
+
+   fec -> groupSize = channel -> fecRemoteGroupSize > 0 ? ENET_MIN (fec -> localGroupSize, channel -> fecRemoteGroupSize) : 0;
+   fec -> memberCount = 0;
+   fec -> parityLength = 0;
+   fec -> historyNext = 0;
+
+   memset (fec -> parity, 0, fec -> slotSize);
+   memset (fec -> history, 0, sizeof (fec -> history));
+}
+
+/** Enables or disables forward error correction on a channel of a connected peer.
+
+    While enabled, every groupSize SEND commands queued on the channel are followed by a
+    SEND_PARITY command carrying the XOR of their data, from which the receiver rebuilds
+    any single command of the group that was lost, without waiting for a retransmission.
+    The parity is queued with the next command sent on the channel, or once the group has
+    been open for ENET_PEER_FEC_GROUP_TIMEOUT milliseconds, complete or not. Fragmented
+    packets are not protected, and FEC only helps when the commands of a group travel in
+    different datagrams.
+
+    Both ends must enable FEC on the channel; the group size in use is the smaller of the
+    two. FEC is refused toward a peer that did not announce ENET_PEER_FLAG_FEC when connecting,
+    since original ENet takes FEC_CONFIGURE for an unknown command and never acknowledges it. A recovered unreliable packet that is older than one already delivered is still
+    dropped, and a recovered reliable packet is not acknowledged, so the sender retransmits
+    it as usual and the receiver discards the copy. Each enabled channel costs about
+    (2 * groupSize + 1) * MTU bytes of memory for the parity and the receive history.
+
+    @param peer peer whose channel to configure
+    @param channelID channel to configure
+    @param groupSize number of commands protected by one parity, 2 to ENET_PEER_FEC_MAXIMUM_GROUP_SIZE, or 0 to disable FEC
+    @retval 0 on success
+    @retval < 0 on failure
+*/
+int
+enet_peer_set_channel_fec (ENetPeer * peer, enet_uint8 channelID, enet_uint8 groupSize)
+{
+   ENetChannel * channel;
+   ENetChannelFec * fec = NULL;
+   ENetProtocol command;
+
+   if (peer -> state != ENET_PEER_STATE_CONNECTED ||
+       ! (peer -> flags & ENET_PEER_FLAG_FEC) ||
+       channelID >= peer -> channelCount ||
+       groupSize == 1 ||
+       groupSize > ENET_PEER_FEC_MAXIMUM_GROUP_SIZE)
+     return -1;
+
+   channel = & peer -> channels [channelID];
+
+   if (groupSize > 0)
+   {
+      fec = (ENetChannelFec *) enet_malloc (sizeof (ENetChannelFec) + (2 * groupSize + 1) * peer -> mtu);
+      if (fec == NULL)
+        return -1;
+
+      fec -> localGroupSize = groupSize;
+      fec -> slotSize = peer -> mtu;
+      fec -> parity = (enet_uint8 *) (fec + 1);
+      fec -> historyCount = 2 * groupSize;
+      fec -> historyData = fec -> parity + fec -> slotSize;
+   }
+
+   command.header.command = ENET_PROTOCOL_COMMAND_FEC_CONFIGURE | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
+   command.header.channelID = 0xFF;
+   command.fecConfigure.channelID = channelID;
+   command.fecConfigure.groupSize = groupSize;
+
+   if (enet_peer_queue_outgoing_command (peer, & command, NULL, 0, 0) == NULL)
+   {
+      if (fec != NULL)
+        enet_free (fec);
+
+      return -1;
+   }
+
+   if (channel -> fec != NULL)
+   {
+      enet_free (channel -> fec);
+
+      -- peer -> fecChannels;
+   }
+
+   channel -> fec = fec;
+
+   if (fec != NULL)
+   {
+      enet_peer_reset_fec (channel);
+
+      ++ peer -> fecChannels;
+   }
+
+   return 0;
+}
+
+/** Gives back the window space of a stream chunk once ENet no longer holds it, that is once it
+    has been acknowledged or its peer has been reset.
+*/
+static void ENET_CALLBACK
+enet_peer_stream_chunk_free (ENetPacket * packet)
+{
+   ENetStream * stream = (ENetStream *) packet -> userData;
+
+   -- stream -> queuedChunks;
+   stream -> queuedLength -= packet -> dataLength - 1;
+}
+
+/** Returns how many more bytes of data a stream may queue before its unacknowledged chunks exceed the window of its peer. */
+static size_t
+enet_peer_stream_window (const ENetStream * stream)
+{
+   size_t windowSize = stream -> peer -> windowSize;
+
+   return windowSize > stream -> queuedLength ? windowSize - stream -> queuedLength : 0;
+}
+
+/** Queues one chunk of a stream. The first byte of the packet is reserved for its ENetProtocolStreamFlag
+    byte, the rest is stream data. The packet is destroyed on failure.
+    @retval 0 on success
+    @retval < 0 on failure
+*/
+static int
+enet_peer_stream_send_chunk (ENetStream * stream, ENetPacket * packet, enet_uint8 streamFlags)
+{
+   if (! (stream -> flags & ENET_STREAM_FLAG_STARTED))
+     streamFlags |= ENET_PROTOCOL_STREAM_FLAG_START;
+
+   packet -> data [0] = streamFlags;
+   packet -> userData = stream;
+   packet -> freeCallback = enet_peer_stream_chunk_free;
+
+   ++ stream -> queuedChunks;
+   stream -> queuedLength += packet -> dataLength - 1;
+
+   if (enet_peer_queue_send_command (stream -> peer, stream -> channelID, packet, ENET_PROTOCOL_COMMAND_FLAG_STREAM) == NULL)
+   {
+      enet_packet_destroy (packet);
+
+      return -1;
+   }
+
+   stream -> flags |= ENET_STREAM_FLAG_STARTED;
+   stream -> sentLength += packet -> dataLength - 1;
+
+   if (streamFlags & ENET_PROTOCOL_STREAM_FLAG_END)
+     stream -> flags |= ENET_STREAM_FLAG_ENDED;
+
+   return 0;
+}
+
+/** Queues the empty chunk that ends a closing stream; enet_peer_pump_streams() retries if that fails. */
+static void
+enet_peer_stream_end (ENetStream * stream)
+{
+   ENetPacket * packet = enet_packet_create (NULL, 1, ENET_PACKET_FLAG_RELIABLE);
+
+   if (packet != NULL)
+     enet_peer_stream_send_chunk (stream, packet, ENET_PROTOCOL_STREAM_FLAG_END);
+}
+
+/** Opens an outgoing stream on a channel of a peer.
+
+    A stream carries a message of any length as a series of reliable chunks of at most one MTU,
+    which the receiver gets in order as ENET_EVENT_TYPE_RECEIVE events with ENET_PACKET_FLAG_STREAM
+    set, the first one with ENET_PACKET_FLAG_STREAM_START and a last empty one with
+    ENET_PACKET_FLAG_STREAM_END. Chunks are only queued while the data of the unacknowledged ones
+    fits in the window of the peer, so neither side ever holds the whole message in memory.
+
+    With a read callback, ENet pulls the data from it whenever enet_host_service() or enet_host_flush()
+    finds room in the window, and ends the stream once it returns 0. Without one, the application pushes
+    the data with enet_peer_stream_write() and ends the stream with enet_peer_stream_close(). ENet frees
+    the stream once its last chunk has been acknowledged, or when the peer is reset, so the application
+    must not use it after it has ended. Only one stream may be open per channel, and other reliable
+    packets sent on the channel are delivered between its chunks. Streams can only be opened to peers
+    that announced ENET_PEER_FLAG_STREAM when connecting, since original ENet would deliver each
+    chunk with its leading flags byte.
+
+    @param peer peer to stream to
+    @param channelID reliable channel carrying the stream
+    @param read callback producing the data of the stream, or NULL to use enet_peer_stream_write()
+    @param data application data stored in the stream
+    @returns the stream on success, NULL if the peer is not connected or does not support streams, the channel is invalid or already has an open stream
+*/
+ENetStream *
+enet_peer_stream_open (ENetPeer * peer, enet_uint8 channelID, ENetStreamReadCallback read, void * data)
+{
+   ENetListIterator currentStream;
+   ENetStream * stream;
+
+   if (peer -> state != ENET_PEER_STATE_CONNECTED ||
+       ! (peer -> flags & ENET_PEER_FLAG_STREAM) ||
+       channelID >= peer -> channelCount)
+     return NULL;
+
+   for (currentStream = enet_list_begin (& peer -> streams);
+        currentStream != enet_list_end (& peer -> streams);
+        currentStream = enet_list_next (currentStream))
+   {
+      stream = (ENetStream *) currentStream;
+
+      if (stream -> channelID == channelID && ! (stream -> flags & ENET_STREAM_FLAG_ENDED))
+        return NULL;
+   }
+
+   stream = (ENetStream *) enet_malloc (sizeof (ENetStream));
+   if (stream == NULL)
+     return NULL;
+
+   stream -> peer = peer;
+   stream -> channelID = channelID;
+   stream -> flags = 0;
+   stream -> read = read;
+   stream -> data = data;
+   stream -> queuedChunks = 0;
+   stream -> queuedLength = 0;
+   stream -> sentLength = 0;
+
+   enet_list_insert (enet_list_end (& peer -> streams), stream);
+
+   return stream;
+}
+
+/** Queues data on a stream opened without a read callback.
+
+    Only as much data as fits in the window of the peer is accepted; the application should offer
+    the rest again after the next call to enet_host_service().
+
+    @param stream stream to write to
+    @param data data to send
+    @param dataLength length of the data
+    @returns the number of bytes accepted, possibly 0 if the window is full, or < 0 on failure
+*/
+int
+enet_peer_stream_write (ENetStream * stream, const void * data, size_t dataLength)
+{
+   size_t chunkLength = enet_peer_fragment_length (stream -> peer) - 1,
+          windowLength = enet_peer_stream_window (stream),
+          writtenLength = 0;
+
+   if (stream -> read != NULL ||
+       (stream -> flags & ENET_STREAM_FLAG_CLOSING) ||
+       stream -> peer -> state != ENET_PEER_STATE_CONNECTED)
+     return -1;
+
+   if (dataLength > windowLength)
+     dataLength = windowLength;
+
+   while (writtenLength < dataLength)
+   {
+      size_t length = ENET_MIN (chunkLength, dataLength - writtenLength);
+      ENetPacket * packet = enet_packet_create (NULL, 1 + length, ENET_PACKET_FLAG_RELIABLE);
+
+      if (packet == NULL)
+        break;
+
+      memcpy (packet -> data + 1, (const enet_uint8 *) data + writtenLength, length);
+
+      if (enet_peer_stream_send_chunk (stream, packet, 0) < 0)
+        break;
+
+      writtenLength += length;
+   }
+
+   if (writtenLength == 0 && dataLength > 0)
+     return -1;
+
+   return (int) writtenLength;
+}
+
+/** Closes a stream. Data already queued is still delivered, followed by the end of the stream; a
+    read callback is not called anymore. The stream is freed by ENet afterwards and must not be used
+    anymore.
+    @param stream stream to close
+    @retval 0 on success
+    @retval < 0 if the stream was already closed
+*/
+int
+enet_peer_stream_close (ENetStream * stream)
+{
+   if (stream -> flags & ENET_STREAM_FLAG_CLOSING)
+     return -1;
+
+   stream -> flags |= ENET_STREAM_FLAG_CLOSING;
+
+   if (stream -> peer -> state == ENET_PEER_STATE_CONNECTED)
+     enet_peer_stream_end (stream);
+
+   return 0;
+}
+
+/** Refills the window of the streams of a peer from their read callbacks, ends the closing ones
+    and frees those whose every chunk has been acknowledged.
+*/
+void
+enet_peer_pump_streams (ENetPeer * peer)
+{
+   ENetListIterator currentStream = enet_list_begin (& peer -> streams);
+   size_t chunkLength = enet_peer_fragment_length (peer) - 1;
+
+   while (currentStream != enet_list_end (& peer -> streams))
+   {
+      ENetStream * stream = (ENetStream *) currentStream;
+
+      currentStream = enet_list_next (currentStream);
+
+      if (stream -> flags & ENET_STREAM_FLAG_ENDED)
+      {
+         if (stream -> queuedChunks == 0)
+         {
+            enet_list_remove (& stream -> streamList);
+
+            enet_free (stream);
+         }
+
+         continue;
+      }
+
+      if (peer -> state != ENET_PEER_STATE_CONNECTED)
+        continue;
+
+      while (stream -> read != NULL &&
+             ! (stream -> flags & ENET_STREAM_FLAG_CLOSING) &&
+             enet_peer_stream_window (stream) >= chunkLength)
+      {
+         ENetPacket * packet = enet_packet_create (NULL, 1 + chunkLength, ENET_PACKET_FLAG_RELIABLE);
+         size_t length;
+
+         if (packet == NULL)
+           break;
+
+         length = stream -> read (stream, packet -> data + 1, chunkLength);
+         if (length == 0)
+         {
+            enet_packet_destroy (packet);
+
+            stream -> flags |= ENET_STREAM_FLAG_CLOSING;
+            break;
+         }
+
+         packet -> dataLength = 1 + ENET_MIN (length, chunkLength);
+
+         if (enet_peer_stream_send_chunk (stream, packet, 0) < 0)
+           break;
+      }
+
+      if (stream -> flags & ENET_STREAM_FLAG_CLOSING)
+        enet_peer_stream_end (stream);
+   }
+}
+
+/** Extracts the next message of an aggregated incoming command as a packet of its own.
+    @returns the message, or NULL if the command is exhausted or malformed
+*/
+static ENetPacket *
+enet_peer_receive_aggregated (ENetIncomingCommand * incomingCommand)
+{
+   const ENetPacket * aggregate = incomingCommand -> packet;
+   size_t offset = incomingCommand -> aggregateOffset,
+          dataLength = 0;
+   int shift;
+
+   for (shift = 0;; shift += 7)
+   {
+      if (offset >= aggregate -> dataLength || shift > 14)
+        return NULL;
+
+      dataLength |= (size_t) (aggregate -> data [offset] & 0x7F) << shift;
+
+      if (! (aggregate -> data [offset ++] & 0x80))
+        break;
+   }
+
+   if (dataLength > aggregate -> dataLength - offset)
+     return NULL;
+
+   incomingCommand -> aggregateOffset = (enet_uint32) (offset + dataLength);
+
+   return enet_packet_create (aggregate -> data + offset, dataLength, aggregate -> flags);
+}
+
+/** Attempts to dequeue any incoming queued packet.
+    @param peer peer to dequeue packets from
+    @param channelID holds the channel ID of the channel the packet was received on success
+    @returns a pointer to the packet, or NULL if there are no available incoming queued packets
+*/
+ENetPacket *
+enet_peer_receive (ENetPeer * peer, enet_uint8 * channelID)
+{
+   ENetIncomingCommand * incomingCommand;
+   ENetPacket * packet;
+   
+   for (;;)
+   {
+      if (enet_list_empty (& peer -> dispatchedCommands))
+        return NULL;
+
+      incomingCommand = (ENetIncomingCommand *) enet_list_front (& peer -> dispatchedCommands);
+
+      if (! (incomingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_AGGREGATE))
+        break;
+
+      if (channelID != NULL)
+        * channelID = incomingCommand -> command.header.channelID;
+
+      /* The aggregate stays at the front of the queue until its last message is handed out. */
+      packet = enet_peer_receive_aggregated (incomingCommand);
+      if (packet != NULL && incomingCommand -> aggregateOffset < incomingCommand -> packet -> dataLength)
+        return packet;
+
+      enet_peer_remove_incoming_commands (peer, & peer -> dispatchedCommands, & incomingCommand -> incomingCommandList, enet_list_next (& incomingCommand -> incomingCommandList), NULL);
+
+      if (packet != NULL)
+        return packet;
+   }
+
+   incomingCommand = (ENetIncomingCommand *) enet_list_remove (enet_list_begin (& peer -> dispatchedCommands));
+
+   if (channelID != NULL)
+     * channelID = incomingCommand -> command.header.channelID;
+
+   packet = incomingCommand -> packet;
+
+   -- packet -> referenceCount;
+
+   enet_free (incomingCommand);
+
+   peer -> totalWaitingData -= ENET_MIN (peer -> totalWaitingData, packet -> dataLength);
+
+   return packet;
+}
+
+static void
 enet_peer_reset_outgoing_commands (ENetPeer * peer, ENetList * queue)
 {
     ENetOutgoingCommand * outgoingCommand;
@@ -268,15 +1350,102 @@ enet_peer_reset_outgoing_commands (ENetPeer * peer, ENetList * queue)
     {
        outgoingCommand = (ENetOutgoingCommand *) enet_list_remove (enet_list_begin (queue));
 
-       if (outgoingCommand -> packet != NULL)
+       if (outgoingCommand -> packet != NULL)
+       {
+          -- outgoingCommand -> packet -> referenceCount;
+
+          if (outgoingCommand -> packet -> referenceCount == 0)
+            enet_packet_destroy (outgoingCommand -> packet);
+       }
+
+       enet_host_release_outgoing_command (peer -> host, outgoingCommand);
+    }
+}
+
+static ENetIncomingCommand **
+enet_peer_fragment_bucket (ENetPeer * peer, enet_uint8 channelID, enet_uint16 reliableSequenceNumber, enet_uint16 unreliableSequenceNumber)
+{
+    enet_uint32 key = (((enet_uint32) reliableSequenceNumber << 16) | unreliableSequenceNumber) ^ ((enet_uint32) channelID << 8);
+
+    return & peer -> fragmentBuckets [((key * 2654435761U) >> 16) & (ENET_PEER_FRAGMENT_BUCKETS - 1)];
+}
+
+/** Looks up the fragmented packet being reassembled on a channel.
+
+    Fragmented commands are indexed by their channel, command and sequence numbers from the
+    time they are queued on their channel until they leave it, so that each fragment finds
+    its start command without walking the channel's incoming queue.
+
+    @param peer the peer the fragments were received from
+    @param channelID channel of the fragments
+    @param commandNumber ENET_PROTOCOL_COMMAND_SEND_FRAGMENT or ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT
+    @param reliableSequenceNumber reliable sequence number of the start command, in host order
+    @param unreliableSequenceNumber unreliable sequence number of the start command, 0 for reliable fragments
+    @returns the start command, or NULL if no fragment of the packet was queued yet
+*/
+ENetIncomingCommand *
+enet_peer_find_incoming_fragments (ENetPeer * peer, enet_uint8 channelID, enet_uint8 commandNumber, enet_uint16 reliableSequenceNumber, enet_uint16 unreliableSequenceNumber)
+{
+    ENetIncomingCommand * incomingCommand;
+
+    if (peer -> fragmentBuckets == NULL)
+      return NULL;
+
+    for (incomingCommand = * enet_peer_fragment_bucket (peer, channelID, reliableSequenceNumber, unreliableSequenceNumber);
+         incomingCommand != NULL;
+         incomingCommand = incomingCommand -> fragmentNext)
+    {
+       if (incomingCommand -> reliableSequenceNumber == reliableSequenceNumber &&
+           incomingCommand -> unreliableSequenceNumber == unreliableSequenceNumber &&
+           incomingCommand -> command.header.channelID == channelID &&
+           (incomingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) == commandNumber)
+         return incomingCommand;
+    }
+
+    return NULL;
+}
+
+static int
+enet_peer_index_incoming_fragments (ENetPeer * peer, ENetIncomingCommand * incomingCommand)
+{
+    ENetIncomingCommand ** bucket;
+
+    if (peer -> fragmentBuckets == NULL)
+    {
+       peer -> fragmentBuckets = (ENetIncomingCommand **) enet_malloc (ENET_PEER_FRAGMENT_BUCKETS * sizeof (ENetIncomingCommand *));
+       if (peer -> fragmentBuckets == NULL)
+         return -1;
+
+       memset (peer -> fragmentBuckets, 0, ENET_PEER_FRAGMENT_BUCKETS * sizeof (ENetIncomingCommand *));
+    }
+
+    bucket = enet_peer_fragment_bucket (peer, incomingCommand -> command.header.channelID, incomingCommand -> reliableSequenceNumber, incomingCommand -> unreliableSequenceNumber);
+
+    incomingCommand -> fragmentNext = * bucket;
+    * bucket = incomingCommand;
+
+    return 0;
+}
+
+/** Removes a fragmented command from the reassembly index once it leaves its channel; does nothing if it already did. */
+static void
+enet_peer_unindex_incoming_fragments (ENetPeer * peer, ENetIncomingCommand * incomingCommand)
+{
+    ENetIncomingCommand ** bucket;
+
+    if (incomingCommand -> fragmentCount <= 0 || peer -> fragmentBuckets == NULL)
+      return;
+
+    for (bucket = enet_peer_fragment_bucket (peer, incomingCommand -> command.header.channelID, incomingCommand -> reliableSequenceNumber, incomingCommand -> unreliableSequenceNumber);
+         * bucket != NULL;
+         bucket = & (* bucket) -> fragmentNext)
+    {
+       if (* bucket == incomingCommand)
        {
-          -- outgoingCommand -> packet -> referenceCount;
-
-          if (outgoingCommand -> packet -> referenceCount == 0)
-            enet_packet_destroy (outgoingCommand -> packet);
+          * bucket = incomingCommand -> fragmentNext;
+          incomingCommand -> fragmentNext = NULL;
+          break;
        }
-
-       enet_free (outgoingCommand);
     }
 }
 
@@ -295,6 +1464,8 @@ enet_peer_remove_incoming_commands (ENetPeer * peer, ENetList * queue, ENetListI
          continue;
 
        enet_list_remove (& incomingCommand -> incomingCommandList);
+
+       enet_peer_unindex_incoming_fragments (peer, incomingCommand);
  
        if (incomingCommand -> packet != NULL)
        {
@@ -306,9 +1477,6 @@ enet_peer_remove_incoming_commands (ENetPeer * peer, ENetList * queue, ENetListI
             enet_packet_destroy (incomingCommand -> packet);
        }
 
-       if (incomingCommand -> fragments != NULL)
-         enet_free (incomingCommand -> fragments);
-
        enet_free (incomingCommand);
     }
 }
@@ -339,6 +1507,10 @@ enet_peer_reset_queues (ENetPeer * peer)
     enet_peer_reset_outgoing_commands (peer, & peer -> outgoingSendReliableCommands);
     enet_peer_reset_incoming_commands (peer, & peer -> dispatchedCommands);
 
+    /* The chunks of the streams have just been released, and with them the last references to the streams. */
+    while (! enet_list_empty (& peer -> streams))
+      enet_free (enet_list_remove (enet_list_begin (& peer -> streams)));
+
     if (peer -> channels != NULL && peer -> channelCount > 0)
     {
         for (channel = peer -> channels;
@@ -347,11 +1519,36 @@ enet_peer_reset_queues (ENetPeer * peer)
         {
             enet_peer_reset_incoming_commands (peer, & channel -> incomingReliableCommands);
             enet_peer_reset_incoming_commands (peer, & channel -> incomingUnreliableCommands);
+            enet_peer_reset_aggregate (peer, channel);
+
+            if (channel -> fec != NULL)
+              enet_free (channel -> fec);
+
+            if (channel -> supersedeSlots != NULL)
+              enet_free (channel -> supersedeSlots);
+
+            if (channel -> sentReliableRing != NULL)
+              enet_free (channel -> sentReliableRing);
+
+            if (channel -> incomingReliableRing != NULL)
+              enet_free (channel -> incomingReliableRing);
         }
 
-        enet_free (peer -> channels);
+        enet_host_release_channels (peer -> host, peer -> channels);
+    }
+
+    if (peer -> fragmentBuckets != NULL)
+    {
+        enet_free (peer -> fragmentBuckets);
+
+        peer -> fragmentBuckets = NULL;
     }
 
+    peer -> aggregatingChannels = 0;
+    peer -> fecChannels = 0;
+    peer -> scheduledChannels = 0;
+    peer -> scheduleClock = 0;
+
     peer -> channels = NULL;
     peer -> channelCount = 0;
 }
@@ -364,7 +1561,8 @@ enet_peer_on_connect (ENetPeer * peer)
         if (peer -> incomingBandwidth != 0)
           ++ peer -> host -> bandwidthLimitedPeers;
 
-        ++ peer -> host -> connectedPeers;
+        peer -> connectedPeerIndex = peer -> host -> connectedPeers;
+        peer -> host -> connectedPeerList [peer -> host -> connectedPeers ++] = peer;
     }
 }
 
@@ -376,7 +1574,14 @@ enet_peer_on_disconnect (ENetPeer * peer)
         if (peer -> incomingBandwidth != 0)
           -- peer -> host -> bandwidthLimitedPeers;
 
-        -- peer -> host -> connectedPeers;
+        /* Swap the last connected peer into this one's slot to keep the list dense. */
+        if (-- peer -> host -> connectedPeers > peer -> connectedPeerIndex)
+        {
+            ENetPeer * lastPeer = peer -> host -> connectedPeerList [peer -> host -> connectedPeers];
+
+            lastPeer -> connectedPeerIndex = peer -> connectedPeerIndex;
+            peer -> host -> connectedPeerList [peer -> connectedPeerIndex] = lastPeer;
+        }
     }
 }
 
@@ -393,6 +1598,12 @@ enet_peer_reset (ENetPeer * peer)
     peer -> outgoingPeerID = ENET_PROTOCOL_MAXIMUM_PEER_ID;
     peer -> connectID = 0;
 
+    if (peer -> state != ENET_PEER_STATE_DISCONNECTED)
+    {
+       ENET_TRACE_CLOCK (peer -> host);
+       ENET_TRACE (peer -> host, ENET_TRACE_EVENT_STATE, peer, ENET_PEER_STATE_DISCONNECTED, peer -> state, 0);
+    }
+
     peer -> state = ENET_PEER_STATE_DISCONNECTED;
 
     peer -> incomingBandwidth = 0;
@@ -431,11 +1642,34 @@ enet_peer_reset (ENetPeer * peer)
     peer -> reliableDataInTransit = 0;
     peer -> outgoingReliableSequenceNumber = 0;
     peer -> windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+    peer -> windowLimit = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
     peer -> incomingUnsequencedGroup = 0;
     peer -> outgoingUnsequencedGroup = 0;
     peer -> eventData = 0;
     peer -> totalWaitingData = 0;
     peer -> flags = 0;
+    peer -> coalesceTimeout = 0;
+    peer -> coalesceDeadline = 0;
+    peer -> coalescedCommands = 0;
+    peer -> coalescedDataLength = 0;
+    peer -> datagramsSent = 0;
+    peer -> datagramFill = 0;
+    peer -> fastRetransmitThreshold = ENET_PEER_FAST_RETRANSMIT_THRESHOLD;
+    peer -> fastRetransmitDatagram = 0;
+    peer -> totalSentData = 0;
+    peer -> totalReceivedData = 0;
+    peer -> totalReceivedDatagrams = 0;
+    peer -> retransmits = 0;
+    peer -> fastRetransmits = 0;
+    peer -> spuriousRetransmits = 0;
+    peer -> expiredPackets = 0;
+    peer -> supersededPackets = 0;
+
+    if (peer -> histograms != NULL)
+    {
+       enet_free (peer -> histograms);
+       peer -> histograms = NULL;
+    }
 
     memset (peer -> unsequencedWindow, 0, sizeof (peer -> unsequencedWindow));
     
@@ -478,6 +1712,237 @@ enet_peer_ping_interval (ENetPeer * peer, enet_uint32 pingInterval)
     peer -> pingInterval = pingInterval ? pingInterval : ENET_PEER_PING_INTERVAL;
 }
 
+/** Sets how long queued commands may be held back to fill a datagram before being sent to a peer.
+
+    While coalescing is enabled, commands queued since the last datagram sent to the peer are
+    held by enet_host_service and enet_host_flush until they fill 7/8 of the MTU or
+    ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS commands, until timeout microseconds have elapsed
+    since the first of them was queued, until enet_peer_flush is called, or until a datagram
+    leaves for the peer anyway, for instance to carry acknowledgements or a ping. The deadline
+    is checked whenever the host is serviced or flushed.
+
+    @param peer the peer to adjust
+    @param timeout maximum time in microseconds commands are held; 0 disables coalescing
+*/
+void
+enet_peer_set_coalescing (ENetPeer * peer, enet_uint32 timeout)
+{
+    peer -> coalesceTimeout = timeout;
+    peer -> coalescedCommands = 0;
+    peer -> coalescedDataLength = 0;
+}
+
+/** Sends any queued commands to a peer immediately, including those held back by coalescing.
+    @param peer the peer to flush
+    @remarks like enet_host_flush, this also sends queued commands to the other peers of the
+    host that are not held back by coalescing
+*/
+void
+enet_peer_flush (ENetPeer * peer)
+{
+    peer -> flags |= ENET_PEER_FLAG_FLUSH;
+
+    enet_host_flush (peer -> host);
+}
+
+/** Sets how many later datagrams must be acknowledged before an unacknowledged reliable command is resent.
+
+    Without fast retransmit a lost reliable command is only resent once its round trip timeout
+    expires, which stalls its channel for at least the mean round trip time plus four times its
+    variance. With it, the command is queued again as soon as acknowledgements have arrived for
+    threshold datagrams sent after it, which tolerates that many datagrams being reordered on the
+    way. Acknowledgements only count when they are for a datagram sent after every datagram
+    counted so far, so an acknowledgement overtaken by a later one counts for nothing. Fast
+    retransmits do not back off the round trip timeout of the command. The number of
+    them, and of those that turned out to be unnecessary because the original was acknowledged
+    after all, are kept in fastRetransmits and spuriousRetransmits.
+
+    @param peer the peer to adjust
+    @param threshold number of later datagrams acknowledged; 0 disables fast retransmit.
+    Defaults to ENET_PEER_FAST_RETRANSMIT_THRESHOLD.
+*/
+void
+enet_peer_set_fast_retransmit (ENetPeer * peer, enet_uint32 threshold)
+{
+    peer -> fastRetransmitThreshold = threshold;
+}
+
+/** Enables or disables the histograms of a peer.
+
+    The peer then keeps ENET_HISTOGRAM_COUNT histograms of fixed size, read with
+    enet_peer_get_histogram: the round trip time of each acknowledgement received, the time each
+    command waited between being queued and first sent, the time from queueing to acknowledgement
+    of each reliable command carrying data, and the time taken to receive all the fragments of a
+    fragmented packet. Their percentiles are read with enet_histogram_percentile, and the
+    histograms of several peers can be added together with enet_histogram_merge. The histograms
+    are freed when the peer is reset, so they only cover the current connection; the histograms of
+    the host, enabled with enet_host_set_histograms, gather the measures of all its peers. They
+    are enabled once the connection is started, for instance on the peer returned by
+    enet_host_connect or on receiving ENET_EVENT_TYPE_CONNECT.
+
+    @param peer the peer to adjust
+    @param enabled nonzero to enable the histograms, empty ones if they were disabled; 0 to disable
+    them and free their memory
+    @retval 0 on success
+    @retval < 0 if the peer is disconnected or the histograms could not be allocated
+*/
+int
+enet_peer_set_histograms (ENetPeer * peer, int enabled)
+{
+    if (! enabled)
+    {
+       if (peer -> histograms != NULL)
+       {
+          enet_free (peer -> histograms);
+          peer -> histograms = NULL;
+       }
+
+       return 0;
+    }
+
+    if (peer -> histograms != NULL)
+      return 0;
+
+    if (peer -> state == ENET_PEER_STATE_DISCONNECTED)
+      return -1;
+
+    peer -> histograms = (ENetHistogram *) enet_malloc (ENET_HISTOGRAM_COUNT * sizeof (ENetHistogram));
+    if (peer -> histograms == NULL)
+      return -1;
+
+    memset (peer -> histograms, 0, ENET_HISTOGRAM_COUNT * sizeof (ENetHistogram));
+
+    return 0;
+}
+
+/** Sets the sending priority and weight of a channel of a peer.
+
+    Commands queued on a channel of higher priority are sent before those of channels of lower
+    priority, including the remaining fragments of a large packet already being sent. Channels of
+    the same priority share the bandwidth in proportion to their weights, in the order of a
+    self-clocked weighted fair queue. As long as every channel keeps priority 0 and weight
+    ENET_PEER_DEFAULT_CHANNEL_WEIGHT, commands are sent in the order they were queued. The new
+    settings apply to the commands queued from now on; the reliable window still applies to all
+    reliable data, so a prioritized reliable command may have to wait for acknowledgements.
+
+    @param peer peer whose channel to configure
+    @param channelID channel to configure
+    @param priority priority of the channel, higher goes first; defaults to 0
+    @param weight share of the channel among the channels of the same priority, from 1 to 255;
+    defaults to ENET_PEER_DEFAULT_CHANNEL_WEIGHT
+    @retval 0 on success
+    @retval < 0 if the channel does not exist or the weight is 0
+*/
+int
+enet_peer_set_channel_priority (ENetPeer * peer, enet_uint8 channelID, enet_uint8 priority, enet_uint8 weight)
+{
+    ENetChannel * channel;
+
+    if (channelID >= peer -> channelCount || weight == 0)
+      return -1;
+
+    channel = & peer -> channels [channelID];
+
+    if (channel -> priority != 0 || channel -> weight != ENET_PEER_DEFAULT_CHANNEL_WEIGHT)
+      -- peer -> scheduledChannels;
+
+    channel -> priority = priority;
+    channel -> weight = weight;
+
+    if (channel -> priority != 0 || channel -> weight != ENET_PEER_DEFAULT_CHANNEL_WEIGHT)
+      ++ peer -> scheduledChannels;
+
+    return 0;
+}
+
+/** Sets how long packets queued on a channel of a peer may wait to be sent.
+
+    An unreliable or unsequenced packet still queued when its time to live has elapsed is
+    dropped from the send loop instead of being sent, fragments included. With expireReliable, a
+    reliable packet none of whose fragments has been sent yet is cancelled as well: each of its
+    commands is replaced by an empty aggregate, which keeps the reliable sequence of the channel
+    intact and which the receiver acknowledges and skips without delivering anything. Since
+    only a receiver that decodes aggregated commands skips it, reliable packets are cancelled
+    only toward peers that announced aggregation support when connecting; toward the original
+    ENet they are always delivered. Packets sent through streams or on a channel with FEC
+    enabled are never cancelled. Dropped and cancelled packets are counted in expiredPackets.
+
+    @param peer peer whose channel to configure
+    @param channelID channel to configure
+    @param timeToLive time to live in milliseconds of the packets queued from now on, 0 for none
+    @param expireReliable nonzero to cancel expired reliable packets as well
+    @retval 0 on success
+    @retval < 0 if the channel does not exist
+*/
+int
+enet_peer_set_channel_time_to_live (ENetPeer * peer, enet_uint8 channelID, enet_uint32 timeToLive, int expireReliable)
+{
+    ENetChannel * channel;
+
+    if (channelID >= peer -> channelCount)
+      return -1;
+
+    channel = & peer -> channels [channelID];
+    channel -> timeToLive = timeToLive;
+    channel -> expireReliable = expireReliable != 0;
+
+    return 0;
+}
+
+/** Enables or disables superseding on a channel.
+
+    Packets sent with enet_peer_send_superseding on a superseding channel replace the unsent
+    packet of the same key instead of queuing behind it. The keys are indexed in a table of
+    at least twice keyCount slots, so finding the packet to replace takes constant time; two
+    keys that share a slot only lose the ability to supersede each other, their packets are
+    still all sent. Packets already queued are kept when the table is resized or removed.
+    Superseded packets are counted in supersededPackets.
+
+    @param peer peer whose channel to configure
+    @param channelID channel to configure
+    @param keyCount number of distinct keys expected to be in flight at once, 0 to disable superseding
+    @retval 0 on success
+    @retval < 0 if the channel does not exist, keyCount is too large or the table could not be allocated
+*/
+int
+enet_peer_set_channel_superseding (ENetPeer * peer, enet_uint8 channelID, size_t keyCount)
+{
+    ENetChannel * channel;
+    ENetOutgoingCommand ** supersedeSlots = NULL;
+    size_t supersedeSlotCount = 0, slot;
+
+    if (channelID >= peer -> channelCount ||
+        keyCount > ENET_PEER_MAXIMUM_SUPERSEDE_SLOTS / 2)
+      return -1;
+
+    channel = & peer -> channels [channelID];
+
+    if (keyCount > 0)
+    {
+        for (supersedeSlotCount = 1; supersedeSlotCount < keyCount * 2; supersedeSlotCount <<= 1);
+
+        supersedeSlots = (ENetOutgoingCommand **) enet_malloc (supersedeSlotCount * sizeof (ENetOutgoingCommand *));
+        if (supersedeSlots == NULL)
+          return -1;
+
+        memset (supersedeSlots, 0, supersedeSlotCount * sizeof (ENetOutgoingCommand *));
+    }
+
+    if (channel -> supersedeSlots != NULL)
+    {
+        for (slot = 0; slot < channel -> supersedeSlotCount; ++ slot)
+          if (channel -> supersedeSlots [slot] != NULL)
+            channel -> supersedeSlots [slot] -> supersedeSlot = NULL;
+
+        enet_free (channel -> supersedeSlots);
+    }
+
+    channel -> supersedeSlots = supersedeSlots;
+    channel -> supersedeSlotCount = supersedeSlotCount;
+
+    return 0;
+}
+
 /** Sets the timeout parameters for a peer.
 
     The timeout parameter control how and when a peer will timeout from a failure to acknowledge
@@ -529,7 +1994,7 @@ enet_peer_disconnect_now (ENetPeer * peer, enet_uint32 data)
 
         enet_peer_queue_outgoing_command (peer, & command, NULL, 0, 0);
 
-        enet_host_flush (peer -> host);
+        enet_peer_flush (peer);
     }
 
     enet_peer_reset (peer);
@@ -569,11 +2034,13 @@ enet_peer_disconnect (ENetPeer * peer, enet_uint32 data)
     {
         enet_peer_on_disconnect (peer);
 
+        ENET_TRACE_CLOCK (peer -> host);
+        ENET_TRACE (peer -> host, ENET_TRACE_EVENT_STATE, peer, ENET_PEER_STATE_DISCONNECTING, peer -> state, 0);
         peer -> state = ENET_PEER_STATE_DISCONNECTING;
     }
     else
     {
-        enet_host_flush (peer -> host);
+        enet_peer_flush (peer);
         enet_peer_reset (peer);
     }
 }
@@ -583,7 +2050,8 @@ enet_peer_has_outgoing_commands (ENetPeer * peer)
 {
   if (enet_list_empty (& peer -> outgoingCommands) &&
       enet_list_empty (& peer -> outgoingSendReliableCommands) &&
-      enet_list_empty (& peer -> sentReliableCommands))
+      enet_list_empty (& peer -> sentReliableCommands) &&
+      peer -> aggregatingChannels == 0)
     return 0;
 
   return 1;
@@ -601,6 +2069,8 @@ enet_peer_disconnect_later (ENetPeer * peer, enet_uint32 data)
     if ((peer -> state == ENET_PEER_STATE_CONNECTED || peer -> state == ENET_PEER_STATE_DISCONNECT_LATER) && 
         enet_peer_has_outgoing_commands (peer))
     {
+        ENET_TRACE_CLOCK (peer -> host);
+        ENET_TRACE (peer -> host, ENET_TRACE_EVENT_STATE, peer, ENET_PEER_STATE_DISCONNECT_LATER, peer -> state, 0);
         peer -> state = ENET_PEER_STATE_DISCONNECT_LATER;
         peer -> eventData = data;
     }
@@ -630,6 +2100,8 @@ enet_peer_queue_acknowledgement (ENetPeer * peer, const ENetProtocol * command,
     if (acknowledgement == NULL)
       return NULL;
 
+    ++ peer -> host -> stats.allocations;
+
     peer -> outgoingDataTotal += sizeof (ENetProtocolAcknowledge);
 
     acknowledgement -> sentTime = sentTime;
@@ -640,8 +2112,70 @@ enet_peer_queue_acknowledgement (ENetPeer * peer, const ENetProtocol * command,
     return acknowledgement;
 }
 
-void
-enet_peer_setup_outgoing_command (ENetPeer * peer, ENetOutgoingCommand * outgoingCommand)
+/** Assigns sequence numbers and queue time to an outgoing command without queueing it. */
+/** Gives a command its place in the self-clocked weighted fair queueing of the peer. Each packet
+    moves the virtual time of its channel forward by its length divided by the channel weight,
+    starting no earlier than the time of the last command sent, and every fragment of a packet
+    shares the time of the first one so that fragment trains stay contiguous in the queues.
+*/
+static void
+enet_peer_schedule_outgoing_command (ENetPeer * peer, ENetOutgoingCommand * outgoingCommand)
+{
+    ENetChannel * channel;
+
+    if (outgoingCommand -> command.header.channelID >= peer -> channelCount)
+    {
+       outgoingCommand -> priority = 0;
+       outgoingCommand -> scheduleTime = peer -> scheduleClock;
+
+       return;
+    }
+
+    channel = & peer -> channels [outgoingCommand -> command.header.channelID];
+
+    if (outgoingCommand -> fragmentOffset == 0)
+    {
+       if (ENET_SCHEDULE_LESS (channel -> scheduleTime, peer -> scheduleClock))
+         channel -> scheduleTime = peer -> scheduleClock;
+
+       channel -> scheduleTime += 1 + (outgoingCommand -> packet != NULL ? outgoingCommand -> packet -> dataLength : 0) / channel -> weight;
+    }
+
+    outgoingCommand -> priority = channel -> priority;
+    outgoingCommand -> scheduleTime = channel -> scheduleTime;
+}
+
+/** Returns the position before which a command is queued in queue. That is the end of the queue,
+    unless some channel of the peer has a priority or weight of its own, in which case the command
+    goes after the last unsent command that has a higher priority or an earlier or equal virtual time.
+    Commands that are being resent stay at the front.
+*/
+static ENetListIterator
+enet_peer_schedule_position (ENetPeer * peer, ENetList * queue, const ENetOutgoingCommand * outgoingCommand)
+{
+    ENetListIterator position = enet_list_end (queue);
+
+    if (peer -> scheduledChannels == 0)
+      return position;
+
+    while (position != enet_list_begin (queue))
+    {
+       const ENetOutgoingCommand * previousCommand = (const ENetOutgoingCommand *) enet_list_previous (position);
+
+       if (previousCommand -> sendAttempts > 0 ||
+           previousCommand -> priority > outgoingCommand -> priority ||
+           (previousCommand -> priority == outgoingCommand -> priority &&
+             ! ENET_SCHEDULE_LESS (outgoingCommand -> scheduleTime, previousCommand -> scheduleTime)))
+         break;
+
+       position = enet_list_previous (position);
+    }
+
+    return position;
+}
+
+static void
+enet_peer_prepare_outgoing_command (ENetPeer * peer, ENetOutgoingCommand * outgoingCommand)
 {
     peer -> outgoingDataTotal += enet_protocol_command_size (outgoingCommand -> command.header.command) + outgoingCommand -> fragmentLength;
 
@@ -653,6 +2187,12 @@ enet_peer_setup_outgoing_command (ENetPeer * peer, ENetOutgoingCommand * outgoin
        outgoingCommand -> unreliableSequenceNumber = 0;
     }
     else
+    if ((outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) == ENET_PROTOCOL_COMMAND_SEND_PARITY)
+    {
+       outgoingCommand -> reliableSequenceNumber = 0;
+       outgoingCommand -> unreliableSequenceNumber = 0;
+    }
+    else
     {
         ENetChannel * channel = & peer -> channels [outgoingCommand -> command.header.channelID];
 
@@ -682,11 +2222,43 @@ enet_peer_setup_outgoing_command (ENetPeer * peer, ENetOutgoingCommand * outgoin
         }
     }
 
+    if (peer -> coalesceTimeout != 0)
+    {
+       if (peer -> coalescedCommands == 0)
+         peer -> coalesceDeadline = enet_time_get_us () + peer -> coalesceTimeout;
+
+       ++ peer -> coalescedCommands;
+       peer -> coalescedDataLength += enet_protocol_command_size (outgoingCommand -> command.header.command) + outgoingCommand -> fragmentLength;
+    }
+
     outgoingCommand -> sendAttempts = 0;
     outgoingCommand -> sentTime = 0;
     outgoingCommand -> roundTripTimeout = 0;
+    outgoingCommand -> gapAcknowledgements = 0;
+    outgoingCommand -> fastRetransmitted = 0;
+    outgoingCommand -> inTransit = 0;
     outgoingCommand -> command.header.reliableSequenceNumber = ENET_HOST_TO_NET_16 (outgoingCommand -> reliableSequenceNumber);
     outgoingCommand -> queueTime = ++ peer -> host -> totalQueued;
+    outgoingCommand -> queuedTime = peer -> histograms != NULL || peer -> host -> histograms != NULL ? ENET_MAX (enet_time_get (), 1) : 0;
+
+    ENET_TRACE (peer -> host, ENET_TRACE_EVENT_COMMAND_QUEUE, peer, outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK,
+                (enet_uint32) outgoingCommand -> command.header.channelID << 16 | outgoingCommand -> reliableSequenceNumber, outgoingCommand -> fragmentLength);
+
+    enet_peer_schedule_outgoing_command (peer, outgoingCommand);
+
+    outgoingCommand -> expireTime = 0;
+
+    if (outgoingCommand -> command.header.channelID < peer -> channelCount &&
+        (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) != ENET_PROTOCOL_COMMAND_SEND_PARITY)
+    {
+        ENetChannel * channel = & peer -> channels [outgoingCommand -> command.header.channelID];
+
+        /* Stream chunks never expire, a hole in a stream could not be told apart from its data. */
+        if (channel -> timeToLive != 0 &&
+            (! (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE) ||
+              (channel -> expireReliable && ! (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_STREAM))))
+          outgoingCommand -> expireTime = enet_time_get () + channel -> timeToLive;
+    }
 
     switch (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK)
     {
@@ -701,18 +2273,24 @@ enet_peer_setup_outgoing_command (ENetPeer * peer, ENetOutgoingCommand * outgoin
     default:
         break;
     }
+}
+
+void
+enet_peer_setup_outgoing_command (ENetPeer * peer, ENetOutgoingCommand * outgoingCommand)
+{
+    enet_peer_prepare_outgoing_command (peer, outgoingCommand);
 
     if ((outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE) != 0 &&
         outgoingCommand -> packet != NULL)
-      enet_list_insert (enet_list_end (& peer -> outgoingSendReliableCommands), outgoingCommand);
+      enet_list_insert (enet_peer_schedule_position (peer, & peer -> outgoingSendReliableCommands, outgoingCommand), outgoingCommand);
     else
-      enet_list_insert (enet_list_end (& peer -> outgoingCommands), outgoingCommand);
+      enet_list_insert (enet_peer_schedule_position (peer, & peer -> outgoingCommands, outgoingCommand), outgoingCommand);
 }
 
 ENetOutgoingCommand *
 enet_peer_queue_outgoing_command (ENetPeer * peer, const ENetProtocol * command, ENetPacket * packet, enet_uint32 offset, enet_uint16 length)
 {
-    ENetOutgoingCommand * outgoingCommand = (ENetOutgoingCommand *) enet_malloc (sizeof (ENetOutgoingCommand));
+    ENetOutgoingCommand * outgoingCommand = enet_host_allocate_outgoing_command (peer -> host);
     if (outgoingCommand == NULL)
       return NULL;
 
@@ -728,6 +2306,48 @@ enet_peer_queue_outgoing_command (ENetPeer * peer, const ENetProtocol * command,
     return outgoingCommand;
 }
 
+/** Makes room in the incoming reliable ring of a channel for a reliable sequence number. The
+    ring doubles until the sequence numbers waiting on the channel fall in distinct slots; the
+    reliable windows accepted ahead of incomingReliableSequenceNumber bound its size.
+    @returns 0 on success, < 0 if the ring could not be allocated
+*/
+static int
+enet_peer_reserve_incoming_reliable_slot (ENetChannel * channel, enet_uint16 reliableSequenceNumber)
+{
+    ENetIncomingCommand ** incomingReliableRing;
+    size_t incomingReliableRingSize, slot;
+
+    if (channel -> incomingReliableRing == NULL)
+    {
+       channel -> incomingReliableRing = (ENetIncomingCommand **) enet_malloc (ENET_PEER_RELIABLE_RING_SIZE * sizeof (ENetIncomingCommand *));
+       if (channel -> incomingReliableRing == NULL)
+         return -1;
+
+       memset (channel -> incomingReliableRing, 0, ENET_PEER_RELIABLE_RING_SIZE * sizeof (ENetIncomingCommand *));
+       channel -> incomingReliableRingSize = ENET_PEER_RELIABLE_RING_SIZE;
+    }
+
+    while (channel -> incomingReliableRing [reliableSequenceNumber & (channel -> incomingReliableRingSize - 1)] != NULL)
+    {
+       incomingReliableRingSize = channel -> incomingReliableRingSize * 2;
+       incomingReliableRing = (ENetIncomingCommand **) enet_malloc (incomingReliableRingSize * sizeof (ENetIncomingCommand *));
+       if (incomingReliableRing == NULL)
+         return -1;
+
+       memset (incomingReliableRing, 0, incomingReliableRingSize * sizeof (ENetIncomingCommand *));
+
+       for (slot = 0; slot < channel -> incomingReliableRingSize; ++ slot)
+         if (channel -> incomingReliableRing [slot] != NULL)
+           incomingReliableRing [channel -> incomingReliableRing [slot] -> reliableSequenceNumber & (incomingReliableRingSize - 1)] = channel -> incomingReliableRing [slot];
+
+       enet_free (channel -> incomingReliableRing);
+       channel -> incomingReliableRing = incomingReliableRing;
+       channel -> incomingReliableRingSize = incomingReliableRingSize;
+    }
+
+    return 0;
+}
+
 void
 enet_peer_dispatch_incoming_unreliable_commands (ENetPeer * peer, ENetChannel * channel, ENetIncomingCommand * queuedCommand)
 {
@@ -747,6 +2367,7 @@ enet_peer_dispatch_incoming_unreliable_commands (ENetPeer * peer, ENetChannel *
           if (incomingCommand -> fragmentsRemaining <= 0)
           {
              channel -> incomingUnreliableSequenceNumber = incomingCommand -> unreliableSequenceNumber;
+             enet_peer_unindex_incoming_fragments (peer, incomingCommand);
              continue;
           }
 
@@ -814,31 +2435,44 @@ enet_peer_dispatch_incoming_unreliable_commands (ENetPeer * peer, ENetChannel *
 void
 enet_peer_dispatch_incoming_reliable_commands (ENetPeer * peer, ENetChannel * channel, ENetIncomingCommand * queuedCommand)
 {
-    ENetListIterator currentCommand;
+    ENetIncomingCommand * incomingCommand;
+    int dispatched = 0;
 
-    for (currentCommand = enet_list_begin (& channel -> incomingReliableCommands);
-         currentCommand != enet_list_end (& channel -> incomingReliableCommands);
-         currentCommand = enet_list_next (currentCommand))
+    if (channel -> incomingReliableRing == NULL)
+      return;
+
+    for (;;)
     {
-       ENetIncomingCommand * incomingCommand = (ENetIncomingCommand *) currentCommand;
-         
-       if (incomingCommand -> fragmentsRemaining > 0 ||
-           incomingCommand -> reliableSequenceNumber != (enet_uint16) (channel -> incomingReliableSequenceNumber + 1))
+       enet_uint16 reliableSequenceNumber = (enet_uint16) (channel -> incomingReliableSequenceNumber + 1);
+       ENetIncomingCommand ** slot = & channel -> incomingReliableRing [reliableSequenceNumber & (channel -> incomingReliableRingSize - 1)];
+
+       incomingCommand = * slot;
+       if (incomingCommand == NULL ||
+           incomingCommand -> reliableSequenceNumber != reliableSequenceNumber ||
+           incomingCommand -> fragmentsRemaining > 0)
          break;
 
-       channel -> incomingReliableSequenceNumber = incomingCommand -> reliableSequenceNumber;
+       * slot = NULL;
+
+       channel -> incomingReliableSequenceNumber = reliableSequenceNumber;
 
        if (incomingCommand -> fragmentCount > 0)
-         channel -> incomingReliableSequenceNumber += incomingCommand -> fragmentCount - 1;
-    } 
+       {
+          channel -> incomingReliableSequenceNumber += incomingCommand -> fragmentCount - 1;
+
+          enet_peer_unindex_incoming_fragments (peer, incomingCommand);
+       }
 
-    if (currentCommand == enet_list_begin (& channel -> incomingReliableCommands))
+       enet_list_move (enet_list_end (& peer -> dispatchedCommands), incomingCommand, incomingCommand);
+
+       dispatched = 1;
+    }
+
+    if (! dispatched)
       return;
 
     channel -> incomingUnreliableSequenceNumber = 0;
 
-    enet_list_move (enet_list_end (& peer -> dispatchedCommands), enet_list_begin (& channel -> incomingReliableCommands), enet_list_previous (currentCommand));
-
     if (! (peer -> flags & ENET_PEER_FLAG_NEEDS_DISPATCH))
     {
        enet_list_insert (enet_list_end (& peer -> host -> dispatchQueue), & peer -> dispatchList);
@@ -875,7 +2509,11 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
            reliableWindow += ENET_PEER_RELIABLE_WINDOWS;
 
         if (reliableWindow < currentWindow || reliableWindow >= currentWindow + ENET_PEER_FREE_RELIABLE_WINDOWS - 1)
-          goto discardCommand;
+        {
+           ++ peer -> host -> stats.drops [ENET_DROP_REASON_WINDOW];
+
+           goto discardCommand;
+        }
     }
                     
     switch (command -> header.command & ENET_PROTOCOL_COMMAND_MASK)
@@ -883,31 +2521,20 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
     case ENET_PROTOCOL_COMMAND_SEND_FRAGMENT:
     case ENET_PROTOCOL_COMMAND_SEND_RELIABLE:
        if (reliableSequenceNumber == channel -> incomingReliableSequenceNumber)
-         goto discardCommand;
-       
-       for (currentCommand = enet_list_previous (enet_list_end (& channel -> incomingReliableCommands));
-            currentCommand != enet_list_end (& channel -> incomingReliableCommands);
-            currentCommand = enet_list_previous (currentCommand))
-       {
-          incomingCommand = (ENetIncomingCommand *) currentCommand;
+         goto duplicateCommand;
 
-          if (reliableSequenceNumber >= channel -> incomingReliableSequenceNumber)
-          {
-             if (incomingCommand -> reliableSequenceNumber < channel -> incomingReliableSequenceNumber)
-               continue;
-          }
-          else
-          if (incomingCommand -> reliableSequenceNumber >= channel -> incomingReliableSequenceNumber)
-            break;
+       if (channel -> incomingReliableRing != NULL)
+       {
+          incomingCommand = channel -> incomingReliableRing [reliableSequenceNumber & (channel -> incomingReliableRingSize - 1)];
+          if (incomingCommand != NULL && incomingCommand -> reliableSequenceNumber == reliableSequenceNumber)
+            goto duplicateCommand;
+       }
 
-          if (incomingCommand -> reliableSequenceNumber <= reliableSequenceNumber)
-          {
-             if (incomingCommand -> reliableSequenceNumber < reliableSequenceNumber)
-               break;
+       if (enet_peer_reserve_incoming_reliable_slot (channel, (enet_uint16) reliableSequenceNumber) < 0)
+         goto notifyError;
 
-             goto discardCommand;
-          }
-       }
+       /* The ring keeps the sequence order, so the list only holds the commands in arrival order. */
+       currentCommand = enet_list_previous (enet_list_end (& channel -> incomingReliableCommands));
        break;
 
     case ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE:
@@ -916,7 +2543,7 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
 
        if (reliableSequenceNumber == channel -> incomingReliableSequenceNumber && 
            unreliableSequenceNumber <= channel -> incomingUnreliableSequenceNumber)
-         goto discardCommand;
+         goto duplicateCommand;
 
        for (currentCommand = enet_list_previous (enet_list_end (& channel -> incomingUnreliableCommands));
             currentCommand != enet_list_end (& channel -> incomingUnreliableCommands);
@@ -947,7 +2574,7 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
              if (incomingCommand -> unreliableSequenceNumber < unreliableSequenceNumber)
                break;
 
-             goto discardCommand;
+             goto duplicateCommand;
           }
        }
        break;
@@ -961,16 +2588,41 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
     }
 
     if (peer -> totalWaitingData >= peer -> host -> maximumWaitingData)
+    {
+       ++ peer -> host -> stats.drops [ENET_DROP_REASON_WAITING_DATA];
+
+       goto notifyError;
+    }
+
+    if (fragmentCount > ENET_PROTOCOL_MAXIMUM_FRAGMENT_COUNT)
       goto notifyError;
 
-    packet = enet_packet_create (data, dataLength, flags);
+    if (fragmentCount > 0 && peer -> host -> reassembly != NULL)
+    {
+       packet = peer -> host -> reassembly (peer, command -> header.channelID, dataLength, flags);
+
+       /* A packet that does not fit, or that something still references, is left to the
+          application untouched, and the fragments are reassembled in a packet of ENet's own. */
+       if (packet != NULL && (packet -> dataLength != dataLength || packet -> data == NULL || packet -> referenceCount > 0))
+         packet = NULL;
+    }
+
     if (packet == NULL)
-      goto notifyError;
+    {
+       packet = enet_packet_create (data, dataLength, flags);
+       if (packet == NULL)
+         goto notifyError;
+
+       ++ peer -> host -> stats.allocations;
+    }
 
-    incomingCommand = (ENetIncomingCommand *) enet_malloc (sizeof (ENetIncomingCommand));
+    /* The bitmap of received fragments is allocated along with the command. */
+    incomingCommand = (ENetIncomingCommand *) enet_malloc (sizeof (ENetIncomingCommand) + (fragmentCount + 31) / 32 * sizeof (enet_uint32));
     if (incomingCommand == NULL)
       goto notifyError;
 
+    ++ peer -> host -> stats.allocations;
+
     incomingCommand -> reliableSequenceNumber = command -> header.reliableSequenceNumber;
     incomingCommand -> unreliableSequenceNumber = unreliableSequenceNumber & 0xFFFF;
     incomingCommand -> command = * command;
@@ -978,17 +2630,20 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
     incomingCommand -> fragmentsRemaining = fragmentCount;
     incomingCommand -> packet = packet;
     incomingCommand -> fragments = NULL;
+    incomingCommand -> aggregateOffset = 0;
+    incomingCommand -> fragmentNext = NULL;
+    incomingCommand -> receivedTime = peer -> host -> serviceTime;
     
     if (fragmentCount > 0)
     { 
-       if (fragmentCount <= ENET_PROTOCOL_MAXIMUM_FRAGMENT_COUNT)
-         incomingCommand -> fragments = (enet_uint32 *) enet_malloc ((fragmentCount + 31) / 32 * sizeof (enet_uint32));
-       if (incomingCommand -> fragments == NULL)
+       if (enet_peer_index_incoming_fragments (peer, incomingCommand) < 0)
        {
           enet_free (incomingCommand);
 
           goto notifyError;
        }
+
+       incomingCommand -> fragments = (enet_uint32 *) (incomingCommand + 1);
        memset (incomingCommand -> fragments, 0, (fragmentCount + 31) / 32 * sizeof (enet_uint32));
     }
 
@@ -1005,6 +2660,8 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
     {
     case ENET_PROTOCOL_COMMAND_SEND_FRAGMENT:
     case ENET_PROTOCOL_COMMAND_SEND_RELIABLE:
+       channel -> incomingReliableRing [reliableSequenceNumber & (channel -> incomingReliableRingSize - 1)] = incomingCommand;
+
        enet_peer_dispatch_incoming_reliable_commands (peer, channel, incomingCommand);
        break;
 
@@ -1015,6 +2672,9 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
 
     return incomingCommand;
 
+duplicateCommand:
+    ++ peer -> host -> stats.drops [ENET_DROP_REASON_DUPLICATE];
+
 discardCommand:
     if (fragmentCount > 0)
       goto notifyError;
@@ -1071,6 +2731,56 @@ float enet_peer_get_packets_throttle(const ENetPeer* peer) {
   return peer->packetThrottle / (float)ENET_PEER_PACKET_THROTTLE_SCALE * 100.0f;
 }
 
+float enet_peer_get_datagram_fill_ratio(const ENetPeer* peer) {
+  return peer->datagramFill / (float)ENET_PEER_PACKET_LOSS_SCALE;
+}
+
+enet_uint32 enet_peer_get_fast_retransmits(const ENetPeer* peer) {
+  return peer->fastRetransmits;
+}
+
+enet_uint32 enet_peer_get_spurious_retransmits(const ENetPeer* peer) {
+  return peer->spuriousRetransmits;
+}
+
+enet_uint32 enet_peer_get_expired_packets(const ENetPeer* peer) {
+  return peer->expiredPackets;
+}
+
+enet_uint32 enet_peer_get_superseded_packets(const ENetPeer* peer) {
+  return peer->supersededPackets;
+}
+
+void enet_peer_get_stats(const ENetPeer* peer, ENetPeerStats* stats) {
+  stats->sentData = peer->totalSentData;
+  stats->receivedData = peer->totalReceivedData;
+  stats->sentDatagrams = peer->datagramsSent;
+  stats->receivedDatagrams = peer->totalReceivedDatagrams;
+  stats->retransmits = peer->retransmits;
+  stats->fastRetransmits = peer->fastRetransmits;
+  stats->spuriousRetransmits = peer->spuriousRetransmits;
+  stats->expiredPackets = peer->expiredPackets;
+  stats->supersededPackets = peer->supersededPackets;
+  stats->roundTripTime = peer->roundTripTime;
+  stats->roundTripTimeVariance = peer->roundTripTimeVariance;
+  stats->lastRoundTripTime = peer->lastRoundTripTime;
+  stats->lowestRoundTripTime = peer->lowestRoundTripTime;
+  stats->packetLoss = peer->packetLoss;
+  stats->packetLossVariance = peer->packetLossVariance;
+  stats->packetThrottle = peer->packetThrottle;
+  stats->mtu = peer->mtu;
+  stats->windowSize = peer->windowSize;
+  stats->reliableDataInTransit = peer->reliableDataInTransit;
+  stats->totalWaitingData = peer->totalWaitingData;
+}
+
+const ENetHistogram* enet_peer_get_histogram(const ENetPeer* peer, ENetHistogramKind kind) {
+  if (peer->histograms == NULL || kind >= ENET_HISTOGRAM_COUNT)
+    return NULL;
+
+  return &peer->histograms[kind];
+}
+
 void* enet_peer_get_data(const ENetPeer* peer) {
   return (void*)peer->data;
 }
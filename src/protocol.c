@@ -23,7 +23,9 @@ static const size_t commandSizes [ENET_PROTOCOL_COMMAND_COUNT] =
     sizeof (ENetProtocolSendUnsequenced),
     sizeof (ENetProtocolBandwidthLimit),
     sizeof (ENetProtocolThrottleConfigure),
-    sizeof (ENetProtocolSendFragment)
+    sizeof (ENetProtocolSendFragment),
+    sizeof (ENetProtocolFecConfigure),
+    sizeof (ENetProtocolSendParity)
 };
 
 size_t
@@ -32,9 +34,22 @@ enet_protocol_command_size (enet_uint8 commandNumber)
     return commandSizes [commandNumber & ENET_PROTOCOL_COMMAND_MASK];
 }
 
+/** Counts a measure in the histograms of the peer and of its host, those that are enabled. */
+static void
+enet_protocol_record_histogram (ENetHost * host, ENetPeer * peer, ENetHistogramKind kind, enet_uint32 value)
+{
+    if (peer -> histograms != NULL)
+      enet_histogram_record (& peer -> histograms [kind], value);
+
+    if (host -> histograms != NULL)
+      enet_histogram_record (& host -> histograms [kind], value);
+}
+
 static void
 enet_protocol_change_state (ENetHost * host, ENetPeer * peer, ENetPeerState state)
 {
+    ENET_TRACE (host, ENET_TRACE_EVENT_STATE, peer, state, peer -> state, 0);
+
     if (state == ENET_PEER_STATE_CONNECTED || state == ENET_PEER_STATE_DISCONNECT_LATER)
       enet_peer_on_connect (peer);
     else
@@ -209,7 +224,7 @@ enet_protocol_remove_sent_unreliable_commands (ENetPeer * peer, ENetList * sentU
            }
         }
 
-        enet_free (outgoingCommand);
+        enet_host_release_outgoing_command (peer -> host, outgoingCommand);
     } while (! enet_list_empty (sentUnreliableCommands));
 
     if (peer -> state == ENET_PEER_STATE_DISCONNECT_LATER &&
@@ -217,6 +232,57 @@ enet_protocol_remove_sent_unreliable_commands (ENetPeer * peer, ENetList * sentU
       enet_peer_disconnect (peer, peer -> eventData);
 }
 
+/** Indexes a reliable command of a channel by its sequence number when it is sent for the first
+    time. The ring doubles until the sequence numbers in flight on the channel fall in distinct
+    slots, which the reliable windows bound to a fraction of the sequence space. If it cannot be
+    allocated, the acknowledgements of the channel are searched in the lists of the peer again
+    until its commands in flight are all acknowledged and a new ring can start empty.
+*/
+static void
+enet_protocol_index_sent_reliable_command (ENetChannel * channel, ENetOutgoingCommand * outgoingCommand)
+{
+    ENetOutgoingCommand ** sentReliableRing;
+    size_t sentReliableRingSize, slot;
+
+    if (channel -> sentReliableRing == NULL)
+    {
+       if (channel -> usedReliableWindows != 0)
+         return;
+
+       channel -> sentReliableRing = (ENetOutgoingCommand **) enet_malloc (ENET_PEER_RELIABLE_RING_SIZE * sizeof (ENetOutgoingCommand *));
+       if (channel -> sentReliableRing == NULL)
+         return;
+
+       memset (channel -> sentReliableRing, 0, ENET_PEER_RELIABLE_RING_SIZE * sizeof (ENetOutgoingCommand *));
+       channel -> sentReliableRingSize = ENET_PEER_RELIABLE_RING_SIZE;
+    }
+
+    while (channel -> sentReliableRing [outgoingCommand -> reliableSequenceNumber & (channel -> sentReliableRingSize - 1)] != NULL)
+    {
+       sentReliableRingSize = channel -> sentReliableRingSize * 2;
+       sentReliableRing = (ENetOutgoingCommand **) enet_malloc (sentReliableRingSize * sizeof (ENetOutgoingCommand *));
+       if (sentReliableRing == NULL)
+       {
+          enet_free (channel -> sentReliableRing);
+          channel -> sentReliableRing = NULL;
+          channel -> sentReliableRingSize = 0;
+          return;
+       }
+
+       memset (sentReliableRing, 0, sentReliableRingSize * sizeof (ENetOutgoingCommand *));
+
+       for (slot = 0; slot < channel -> sentReliableRingSize; ++ slot)
+         if (channel -> sentReliableRing [slot] != NULL)
+           sentReliableRing [channel -> sentReliableRing [slot] -> reliableSequenceNumber & (sentReliableRingSize - 1)] = channel -> sentReliableRing [slot];
+
+       enet_free (channel -> sentReliableRing);
+       channel -> sentReliableRing = sentReliableRing;
+       channel -> sentReliableRingSize = sentReliableRingSize;
+    }
+
+    channel -> sentReliableRing [outgoingCommand -> reliableSequenceNumber & (channel -> sentReliableRingSize - 1)] = outgoingCommand;
+}
+
 static ENetOutgoingCommand *
 enet_protocol_find_sent_reliable_command (ENetList * list, enet_uint16 reliableSequenceNumber, enet_uint8 channelID)
 {
@@ -242,36 +308,122 @@ enet_protocol_find_sent_reliable_command (ENetList * list, enet_uint16 reliableS
     return NULL;
 }
 
+/** Counts the acknowledgement of a command as a gap for every unacknowledged command sent in an
+    earlier datagram, and queues again those that reached the fast retransmit threshold.
+
+    sentReliableCommands is in sending order, so the commands preceding the acknowledged one were
+    sent in earlier datagrams, or in the same datagram for the last few of them. Only the first
+    acknowledgement of a datagram newer than all those counted so far gets here, so each datagram
+    is counted once, and the commands walked are the unacknowledged ones, which leave the list at
+    the latest after fastRetransmitThreshold walks.
+*/
+static void
+enet_protocol_fast_retransmit (ENetPeer * peer, const ENetOutgoingCommand * acknowledgedCommand)
+{
+    ENetOutgoingCommand * outgoingCommand;
+    ENetListIterator currentCommand, insertPosition, insertSendReliablePosition;
+
+    peer -> fastRetransmitDatagram = acknowledgedCommand -> sentDatagram;
+
+    currentCommand = enet_list_begin (& peer -> sentReliableCommands);
+    insertPosition = enet_list_begin (& peer -> outgoingCommands);
+    insertSendReliablePosition = enet_list_begin (& peer -> outgoingSendReliableCommands);
+
+    while (currentCommand != & acknowledgedCommand -> outgoingCommandList)
+    {
+       outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+
+       if (outgoingCommand -> sentDatagram == acknowledgedCommand -> sentDatagram)
+         break;
+
+       currentCommand = enet_list_next (currentCommand);
+
+       if (++ outgoingCommand -> gapAcknowledgements < peer -> fastRetransmitThreshold)
+         continue;
+
+       ++ peer -> packetsLost;
+       ++ peer -> fastRetransmits;
+       ++ peer -> host -> stats.fastRetransmits;
+
+       ENET_TRACE (peer -> host, ENET_TRACE_EVENT_RETRANSMIT, peer, 1,
+                   (enet_uint32) outgoingCommand -> command.header.channelID << 16 | outgoingCommand -> reliableSequenceNumber, outgoingCommand -> sendAttempts);
+
+       outgoingCommand -> gapAcknowledgements = 0;
+       outgoingCommand -> fastRetransmitted = 1;
+       outgoingCommand -> inTransit = 0;
+
+       if (outgoingCommand -> packet != NULL)
+       {
+         peer -> reliableDataInTransit -= outgoingCommand -> fragmentLength;
+
+         enet_list_insert (insertSendReliablePosition, enet_list_remove (& outgoingCommand -> outgoingCommandList));
+       }
+       else
+         enet_list_insert (insertPosition, enet_list_remove (& outgoingCommand -> outgoingCommandList));
+    }
+}
+
 static ENetProtocolCommand
-enet_protocol_remove_sent_reliable_command (ENetPeer * peer, enet_uint16 reliableSequenceNumber, enet_uint8 channelID)
+enet_protocol_remove_sent_reliable_command (ENetPeer * peer, enet_uint16 reliableSequenceNumber, enet_uint8 channelID, enet_uint16 receivedSentTime)
 {
     ENetOutgoingCommand * outgoingCommand = NULL;
     ENetListIterator currentCommand;
     ENetProtocolCommand commandNumber;
     int wasSent = 1;
 
-    for (currentCommand = enet_list_begin (& peer -> sentReliableCommands);
-         currentCommand != enet_list_end (& peer -> sentReliableCommands);
-         currentCommand = enet_list_next (currentCommand))
+    if (channelID < peer -> channelCount && peer -> channels [channelID].sentReliableRing != NULL)
     {
-       outgoingCommand = (ENetOutgoingCommand *) currentCommand;
-        
-       if (outgoingCommand -> reliableSequenceNumber == reliableSequenceNumber &&
-           outgoingCommand -> command.header.channelID == channelID)
-         break;
-    }
+       ENetChannel * channel = & peer -> channels [channelID];
+       ENetOutgoingCommand ** slot = & channel -> sentReliableRing [reliableSequenceNumber & (channel -> sentReliableRingSize - 1)];
 
-    if (currentCommand == enet_list_end (& peer -> sentReliableCommands))
+       outgoingCommand = * slot;
+       if (outgoingCommand == NULL || outgoingCommand -> reliableSequenceNumber != reliableSequenceNumber)
+         return ENET_PROTOCOL_COMMAND_NONE;
+
+       * slot = NULL;
+       wasSent = outgoingCommand -> inTransit;
+    }
+    else
     {
-       outgoingCommand = enet_protocol_find_sent_reliable_command (& peer -> outgoingCommands, reliableSequenceNumber, channelID);
+       for (currentCommand = enet_list_begin (& peer -> sentReliableCommands);
+            currentCommand != enet_list_end (& peer -> sentReliableCommands);
+            currentCommand = enet_list_next (currentCommand))
+       {
+          outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+
+          if (outgoingCommand -> reliableSequenceNumber == reliableSequenceNumber &&
+              outgoingCommand -> command.header.channelID == channelID)
+            break;
+       }
+
+       if (currentCommand == enet_list_end (& peer -> sentReliableCommands))
+       {
+          outgoingCommand = enet_protocol_find_sent_reliable_command (& peer -> outgoingCommands, reliableSequenceNumber, channelID);
+          if (outgoingCommand == NULL)
+            outgoingCommand = enet_protocol_find_sent_reliable_command (& peer -> outgoingSendReliableCommands, reliableSequenceNumber, channelID);
+
+          wasSent = 0;
+       }
+
        if (outgoingCommand == NULL)
-         outgoingCommand = enet_protocol_find_sent_reliable_command (& peer -> outgoingSendReliableCommands, reliableSequenceNumber, channelID);
+         return ENET_PROTOCOL_COMMAND_NONE;
+    }
 
-       wasSent = 0;
+    /* An acknowledgement echoing another sent time than the latest one is for the transmission
+       preceding the fast retransmit, or the retransmit has not even left yet. */
+    if (outgoingCommand -> fastRetransmitted &&
+        (! wasSent || (outgoingCommand -> sentTime & 0xFFFF) != receivedSentTime))
+    {
+      ++ peer -> spuriousRetransmits;
+      ++ peer -> host -> stats.spuriousRetransmits;
     }
 
-    if (outgoingCommand == NULL)
-      return ENET_PROTOCOL_COMMAND_NONE;
+    /* Only an acknowledgement of the latest transmission says which datagram got through. */
+    if (wasSent &&
+        peer -> fastRetransmitThreshold > 0 &&
+        (outgoingCommand -> sentTime & 0xFFFF) == receivedSentTime &&
+        ENET_SCHEDULE_LESS (peer -> fastRetransmitDatagram, outgoingCommand -> sentDatagram))
+      enet_protocol_fast_retransmit (peer, outgoingCommand);
 
     if (channelID < peer -> channelCount)
     {
@@ -291,6 +443,10 @@ enet_protocol_remove_sent_reliable_command (ENetPeer * peer, enet_uint16 reliabl
 
     if (outgoingCommand -> packet != NULL)
     {
+       if (outgoingCommand -> queuedTime != 0)
+         enet_protocol_record_histogram (peer -> host, peer, ENET_HISTOGRAM_DELIVERY_LATENCY,
+                                         ENET_TIME_DIFFERENCE (peer -> host -> serviceTime, outgoingCommand -> queuedTime));
+
        if (wasSent)
        {
           peer->reliableDataInTransit -= outgoingCommand->fragmentLength;
@@ -310,7 +466,7 @@ enet_protocol_remove_sent_reliable_command (ENetPeer * peer, enet_uint16 reliabl
        }
     }
 
-    enet_free (outgoingCommand);
+    enet_host_release_outgoing_command (peer -> host, outgoingCommand);
 
     if (enet_list_empty (& peer -> sentReliableCommands))
       return commandNumber;
@@ -339,7 +495,7 @@ enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENet
       return NULL;
 
     for (currentPeer = host -> peers;
-         currentPeer < & host -> peers [host -> peerCount];
+         currentPeer < & host -> peers [host -> committedPeers];
          ++ currentPeer)
     {
         if (currentPeer -> state == ENET_PEER_STATE_DISCONNECTED)
@@ -359,15 +515,26 @@ enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENet
         }
     }
 
-    if (peer == NULL || duplicatePeers >= host -> duplicatePeers)
+    if (duplicatePeers >= host -> duplicatePeers)
       return NULL;
 
+    if (peer == NULL)
+    {
+        if (host -> committedPeers >= host -> peerCount)
+          return NULL;
+
+        peer = & host -> peers [host -> committedPeers];
+        if (enet_host_commit_peers (host, host -> committedPeers + 1) < 0)
+          return NULL;
+    }
+
     if (channelCount > host -> channelLimit)
       channelCount = host -> channelLimit;
-    peer -> channels = (ENetChannel *) enet_malloc (channelCount * sizeof (ENetChannel));
+    peer -> channels = enet_host_acquire_channels (host, channelCount);
     if (peer -> channels == NULL)
       return NULL;
     peer -> channelCount = channelCount;
+    ENET_TRACE (host, ENET_TRACE_EVENT_STATE, peer, ENET_PEER_STATE_ACKNOWLEDGING_CONNECT, peer -> state, 0);
     peer -> state = ENET_PEER_STATE_ACKNOWLEDGING_CONNECT;
     peer -> connectID = command -> connect.connectID;
     peer -> address = host -> receivedAddress;
@@ -380,6 +547,14 @@ enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENet
     peer -> packetThrottleDeceleration = ENET_NET_TO_HOST_32 (command -> connect.packetThrottleDeceleration);
     peer -> eventData = ENET_NET_TO_HOST_32 (command -> connect.data);
 
+    /* Original ENet never sets these bits, so aggregated commands, FEC and streams only go to peers that announced them. */
+    if (command -> header.command & ENET_PROTOCOL_COMMAND_FLAG_AGGREGATE)
+      peer -> flags |= ENET_PEER_FLAG_AGGREGATE;
+    if (command -> header.command & ENET_PROTOCOL_COMMAND_FLAG_FEC)
+      peer -> flags |= ENET_PEER_FLAG_FEC;
+    if (command -> header.command & ENET_PROTOCOL_COMMAND_FLAG_STREAM)
+      peer -> flags |= ENET_PEER_FLAG_STREAM;
+
     incomingSessionID = command -> connect.incomingSessionID == 0xFF ? peer -> outgoingSessionID : command -> connect.incomingSessionID;
     incomingSessionID = (incomingSessionID + 1) & (ENET_PROTOCOL_HEADER_SESSION_MASK >> ENET_PROTOCOL_HEADER_SESSION_SHIFT);
     if (incomingSessionID == peer -> outgoingSessionID)
@@ -406,6 +581,26 @@ enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENet
 
         channel -> usedReliableWindows = 0;
         memset (channel -> reliableWindows, 0, sizeof (channel -> reliableWindows));
+
+        enet_list_clear (& channel -> aggregateCommands);
+        channel -> aggregateLength = 0;
+        channel -> aggregateFlags = 0;
+        channel -> aggregateTimeout = 0;
+        channel -> aggregateDeadline = 0;
+        channel -> aggregation = 0;
+        channel -> fec = NULL;
+        channel -> fecRemoteGroupSize = 0;
+        channel -> priority = 0;
+        channel -> weight = ENET_PEER_DEFAULT_CHANNEL_WEIGHT;
+        channel -> scheduleTime = 0;
+        channel -> timeToLive = 0;
+        channel -> expireReliable = 0;
+        channel -> supersedeSlots = NULL;
+        channel -> supersedeSlotCount = 0;
+        channel -> sentReliableRing = NULL;
+        channel -> sentReliableRingSize = 0;
+        channel -> incomingReliableRing = NULL;
+        channel -> incomingReliableRingSize = 0;
     }
 
     mtu = ENET_NET_TO_HOST_32 (command -> connect.mtu);
@@ -419,9 +614,14 @@ enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENet
     if (mtu < peer -> mtu)
       peer -> mtu = mtu;
 
+    /* A window above ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE is only proposed by a peer that scales its window too. */
+    peer -> windowLimit = ENET_MIN (host -> windowLimit, ENET_NET_TO_HOST_32 (command -> connect.windowSize));
+    if (peer -> windowLimit < ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE)
+      peer -> windowLimit = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+
     if (host -> outgoingBandwidth == 0 &&
         peer -> incomingBandwidth == 0)
-      peer -> windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+      peer -> windowSize = peer -> windowLimit;
     else
     if (host -> outgoingBandwidth == 0 ||
         peer -> incomingBandwidth == 0)
@@ -436,11 +636,11 @@ enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENet
     if (peer -> windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE)
       peer -> windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
     else
-    if (peer -> windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE)
-      peer -> windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+    if (peer -> windowSize > peer -> windowLimit)
+      peer -> windowSize = peer -> windowLimit;
 
     if (host -> incomingBandwidth == 0)
-      windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+      windowSize = peer -> windowLimit;
     else
       windowSize = (host -> incomingBandwidth / ENET_PEER_WINDOW_SIZE_SCALE) *
                      ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
@@ -451,10 +651,10 @@ enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENet
     if (windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE)
       windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
     else
-    if (windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE)
-      windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+    if (windowSize > peer -> windowLimit)
+      windowSize = peer -> windowLimit;
 
-    verifyCommand.header.command = ENET_PROTOCOL_COMMAND_VERIFY_CONNECT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
+    verifyCommand.header.command = ENET_PROTOCOL_COMMAND_VERIFY_CONNECT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE | ENET_PROTOCOL_COMMAND_FLAG_AGGREGATE | ENET_PROTOCOL_COMMAND_FLAG_FEC | ENET_PROTOCOL_COMMAND_FLAG_STREAM;
     verifyCommand.header.channelID = 0xFF;
     verifyCommand.verifyConnect.outgoingPeerID = ENET_HOST_TO_NET_16 (peer -> incomingPeerID);
     verifyCommand.verifyConnect.incomingSessionID = incomingSessionID;
@@ -474,10 +674,51 @@ enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENet
     return peer;
 }
 
+/** Returns the position of a command in the FEC receive history of a channel, or -1 if it is not there. */
+static int
+enet_protocol_find_fec_command (const ENetChannelFec * fec, const ENetProtocolParityMember * member)
+{
+    size_t index;
+
+    for (index = 0; index < fec -> historyCount; ++ index)
+      if (! memcmp (& fec -> history [index], member, sizeof (ENetProtocolParityMember)))
+        return (int) index;
+
+    return -1;
+}
+
+/** Keeps a copy of a SEND command received on a channel with FEC enabled, so that a later
+    SEND_PARITY can rebuild another command of the same group.
+*/
+static void
+enet_protocol_record_fec_command (ENetPeer * peer, const ENetProtocol * command, enet_uint16 sequenceNumber, const enet_uint8 * data, size_t dataLength)
+{
+    ENetChannelFec * fec = peer -> channels [command -> header.channelID].fec;
+    ENetProtocolParityMember member;
+
+    if (fec == NULL || dataLength > fec -> slotSize)
+      return;
+
+    member.command = command -> header.command;
+    member.reliableSequenceNumber = ENET_HOST_TO_NET_16 (command -> header.reliableSequenceNumber);
+    member.sequenceNumber = sequenceNumber;
+    member.dataLength = ENET_HOST_TO_NET_16 ((enet_uint16) dataLength);
+
+    if (enet_protocol_find_fec_command (fec, & member) >= 0)
+      return;
+
+    fec -> history [fec -> historyNext] = member;
+    memcpy (& fec -> historyData [fec -> historyNext * fec -> slotSize], data, dataLength);
+
+    fec -> historyNext = (fec -> historyNext + 1) % fec -> historyCount;
+}
+
 static int
 enet_protocol_handle_send_reliable (ENetHost * host, ENetPeer * peer, const ENetProtocol * command, enet_uint8 ** currentData)
 {
-    size_t dataLength;
+    const enet_uint8 * data;
+    enet_uint32 flags = ENET_PACKET_FLAG_RELIABLE;
+    size_t dataLength, skip = 0;
 
     if (command -> header.channelID >= peer -> channelCount ||
         (peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER))
@@ -490,9 +731,28 @@ enet_protocol_handle_send_reliable (ENetHost * host, ENetPeer * peer, const ENet
         * currentData > & host -> receivedData [host -> receivedDataLength])
       return -1;
 
-    if (enet_peer_queue_incoming_command (peer, command, (const enet_uint8 *) command + sizeof (ENetProtocolSendReliable), dataLength, ENET_PACKET_FLAG_RELIABLE, 0) == NULL)
+    data = (const enet_uint8 *) command + sizeof (ENetProtocolSendReliable);
+
+    if (command -> header.command & ENET_PROTOCOL_COMMAND_FLAG_STREAM)
+    {
+        /* A stream chunk starts with its ENetProtocolStreamFlag byte, which becomes packet flags. */
+        if (dataLength < 1)
+          return -1;
+
+        flags |= ENET_PACKET_FLAG_STREAM;
+        if (data [0] & ENET_PROTOCOL_STREAM_FLAG_START)
+          flags |= ENET_PACKET_FLAG_STREAM_START;
+        if (data [0] & ENET_PROTOCOL_STREAM_FLAG_END)
+          flags |= ENET_PACKET_FLAG_STREAM_END;
+
+        skip = 1;
+    }
+
+    if (enet_peer_queue_incoming_command (peer, command, data + skip, dataLength - skip, flags, 0) == NULL)
       return -1;
 
+    enet_protocol_record_fec_command (peer, command, 0, data, dataLength);
+
     return 0;
 }
 
@@ -520,7 +780,10 @@ enet_protocol_handle_send_unsequenced (ENetHost * host, ENetPeer * peer, const E
       unsequencedGroup += 0x10000;
 
     if (unsequencedGroup >= (enet_uint32) peer -> incomingUnsequencedGroup + ENET_PEER_FREE_UNSEQUENCED_WINDOWS * ENET_PEER_UNSEQUENCED_WINDOW_SIZE)
+    {
+      ++ host -> stats.drops [ENET_DROP_REASON_WINDOW];
       return 0;
+    }
 
     unsequencedGroup &= 0xFFFF;
 
@@ -532,12 +795,17 @@ enet_protocol_handle_send_unsequenced (ENetHost * host, ENetPeer * peer, const E
     }
     else
     if (peer -> unsequencedWindow [index / 32] & (1u << (index % 32)))
+    {
+      ++ host -> stats.drops [ENET_DROP_REASON_DUPLICATE];
       return 0;
+    }
       
     if (enet_peer_queue_incoming_command (peer, command, (const enet_uint8 *) command + sizeof (ENetProtocolSendUnsequenced), dataLength, ENET_PACKET_FLAG_UNSEQUENCED, 0) == NULL)
       return -1;
    
     peer -> unsequencedWindow [index / 32] |= 1u << (index % 32);
+
+    enet_protocol_record_fec_command (peer, command, command -> sendUnsequenced.unsequencedGroup, (const enet_uint8 *) command + sizeof (ENetProtocolSendUnsequenced), dataLength);
  
     return 0;
 }
@@ -561,9 +829,130 @@ enet_protocol_handle_send_unreliable (ENetHost * host, ENetPeer * peer, const EN
     if (enet_peer_queue_incoming_command (peer, command, (const enet_uint8 *) command + sizeof (ENetProtocolSendUnreliable), dataLength, 0, 0) == NULL)
       return -1;
 
+    enet_protocol_record_fec_command (peer, command, command -> sendUnreliable.unreliableSequenceNumber, (const enet_uint8 *) command + sizeof (ENetProtocolSendUnreliable), dataLength);
+
     return 0;
 }
 
+/** Rebuilds the single missing command of an FEC group, if any, from its parity and the
+    other members kept in the receive history.
+
+    The command is rebuilt in place in the received datagram, just before the parity bytes
+    where the member table was, and handed to the regular SEND handler so that it goes
+    through the same window and duplicate checks as if it had arrived. It is not
+    acknowledged, so a reliable command is still retransmitted by the sender.
+*/
+static int
+enet_protocol_handle_send_parity (ENetHost * host, ENetPeer * peer, const ENetProtocol * command, enet_uint8 ** currentData)
+{
+    int indices [ENET_PEER_FEC_MAXIMUM_GROUP_SIZE];
+    ENetProtocolParityMember member, missing;
+    ENetChannelFec * fec;
+    ENetProtocol * recovered;
+    enet_uint8 * members, * parity, * recoveredData;
+    size_t memberCount, dataLength, parityLength, missingCount = 0, i, j;
+    enet_uint8 channelID;
+
+    if (command -> header.channelID >= peer -> channelCount ||
+        (peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER))
+      return -1;
+
+    channelID = command -> header.channelID;
+    memberCount = command -> sendParity.memberCount;
+    dataLength = ENET_NET_TO_HOST_16 (command -> sendParity.dataLength);
+    * currentData += dataLength;
+    if (dataLength > host -> maximumPacketSize ||
+        * currentData < host -> receivedData ||
+        * currentData > & host -> receivedData [host -> receivedDataLength] ||
+        memberCount < 1 ||
+        memberCount > ENET_PEER_FEC_MAXIMUM_GROUP_SIZE ||
+        memberCount * sizeof (ENetProtocolParityMember) > dataLength)
+      return -1;
+
+    fec = peer -> channels [channelID].fec;
+    if (fec == NULL)
+      return 0;
+
+    members = (enet_uint8 *) command + sizeof (ENetProtocolSendParity);
+    parity = members + memberCount * sizeof (ENetProtocolParityMember);
+    parityLength = dataLength - memberCount * sizeof (ENetProtocolParityMember);
+
+    for (i = 0; i < memberCount; ++ i)
+    {
+        memcpy (& member, members + i * sizeof (ENetProtocolParityMember), sizeof (ENetProtocolParityMember));
+
+        if (ENET_NET_TO_HOST_16 (member.dataLength) > parityLength)
+          return 0;
+
+        indices [i] = enet_protocol_find_fec_command (fec, & member);
+        if (indices [i] < 0)
+        {
+            missing = member;
+
+            ++ missingCount;
+        }
+    }
+
+    if (missingCount != 1)
+      return 0;
+
+    for (i = 0; i < memberCount; ++ i)
+    {
+        const enet_uint8 * data;
+        size_t memberLength;
+
+        if (indices [i] < 0)
+          continue;
+
+        data = & fec -> historyData [indices [i] * fec -> slotSize];
+        memberLength = ENET_NET_TO_HOST_16 (fec -> history [indices [i]].dataLength);
+
+        for (j = 0; j < memberLength; ++ j)
+          parity [j] ^= data [j];
+    }
+
+    recoveredData = parity;
+
+    switch (missing.command & ENET_PROTOCOL_COMMAND_MASK)
+    {
+    case ENET_PROTOCOL_COMMAND_SEND_RELIABLE:
+        recovered = (ENetProtocol *) (parity - sizeof (ENetProtocolSendReliable));
+        recovered -> sendReliable.dataLength = missing.dataLength;
+        break;
+
+    case ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE:
+        recovered = (ENetProtocol *) (parity - sizeof (ENetProtocolSendUnreliable));
+        recovered -> sendUnreliable.unreliableSequenceNumber = missing.sequenceNumber;
+        recovered -> sendUnreliable.dataLength = missing.dataLength;
+        break;
+
+    case ENET_PROTOCOL_COMMAND_SEND_UNSEQUENCED:
+        recovered = (ENetProtocol *) (parity - sizeof (ENetProtocolSendUnsequenced));
+        recovered -> sendUnsequenced.unsequencedGroup = missing.sequenceNumber;
+        recovered -> sendUnsequenced.dataLength = missing.dataLength;
+        break;
+
+    default:
+        return 0;
+    }
+
+    recovered -> header.command = missing.command;
+    recovered -> header.channelID = channelID;
+    recovered -> header.reliableSequenceNumber = ENET_NET_TO_HOST_16 (missing.reliableSequenceNumber);
+
+    switch (missing.command & ENET_PROTOCOL_COMMAND_MASK)
+    {
+    case ENET_PROTOCOL_COMMAND_SEND_RELIABLE:
+        return enet_protocol_handle_send_reliable (host, peer, recovered, & recoveredData);
+
+    case ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE:
+        return enet_protocol_handle_send_unreliable (host, peer, recovered, & recoveredData);
+
+    default:
+        return enet_protocol_handle_send_unsequenced (host, peer, recovered, & recoveredData);
+    }
+}
+
 static int
 enet_protocol_handle_send_fragment (ENetHost * host, ENetPeer * peer, const ENetProtocol * command, enet_uint8 ** currentData)
 {
@@ -575,8 +964,7 @@ enet_protocol_handle_send_fragment (ENetHost * host, ENetPeer * peer, const ENet
            totalLength;
     ENetChannel * channel;
     enet_uint16 startWindow, currentWindow;
-    ENetListIterator currentCommand;
-    ENetIncomingCommand * startCommand = NULL;
+    ENetIncomingCommand * startCommand;
 
     if (command -> header.channelID >= peer -> channelCount ||
         (peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER))
@@ -613,38 +1001,15 @@ enet_protocol_handle_send_fragment (ENetHost * host, ENetPeer * peer, const ENet
         fragmentOffset >= totalLength ||
         fragmentLength > totalLength - fragmentOffset)
       return -1;
- 
-    for (currentCommand = enet_list_previous (enet_list_end (& channel -> incomingReliableCommands));
-         currentCommand != enet_list_end (& channel -> incomingReliableCommands);
-         currentCommand = enet_list_previous (currentCommand))
-    {
-       ENetIncomingCommand * incomingCommand = (ENetIncomingCommand *) currentCommand;
-
-       if (startSequenceNumber >= channel -> incomingReliableSequenceNumber)
-       {
-          if (incomingCommand -> reliableSequenceNumber < channel -> incomingReliableSequenceNumber)
-            continue;
-       }
-       else
-       if (incomingCommand -> reliableSequenceNumber >= channel -> incomingReliableSequenceNumber)
-         break;
-
-       if (incomingCommand -> reliableSequenceNumber <= startSequenceNumber)
-       {
-          if (incomingCommand -> reliableSequenceNumber < startSequenceNumber)
-            break;
-        
-          if ((incomingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) != ENET_PROTOCOL_COMMAND_SEND_FRAGMENT ||
-              totalLength != incomingCommand -> packet -> dataLength ||
-              fragmentCount != incomingCommand -> fragmentCount)
-            return -1;
 
-          startCommand = incomingCommand;
-          break;
-       }
+    startCommand = enet_peer_find_incoming_fragments (peer, command -> header.channelID, ENET_PROTOCOL_COMMAND_SEND_FRAGMENT, startSequenceNumber, 0);
+    if (startCommand != NULL)
+    {
+       if (totalLength != startCommand -> packet -> dataLength ||
+           fragmentCount != startCommand -> fragmentCount)
+         return -1;
     }
- 
-    if (startCommand == NULL)
+    else
     {
        ENetProtocol hostCommand = * command;
 
@@ -669,7 +1034,12 @@ enet_protocol_handle_send_fragment (ENetHost * host, ENetPeer * peer, const ENet
                fragmentLength);
 
         if (startCommand -> fragmentsRemaining <= 0)
+        {
+          enet_protocol_record_histogram (host, peer, ENET_HISTOGRAM_REASSEMBLY_TIME,
+                                          ENET_TIME_DIFFERENCE (host -> serviceTime, startCommand -> receivedTime));
+
           enet_peer_dispatch_incoming_reliable_commands (peer, channel, NULL);
+        }
     }
 
     return 0;
@@ -687,8 +1057,7 @@ enet_protocol_handle_send_unreliable_fragment (ENetHost * host, ENetPeer * peer,
            totalLength;
     enet_uint16 reliableWindow, currentWindow;
     ENetChannel * channel;
-    ENetListIterator currentCommand;
-    ENetIncomingCommand * startCommand = NULL;
+    ENetIncomingCommand * startCommand;
 
     if (command -> header.channelID >= peer -> channelCount ||
         (peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER))
@@ -730,43 +1099,14 @@ enet_protocol_handle_send_unreliable_fragment (ENetHost * host, ENetPeer * peer,
         fragmentLength > totalLength - fragmentOffset)
       return -1;
 
-    for (currentCommand = enet_list_previous (enet_list_end (& channel -> incomingUnreliableCommands));
-         currentCommand != enet_list_end (& channel -> incomingUnreliableCommands);
-         currentCommand = enet_list_previous (currentCommand))
+    startCommand = enet_peer_find_incoming_fragments (peer, command -> header.channelID, ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT, reliableSequenceNumber, startSequenceNumber);
+    if (startCommand != NULL)
     {
-       ENetIncomingCommand * incomingCommand = (ENetIncomingCommand *) currentCommand;
-
-       if (reliableSequenceNumber >= channel -> incomingReliableSequenceNumber)
-       {
-          if (incomingCommand -> reliableSequenceNumber < channel -> incomingReliableSequenceNumber)
-            continue;
-       }
-       else
-       if (incomingCommand -> reliableSequenceNumber >= channel -> incomingReliableSequenceNumber)
-         break;
-
-       if (incomingCommand -> reliableSequenceNumber < reliableSequenceNumber)
-         break;
-
-       if (incomingCommand -> reliableSequenceNumber > reliableSequenceNumber)
-         continue;
-
-       if (incomingCommand -> unreliableSequenceNumber <= startSequenceNumber)
-       {
-          if (incomingCommand -> unreliableSequenceNumber < startSequenceNumber)
-            break;
-
-          if ((incomingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) != ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT ||
-              totalLength != incomingCommand -> packet -> dataLength ||
-              fragmentCount != incomingCommand -> fragmentCount)
-            return -1;
-
-          startCommand = incomingCommand;
-          break;
-       }
+       if (totalLength != startCommand -> packet -> dataLength ||
+           fragmentCount != startCommand -> fragmentCount)
+         return -1;
     }
-
-    if (startCommand == NULL)
+    else
     {
        startCommand = enet_peer_queue_incoming_command (peer, command, NULL, totalLength, ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT, fragmentCount);
        if (startCommand == NULL)
@@ -787,7 +1127,12 @@ enet_protocol_handle_send_unreliable_fragment (ENetHost * host, ENetPeer * peer,
                fragmentLength);
 
         if (startCommand -> fragmentsRemaining <= 0)
+        {
+          enet_protocol_record_histogram (host, peer, ENET_HISTOGRAM_REASSEMBLY_TIME,
+                                          ENET_TIME_DIFFERENCE (host -> serviceTime, startCommand -> receivedTime));
+
           enet_peer_dispatch_incoming_unreliable_commands (peer, channel, NULL);
+        }
     }
 
     return 0;
@@ -818,7 +1163,7 @@ enet_protocol_handle_bandwidth_limit (ENetHost * host, ENetPeer * peer, const EN
       ++ host -> bandwidthLimitedPeers;
 
     if (peer -> incomingBandwidth == 0 && host -> outgoingBandwidth == 0)
-      peer -> windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+      peer -> windowSize = peer -> windowLimit;
     else
     if (peer -> incomingBandwidth == 0 || host -> outgoingBandwidth == 0)
       peer -> windowSize = (ENET_MAX (peer -> incomingBandwidth, host -> outgoingBandwidth) /
@@ -830,8 +1175,8 @@ enet_protocol_handle_bandwidth_limit (ENetHost * host, ENetPeer * peer, const EN
     if (peer -> windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE)
       peer -> windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
     else
-    if (peer -> windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE)
-      peer -> windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+    if (peer -> windowSize > peer -> windowLimit)
+      peer -> windowSize = peer -> windowLimit;
 
     return 0;
 }
@@ -849,6 +1194,23 @@ enet_protocol_handle_throttle_configure (ENetHost * host, ENetPeer * peer, const
     return 0;
 }
 
+static int
+enet_protocol_handle_fec_configure (ENetPeer * peer, const ENetProtocol * command)
+{
+    ENetChannel * channel;
+
+    if (command -> fecConfigure.channelID >= peer -> channelCount ||
+        (peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER))
+      return -1;
+
+    channel = & peer -> channels [command -> fecConfigure.channelID];
+    channel -> fecRemoteGroupSize = ENET_MIN (command -> fecConfigure.groupSize, ENET_PEER_FEC_MAXIMUM_GROUP_SIZE);
+
+    enet_peer_reset_fec (channel);
+
+    return 0;
+}
+
 static int
 enet_protocol_handle_disconnect (ENetHost * host, ENetPeer * peer, const ENetProtocol * command)
 {
@@ -900,10 +1262,17 @@ enet_protocol_handle_acknowledge (ENetHost * host, ENetEvent * event, ENetPeer *
     roundTripTime = ENET_TIME_DIFFERENCE (host -> serviceTime, receivedSentTime);
     roundTripTime = ENET_MAX (roundTripTime, 1);
 
+    enet_protocol_record_histogram (host, peer, ENET_HISTOGRAM_ROUND_TRIP_TIME, roundTripTime);
+
     if (peer -> lastReceiveTime > 0)
     {
+       enet_uint32 packetThrottle = peer -> packetThrottle;
+
        enet_peer_throttle (peer, roundTripTime);
 
+       if (peer -> packetThrottle != packetThrottle)
+         ENET_TRACE (host, ENET_TRACE_EVENT_THROTTLE, peer, 0, peer -> packetThrottle, packetThrottle);
+
        peer -> roundTripTimeVariance -= (peer -> roundTripTimeVariance + 3) / 4;
 
        if (roundTripTime >= peer -> roundTripTime)
@@ -946,7 +1315,10 @@ enet_protocol_handle_acknowledge (ENetHost * host, ENetEvent * event, ENetPeer *
 
     receivedReliableSequenceNumber = ENET_NET_TO_HOST_16 (command -> acknowledge.receivedReliableSequenceNumber);
 
-    commandNumber = enet_protocol_remove_sent_reliable_command (peer, receivedReliableSequenceNumber, command -> header.channelID);
+    commandNumber = enet_protocol_remove_sent_reliable_command (peer, receivedReliableSequenceNumber, command -> header.channelID, ENET_NET_TO_HOST_16 (command -> acknowledge.receivedSentTime));
+
+    ENET_TRACE (host, ENET_TRACE_EVENT_ACKNOWLEDGE, peer, commandNumber,
+                (enet_uint32) command -> header.channelID << 16 | receivedReliableSequenceNumber, roundTripTime);
 
     switch (peer -> state)
     {
@@ -1000,7 +1372,7 @@ enet_protocol_handle_verify_connect (ENetHost * host, ENetEvent * event, ENetPee
         return -1;
     }
 
-    enet_protocol_remove_sent_reliable_command (peer, 1, 0xFF);
+    enet_protocol_remove_sent_reliable_command (peer, 1, 0xFF, 0);
     
     if (channelCount < peer -> channelCount)
       peer -> channelCount = channelCount;
@@ -1025,15 +1397,25 @@ enet_protocol_handle_verify_connect (ENetHost * host, ENetEvent * event, ENetPee
     if (windowSize < ENET_PROTOCOL_MINIMUM_WINDOW_SIZE)
       windowSize = ENET_PROTOCOL_MINIMUM_WINDOW_SIZE;
 
-    if (windowSize > ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE)
-      windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
+    if (windowSize > peer -> windowLimit)
+      windowSize = peer -> windowLimit;
 
     if (windowSize < peer -> windowSize)
       peer -> windowSize = windowSize;
 
+    /* An original ENet server answers with at most ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE. */
+    peer -> windowLimit = ENET_MAX (windowSize, ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE);
+
     peer -> incomingBandwidth = ENET_NET_TO_HOST_32 (command -> verifyConnect.incomingBandwidth);
     peer -> outgoingBandwidth = ENET_NET_TO_HOST_32 (command -> verifyConnect.outgoingBandwidth);
 
+    if (command -> header.command & ENET_PROTOCOL_COMMAND_FLAG_AGGREGATE)
+      peer -> flags |= ENET_PEER_FLAG_AGGREGATE;
+    if (command -> header.command & ENET_PROTOCOL_COMMAND_FLAG_FEC)
+      peer -> flags |= ENET_PEER_FLAG_FEC;
+    if (command -> header.command & ENET_PROTOCOL_COMMAND_FLAG_STREAM)
+      peer -> flags |= ENET_PEER_FLAG_STREAM;
+
     enet_protocol_notify_connect (host, peer, event);
     return 0;
 }
@@ -1048,16 +1430,17 @@ enet_protocol_handle_incoming_commands (ENetHost * host, ENetEvent * event)
     size_t headerSize;
     enet_uint16 peerID, flags;
     enet_uint8 sessionID;
-    enet_uint8 * srcBuffer;
-    enet_uint8 * dstBuffer;
+    enet_uint8 * spareBuffer;
     enet_uint16 extendedHeaderFlags = 0;
     int hasExtendedHeaders = 0;
+    const size_t datagramLength = host -> receivedDataLength;
 
-    if (host -> encryptor.context != NULL && host -> encryptor.decrypt != NULL)
+    if (host -> encryptor.context != NULL &&
+        (host -> encryptor.decrypt != NULL || host -> encryptor.decryptInPlace != NULL))
         hasExtendedHeaders = 1;
 
     if (host -> receivedDataLength < (size_t) & ((ENetProtocolHeader *) 0) -> sentTime)
-      return 0;
+      goto malformedDatagram;
 
     header = (ENetProtocolHeader *) host -> receivedData;
 
@@ -1082,8 +1465,8 @@ enet_protocol_handle_incoming_commands (ENetHost * host, ENetEvent * event)
     if (peerID == ENET_PROTOCOL_MAXIMUM_PEER_ID)
       peer = NULL;
     else
-    if (peerID >= host -> peerCount)
-      return 0;
+    if (peerID >= host -> committedPeers)
+      goto sessionMismatch;
     else
     {
        peer = & host -> peers [peerID];
@@ -1094,7 +1477,7 @@ enet_protocol_handle_incoming_commands (ENetHost * host, ENetEvent * event)
             !enet_address_is_broadcast(&peer->address)) ||
            (peer -> outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID &&
             sessionID != peer -> incomingSessionID))
-         return 0;
+         goto sessionMismatch;
     }
 
     if (hasExtendedHeaders)
@@ -1107,51 +1490,65 @@ enet_protocol_handle_incoming_commands (ENetHost * host, ENetEvent * event)
         extendedHeaderFlags = ENET_NET_TO_HOST_16(extendedHeaderFlags);
     }
 
-    srcBuffer = host -> receivedData;
-    dstBuffer = host -> packetData [1];
+    /* Stages that cannot run in place write into whichever packet buffer does not hold the
+       current datagram, past the headroom, and only the header is copied in front of them. */
+    spareBuffer = host -> packetData [1];
     if (extendedHeaderFlags & ENET_PROTOCOL_HEADER_EXTENDED_FLAG_ENCRYPTED)
     {
         size_t originalSize;
-        if (host -> encryptor.context == NULL || host -> encryptor.decrypt == NULL)
-            return 0;
-
-        originalSize = host -> encryptor.decrypt(host -> encryptor.context,
-            peer,
-            srcBuffer + headerSize,
-            host -> receivedDataLength - headerSize,
-            dstBuffer + headerSize,
-            sizeof(host -> packetData [0]) - headerSize);
-        if (originalSize <= 0)
-            return 0;
-
-        memcpy(dstBuffer, header, headerSize);
-        host -> receivedData = dstBuffer;
-        host -> receivedDataLength = headerSize + originalSize;
+        if (host -> encryptor.context == NULL)
+            goto malformedDatagram;
 
-        dstBuffer = srcBuffer;
-        srcBuffer = host -> receivedData;
+        if (host -> encryptor.decryptInPlace != NULL)
+        {
+            originalSize = host -> encryptor.decryptInPlace (host -> encryptor.context,
+                peer,
+                host -> receivedData + headerSize,
+                host -> receivedDataLength - headerSize);
+            if (originalSize <= 0 || originalSize > host -> receivedDataLength - headerSize)
+                goto malformedDatagram;
+
+            host -> receivedDataLength = headerSize + originalSize;
+        }
+        else
+        {
+            if (host -> encryptor.decrypt == NULL)
+                goto malformedDatagram;
+
+            originalSize = host -> encryptor.decrypt (host -> encryptor.context,
+                peer,
+                host -> receivedData + headerSize,
+                host -> receivedDataLength - headerSize,
+                spareBuffer + ENET_PACKET_HEADROOM + headerSize,
+                sizeof (host -> packetData [0]) - ENET_PACKET_HEADROOM - headerSize);
+            if (originalSize <= 0 || originalSize > sizeof (host -> packetData [0]) - ENET_PACKET_HEADROOM - headerSize)
+                goto malformedDatagram;
+
+            memcpy (spareBuffer + ENET_PACKET_HEADROOM, host -> receivedData, headerSize);
+            host -> receivedData = spareBuffer + ENET_PACKET_HEADROOM;
+            host -> receivedDataLength = headerSize + originalSize;
+
+            spareBuffer = host -> packetData [0];
+        }
     }
 
     if (flags & ENET_PROTOCOL_HEADER_FLAG_COMPRESSED)
     {
         size_t originalSize;
         if (host -> compressor.context == NULL || host -> compressor.decompress == NULL)
-          return 0;
+          goto malformedDatagram;
 
         originalSize = host -> compressor.decompress (host -> compressor.context,
-                                    srcBuffer + headerSize, 
+                                    host -> receivedData + headerSize, 
                                     host -> receivedDataLength - headerSize, 
-                                    dstBuffer + headerSize, 
-                                    sizeof (host -> packetData [0]) - headerSize);
-        if (originalSize <= 0 || originalSize > sizeof (host -> packetData [0]) - headerSize)
-          return 0;
+                                    spareBuffer + ENET_PACKET_HEADROOM + headerSize, 
+                                    sizeof (host -> packetData [0]) - ENET_PACKET_HEADROOM - headerSize);
+        if (originalSize <= 0 || originalSize > sizeof (host -> packetData [0]) - ENET_PACKET_HEADROOM - headerSize)
+          goto malformedDatagram;
 
-        memcpy (dstBuffer, header, headerSize);
-        host -> receivedData = dstBuffer;
+        memcpy (spareBuffer + ENET_PACKET_HEADROOM, host -> receivedData, headerSize);
+        host -> receivedData = spareBuffer + ENET_PACKET_HEADROOM;
         host -> receivedDataLength = headerSize + originalSize;
-
-        dstBuffer = srcBuffer;
-        srcBuffer = host -> receivedData;
     }
 
     if (host -> checksum != NULL)
@@ -1169,7 +1566,10 @@ enet_protocol_handle_incoming_commands (ENetHost * host, ENetEvent * event)
         buffer.dataLength = host -> receivedDataLength;
 
         if (host -> checksum (& buffer, 1) != desiredChecksum)
-          return 0;
+        {
+           ++ host -> stats.drops [ENET_DROP_REASON_CHECKSUM];
+           return 0;
+        }
     }
        
     if (peer != NULL)
@@ -1177,7 +1577,11 @@ enet_protocol_handle_incoming_commands (ENetHost * host, ENetEvent * event)
        peer -> address.host = host -> receivedAddress.host;
        peer -> address.port = host -> receivedAddress.port;
        peer -> incomingDataTotal += host -> receivedDataLength;
+       peer -> totalReceivedData += datagramLength;
+       ++ peer -> totalReceivedDatagrams;
     }
+
+    ENET_TRACE (host, ENET_TRACE_EVENT_DATAGRAM_RECEIVE, peer, 0, (enet_uint32) datagramLength, (enet_uint32) host -> receivedDataLength);
     
     currentData = host -> receivedData + headerSize;
   
@@ -1189,17 +1593,18 @@ enet_protocol_handle_incoming_commands (ENetHost * host, ENetEvent * event)
        command = (ENetProtocol *) currentData;
 
        if (currentData + sizeof (ENetProtocolCommandHeader) > & host -> receivedData [host -> receivedDataLength])
-         break;
+         goto malformedCommand;
 
        commandNumber = command -> header.command & ENET_PROTOCOL_COMMAND_MASK;
        if (commandNumber >= ENET_PROTOCOL_COMMAND_COUNT) 
-         break;
+         goto malformedCommand;
        
        commandSize = commandSizes [commandNumber];
        if (commandSize == 0 || currentData + commandSize > & host -> receivedData [host -> receivedDataLength])
-         break;
+         goto malformedCommand;
 
        currentData += commandSize;
+       ++ host -> stats.receivedCommands [commandNumber];
 
        if (peer == NULL && commandNumber != ENET_PROTOCOL_COMMAND_CONNECT)
          break;
@@ -1271,6 +1676,16 @@ enet_protocol_handle_incoming_commands (ENetHost * host, ENetEvent * event)
             goto commandError;
           break;
 
+       case ENET_PROTOCOL_COMMAND_FEC_CONFIGURE:
+          if (enet_protocol_handle_fec_configure (peer, command))
+            goto commandError;
+          break;
+
+       case ENET_PROTOCOL_COMMAND_SEND_PARITY:
+          if (enet_protocol_handle_send_parity (host, peer, command, & currentData))
+            goto commandError;
+          break;
+
        default:
           goto commandError;
        }
@@ -1305,30 +1720,90 @@ enet_protocol_handle_incoming_commands (ENetHost * host, ENetEvent * event)
        }
     }
 
+    goto commandError;
+
+malformedCommand:
+    ++ host -> stats.drops [ENET_DROP_REASON_MALFORMED];
+
 commandError:
     if (event != NULL && event -> type != ENET_EVENT_TYPE_NONE)
       return 1;
 
     return 0;
+
+sessionMismatch:
+    ++ host -> stats.drops [ENET_DROP_REASON_SESSION];
+    return 0;
+
+malformedDatagram:
+    ++ host -> stats.drops [ENET_DROP_REASON_MALFORMED];
+    return 0;
 }
  
+/** Handles the datagram received from host -> receivedAddress in host -> receivedData, whether it
+    was read from the socket of the host or fed by a replay.
+    @retval 1 if an event was produced
+    @retval 0 if no event was produced
+    @retval < 0 on failure
+*/
+int
+enet_protocol_receive_datagram (ENetHost * host, ENetEvent * event)
+{
+    host -> totalReceivedData += host -> receivedDataLength;
+    host -> totalReceivedPackets ++;
+    host -> stats.receivedData += host -> receivedDataLength;
+    ++ host -> stats.receivedDatagrams;
+
+    if (host -> captureFile != NULL)
+    {
+       ENetBuffer buffer;
+
+       buffer.data = host -> receivedData;
+       buffer.dataLength = host -> receivedDataLength;
+
+       enet_host_capture_datagram (host, & host -> receivedAddress, 0, & buffer, 1);
+    }
+
+    if (host -> intercept != NULL)
+    {
+       switch (host -> intercept (host, event))
+       {
+       case 1:
+          return event != NULL && event -> type != ENET_EVENT_TYPE_NONE ? 1 : 0;
+       
+       case -1:
+          return -1;
+     
+       default:
+          break;
+       }
+    }
+
+    return enet_protocol_handle_incoming_commands (host, event);
+}
+
 static int
 enet_protocol_receive_incoming_commands (ENetHost * host, ENetEvent * event)
 {
     int packets;
 
+    ENET_TRACE_CLOCK (host);
+
     for (packets = 0; packets < 256; ++ packets)
     {
        int receivedLength;
        ENetBuffer buffer;
 
-       buffer.data = host -> packetData [0];
-       buffer.dataLength = sizeof (host -> packetData [0]);
+       buffer.data = host -> packetData [0] + ENET_PACKET_HEADROOM;
+       buffer.dataLength = sizeof (host -> packetData [0]) - ENET_PACKET_HEADROOM;
 
-       receivedLength = enet_socket_receive (host -> socket,
-                                             & host -> receivedAddress,
-                                             & buffer,
-                                             1);
+       if (host -> socketBackend.context != NULL)
+         receivedLength = host -> socketBackend.receive (host -> socketBackend.context, host, & host -> receivedAddress, & buffer);
+       else
+         receivedLength = enet_socket_receive (host -> socket,
+                                               & host -> receivedAddress,
+                                               & buffer,
+                                               1);
 
        if (receivedLength == -2)
          continue;
@@ -1339,31 +1814,10 @@ enet_protocol_receive_incoming_commands (ENetHost * host, ENetEvent * event)
        if (receivedLength == 0)
          return 0;
 
-       host -> receivedData = host -> packetData [0];
+       host -> receivedData = host -> packetData [0] + ENET_PACKET_HEADROOM;
        host -> receivedDataLength = receivedLength;
-      
-       host -> totalReceivedData += receivedLength;
-       host -> totalReceivedPackets ++;
-
-       if (host -> intercept != NULL)
-       {
-          switch (host -> intercept (host, event))
-          {
-          case 1:
-             if (event != NULL && event -> type != ENET_EVENT_TYPE_NONE)
-               return 1;
 
-             continue;
-          
-          case -1:
-             return -1;
-        
-          default:
-             break;
-          }
-       }
-        
-       switch (enet_protocol_handle_incoming_commands (host, event))
+       switch (enet_protocol_receive_datagram (host, event))
        {
        case 1:
           return 1;
@@ -1467,6 +1921,14 @@ enet_protocol_check_timeouts (ENetHost * host, ENetPeer * peer, ENetEvent * even
        }
 
        ++ peer -> packetsLost;
+       ++ peer -> retransmits;
+       ++ host -> stats.retransmits;
+
+       ENET_TRACE (host, ENET_TRACE_EVENT_RETRANSMIT, peer, 0,
+                   (enet_uint32) outgoingCommand -> command.header.channelID << 16 | outgoingCommand -> reliableSequenceNumber, outgoingCommand -> sendAttempts);
+
+       outgoingCommand -> fastRetransmitted = 0;
+       outgoingCommand -> inTransit = 0;
 
        roundTripTimeout = peer -> roundTripTime + ENET_MIN (peer -> roundTripTime, 4 * ENET_MAX (1, peer -> roundTripTimeVariance));
        roundTripTimeout = ENET_MIN (roundTripTimeout, peer->timeoutMaximum / 5);
@@ -1496,13 +1958,95 @@ enet_protocol_check_timeouts (ENetHost * host, ENetPeer * peer, ENetEvent * even
     return 0;
 }
 
+/** Decides whether the commands queued to a coalescing peer are held back for now, so that
+    more commands can join them in the same datagram.
+    @returns 1 if the commands are held, 0 if they are to be sent
+*/
+static int
+enet_protocol_coalesce_outgoing_commands (ENetHost * host, ENetPeer * peer)
+{
+    if (peer -> coalesceTimeout == 0 ||
+        peer -> coalescedCommands == 0 ||
+        peer -> flags & ENET_PEER_FLAG_FLUSH ||
+        host -> commandCount > 0 ||
+        peer -> coalescedCommands >= ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS ||
+        peer -> coalescedDataLength >= peer -> mtu - peer -> mtu / 8)
+      return 0;
+
+    return ENET_TIME_LESS (enet_time_get_us (), peer -> coalesceDeadline);
+}
+
+/** Cancels a reliable packet whose time to live elapsed before any of its commands was sent.
+    Each of its commands becomes an empty aggregated SEND_RELIABLE with the same reliable sequence
+    number, as does each fragment a fragment run still has to send, so the receiver acknowledges it and moves on without delivering anything. A receiver
+    that does not decode aggregated commands would deliver an empty packet instead, so this is
+    only done toward peers that announced ENET_PEER_FLAG_AGGREGATE when connecting.
+*/
+static void
+enet_protocol_expire_reliable_command (ENetPeer * peer, ENetOutgoingCommand * outgoingCommand)
+{
+    ENetPacket * packet = outgoingCommand -> packet;
+    ENetListIterator currentCommand = & outgoingCommand -> outgoingCommandList;
+
+    ++ peer -> expiredPackets;
+
+    /* The fragments of a packet are queued next to each other. */
+    do
+    {
+       outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+       currentCommand = enet_list_next (currentCommand);
+
+       outgoingCommand -> command.header.command = ENET_PROTOCOL_COMMAND_SEND_RELIABLE | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE | ENET_PROTOCOL_COMMAND_FLAG_AGGREGATE;
+       outgoingCommand -> command.sendReliable.dataLength = 0;
+       outgoingCommand -> fragmentOffset = 0;
+       outgoingCommand -> fragmentLength = 0;
+       outgoingCommand -> packet = NULL;
+       outgoingCommand -> expireTime = 0;
+
+       if (outgoingCommand -> fragmentTable != NULL)
+       {
+          enet_fragment_table_release (outgoingCommand -> fragmentTable);
+
+          outgoingCommand -> fragmentTable = NULL;
+       }
+
+       enet_peer_unindex_outgoing_command (outgoingCommand);
+
+       -- packet -> referenceCount;
+    }
+    while (currentCommand != enet_list_end (& peer -> outgoingSendReliableCommands) &&
+           ((ENetOutgoingCommand *) currentCommand) -> packet == packet &&
+           ((ENetOutgoingCommand *) currentCommand) -> sendAttempts < 1);
+
+    if (packet -> referenceCount == 0)
+      enet_packet_destroy (packet);
+}
+
+/** Returns whether outgoingCommand is to be sent before otherCommand: by priority then virtual
+    time when the channels of the peer are scheduled, in queueing order otherwise or on a tie.
+*/
+static int
+enet_protocol_schedule_before (const ENetPeer * peer, const ENetOutgoingCommand * outgoingCommand, const ENetOutgoingCommand * otherCommand)
+{
+    if (peer -> scheduledChannels > 0)
+    {
+       if (outgoingCommand -> priority != otherCommand -> priority)
+         return outgoingCommand -> priority > otherCommand -> priority;
+
+       if (outgoingCommand -> scheduleTime != otherCommand -> scheduleTime)
+         return ENET_SCHEDULE_LESS (outgoingCommand -> scheduleTime, otherCommand -> scheduleTime);
+    }
+
+    return ENET_TIME_LESS (outgoingCommand -> queueTime, otherCommand -> queueTime);
+}
+
 static int
 enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer, ENetList * sentUnreliableCommands)
 {
     ENetProtocol * command = & host -> commands [host -> commandCount];
     ENetBuffer * buffer = & host -> buffers [host -> bufferCount];
     ENetOutgoingCommand * outgoingCommand;
-    ENetListIterator currentCommand, currentSendReliableCommand;
+    ENetListIterator currentCommand, currentSendReliableCommand, * currentIterator;
     ENetChannel *channel = NULL;
     enet_uint16 reliableWindow = 0;
     size_t commandSize;
@@ -1518,10 +2062,11 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer, ENetLis
           outgoingCommand = (ENetOutgoingCommand *) currentCommand;
 
           if (currentSendReliableCommand != enet_list_end (& peer -> outgoingSendReliableCommands) &&
-              ENET_TIME_LESS (((ENetOutgoingCommand *) currentSendReliableCommand) -> queueTime, outgoingCommand -> queueTime))
+              enet_protocol_schedule_before (peer, (ENetOutgoingCommand *) currentSendReliableCommand, outgoingCommand))
             goto useSendReliableCommand;
 
           currentCommand = enet_list_next (currentCommand);
+          currentIterator = & currentCommand;
        }
        else
        if (currentSendReliableCommand != enet_list_end (& peer -> outgoingSendReliableCommands))
@@ -1529,6 +2074,7 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer, ENetLis
        useSendReliableCommand:
           outgoingCommand = (ENetOutgoingCommand *) currentSendReliableCommand;
           currentSendReliableCommand = enet_list_next (currentSendReliableCommand);
+          currentIterator = & currentSendReliableCommand;
        }
        else
          break;
@@ -1536,6 +2082,15 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer, ENetLis
        if (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE)
        {
           channel = outgoingCommand -> command.header.channelID < peer -> channelCount ? & peer -> channels [outgoingCommand -> command.header.channelID] : NULL;
+
+          if (outgoingCommand -> expireTime != 0 &&
+              outgoingCommand -> sendAttempts < 1 &&
+              outgoingCommand -> fragmentOffset == 0 &&
+              channel != NULL && channel -> fec == NULL &&
+              peer -> flags & ENET_PEER_FLAG_AGGREGATE &&
+              ENET_TIME_GREATER_EQUAL (host -> serviceTime, outgoingCommand -> expireTime))
+            enet_protocol_expire_reliable_command (peer, outgoingCommand);
+
           reliableWindow = outgoingCommand -> reliableSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
           if (channel != NULL)
           {
@@ -1582,10 +2137,70 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer, ENetLis
           break;
        }
 
+       if (ENET_SCHEDULE_LESS (peer -> scheduleClock, outgoingCommand -> scheduleTime))
+         peer -> scheduleClock = outgoingCommand -> scheduleTime;
+
+       if (! (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE) &&
+           outgoingCommand -> packet != NULL && outgoingCommand -> fragmentOffset == 0)
+       {
+          int expired = outgoingCommand -> expireTime != 0 && ENET_TIME_GREATER_EQUAL (host -> serviceTime, outgoingCommand -> expireTime);
+
+          if (expired)
+            ++ peer -> expiredPackets;
+          else
+          {
+             peer -> packetThrottleCounter += ENET_PEER_PACKET_THROTTLE_COUNTER;
+             peer -> packetThrottleCounter %= ENET_PEER_PACKET_THROTTLE_SCALE;
+          }
+
+          if (expired || peer -> packetThrottleCounter > peer -> packetThrottle)
+          {
+             enet_uint16 reliableSequenceNumber = outgoingCommand -> reliableSequenceNumber,
+                         unreliableSequenceNumber = outgoingCommand -> unreliableSequenceNumber;
+             for (;;)
+             {
+                -- outgoingCommand -> packet -> referenceCount;
+
+                if (outgoingCommand -> packet -> referenceCount == 0)
+                  enet_packet_destroy (outgoingCommand -> packet);
+
+                enet_list_remove (& outgoingCommand -> outgoingCommandList);
+                enet_host_release_outgoing_command (peer -> host, outgoingCommand);
+
+                if (currentCommand == enet_list_end (& peer -> outgoingCommands))
+                  break;
+
+                outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+                if (outgoingCommand -> reliableSequenceNumber != reliableSequenceNumber ||
+                    outgoingCommand -> unreliableSequenceNumber != unreliableSequenceNumber)
+                  break;
+
+                currentCommand = enet_list_next (currentCommand);
+             }
+
+             continue;
+          }
+       }
+
+       /* A fragment run sends its next fragment as a command of its own and stays queued for the others. */
+       if (outgoingCommand -> pendingFragments > 0)
+       {
+          ENetOutgoingCommand * fragment = enet_peer_split_fragment_run (peer, outgoingCommand);
+          if (fragment == NULL)
+            break;
+
+          * currentIterator = & outgoingCommand -> outgoingCommandList;
+          outgoingCommand = fragment;
+       }
+
+       enet_peer_unindex_outgoing_command (outgoingCommand);
+
        if (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE)
        {
           if (channel != NULL && outgoingCommand -> sendAttempts < 1)
           {
+             enet_protocol_index_sent_reliable_command (channel, outgoingCommand);
+
              channel -> usedReliableWindows |= 1u << reliableWindow;
              ++ channel -> reliableWindows [reliableWindow];
           }
@@ -1604,6 +2219,9 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer, ENetLis
                             enet_list_remove (& outgoingCommand -> outgoingCommandList));
 
           outgoingCommand -> sentTime = host -> serviceTime;
+          outgoingCommand -> sentDatagram = peer -> datagramsSent;
+          outgoingCommand -> gapAcknowledgements = 0;
+          outgoingCommand -> inTransit = 1;
 
           host -> headerFlags |= ENET_PROTOCOL_HEADER_FLAG_SENT_TIME;
 
@@ -1611,40 +2229,6 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer, ENetLis
        }
        else
        {
-          if (outgoingCommand -> packet != NULL && outgoingCommand -> fragmentOffset == 0)
-          {
-             peer -> packetThrottleCounter += ENET_PEER_PACKET_THROTTLE_COUNTER;
-             peer -> packetThrottleCounter %= ENET_PEER_PACKET_THROTTLE_SCALE;
-
-             if (peer -> packetThrottleCounter > peer -> packetThrottle)
-             {
-                enet_uint16 reliableSequenceNumber = outgoingCommand -> reliableSequenceNumber,
-                            unreliableSequenceNumber = outgoingCommand -> unreliableSequenceNumber;
-                for (;;)
-                {
-                   -- outgoingCommand -> packet -> referenceCount;
-
-                   if (outgoingCommand -> packet -> referenceCount == 0)
-                     enet_packet_destroy (outgoingCommand -> packet);
-
-                   enet_list_remove (& outgoingCommand -> outgoingCommandList);
-                   enet_free (outgoingCommand);
-
-                   if (currentCommand == enet_list_end (& peer -> outgoingCommands))
-                     break;
-
-                   outgoingCommand = (ENetOutgoingCommand *) currentCommand;
-                   if (outgoingCommand -> reliableSequenceNumber != reliableSequenceNumber ||
-                       outgoingCommand -> unreliableSequenceNumber != unreliableSequenceNumber)
-                     break;
-
-                   currentCommand = enet_list_next (currentCommand);
-                }
-
-                continue;
-             }
-          }
-
           enet_list_remove (& outgoingCommand -> outgoingCommandList);
 
           if (outgoingCommand -> packet != NULL)
@@ -1658,6 +2242,14 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer, ENetLis
 
        * command = outgoingCommand -> command;
 
+       ENET_TRACE (host, ENET_TRACE_EVENT_COMMAND_SEND, peer, outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK,
+                   (enet_uint32) outgoingCommand -> command.header.channelID << 16 | outgoingCommand -> reliableSequenceNumber, outgoingCommand -> fragmentLength);
+
+       /* Reliable commands count their first transmission, the others are only sent once. */
+       if (outgoingCommand -> queuedTime != 0 && outgoingCommand -> sendAttempts <= 1)
+         enet_protocol_record_histogram (host, peer, ENET_HISTOGRAM_QUEUE_DELAY,
+                                         ENET_TIME_LESS (host -> serviceTime, outgoingCommand -> queuedTime) ? 0 : host -> serviceTime - outgoingCommand -> queuedTime);
+
        if (outgoingCommand -> packet != NULL)
        {
           ++ buffer;
@@ -1669,7 +2261,7 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer, ENetLis
        }
        else
        if (! (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE))
-         enet_free (outgoingCommand);
+         enet_host_release_outgoing_command (peer -> host, outgoingCommand);
 
        ++ peer -> packetsSent;
         
@@ -1688,6 +2280,110 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer, ENetLis
     return canPing;
 }
 
+/** Runs the outgoing transform stages over the commands gathered in host -> buffers [1 .. bufferCount - 1].
+
+    Compression reads the gather list directly and writes past the headroom of packetData [1].
+    Encryption then runs in place on that output when the encryptor provides encryptInPlace,
+    so compression followed by encryption touches each payload byte at most twice. If
+    encryption is the first stage and needs contiguous input, the gather list is flattened
+    once into packetData [0]; otherwise an out-of-place encryptor reads the previous stage
+    and writes into the packet buffer it does not use.
+
+    @param extendedHeaderFlags receives ENET_PROTOCOL_HEADER_EXTENDED_FLAG_ENCRYPTED if encryption succeeded
+    @param outData receives the transformed payload, always preceded by ENET_PACKET_HEADROOM free bytes
+    @returns the size of the transformed payload, or 0 if the gathered commands should be sent as is
+*/
+static size_t
+enet_protocol_transform_outgoing_commands (ENetHost * host, ENetPeer * peer, enet_uint16 * extendedHeaderFlags, enet_uint8 ** outData)
+{
+    const size_t originalSize = host -> packetSize - sizeof (ENetProtocolHeader),
+                 dataLimit = sizeof (host -> packetData [0]) - ENET_PACKET_HEADROOM;
+    enet_uint8 * contentData = NULL;
+    size_t contentSize = 0;
+
+    if (host -> compressor.context != NULL && host -> compressor.compress != NULL)
+    {
+        enet_uint8 * compressedData = host -> packetData [1] + ENET_PACKET_HEADROOM;
+        size_t compressedSize = host -> compressor.compress (host -> compressor.context,
+                                    & host -> buffers [1], host -> bufferCount - 1,
+                                    originalSize,
+                                    compressedData,
+                                    originalSize);
+        if (compressedSize > 0 && compressedSize < originalSize)
+        {
+            host -> headerFlags |= ENET_PROTOCOL_HEADER_FLAG_COMPRESSED;
+            host -> stats.compressionSavedData += originalSize - compressedSize;
+            contentData = compressedData;
+            contentSize = compressedSize;
+#ifdef ENET_DEBUG_COMPRESS
+            printf ("peer %u: compressed %u -> %u (%u%%)\n", peer -> incomingPeerID, originalSize, compressedSize, (compressedSize * 100) / originalSize);
+#endif
+        }
+    }
+
+    if (host -> encryptor.context == NULL)
+      goto done;
+
+    if (host -> encryptor.encryptInPlace != NULL)
+    {
+        enet_uint8 * encryptedData = contentData;
+        size_t encryptedSize, encryptedLength = contentSize;
+
+        if (encryptedData == NULL)
+        {
+            const ENetBuffer * buffer;
+
+            encryptedData = host -> packetData [0] + ENET_PACKET_HEADROOM;
+            for (buffer = & host -> buffers [1]; buffer < & host -> buffers [host -> bufferCount]; ++ buffer)
+            {
+                memcpy (encryptedData + encryptedLength, buffer -> data, buffer -> dataLength);
+                encryptedLength += buffer -> dataLength;
+            }
+        }
+
+        encryptedSize = host -> encryptor.encryptInPlace (host -> encryptor.context, peer, encryptedData, encryptedLength, dataLimit);
+        if (encryptedSize > 0 && encryptedSize <= dataLimit)
+        {
+            * extendedHeaderFlags |= ENET_PROTOCOL_HEADER_EXTENDED_FLAG_ENCRYPTED;
+            contentData = encryptedData;
+            contentSize = encryptedSize;
+        }
+    }
+    else
+    if (host -> encryptor.encrypt != NULL)
+    {
+        enet_uint8 * encryptedData = host -> packetData [0] + ENET_PACKET_HEADROOM;
+        size_t encryptedSize;
+
+        if (contentData != NULL)
+        {
+            ENetBuffer contentBuffer;
+
+            contentBuffer.data = contentData;
+            contentBuffer.dataLength = contentSize;
+            encryptedSize = host -> encryptor.encrypt (host -> encryptor.context, peer,
+                                & contentBuffer, 1, contentSize,
+                                encryptedData, dataLimit);
+        }
+        else
+          encryptedSize = host -> encryptor.encrypt (host -> encryptor.context, peer,
+                              & host -> buffers [1], host -> bufferCount - 1, originalSize,
+                              encryptedData, dataLimit);
+
+        if (encryptedSize > 0 && encryptedSize <= dataLimit)
+        {
+            * extendedHeaderFlags |= ENET_PROTOCOL_HEADER_EXTENDED_FLAG_ENCRYPTED;
+            contentData = encryptedData;
+            contentSize = encryptedSize;
+        }
+    }
+
+done:
+    * outData = contentData;
+
+    return contentSize;
+}
+
 static int
 enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int checkForTimeouts)
 {
@@ -1695,16 +2391,20 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
     ENetProtocolHeader * header = (ENetProtocolHeader *) headerData;
     int sentLength = 0;
     size_t newSize = 0;
+    enet_uint8 * newData = NULL;
+    const ENetProtocol * command;
     ENetList sentUnreliableCommands;
-    size_t contentBufferIndex;
+    int holdCommands = 0;
     int hasExtendedHeaders = 0;
     enet_uint16 extendedHeaderFlags = 0;
 
     enet_list_clear (& sentUnreliableCommands);
 
+    ENET_TRACE_CLOCK (host);
+
     for (int sendPass = 0, continueSending = 0; sendPass <= continueSending; ++ sendPass)
     for (ENetPeer * currentPeer = host -> peers;
-         currentPeer < & host -> peers [host -> peerCount];
+         currentPeer < & host -> peers [host -> committedPeers];
          ++ currentPeer)
     {
         if (currentPeer -> state == ENET_PEER_STATE_DISCONNECTED ||
@@ -1733,8 +2433,22 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
               goto nextPeer;
         }
 
+        if (sendPass == 0 && ! enet_list_empty (& currentPeer -> streams))
+          enet_peer_pump_streams (currentPeer);
+
+        if (sendPass == 0 && currentPeer -> aggregatingChannels > 0)
+          enet_peer_flush_aggregates (currentPeer, ! checkForTimeouts);
+
+        if (sendPass == 0 && currentPeer -> fecChannels > 0)
+          enet_peer_flush_parity (currentPeer);
+
+        holdCommands = sendPass == 0 && enet_protocol_coalesce_outgoing_commands (host, currentPeer);
+        if (! holdCommands)
+          currentPeer -> flags &= ~ ENET_PEER_FLAG_FLUSH;
+
         if (((enet_list_empty (& currentPeer -> outgoingCommands) &&
               enet_list_empty (& currentPeer -> outgoingSendReliableCommands)) ||
+             holdCommands ||
              enet_protocol_check_outgoing_commands (host, currentPeer, & sentUnreliableCommands)) &&
             enet_list_empty (& currentPeer -> sentReliableCommands) &&
             ENET_TIME_DIFFERENCE (host -> serviceTime, currentPeer -> lastReceiveTime) >= currentPeer -> pingInterval &&
@@ -1747,6 +2461,9 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
         if (host -> commandCount == 0)
           goto nextPeer;
 
+        currentPeer -> coalescedCommands = 0;
+        currentPeer -> coalescedDataLength = 0;
+
         if (currentPeer -> packetLossEpoch == 0)
           currentPeer -> packetLossEpoch = host -> serviceTime;
         else
@@ -1777,58 +2494,10 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
         else
           host -> buffers -> dataLength = (size_t) & ((ENetProtocolHeader *) 0) -> sentTime;
 
-        newSize = 0;
-        if (host -> compressor.context != NULL && host -> compressor.compress != NULL)
-        {
-            size_t originalSize = host -> packetSize - sizeof(ENetProtocolHeader),
-                   compressedSize = host -> compressor.compress (host -> compressor.context,
-                                        & host -> buffers [1], host -> bufferCount - 1,
-                                        originalSize,
-                                        host -> packetData [1],
-                                        originalSize);
-            if (compressedSize > 0 && compressedSize < originalSize)
-            {
-                host -> headerFlags |= ENET_PROTOCOL_HEADER_FLAG_COMPRESSED;
-                newSize = compressedSize;
-                contentBufferIndex = 1;
-#ifdef ENET_DEBUG_COMPRESS
-                printf ("peer %u: compressed %u -> %u (%u%%)\n", currentPeer -> incomingPeerID, originalSize, compressedSize, (compressedSize * 100) / originalSize);
-#endif
-            }
-        }
-
-        if (host -> encryptor.context != NULL && host -> encryptor.encrypt != NULL)
-        {
-            ENetBuffer compressedBuffer;
-            size_t originalSize = host->packetSize - sizeof(ENetProtocolHeader);
-            size_t encryptedSize;
-            if (newSize > 0)
-            {
-                compressedBuffer.data = host -> packetData [contentBufferIndex];
-                compressedBuffer.dataLength = newSize;
-                encryptedSize = host -> encryptor.encrypt(host -> encryptor.context,
-                    currentPeer,
-                    &compressedBuffer, 1,
-                    newSize,
-                    host -> packetData [0],
-                    sizeof (host->packetData [0]));
-            }
-            else
-                encryptedSize = host -> encryptor.encrypt(host -> encryptor.context,
-                    currentPeer,
-                    &host -> buffers [1], host -> bufferCount - 1,
-                    originalSize,
-                    host -> packetData [0],
-                    sizeof (host->packetData [0]));
-
-            hasExtendedHeaders = 1;
-            if (encryptedSize > 0)
-            {
-                extendedHeaderFlags |= ENET_PROTOCOL_HEADER_EXTENDED_FLAG_ENCRYPTED;
-                newSize = encryptedSize;
-                contentBufferIndex = 0;
-            }
-        }
+        hasExtendedHeaders = host -> encryptor.context != NULL &&
+                             (host -> encryptor.encrypt != NULL || host -> encryptor.encryptInPlace != NULL);
+        extendedHeaderFlags = 0;
+        newSize = enet_protocol_transform_outgoing_commands (host, currentPeer, & extendedHeaderFlags, & newData);
 
         if (currentPeer -> outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID)
           host -> headerFlags |= currentPeer -> outgoingSessionID << ENET_PROTOCOL_HEADER_SESSION_SHIFT;
@@ -1863,22 +2532,56 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
 
         if (newSize > 0)
         {
-            host -> buffers [1].data = host -> packetData [contentBufferIndex];
-            host -> buffers [1].dataLength = newSize;
-            host -> bufferCount = 2;
+            /* The transformed payload sits right after the buffer headroom, so the header is
+               written in front of it and the datagram goes out as a single contiguous buffer. */
+            memcpy (newData - host -> buffers -> dataLength, headerData, host -> buffers -> dataLength);
+            host -> buffers -> data = newData - host -> buffers -> dataLength;
+            host -> buffers -> dataLength += newSize;
+            host -> bufferCount = 1;
         }
 
         currentPeer -> lastSendTime = host -> serviceTime;
 
-        sentLength = enet_socket_send (host -> socket, & currentPeer -> address, host -> buffers, host -> bufferCount);
+        if (host -> replay != NULL)
+        {
+           /* A replayed host answers peers that only exist in its capture, so nothing leaves it. */
+           size_t bufferIndex;
+
+           sentLength = 0;
+           for (bufferIndex = 0; bufferIndex < host -> bufferCount; ++ bufferIndex)
+             sentLength += (int) host -> buffers [bufferIndex].dataLength;
+        }
+        else
+        if (host -> socketBackend.context != NULL)
+          sentLength = host -> socketBackend.send (host -> socketBackend.context, host, & currentPeer -> address, host -> buffers, host -> bufferCount);
+        else
+          sentLength = enet_socket_send (host -> socket, & currentPeer -> address, host -> buffers, host -> bufferCount);
 
         enet_protocol_remove_sent_unreliable_commands (currentPeer, & sentUnreliableCommands);
 
         if (sentLength < 0)
           return -1;
 
+        if (host -> captureFile != NULL && sentLength > 0)
+          enet_host_capture_datagram (host, & currentPeer -> address, 1, host -> buffers, host -> bufferCount);
+
         host -> totalSentData += sentLength;
         host -> totalSentPackets ++;
+        host -> stats.sentData += sentLength;
+        ++ host -> stats.sentDatagrams;
+        currentPeer -> totalSentData += sentLength;
+
+        ENET_TRACE (host, ENET_TRACE_EVENT_DATAGRAM_SEND, currentPeer, (enet_uint8) host -> commandCount, (enet_uint32) sentLength, 0);
+
+        for (command = host -> commands; command < & host -> commands [host -> commandCount]; ++ command)
+          ++ host -> stats.sentCommands [command -> header.command & ENET_PROTOCOL_COMMAND_MASK];
+
+        {
+            enet_uint32 fill = (enet_uint32) sentLength * ENET_PEER_PACKET_LOSS_SCALE / currentPeer -> mtu;
+
+            currentPeer -> datagramFill = currentPeer -> datagramsSent > 0 ? (currentPeer -> datagramFill * 15 + fill) / 16 : fill;
+            ++ currentPeer -> datagramsSent;
+        }
 
     nextPeer:
         if (currentPeer -> flags & ENET_PEER_FLAG_CONTINUE_SENDING)
@@ -1923,21 +2626,8 @@ enet_host_check_events (ENetHost * host, ENetEvent * event)
     return enet_protocol_dispatch_incoming_commands (host, event);
 }
 
-/** Waits for events on the host specified and shuttles packets between
-    the host and its peers.
-
-    @param host    host to service
-    @param event   an event structure where event details will be placed if one occurs
-                   if event == NULL then no events will be delivered
-    @param timeout number of milliseconds that ENet should wait for events
-    @retval > 0 if an event occurred within the specified time limit
-    @retval 0 if no event occurred
-    @retval < 0 on failure
-    @remarks enet_host_service should be called fairly regularly for adequate performance
-    @ingroup host
-*/
-int
-enet_host_service (ENetHost * host, ENetEvent * event, enet_uint32 timeout)
+static int
+enet_protocol_service (ENetHost * host, ENetEvent * event, enet_uint32 timeout)
 {
     enet_uint32 waitCondition;
 
@@ -1971,7 +2661,10 @@ enet_host_service (ENetHost * host, ENetEvent * event, enet_uint32 timeout)
     do
     {
        if (ENET_TIME_DIFFERENCE (host -> serviceTime, host -> bandwidthThrottleEpoch) >= ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL)
+       {
          enet_host_bandwidth_throttle (host);
+         enet_host_release_peers (host);
+       }
 
        switch (enet_protocol_send_outgoing_commands (host, event, 1))
        {
@@ -2052,6 +2745,12 @@ enet_host_service (ENetHost * host, ENetEvent * event, enet_uint32 timeout)
 
           waitCondition = ENET_SOCKET_WAIT_RECEIVE | ENET_SOCKET_WAIT_INTERRUPT;
 
+          if (host -> socketBackend.context != NULL)
+          {
+             if (host -> socketBackend.wait (host -> socketBackend.context, host, & waitCondition, ENET_TIME_DIFFERENCE (timeout, host -> serviceTime)) != 0)
+               return -1;
+          }
+          else
           if (enet_socket_wait (host -> socket, & waitCondition, ENET_TIME_DIFFERENCE (timeout, host -> serviceTime)) != 0)
             return -1;
        }
@@ -2063,3 +2762,27 @@ enet_host_service (ENetHost * host, ENetEvent * event, enet_uint32 timeout)
     return 0; 
 }
 
+/** Waits for events on the host specified and shuttles packets between
+    the host and its peers.
+
+    @param host    host to service
+    @param event   an event structure where event details will be placed if one occurs
+                   if event == NULL then no events will be delivered
+    @param timeout number of milliseconds that ENet should wait for events
+    @retval > 0 if an event occurred within the specified time limit
+    @retval 0 if no event occurred
+    @retval < 0 on failure
+    @remarks enet_host_service should be called fairly regularly for adequate performance
+    @ingroup host
+*/
+int
+enet_host_service (ENetHost * host, ENetEvent * event, enet_uint32 timeout)
+{
+    int result = enet_protocol_service (host, event, timeout);
+
+    /* The commands the application queues until the next service are traced at a fresh time. */
+    ENET_TRACE_CLOCK (host);
+
+    return result;
+}
+
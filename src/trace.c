@@ -0,0 +1,189 @@
+/**
+ @file  trace.c
+ @brief ENet protocol event trace
+*/
+#include <stdio.h>
+#include <string.h>
+#define ENET_BUILDING_LIB 1
+#include "rcenet/enet.h"
+#include "rcenet/time.h"
+
+/** @defgroup Trace ENet protocol event trace
+    @{
+*/
+
+/** Enables, resizes or disables the event trace of a host.
+
+    The protocol then records its datagrams sent and received, the commands queued, sent,
+    retransmitted and acknowledged, the changes of throttle and the state transitions of the
+    peers in a ring of fixed size, without locking or allocating. Once the ring is full, the
+    oldest events unread are overwritten, which makes the ring a flight recorder of the last
+    capacity events. The events are read with enet_host_trace_read or appended to a file with
+    enet_host_trace_write, from the thread that services the host. When the library is built with
+    ENET_NO_TRACE, the tracepoints are compiled out and the trace cannot be enabled.
+
+    @param host host to trace
+    @param capacity number of events kept, rounded up to a power of two; 0 disables the trace and
+    frees its ring. Events not read yet are lost when the trace is resized.
+    @retval 0 on success
+    @retval < 0 if the ring could not be allocated or the tracepoints are compiled out
+*/
+int
+enet_host_trace_enable (ENetHost * host, size_t capacity)
+{
+    ENetTraceEvent * traceEvents = NULL;
+    size_t traceCapacity = 0;
+
+    if (capacity > 0)
+    {
+#ifdef ENET_NO_TRACE
+       return -1;
+#else
+       for (traceCapacity = 1; traceCapacity < capacity; traceCapacity <<= 1)
+         if (traceCapacity > ((size_t) -1) / (2 * sizeof (ENetTraceEvent)))
+           return -1;
+
+       traceEvents = (ENetTraceEvent *) enet_malloc (traceCapacity * sizeof (ENetTraceEvent));
+       if (traceEvents == NULL)
+         return -1;
+#endif
+    }
+
+    if (host -> traceEvents != NULL)
+      enet_free (host -> traceEvents);
+
+    host -> traceEvents = traceEvents;
+    host -> traceCapacity = traceCapacity;
+    host -> traceWritten = 0;
+    host -> traceRead = 0;
+    host -> traceTimeStale = 1;
+
+    return 0;
+}
+
+/** Reads the oldest events of the trace of a host not read yet.
+    @param host host whose trace is read
+    @param events receives the events, oldest first. If events were overwritten before being
+    read, the first one is an ENET_TRACE_EVENT_LOST event giving their number.
+    @param eventCount maximum number of events to read
+    @returns the number of events read, 0 once the trace is drained or if it is disabled
+*/
+size_t
+enet_host_trace_read (ENetHost * host, ENetTraceEvent * events, size_t eventCount)
+{
+    size_t count = 0;
+
+    if (host -> traceEvents == NULL || eventCount == 0)
+      return 0;
+
+    if (host -> traceWritten - host -> traceRead > host -> traceCapacity)
+    {
+       ENetTraceEvent * lost = & events [count ++];
+       size_t lostCount = host -> traceWritten - host -> traceRead - host -> traceCapacity;
+
+       host -> traceRead += lostCount;
+
+       * lost = host -> traceEvents [host -> traceRead & (host -> traceCapacity - 1)];
+       lost -> type = ENET_TRACE_EVENT_LOST;
+       lost -> detail = 0;
+       lost -> peerID = ENET_PROTOCOL_MAXIMUM_PEER_ID;
+       lost -> value = lostCount > 0xFFFFFFFFu ? 0xFFFFFFFFu : (enet_uint32) lostCount;
+       lost -> extra = 0;
+    }
+
+    for (; count < eventCount && host -> traceRead != host -> traceWritten; ++ count, ++ host -> traceRead)
+      events [count] = host -> traceEvents [host -> traceRead & (host -> traceCapacity - 1)];
+
+    return count;
+}
+
+static void
+enet_trace_put_16 (enet_uint8 * data, enet_uint16 value)
+{
+    data [0] = (enet_uint8) value;
+    data [1] = (enet_uint8) (value >> 8);
+}
+
+static void
+enet_trace_put_32 (enet_uint8 * data, enet_uint32 value)
+{
+    data [0] = (enet_uint8) value;
+    data [1] = (enet_uint8) (value >> 8);
+    data [2] = (enet_uint8) (value >> 16);
+    data [3] = (enet_uint8) (value >> 24);
+}
+
+/** Appends the events of the trace of a host not read yet to a binary trace file, which the
+    rcenet_trace tool decodes to text or to the Chrome trace format. The file header is written
+    first if the file is empty. The format of the file is described with ENetTraceEvent.
+    @param host host whose trace is written
+    @param fileName path of the file, created if needed
+    @returns the number of events written
+    @retval < 0 if the trace is disabled or the file could not be written
+*/
+int
+enet_host_trace_write (ENetHost * host, const char * fileName)
+{
+    ENetTraceEvent events [256];
+    enet_uint8 data [sizeof (events) / sizeof (events [0]) * ENET_TRACE_EVENT_SIZE];
+    size_t count, i;
+    int written = 0;
+    FILE * file;
+
+    if (host -> traceEvents == NULL)
+      return -1;
+
+    file = fopen (fileName, "ab");
+    if (file == NULL)
+      return -1;
+
+    if (fseek (file, 0, SEEK_END) != 0)
+    {
+       fclose (file);
+       return -1;
+    }
+
+    if (ftell (file) == 0)
+    {
+       memset (data, 0, ENET_TRACE_FILE_HEADER_SIZE);
+       memcpy (data, "RCETRACE", 8);
+       enet_trace_put_16 (& data [8], ENET_TRACE_FILE_VERSION);
+       enet_trace_put_16 (& data [10], ENET_TRACE_EVENT_SIZE);
+
+       if (fwrite (data, ENET_TRACE_FILE_HEADER_SIZE, 1, file) != 1)
+       {
+          fclose (file);
+          return -1;
+       }
+    }
+
+    while ((count = enet_host_trace_read (host, events, sizeof (events) / sizeof (events [0]))) > 0)
+    {
+       for (i = 0; i < count; ++ i)
+       {
+          enet_uint8 * event = & data [i * ENET_TRACE_EVENT_SIZE];
+
+          enet_trace_put_32 (& event [0], events [i].time);
+          event [4] = events [i].type;
+          event [5] = events [i].detail;
+          enet_trace_put_16 (& event [6], events [i].peerID);
+          enet_trace_put_32 (& event [8], events [i].value);
+          enet_trace_put_32 (& event [12], events [i].extra);
+       }
+
+       if (fwrite (data, ENET_TRACE_EVENT_SIZE, count, file) != count)
+       {
+          fclose (file);
+          return -1;
+       }
+
+       written += (int) count;
+    }
+
+    if (fclose (file) != 0)
+      return -1;
+
+    return written;
+}
+
+/** @} */
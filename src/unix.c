@@ -8,6 +8,7 @@
 #include <sys/socket.h>
 #include <sys/ioctl.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 #include <netinet/tcp.h>
 #include <netdb.h>
 #include <unistd.h>
@@ -53,6 +54,14 @@
 #include <poll.h>
 #endif
 
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
 #if !defined(HAS_SOCKLEN_T) && !defined(__socklen_t_defined)
 typedef int socklen_t;
 #endif
@@ -196,6 +205,9 @@ enet_time_get (void)
 {
     struct timeval timeVal;
 
+    if (enet_time_virtual != NULL)
+      return (enet_uint32) (* enet_time_virtual / 1000) - timeBase;
+
     gettimeofday (& timeVal, NULL);
 
     return timeVal.tv_sec * 1000 + timeVal.tv_usec / 1000 - timeBase;
@@ -206,11 +218,72 @@ enet_time_set (enet_uint32 newTimeBase)
 {
     struct timeval timeVal;
 
+    if (enet_time_virtual != NULL)
+    {
+       timeBase = (enet_uint32) (* enet_time_virtual / 1000) - newTimeBase;
+       return;
+    }
+
     gettimeofday (& timeVal, NULL);
     
     timeBase = timeVal.tv_sec * 1000 + timeVal.tv_usec / 1000 - newTimeBase;
 }
 
+enet_uint32
+enet_time_get_us (void)
+{
+    struct timespec timeSpec;
+
+    if (enet_time_virtual != NULL)
+      return (enet_uint32) * enet_time_virtual;
+
+    clock_gettime (CLOCK_MONOTONIC, & timeSpec);
+
+    return (enet_uint32) timeSpec.tv_sec * 1000000 + (enet_uint32) (timeSpec.tv_nsec / 1000);
+}
+
+void *
+enet_memory_reserve (size_t size)
+{
+    void * memory = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    return memory != MAP_FAILED ? memory : NULL;
+}
+
+int
+enet_memory_commit (void * memory, size_t size)
+{
+    /* The mapping takes physical memory as pages are written; there is nothing to commit. */
+    (void) memory;
+    (void) size;
+
+    return 0;
+}
+
+int
+enet_memory_discard (void * memory, size_t size)
+{
+#ifdef __linux__
+    /* Private anonymous pages read back as zeros once dropped. */
+    return madvise (memory, size, MADV_DONTNEED);
+#else
+    /* Elsewhere MADV_DONTNEED may keep the contents, so map fresh zero pages over the range. */
+    return mmap (memory, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) != MAP_FAILED ? 0 : -1;
+#endif
+}
+
+void
+enet_memory_release (void * memory, size_t size)
+{
+    munmap (memory, size);
+}
+
+size_t
+enet_memory_page_size (void)
+{
+    return (size_t) sysconf (_SC_PAGESIZE);
+}
+
 int
 enet_address_set_host (ENetAddress * address, ENetAddressType type, const char * name)
 {
@@ -364,7 +437,7 @@ int
 enet_socket_get_address (ENetSocket socket, ENetAddress * address)
 {
     unsigned char sockAddrBuf[sizeof(struct sockaddr_in6)] = { 0 };
-    int bufferLength;
+    socklen_t bufferLength = sizeof (sockAddrBuf);
 
     if (getsockname(socket, (struct sockaddr *) sockAddrBuf, &bufferLength) == -1)
         return -1;
@@ -169,13 +169,72 @@ enet_host_random_seed (void)
 enet_uint32
 enet_time_get (void)
 {
+    if (enet_time_virtual != NULL)
+      return (enet_uint32) (* enet_time_virtual / 1000) - timeBase;
+
     return (enet_uint32) timeGetTime () - timeBase;
 }
 
 void
 enet_time_set (enet_uint32 newTimeBase)
 {
-    timeBase = (enet_uint32) timeGetTime () - newTimeBase;
+    if (enet_time_virtual != NULL)
+      timeBase = (enet_uint32) (* enet_time_virtual / 1000) - newTimeBase;
+    else
+      timeBase = (enet_uint32) timeGetTime () - newTimeBase;
+}
+
+enet_uint32
+enet_time_get_us (void)
+{
+    LARGE_INTEGER counter, frequency;
+
+    if (enet_time_virtual != NULL)
+      return (enet_uint32) * enet_time_virtual;
+
+    QueryPerformanceCounter (& counter);
+    QueryPerformanceFrequency (& frequency);
+
+    return (enet_uint32) ((counter.QuadPart / frequency.QuadPart) * 1000000 +
+                          (counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart);
+}
+
+void *
+enet_memory_reserve (size_t size)
+{
+    /* Only the address space: pages are charged to the commit limit by enet_memory_commit. */
+    return VirtualAlloc (NULL, size, MEM_RESERVE, PAGE_READWRITE);
+}
+
+int
+enet_memory_commit (void * memory, size_t size)
+{
+    return VirtualAlloc (memory, size, MEM_COMMIT, PAGE_READWRITE) != NULL ? 0 : -1;
+}
+
+int
+enet_memory_discard (void * memory, size_t size)
+{
+    /* Committing the pages again later gives zero pages on first touch. */
+    return VirtualFree (memory, size, MEM_DECOMMIT) ? 0 : -1;
+}
+
+void
+enet_memory_release (void * memory, size_t size)
+{
+    (void) size;
+
+    VirtualFree (memory, 0, MEM_RELEASE);
+}
+
+size_t
+enet_memory_page_size (void)
+{
+    SYSTEM_INFO systemInfo;
+
+    GetSystemInfo (& systemInfo);
+
+    return (size_t) systemInfo.dwPageSize;
 }
 
 int
@@ -273,7 +332,7 @@ int
 enet_socket_get_address (ENetSocket socket, ENetAddress * address)
 {
     unsigned char sockAddrBuf[sizeof(struct sockaddr_in6)] = { 0 };
-    int bufferLength;
+    int bufferLength = sizeof (sockAddrBuf);
 
     if (getsockname (socket, (struct sockaddr *) sockAddrBuf, &bufferLength) == -1)
       return -1;
@@ -0,0 +1,123 @@
+/**
+ @file  rcenet_replay.c
+ @brief Replays a capture written by enet_host_capture_open into a fresh host
+
+ Feeds the datagrams a captured host received to a new host, which takes the place of the captured
+ one, and prints the events it produces with the virtual time at which they occur, then how long
+ the replay took. The new host should be given the peer count and channel limit of the captured
+ host, so that peers and channels are allocated the same way. Since the replay cannot make the
+ application calls of the captured process, it reproduces hosts that accept their connections,
+ such as servers; the packets received are counted but not answered.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rcenet/enet.h"
+
+int
+main (int argc, char ** argv)
+{
+    const char * fileName = NULL;
+    size_t peerCount = 32, channelLimit = ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT;
+    size_t counts [4] = { 0, 0, 0, 0 };
+    unsigned long receivedData = 0;
+    int quiet = 0, result, argi;
+    enet_uint32 start, elapsed;
+    ENetReplay * replay;
+    ENetHost * host;
+    ENetEvent event;
+
+    for (argi = 1; argi < argc; ++ argi)
+    {
+        if (strcmp (argv [argi], "--peers") == 0 && argi + 1 < argc)
+          peerCount = (size_t) strtoul (argv [++ argi], NULL, 10);
+        else
+        if (strcmp (argv [argi], "--channels") == 0 && argi + 1 < argc)
+          channelLimit = (size_t) strtoul (argv [++ argi], NULL, 10);
+        else
+        if (strcmp (argv [argi], "--quiet") == 0)
+          quiet = 1;
+        else
+        if (fileName == NULL)
+          fileName = argv [argi];
+        else
+          fileName = NULL, argi = argc;
+    }
+
+    if (fileName == NULL || peerCount == 0)
+    {
+        fprintf (stderr, "usage: %s [--peers count] [--channels count] [--quiet] capture-file\n", argv [0]);
+        return 2;
+    }
+
+    if (enet_initialize () != 0)
+    {
+        fprintf (stderr, "rcenet_replay: cannot initialize the library\n");
+        return 1;
+    }
+
+    replay = enet_replay_create (fileName);
+    if (replay == NULL)
+    {
+        fprintf (stderr, "rcenet_replay: %s is not a capture of a host\n", fileName);
+        enet_deinitialize ();
+        return 1;
+    }
+
+    host = enet_host_create (ENET_ADDRESS_TYPE_ANY, NULL, peerCount, channelLimit, 0, 0);
+    if (host == NULL)
+    {
+        fprintf (stderr, "rcenet_replay: cannot create a host\n");
+        enet_replay_destroy (replay);
+        enet_deinitialize ();
+        return 1;
+    }
+
+    start = enet_time_get_us ();
+
+    while ((result = enet_replay_service (replay, host, & event)) > 0)
+    {
+        if (event.type < sizeof (counts) / sizeof (counts [0]))
+          ++ counts [event.type];
+
+        switch (event.type)
+        {
+        case ENET_EVENT_TYPE_CONNECT:
+           if (! quiet)
+             printf ("%10u peer %u connect data=%u\n", (unsigned) host -> serviceTime, (unsigned) event.peer -> incomingPeerID, (unsigned) event.data);
+           break;
+
+        case ENET_EVENT_TYPE_DISCONNECT:
+           if (! quiet)
+             printf ("%10u peer %u disconnect data=%u\n", (unsigned) host -> serviceTime, (unsigned) event.peer -> incomingPeerID, (unsigned) event.data);
+           break;
+
+        case ENET_EVENT_TYPE_RECEIVE:
+           if (! quiet)
+             printf ("%10u peer %u receive channel=%u length=%lu\n", (unsigned) host -> serviceTime, (unsigned) event.peer -> incomingPeerID,
+                     (unsigned) event.channelID, (unsigned long) event.packet -> dataLength);
+           receivedData += (unsigned long) event.packet -> dataLength;
+           enet_packet_destroy (event.packet);
+           break;
+
+        default:
+           break;
+        }
+    }
+
+    elapsed = enet_time_get_us () - start;
+
+    printf ("%lu connects, %lu disconnects, %lu packets (%lu bytes), %lu datagrams in %.3f ms\n",
+            (unsigned long) counts [ENET_EVENT_TYPE_CONNECT], (unsigned long) counts [ENET_EVENT_TYPE_DISCONNECT],
+            (unsigned long) counts [ENET_EVENT_TYPE_RECEIVE], receivedData,
+            (unsigned long) host -> stats.receivedDatagrams, elapsed / 1000.0);
+
+    if (result < 0)
+      fprintf (stderr, "rcenet_replay: %s is truncated\n", fileName);
+
+    enet_host_destroy (host);
+    enet_replay_destroy (replay);
+    enet_deinitialize ();
+
+    return result < 0 ? 1 : 0;
+}
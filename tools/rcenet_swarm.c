@@ -0,0 +1,661 @@
+/**
+ @file  rcenet_swarm.c
+ @brief Load generator running thousands of simulated clients over a few sockets
+
+ Each simulated client is one outgoing peer of a client-side host, and the clients are spread over
+ a few such hosts, 4096 per host by default, so that ten thousand clients take three sockets and
+ three packet buffers instead of ten thousand. The clients connect at a bounded rate, then each
+ sends one message per tick at the given tick rate, the ticks of the clients being spread evenly
+ over the tick interval. Message sizes are drawn uniformly between a minimum and a maximum, and a
+ given share of the messages is reliable, sent on channel 0; the others are unreliable, sent on
+ channel 1. With churn, that many random clients per second disconnect and connect again, once
+ every client has connected; the distributions are also measured from then on, so that the
+ connection storm of the ramp-up does not weigh on them.
+
+ Every message starts with the time it was sent, in microseconds of enet_time_get_us, and the
+ index of its client. A server that echoes the messages back unchanged lets the swarm measure
+ round trips. With --local the swarm runs such a server itself on loopback, in the same process,
+ and reports the latency distributions observed by the server: the delay from sending to
+ receiving each message, and the round trip times and reliable delivery latencies of the host
+ histograms of the server. The server then shares the thread of the clients, so its figures
+ include the time it waits for them to be serviced.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rcenet/enet.h"
+#include "rcenet/time.h"
+
+#define SWARM_CLIENTS_PER_SOCKET 4096
+#define SWARM_CONNECT_BATCH      1024
+#define SWARM_MESSAGE_HEADER     8
+#define SWARM_MAXIMUM_SIZE       (64 * 1024)
+#define SWARM_SOCKET_BUFFER_SIZE (4 * 1024 * 1024)
+#define SWARM_DRAIN_TIME         3000
+
+typedef struct _SwarmClient
+{
+   ENetPeer * peer;
+   size_t host;
+   int connected;
+   int leaving;
+} SwarmClient;
+
+typedef struct _SwarmOptions
+{
+   size_t clients;
+   size_t sockets;
+   enet_uint32 tickRate;
+   size_t minimumSize;
+   size_t maximumSize;
+   enet_uint32 reliablePercent;
+   enet_uint32 churnRate;
+   enet_uint32 connectRate;
+   enet_uint32 duration;
+   enet_uint32 seed;
+   int local;
+   int quiet;
+} SwarmOptions;
+
+typedef struct _SwarmStats
+{
+   enet_uint64 connects;
+   enet_uint64 failedConnects;
+   enet_uint64 droppedClients;
+   enet_uint64 churned;
+   enet_uint64 sentMessages;
+   enet_uint64 sentReliable;
+   enet_uint64 sentBytes;
+   enet_uint64 echoes;
+   enet_uint64 serverMessages;
+} SwarmStats;
+
+static SwarmOptions options;
+static SwarmStats stats;
+static SwarmClient * clients = NULL;
+static size_t * idleClients = NULL;
+static size_t idleCount = 0, connectingCount = 0, connectedCount = 0;
+static ENetHost ** hosts = NULL;
+static ENetHost * server = NULL;
+static ENetHistogram echoRoundTrips, serverLatencies;
+static enet_uint8 message [SWARM_MAXIMUM_SIZE];
+static int steady = 0, stopping = 0;
+
+static enet_uint32
+swarm_random (void)
+{
+    options.seed ^= options.seed << 13;
+    options.seed ^= options.seed >> 17;
+    options.seed ^= options.seed << 5;
+    return options.seed;
+}
+
+static int
+swarm_parse_range (const char * text, size_t * minimum, size_t * maximum)
+{
+    char * end;
+
+    * minimum = (size_t) strtoul (text, & end, 10);
+    * maximum = * minimum;
+    if (* end == '-')
+      * maximum = (size_t) strtoul (end + 1, & end, 10);
+
+    return * end == '\0' && * minimum >= SWARM_MESSAGE_HEADER && * minimum <= * maximum && * maximum <= SWARM_MAXIMUM_SIZE ? 0 : -1;
+}
+
+/** Parses host:port, or [host]:port for an IPv6 address. */
+static int
+swarm_parse_address (const char * text, ENetAddress * address)
+{
+    char name [256];
+    const char * port = strrchr (text, ':');
+    size_t nameLength;
+
+    if (port == NULL || port == text)
+      return -1;
+
+    nameLength = (size_t) (port - text);
+    if (text [0] == '[' && text [nameLength - 1] == ']')
+    {
+        ++ text;
+        nameLength -= 2;
+    }
+
+    if (nameLength == 0 || nameLength >= sizeof (name))
+      return -1;
+
+    memcpy (name, text, nameLength);
+    name [nameLength] = '\0';
+
+    memset (address, 0, sizeof (ENetAddress));
+    address -> port = (enet_uint16) strtoul (port + 1, NULL, 10);
+
+    return address -> port != 0 && enet_address_set_host (address, ENET_ADDRESS_TYPE_ANY, name) == 0 ? 0 : -1;
+}
+
+static void
+swarm_print_histogram (const char * name, const ENetHistogram * histogram, const char * unit)
+{
+    if (histogram == NULL || histogram -> count == 0)
+    {
+        printf ("%-28s no samples\n", name);
+        return;
+    }
+
+    printf ("%-28s %10llu samples  p50 %6u  p90 %6u  p99 %6u  p99.9 %6u  max %6u %s\n", name, (unsigned long long) histogram -> count,
+            (unsigned) enet_histogram_percentile (histogram, 50.0), (unsigned) enet_histogram_percentile (histogram, 90.0),
+            (unsigned) enet_histogram_percentile (histogram, 99.0), (unsigned) enet_histogram_percentile (histogram, 99.9),
+            (unsigned) histogram -> maximum, unit);
+}
+
+/** Starts the connection of at most budget idle clients, keeping at most SWARM_CONNECT_BATCH
+    handshakes in flight. */
+static void
+swarm_connect (const ENetAddress * address, size_t budget)
+{
+    while (idleCount > 0 && budget > 0 && connectingCount < SWARM_CONNECT_BATCH)
+    {
+        SwarmClient * client = & clients [idleClients [-- idleCount]];
+
+        client -> peer = enet_host_connect (hosts [client -> host], address, 2, 0);
+        if (client -> peer == NULL)
+        {
+            /* Every peer of the host is still in use, by clients disconnecting. */
+            ++ idleCount;
+            return;
+        }
+
+        client -> peer -> data = client;
+        client -> connected = 0;
+        client -> leaving = 0;
+
+        ++ connectingCount;
+        -- budget;
+    }
+}
+
+static void
+swarm_send (SwarmClient * client, enet_uint32 clientIndex)
+{
+    size_t size = options.minimumSize + (options.maximumSize > options.minimumSize ? swarm_random () % (options.maximumSize - options.minimumSize + 1) : 0);
+    int reliable = swarm_random () % 100 < options.reliablePercent;
+    enet_uint32 now = enet_time_get_us ();
+
+    memcpy (message, & now, sizeof (now));
+    memcpy (message + sizeof (now), & clientIndex, sizeof (clientIndex));
+
+    if (enet_peer_send (client -> peer, reliable ? 0 : 1, enet_packet_create (message, size, reliable ? ENET_PACKET_FLAG_RELIABLE : 0)) < 0)
+      return;
+
+    ++ stats.sentMessages;
+    stats.sentReliable += reliable;
+    stats.sentBytes += size;
+}
+
+static int
+swarm_service_client_host (ENetHost * host)
+{
+    ENetEvent event;
+    int result;
+
+    for (result = enet_host_service (host, & event, 0);
+         result > 0;
+         result = enet_host_check_events (host, & event))
+    {
+        SwarmClient * client = event.peer != NULL ? (SwarmClient *) event.peer -> data : NULL;
+        enet_uint32 sentTime;
+
+        switch (event.type)
+        {
+        case ENET_EVENT_TYPE_CONNECT:
+            if (client == NULL)
+              break;
+
+            client -> connected = 1;
+            -- connectingCount;
+            ++ connectedCount;
+            ++ stats.connects;
+            break;
+
+        case ENET_EVENT_TYPE_DISCONNECT:
+        case ENET_EVENT_TYPE_DISCONNECT_TIMEOUT:
+            if (client == NULL)
+              break;
+
+            if (client -> connected)
+            {
+                -- connectedCount;
+                if (! client -> leaving)
+                  ++ stats.droppedClients;
+            }
+            else
+            {
+                -- connectingCount;
+                ++ stats.failedConnects;
+            }
+
+            client -> peer -> data = NULL;
+            client -> peer = NULL;
+            client -> connected = 0;
+            idleClients [idleCount ++] = (size_t) (client - clients);
+            break;
+
+        case ENET_EVENT_TYPE_RECEIVE:
+            if (event.packet -> dataLength >= SWARM_MESSAGE_HEADER)
+            {
+                memcpy (& sentTime, event.packet -> data, sizeof (sentTime));
+                enet_histogram_record (& echoRoundTrips, enet_time_get_us () - sentTime);
+                ++ stats.echoes;
+            }
+            enet_packet_destroy (event.packet);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return result;
+}
+
+static int
+swarm_service_server (void)
+{
+    ENetEvent event;
+    int result;
+
+    for (result = enet_host_service (server, & event, 0);
+         result > 0;
+         result = enet_host_check_events (server, & event))
+    {
+        enet_uint32 sentTime;
+
+        if (event.type != ENET_EVENT_TYPE_RECEIVE)
+          continue;
+
+        if (event.packet -> dataLength >= SWARM_MESSAGE_HEADER)
+        {
+            memcpy (& sentTime, event.packet -> data, sizeof (sentTime));
+            enet_histogram_record (& serverLatencies, enet_time_get_us () - sentTime);
+            ++ stats.serverMessages;
+        }
+
+        /* Echo the message back as it came, handing the received packet over. */
+        if (stopping || enet_peer_send (event.peer, event.channelID, event.packet) < 0)
+          enet_packet_destroy (event.packet);
+    }
+
+    return result;
+}
+
+static int
+swarm_service (void)
+{
+    size_t i;
+
+    if (server != NULL && swarm_service_server () < 0)
+      return -1;
+
+    for (i = 0; i < options.sockets; ++ i)
+      if (swarm_service_client_host (hosts [i]) < 0)
+        return -1;
+
+    return 0;
+}
+
+static void
+swarm_reset_histograms (ENetHost * host)
+{
+    size_t kind;
+
+    for (kind = 0; host != NULL && host -> histograms != NULL && kind < ENET_HISTOGRAM_COUNT; ++ kind)
+      enet_histogram_reset (& host -> histograms [kind]);
+}
+
+/** Disconnects a random connected client, for churn.
+    @returns 0 if a client was disconnected, < 0 if none is connected
+*/
+static int
+swarm_churn (void)
+{
+    size_t attempt;
+
+    if (connectedCount == 0)
+      return -1;
+
+    for (attempt = 0; attempt < 64; ++ attempt)
+    {
+        SwarmClient * client = & clients [swarm_random () % options.clients];
+
+        if (client -> connected && ! client -> leaving)
+        {
+            client -> leaving = 1;
+            enet_peer_disconnect (client -> peer, 0);
+            ++ stats.churned;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+static int
+swarm_run (const ENetAddress * address)
+{
+    enet_uint64 clock = 0, tickInterval = 1000000 / options.tickRate, nextReport = 1000000, tick = 0;
+    enet_uint64 duration = (enet_uint64) options.duration * 1000000, connectCredit = 0, churnCredit = 0;
+    enet_uint64 lastMessages = 0, lastEchoes = 0;
+    enet_uint32 last = enet_time_get_us (), now, deadline;
+    size_t cursor = 0, i;
+
+    while (clock < duration)
+    {
+        now = enet_time_get_us ();
+        clock += (enet_uint32) (now - last);
+
+        /* Connections the handshake limit held back are not made up for later. */
+        connectCredit += (enet_uint64) options.connectRate * (enet_uint32) (now - last);
+        swarm_connect (address, (size_t) (connectCredit / 1000000));
+        connectCredit %= 1000000;
+
+        /* The distributions and the churn start once every client has connected, so that the
+           connection storm only weighs on the ramp-up. */
+        if (! steady && connectedCount == options.clients)
+        {
+            steady = 1;
+
+            enet_histogram_reset (& echoRoundTrips);
+            enet_histogram_reset (& serverLatencies);
+            swarm_reset_histograms (server);
+            for (i = 0; i < options.sockets; ++ i)
+              swarm_reset_histograms (hosts [i]);
+
+            printf ("all clients connected after %.3f s\n", (double) clock / 1000000.0);
+        }
+
+        if (steady)
+          churnCredit += (enet_uint64) options.churnRate * (enet_uint32) (now - last);
+        for (; churnCredit >= 1000000; churnCredit -= 1000000)
+          if (swarm_churn () < 0)
+          {
+              churnCredit = 0;
+              break;
+          }
+
+        last = now;
+
+        /* The tick of client k falls k / clients of the interval after the start of the tick. */
+        while (tick * tickInterval + cursor * tickInterval / options.clients <= clock)
+        {
+            SwarmClient * client = & clients [cursor];
+
+            if (client -> connected && ! client -> leaving)
+              swarm_send (client, (enet_uint32) cursor);
+
+            if (++ cursor >= options.clients)
+            {
+                cursor = 0;
+                ++ tick;
+            }
+        }
+
+        if (swarm_service () < 0)
+          return -1;
+
+        if (clock >= nextReport)
+        {
+            if (! options.quiet)
+              printf ("%5u s  connected %6u/%u  sent %8llu msg/s  echoed %8llu msg/s\n", (unsigned) (nextReport / 1000000),
+                      (unsigned) connectedCount, (unsigned) options.clients,
+                      (unsigned long long) (stats.sentMessages - lastMessages), (unsigned long long) (stats.echoes - lastEchoes));
+
+            lastMessages = stats.sentMessages;
+            lastEchoes = stats.echoes;
+            nextReport += 1000000;
+        }
+    }
+
+    /* Disconnect everybody, still echoing what arrives meanwhile, so that the disconnections
+       are reported to the server rather than timed out. */
+    stopping = 1;
+    for (i = 0; i < options.clients; ++ i)
+      if (clients [i].peer != NULL)
+      {
+          clients [i].leaving = 1;
+          enet_peer_disconnect (clients [i].peer, 0);
+
+          /* A connection still in progress is reset at once, without an event. */
+          if (! clients [i].connected)
+          {
+              clients [i].peer -> data = NULL;
+              clients [i].peer = NULL;
+              -- connectingCount;
+          }
+      }
+
+    deadline = enet_time_get () + SWARM_DRAIN_TIME;
+    while (connectedCount + connectingCount > 0 && ENET_TIME_LESS (enet_time_get (), deadline))
+      if (swarm_service () < 0)
+        return -1;
+
+    return 0;
+}
+
+static void
+swarm_usage (const char * program)
+{
+    fprintf (stderr,
+             "usage: %s [options] (--local | host:port)\n\n"
+             "  --local               run an echo server on loopback and report its latencies\n"
+             "  --clients count       simulated clients (1000)\n"
+             "  --sockets count       client sockets the clients share (one per %u clients)\n"
+             "  --rate hz             messages per second sent by each client (20)\n"
+             "  --size min[-max]      message size in bytes, at least %u (64)\n"
+             "  --reliable percent    share of reliable messages (50)\n"
+             "  --churn count         clients disconnecting and connecting again per second (0)\n"
+             "  --connect-rate count  connections started per second (1000)\n"
+             "  --duration seconds    length of the run, connection included (10)\n"
+             "  --seed value          seed of the random draws (1)\n"
+             "  --quiet               only print the final report\n",
+             program, (unsigned) SWARM_CLIENTS_PER_SOCKET, (unsigned) SWARM_MESSAGE_HEADER);
+}
+
+int
+main (int argc, char ** argv)
+{
+    ENetAddress address;
+    const char * target = NULL;
+    size_t i, peersPerSocket;
+    int argi, invalid = 0, result = 1;
+
+    options.clients = 1000;
+    options.tickRate = 20;
+    options.minimumSize = 64;
+    options.maximumSize = 64;
+    options.reliablePercent = 50;
+    options.connectRate = 1000;
+    options.duration = 10;
+    options.seed = 1;
+
+    for (argi = 1; argi < argc; ++ argi)
+    {
+        const char * value = argi + 1 < argc ? argv [argi + 1] : NULL;
+
+        if (strcmp (argv [argi], "--local") == 0)
+          options.local = 1;
+        else
+        if (strcmp (argv [argi], "--quiet") == 0)
+          options.quiet = 1;
+        else
+        if (value != NULL && strcmp (argv [argi], "--clients") == 0)
+          options.clients = (size_t) strtoul (argv [++ argi], NULL, 10);
+        else
+        if (value != NULL && strcmp (argv [argi], "--sockets") == 0)
+          options.sockets = (size_t) strtoul (argv [++ argi], NULL, 10);
+        else
+        if (value != NULL && strcmp (argv [argi], "--rate") == 0)
+          options.tickRate = (enet_uint32) strtoul (argv [++ argi], NULL, 10);
+        else
+        if (value != NULL && strcmp (argv [argi], "--size") == 0)
+        {
+            if (swarm_parse_range (argv [++ argi], & options.minimumSize, & options.maximumSize) < 0)
+              invalid = 1;
+        }
+        else
+        if (value != NULL && strcmp (argv [argi], "--reliable") == 0)
+          options.reliablePercent = (enet_uint32) strtoul (argv [++ argi], NULL, 10);
+        else
+        if (value != NULL && strcmp (argv [argi], "--churn") == 0)
+          options.churnRate = (enet_uint32) strtoul (argv [++ argi], NULL, 10);
+        else
+        if (value != NULL && strcmp (argv [argi], "--connect-rate") == 0)
+          options.connectRate = (enet_uint32) strtoul (argv [++ argi], NULL, 10);
+        else
+        if (value != NULL && strcmp (argv [argi], "--duration") == 0)
+          options.duration = (enet_uint32) strtoul (argv [++ argi], NULL, 10);
+        else
+        if (value != NULL && strcmp (argv [argi], "--seed") == 0)
+          options.seed = (enet_uint32) strtoul (argv [++ argi], NULL, 10);
+        else
+        if (argv [argi][0] != '-' && target == NULL)
+          target = argv [argi];
+        else
+          invalid = 1;
+    }
+
+    if (options.sockets == 0)
+      options.sockets = (options.clients + SWARM_CLIENTS_PER_SOCKET - 1) / SWARM_CLIENTS_PER_SOCKET;
+
+    if (invalid || (target == NULL) == ! options.local || options.clients == 0 || options.sockets == 0 || options.sockets > options.clients ||
+        options.tickRate == 0 || options.tickRate > 1000000 || options.reliablePercent > 100 || options.connectRate == 0 ||
+        options.duration == 0 || options.seed == 0)
+    {
+        swarm_usage (argv [0]);
+        return 2;
+    }
+
+    if (enet_initialize () != 0)
+    {
+        fprintf (stderr, "rcenet_swarm: cannot initialize the library\n");
+        return 1;
+    }
+
+    /* Peers stay in use while their disconnection completes, so leave room for the churn. */
+    peersPerSocket = (options.clients + options.sockets - 1) / options.sockets;
+    peersPerSocket += peersPerSocket / 8 + 64;
+
+    clients = (SwarmClient *) calloc (options.clients, sizeof (SwarmClient));
+    idleClients = (size_t *) malloc (options.clients * sizeof (size_t));
+    hosts = (ENetHost **) calloc (options.sockets, sizeof (ENetHost *));
+    if (clients == NULL || idleClients == NULL || hosts == NULL)
+    {
+        fprintf (stderr, "rcenet_swarm: out of memory\n");
+        goto done;
+    }
+
+    if (peersPerSocket > ENET_PROTOCOL_MAXIMUM_PEER_ID)
+    {
+        fprintf (stderr, "rcenet_swarm: more than %u clients per socket\n", (unsigned) ENET_PROTOCOL_MAXIMUM_PEER_ID);
+        goto done;
+    }
+
+    if (options.local)
+    {
+        enet_address_build_loopback (& address, ENET_ADDRESS_TYPE_IPV4);
+
+        server = enet_host_create (ENET_ADDRESS_TYPE_IPV4, & address, peersPerSocket * options.sockets, 2, 0, 0);
+        if (server == NULL || enet_host_set_histograms (server, 1) < 0)
+        {
+            fprintf (stderr, "rcenet_swarm: cannot create the local server\n");
+            goto done;
+        }
+
+        enet_socket_set_option (server -> socket, ENET_SOCKOPT_RCVBUF, SWARM_SOCKET_BUFFER_SIZE);
+        enet_socket_set_option (server -> socket, ENET_SOCKOPT_SNDBUF, SWARM_SOCKET_BUFFER_SIZE);
+
+        address = server -> address;
+    }
+    else
+    if (swarm_parse_address (target, & address) < 0)
+    {
+        fprintf (stderr, "rcenet_swarm: cannot resolve %s\n", target);
+        goto done;
+    }
+
+    for (i = 0; i < options.sockets; ++ i)
+    {
+        hosts [i] = enet_host_create (address.type, NULL, peersPerSocket, 2, 0, 0);
+        if (hosts [i] == NULL || enet_host_set_histograms (hosts [i], 1) < 0)
+        {
+            fprintf (stderr, "rcenet_swarm: cannot create client socket %u\n", (unsigned) i);
+            goto done;
+        }
+
+        enet_socket_set_option (hosts [i] -> socket, ENET_SOCKOPT_RCVBUF, SWARM_SOCKET_BUFFER_SIZE);
+        enet_socket_set_option (hosts [i] -> socket, ENET_SOCKOPT_SNDBUF, SWARM_SOCKET_BUFFER_SIZE);
+    }
+
+    for (i = 0; i < options.clients; ++ i)
+    {
+        clients [i].host = i % options.sockets;
+        idleClients [idleCount ++] = options.clients - 1 - i;
+    }
+
+    for (i = SWARM_MESSAGE_HEADER; i < sizeof (message); ++ i)
+      message [i] = (enet_uint8) (i * 131);
+
+    enet_histogram_reset (& echoRoundTrips);
+    enet_histogram_reset (& serverLatencies);
+
+    printf ("%u clients over %u sockets, %u Hz, %u-%u bytes, %u%% reliable, %u churn/s, %u s\n",
+            (unsigned) options.clients, (unsigned) options.sockets, (unsigned) options.tickRate,
+            (unsigned) options.minimumSize, (unsigned) options.maximumSize, (unsigned) options.reliablePercent,
+            (unsigned) options.churnRate, (unsigned) options.duration);
+
+    if (swarm_run (& address) < 0)
+    {
+        fprintf (stderr, "rcenet_swarm: servicing a host failed\n");
+        goto done;
+    }
+
+    if (! steady)
+      printf ("not every client connected: the distributions include the ramp-up\n");
+
+    printf ("connects %llu (%llu failed), churned %llu, dropped %llu\n",
+            (unsigned long long) stats.connects, (unsigned long long) stats.failedConnects,
+            (unsigned long long) stats.churned, (unsigned long long) stats.droppedClients);
+    printf ("sent %llu messages (%llu reliable, %llu bytes), %llu echoed\n",
+            (unsigned long long) stats.sentMessages, (unsigned long long) stats.sentReliable,
+            (unsigned long long) stats.sentBytes, (unsigned long long) stats.echoes);
+
+    if (server != NULL)
+    {
+        printf ("server received %llu messages\n", (unsigned long long) stats.serverMessages);
+        swarm_print_histogram ("server message latency", & serverLatencies, "us");
+        swarm_print_histogram ("server round trip time", enet_host_get_histogram (server, ENET_HISTOGRAM_ROUND_TRIP_TIME), "ms");
+        swarm_print_histogram ("server reliable delivery", enet_host_get_histogram (server, ENET_HISTOGRAM_DELIVERY_LATENCY), "ms");
+    }
+
+    swarm_print_histogram ("client echo round trip", & echoRoundTrips, "us");
+
+    for (i = 1; i < options.sockets; ++ i)
+      enet_histogram_merge (& hosts [0] -> histograms [ENET_HISTOGRAM_ROUND_TRIP_TIME], enet_host_get_histogram (hosts [i], ENET_HISTOGRAM_ROUND_TRIP_TIME));
+    swarm_print_histogram ("client round trip time", enet_host_get_histogram (hosts [0], ENET_HISTOGRAM_ROUND_TRIP_TIME), "ms");
+
+    result = 0;
+
+done:
+    for (i = 0; hosts != NULL && i < options.sockets; ++ i)
+      if (hosts [i] != NULL)
+        enet_host_destroy (hosts [i]);
+    if (server != NULL)
+      enet_host_destroy (server);
+
+    free (hosts);
+    free (idleClients);
+    free (clients);
+
+    enet_deinitialize ();
+
+    return result;
+}
@@ -0,0 +1,246 @@
+/**
+ @file  rcenet_trace.c
+ @brief Offline decoder of the trace files written by enet_host_trace_write
+
+ Prints the events of a trace file as text, one event per line, or with --chrome as a Chrome trace
+ (JSON) that chrome://tracing and Perfetto open, with one track per peer. Event times are written
+ as 32-bit microseconds in the file and are unwrapped here, so traces longer than 71 minutes keep
+ increasing times as long as no gap between two events reaches that length.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "rcenet/enet.h"
+
+static const char * const eventNames [ENET_TRACE_EVENT_COUNT] =
+{
+   "none",
+   "lost",
+   "datagram_receive",
+   "datagram_send",
+   "command_queue",
+   "command_send",
+   "retransmit",
+   "acknowledge",
+   "throttle",
+   "state"
+};
+
+static const char * const commandNames [ENET_PROTOCOL_COMMAND_COUNT] =
+{
+   "none",
+   "acknowledge",
+   "connect",
+   "verify_connect",
+   "disconnect",
+   "ping",
+   "send_reliable",
+   "send_unreliable",
+   "send_fragment",
+   "send_unsequenced",
+   "bandwidth_limit",
+   "throttle_configure",
+   "send_unreliable_fragment",
+   "fec_configure",
+   "send_parity"
+};
+
+static const char * const stateNames [] =
+{
+   "disconnected",
+   "connecting",
+   "acknowledging_connect",
+   "connection_pending",
+   "connection_succeeded",
+   "connected",
+   "disconnect_later",
+   "disconnecting",
+   "acknowledging_disconnect",
+   "zombie"
+};
+
+static const char *
+trace_name (const char * const * names, size_t count, enet_uint32 value)
+{
+    return value < count ? names [value] : "unknown";
+}
+
+static enet_uint16
+trace_get_16 (const enet_uint8 * data)
+{
+    return (enet_uint16) (data [0] | data [1] << 8);
+}
+
+static enet_uint32
+trace_get_32 (const enet_uint8 * data)
+{
+    return (enet_uint32) data [0] | (enet_uint32) data [1] << 8 | (enet_uint32) data [2] << 16 | (enet_uint32) data [3] << 24;
+}
+
+/** Writes the arguments of an event, as "name=value" pairs or as the members of a JSON object. */
+static void
+trace_print_arguments (const ENetTraceEvent * event, int chrome)
+{
+    const char * format = chrome ? "\"%s\":%lu" : " %s=%lu";
+    const char * stringFormat = chrome ? "\"%s\":\"%s\"" : " %s=%s";
+    const char * separator = chrome ? "," : "";
+
+    switch (event -> type)
+    {
+    case ENET_TRACE_EVENT_LOST:
+       printf (format, "events", (unsigned long) event -> value);
+       break;
+
+    case ENET_TRACE_EVENT_DATAGRAM_RECEIVE:
+       printf (format, "length", (unsigned long) event -> value);
+       printf ("%s", separator);
+       printf (format, "decoded", (unsigned long) event -> extra);
+       break;
+
+    case ENET_TRACE_EVENT_DATAGRAM_SEND:
+       printf (format, "length", (unsigned long) event -> value);
+       printf ("%s", separator);
+       printf (format, "commands", (unsigned long) event -> detail);
+       break;
+
+    case ENET_TRACE_EVENT_COMMAND_QUEUE:
+    case ENET_TRACE_EVENT_COMMAND_SEND:
+    case ENET_TRACE_EVENT_ACKNOWLEDGE:
+       printf (stringFormat, "command", trace_name (commandNames, ENET_PROTOCOL_COMMAND_COUNT, event -> detail));
+       printf ("%s", separator);
+       printf (format, "channel", (unsigned long) (event -> value >> 16));
+       printf ("%s", separator);
+       printf (format, "sequence", (unsigned long) (event -> value & 0xFFFF));
+       printf ("%s", separator);
+       printf (format, event -> type == ENET_TRACE_EVENT_ACKNOWLEDGE ? "rtt" : "length", (unsigned long) event -> extra);
+       break;
+
+    case ENET_TRACE_EVENT_RETRANSMIT:
+       printf (stringFormat, "kind", event -> detail ? "fast" : "timeout");
+       printf ("%s", separator);
+       printf (format, "channel", (unsigned long) (event -> value >> 16));
+       printf ("%s", separator);
+       printf (format, "sequence", (unsigned long) (event -> value & 0xFFFF));
+       printf ("%s", separator);
+       printf (format, "attempts", (unsigned long) event -> extra);
+       break;
+
+    case ENET_TRACE_EVENT_THROTTLE:
+       printf (format, "throttle", (unsigned long) event -> value);
+       printf ("%s", separator);
+       printf (format, "previous", (unsigned long) event -> extra);
+       break;
+
+    case ENET_TRACE_EVENT_STATE:
+       printf (stringFormat, "state", trace_name (stateNames, sizeof (stateNames) / sizeof (stateNames [0]), event -> detail));
+       printf ("%s", separator);
+       printf (stringFormat, "previous", trace_name (stateNames, sizeof (stateNames) / sizeof (stateNames [0]), event -> value));
+       break;
+
+    default:
+       printf (format, "detail", (unsigned long) event -> detail);
+       printf ("%s", separator);
+       printf (format, "value", (unsigned long) event -> value);
+       printf ("%s", separator);
+       printf (format, "extra", (unsigned long) event -> extra);
+       break;
+    }
+}
+
+static void
+trace_print_event (const ENetTraceEvent * event, double time, int chrome, int first)
+{
+    const char * name = trace_name (eventNames, ENET_TRACE_EVENT_COUNT, event -> type);
+
+    if (chrome)
+    {
+        printf ("%s\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.0f,\"pid\":1,\"tid\":%u,\"args\":{",
+                first ? "" : ",", name, time, (unsigned) event -> peerID);
+        trace_print_arguments (event, 1);
+        printf ("}}");
+    }
+    else
+    {
+        if (event -> peerID == ENET_PROTOCOL_MAXIMUM_PEER_ID)
+          printf ("%14.6f     - %-16s", time / 1000000.0, name);
+        else
+          printf ("%14.6f %5u %-16s", time / 1000000.0, (unsigned) event -> peerID, name);
+        trace_print_arguments (event, 0);
+        printf ("\n");
+    }
+}
+
+int
+main (int argc, char ** argv)
+{
+    enet_uint8 data [ENET_TRACE_FILE_HEADER_SIZE > ENET_TRACE_EVENT_SIZE ? ENET_TRACE_FILE_HEADER_SIZE : ENET_TRACE_EVENT_SIZE];
+    const char * fileName = NULL;
+    double time = 0.0;
+    enet_uint32 lastTime = 0;
+    size_t eventCount = 0;
+    int chrome = 0, argi;
+    FILE * file;
+
+    for (argi = 1; argi < argc; ++ argi)
+    {
+        if (strcmp (argv [argi], "--chrome") == 0)
+          chrome = 1;
+        else
+        if (fileName == NULL)
+          fileName = argv [argi];
+        else
+          fileName = NULL, argi = argc;
+    }
+
+    if (fileName == NULL)
+    {
+        fprintf (stderr, "usage: %s [--chrome] trace-file\n", argv [0]);
+        return 2;
+    }
+
+    file = fopen (fileName, "rb");
+    if (file == NULL)
+    {
+        fprintf (stderr, "rcenet_trace: cannot open %s\n", fileName);
+        return 1;
+    }
+
+    if (fread (data, ENET_TRACE_FILE_HEADER_SIZE, 1, file) != 1 ||
+        memcmp (data, "RCETRACE", 8) != 0 ||
+        trace_get_16 (& data [8]) != ENET_TRACE_FILE_VERSION ||
+        trace_get_16 (& data [10]) != ENET_TRACE_EVENT_SIZE)
+    {
+        fprintf (stderr, "rcenet_trace: %s is not a version %u trace file\n", fileName, (unsigned) ENET_TRACE_FILE_VERSION);
+        fclose (file);
+        return 1;
+    }
+
+    if (chrome)
+      printf ("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    while (fread (data, ENET_TRACE_EVENT_SIZE, 1, file) == 1)
+    {
+        ENetTraceEvent event;
+
+        event.time = trace_get_32 (& data [0]);
+        event.type = data [4];
+        event.detail = data [5];
+        event.peerID = trace_get_16 (& data [6]);
+        event.value = trace_get_32 (& data [8]);
+        event.extra = trace_get_32 (& data [12]);
+
+        if (eventCount > 0)
+          time += (double) (enet_uint32) (event.time - lastTime);
+        lastTime = event.time;
+
+        trace_print_event (& event, time, chrome, eventCount == 0);
+
+        ++ eventCount;
+    }
+
+    if (chrome)
+      printf ("\n]}\n");
+
+    fclose (file);
+
+    return 0;
+}
@@ -49,12 +49,19 @@ end
 
 add_includedirs("include")
 
+-- Points de trace du protocole (activés par défaut) : xmake f --trace=n les retire à la compilation
+option("trace", { default = true, showmenu = true, description = "Compiler les points de trace du protocole (enet_host_trace_enable)" })
+
 target("rcenet", function ()
     set_kind("$(kind)")
 
     add_headerfiles("include/(rcenet/*.h)")
     add_files("src/*.c")
 
+    if not has_config("trace") then
+        add_defines("ENET_NO_TRACE=1")
+    end
+
     if is_kind("shared") then
         add_defines("ENET_DLL", { public = true })
     end
@@ -78,3 +85,37 @@ target("rcenet", function ()
             "socklen_t")
     end
 end)
+
+-- Benchmarks (désactivés par défaut) : xmake f --benchmarks=y
+option("benchmarks", { default = false, showmenu = true, description = "Construire l'exécutable de benchmarks rcenet_bench" })
+
+if has_config("benchmarks") then
+    target("rcenet_bench", function ()
+        set_kind("binary")
+        add_deps("rcenet")
+        add_includedirs("bench")
+        add_files("bench/*.c")
+    end)
+end
+
+-- Outils (désactivés par défaut) : xmake f --tools=y
+option("tools", { default = false, showmenu = true, description = "Construire les outils rcenet_trace, rcenet_replay et rcenet_swarm" })
+
+if has_config("tools") then
+    target("rcenet_trace", function ()
+        set_kind("binary")
+        add_files("tools/rcenet_trace.c")
+    end)
+
+    target("rcenet_replay", function ()
+        set_kind("binary")
+        add_deps("rcenet")
+        add_files("tools/rcenet_replay.c")
+    end)
+
+    target("rcenet_swarm", function ()
+        set_kind("binary")
+        add_deps("rcenet")
+        add_files("tools/rcenet_swarm.c")
+    end)
+end